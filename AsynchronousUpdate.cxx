@@ -0,0 +1,268 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkGeodesicDistanceMapImageFilter.h"
+#include "itkAsynchronousUpdater.h"
+#include "itkCommand.h"
+
+// Cancel the job once the process object reached a given progress.
+struct CancelState
+  {
+  itk::AsynchronousUpdater* Updater;
+  float                     CancelAt;
+  };
+
+void OnProgress( itk::Object* caller, const itk::EventObject&, void* clientData )
+{
+  CancelState* state = static_cast< CancelState* >( clientData );
+  const float progress = static_cast< itk::ProcessObject* >( caller )->GetProgress();
+
+  if( progress >= state->CancelAt )
+    {
+    state->Updater->Cancel();
+    }
+}
+
+// Cancel the job as soon as its update starts, before the process object
+// resets its abort flag.
+void OnStart( itk::Object*, const itk::EventObject&, void* clientData )
+{
+  static_cast< CancelState* >( clientData )->Updater->Cancel();
+}
+
+// With one job at a time: the first job holds its first progress event
+// until the third one is cancelled, and checks that the second one is
+// still queued.
+struct QueueState
+  {
+  itk::AsynchronousUpdater* Others[2];
+  bool                      OthersQueued;
+  itk::AsynchronousUpdater* Previous;
+  bool                      StartedAfterPrevious;
+  unsigned int              NumberOfStarts;
+  };
+
+void OnFirstProgress( itk::Object*, const itk::EventObject&, void* clientData )
+{
+  QueueState* state = static_cast< QueueState* >( clientData );
+  if( state->Others[0] )
+    {
+    while( state->Others[1]->GetStatus() != itk::AsynchronousUpdater::Cancelled )
+      {
+      }
+    state->OthersQueued = ( state->Others[0]->GetStatus() == itk::AsynchronousUpdater::Queued );
+    state->Others[0] = 0;
+    }
+}
+
+void OnQueuedStart( itk::Object*, const itk::EventObject&, void* clientData )
+{
+  QueueState* state = static_cast< QueueState* >( clientData );
+  ++state->NumberOfStarts;
+  state->StartedAfterPrevious = ( state->Previous->GetStatus() == itk::AsynchronousUpdater::Completed );
+}
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  typedef unsigned char PixelType;
+  const unsigned int Dimension = 2;
+
+  typedef itk::Image< PixelType, Dimension > ImageType;
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+
+  typedef double                                                              WeightType;
+
+  typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::undirectedS,
+    boost::no_property, boost::property< boost::edge_weight_t, WeightType > > GraphType;
+
+  typedef itk::IndexMetric< ImageType, WeightType >                           MetricType;
+  typedef itk::ImageBoostGraphAdaptor< ImageType, GraphType, MetricType >     AdaptorType;
+
+  std::vector< AdaptorType::NeighborhoodIteratorOffsetType > offset;
+  for( int i = -1; i <= 1; ++i )
+    {
+    for( int j = -1; j <= 1; ++j )
+      {
+      if( i != 0 || j != 0 )
+        {
+        AdaptorType::NeighborhoodIteratorOffsetType o;
+        o[0] = i;
+        o[1] = j;
+        offset.push_back( o );
+        }
+      }
+    }
+
+  AdaptorType::Pointer adaptor = AdaptorType::New();
+  adaptor->SetInput( input );
+  adaptor->SetNeighbors( offset );
+
+  itk::AsynchronousUpdater::Pointer updater = itk::AsynchronousUpdater::New();
+  updater->SetProcessObject( adaptor );
+  updater->SetNumberOfThreads( 2 );
+
+  CancelState state;
+  state.Updater       = updater;
+  state.CancelAt      = 0.3f;
+
+  itk::CStyleCommand::Pointer command = itk::CStyleCommand::New();
+  command->SetCallback( OnProgress );
+  command->SetClientData( &state );
+  adaptor->AddObserver( itk::ProgressEvent(), command );
+
+  // Cancelled build: the partial graph is freed.
+  updater->Start();
+
+  if( updater->Wait() || updater->GetStatus() != itk::AsynchronousUpdater::Cancelled )
+    {
+    std::cerr << "build was not cancelled" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( num_vertices( adaptor->GetOutput() ) != 0 )
+    {
+    std::cerr << num_vertices( adaptor->GetOutput() ) << " vertices left" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Cancelled before the build started.
+  itk::CStyleCommand::Pointer startCommand = itk::CStyleCommand::New();
+  startCommand->SetCallback( OnStart );
+  startCommand->SetClientData( &state );
+  const unsigned long startTag = adaptor->AddObserver( itk::StartEvent(), startCommand );
+
+  state.CancelAt = 2.f;
+  adaptor->Modified();
+  updater->Start();
+
+  if( updater->Wait() || updater->GetStatus() != itk::AsynchronousUpdater::Cancelled )
+    {
+    std::cerr << "build was not cancelled at its start" << std::endl;
+    return EXIT_FAILURE;
+    }
+  adaptor->RemoveObserver( startTag );
+
+  // Complete build
+  updater->Start();
+
+  if( !updater->Wait() || updater->GetProgress() != 1.f )
+    {
+    std::cerr << "build did not complete" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( num_edges( adaptor->GetOutput() ) != adaptor->ComputeNumberOfEdges() )
+    {
+    std::cerr << "edges: " << num_edges( adaptor->GetOutput() ) << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Cancelled filter: its outputs are released.
+  typedef itk::Image< double, Dimension >                                     DistanceImageType;
+  typedef itk::GeodesicDistanceMapImageFilter< ImageType, DistanceImageType > FilterType;
+
+  ImageType::IndexType seed;
+  seed[0] = 320;
+  seed[1] = 240;
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( input );
+  filter->SetNeighbors( offset );
+  filter->AddSeed( seed, 1 );
+
+  itk::AsynchronousUpdater::Pointer filterUpdater = itk::AsynchronousUpdater::New();
+  filterUpdater->SetProcessObject( filter );
+
+  CancelState filterState;
+  filterState.Updater       = filterUpdater;
+  filterState.CancelAt      = 0.5f;
+
+  itk::CStyleCommand::Pointer filterCommand = itk::CStyleCommand::New();
+  filterCommand->SetCallback( OnProgress );
+  filterCommand->SetClientData( &filterState );
+  filter->AddObserver( itk::ProgressEvent(), filterCommand );
+
+  filterUpdater->Start();
+
+  if( filterUpdater->Wait() ||
+      filter->GetDistanceMap()->GetBufferedRegion().GetNumberOfPixels() != 0 )
+    {
+    std::cerr << "filter was not cancelled" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // One job at a time: the others are queued, run in order, and a queued
+  // job is cancelled without starting.
+  itk::AsynchronousUpdater::SetGlobalMaximumNumberOfJobs( 1 );
+
+  AdaptorType::Pointer queuedAdaptors[3];
+  itk::AsynchronousUpdater::Pointer queued[3];
+  for( unsigned int i = 0; i < 3; ++i )
+    {
+    queuedAdaptors[i] = AdaptorType::New();
+    queuedAdaptors[i]->SetInput( input );
+    queuedAdaptors[i]->SetNeighbors( offset );
+    queued[i] = itk::AsynchronousUpdater::New();
+    queued[i]->SetProcessObject( queuedAdaptors[i] );
+    }
+
+  QueueState queueState;
+  queueState.Others[0]            = queued[1];
+  queueState.Others[1]            = queued[2];
+  queueState.OthersQueued         = false;
+  queueState.Previous             = queued[0];
+  queueState.StartedAfterPrevious = false;
+  queueState.NumberOfStarts       = 0;
+
+  itk::CStyleCommand::Pointer holdCommand = itk::CStyleCommand::New();
+  holdCommand->SetCallback( OnFirstProgress );
+  holdCommand->SetClientData( &queueState );
+  queuedAdaptors[0]->AddObserver( itk::ProgressEvent(), holdCommand );
+
+  itk::CStyleCommand::Pointer queuedStartCommand = itk::CStyleCommand::New();
+  queuedStartCommand->SetCallback( OnQueuedStart );
+  queuedStartCommand->SetClientData( &queueState );
+  queuedAdaptors[1]->AddObserver( itk::StartEvent(), queuedStartCommand );
+  queuedAdaptors[2]->AddObserver( itk::StartEvent(), queuedStartCommand );
+
+  for( unsigned int i = 0; i < 3; ++i )
+    {
+    queued[i]->Start();
+    }
+  queued[2]->Cancel();
+
+  if( queued[2]->Wait() || queued[2]->GetStatus() != itk::AsynchronousUpdater::Cancelled ||
+      !queued[0]->Wait() || !queued[1]->Wait() )
+    {
+    std::cerr << "queued jobs: " << queued[0]->GetStatus() << " " << queued[1]->GetStatus() << " "
+              << queued[2]->GetStatus() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( !queueState.OthersQueued || !queueState.StartedAfterPrevious || queueState.NumberOfStarts != 1 )
+    {
+    std::cerr << "jobs were not queued: " << queueState.OthersQueued << " "
+              << queueState.StartedAfterPrevious << " " << queueState.NumberOfStarts << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( queued[1]->GetProgress() != 1.f || queued[2]->GetProgress() != 0.f )
+    {
+    std::cerr << "progress: " << queued[1]->GetProgress() << " " << queued[2]->GetProgress() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::cout << "SUCCESS!" << std::endl;
+  return EXIT_SUCCESS;
+}
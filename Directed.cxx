@@ -47,7 +47,7 @@ int main( int argc, char* argv[] )
   adaptor->Update();
 
   typedef AdaptorType::GraphType GraphType;
-  GraphType graph = adaptor->GetOutput();
+  const GraphType& graph = adaptor->GetOutput();
 
   ImageType::RegionType region = input->GetLargestPossibleRegion();
 
@@ -0,0 +1,148 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageBoostGraphAdaptor.h"
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  typedef unsigned char PixelType;
+  const unsigned int Dimension = 2;
+
+  typedef itk::Image< PixelType, Dimension > ImageType;
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+
+  typedef double                                                              WeightType;
+
+  typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::undirectedS,
+    boost::no_property, boost::property< boost::edge_weight_t, WeightType > > GraphType;
+
+  typedef itk::IndexMetric< ImageType, WeightType >                           MetricType;
+  typedef itk::ImageBoostGraphAdaptor< ImageType, GraphType, MetricType >     AdaptorType;
+
+  std::vector< AdaptorType::NeighborhoodIteratorOffsetType > offset( 8 );
+
+  size_t k = 0;
+  offset[k][0] = -1;
+  offset[k][1] = -1;
+  k++;
+
+  offset[k][0] = -1;
+  offset[k][1] = 0;
+  k++;
+
+  offset[k][0] = -1;
+  offset[k][1] = 1;
+  k++;
+
+  offset[k][0] = 0;
+  offset[k][1] = -1;
+  k++;
+
+  offset[k][0] = 0;
+  offset[k][1] = 1;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = -1;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = 0;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = 1;
+  k++;
+
+
+  AdaptorType::Pointer adaptor = AdaptorType::New();
+  adaptor->SetInput( input );
+  adaptor->SetNeighbors( offset );
+  adaptor->Update();
+
+  typedef AdaptorType::GraphType       GraphType;
+  typedef AdaptorType::ExportIndexType ExportIndexType;
+  typedef AdaptorType::CSRMatrixType   CSRMatrixType;
+
+  const GraphType& graph = adaptor->GetOutput();
+
+  // COO: each undirected edge once.
+  const itk::SizeValueType numberOfEdges = adaptor->ComputeNumberOfEdges();
+
+  if( numberOfEdges != num_edges( graph ) )
+    {
+    std::cerr << "number of edges: " << numberOfEdges << " != " << num_edges( graph ) << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::vector< ExportIndexType > sources( numberOfEdges );
+  std::vector< ExportIndexType > targets( numberOfEdges );
+  std::vector< WeightType >      weights( numberOfEdges );
+
+  if( adaptor->ExportCOO( &sources[0], &targets[0], &weights[0] ) != numberOfEdges )
+    {
+    return EXIT_FAILURE;
+    }
+
+  for( itk::SizeValueType i = 0; i < numberOfEdges; ++i )
+    {
+    std::pair< AdaptorType::EdgeDescriptorType, bool > e = edge( sources[i], targets[i], graph );
+
+    if( !e.second || get( boost::edge_weight, graph, e.first ) != weights[i] )
+      {
+      std::cerr << "COO edge " << sources[i] << " - " << targets[i] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // CSR: adjacency matrix, symmetric.
+  CSRMatrixType matrix;
+  adaptor->ExportCSR( matrix );
+
+  if( matrix.GetNumberOfRows() != num_vertices( graph ) ||
+      matrix.GetNumberOfEntries() != 2 * num_edges( graph ) )
+    {
+    std::cerr << "CSR size: " << matrix.GetNumberOfRows() << " rows, "
+              << matrix.GetNumberOfEntries() << " entries" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  for( ExportIndexType u = 0; u < matrix.GetNumberOfRows(); ++u )
+    {
+    const ExportIndexType rowStart = matrix.GetRowPointers()[u];
+    const ExportIndexType rowEnd = matrix.GetRowPointers()[u + 1];
+
+    if( rowEnd - rowStart != out_degree( u, graph ) )
+      {
+      std::cerr << "CSR row " << u << ": " << rowEnd - rowStart
+                << " != " << out_degree( u, graph ) << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    for( ExportIndexType e = rowStart; e < rowEnd; ++e )
+      {
+      std::pair< AdaptorType::EdgeDescriptorType, bool > edgePair =
+        edge( u, matrix.GetColumns()[e], graph );
+
+      if( !edgePair.second || get( boost::edge_weight, graph, edgePair.first ) != matrix.GetValues()[e] )
+        {
+        std::cerr << "CSR entry " << u << ", " << matrix.GetColumns()[e] << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  std::cout << numberOfEdges << " edges" << std::endl;
+  std::cout << "SUCCESS!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,153 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkGeodesicDistanceMapImageFilter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  typedef unsigned char PixelType;
+  const unsigned int Dimension = 2;
+
+  typedef itk::Image< PixelType, Dimension > ImageType;
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+
+  typedef double                                                              WeightType;
+  typedef itk::Image< WeightType, Dimension >                                 DistanceImageType;
+  typedef itk::Image< unsigned short, Dimension >                             LabelImageType;
+  typedef itk::IndexMetric< ImageType, WeightType >                           MetricType;
+
+  typedef itk::GeodesicDistanceMapImageFilter< ImageType, DistanceImageType,
+    LabelImageType, MetricType >                                              FilterType;
+
+  std::vector< ImageType::OffsetType > offset( 8 );
+
+  size_t k = 0;
+  offset[k][0] = -1;
+  offset[k][1] = -1;
+  k++;
+
+  offset[k][0] = -1;
+  offset[k][1] = 0;
+  k++;
+
+  offset[k][0] = -1;
+  offset[k][1] = 1;
+  k++;
+
+  offset[k][0] = 0;
+  offset[k][1] = -1;
+  k++;
+
+  offset[k][0] = 0;
+  offset[k][1] = 1;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = -1;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = 0;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = 1;
+  k++;
+
+  ImageType::IndexType idx1, idx2;
+  idx1[0] = 320;
+  idx1[1] = 240;
+
+  idx2[0] = 160;
+  idx2[1] = 120;
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( input );
+  filter->SetNeighbors( offset );
+  filter->AddSeed( idx1, 1 );
+  filter->AddSeed( idx2, 2 );
+  filter->Update();
+
+  DistanceImageType::Pointer      distances     = filter->GetDistanceMap();
+  LabelImageType::Pointer         labels        = filter->GetVoronoiMap();
+  FilterType::PredecessorImageType::Pointer predecessors = filter->GetPredecessorMap();
+
+  if( distances->GetPixel( idx1 ) != 0. || distances->GetPixel( idx2 ) != 0. )
+    {
+    std::cerr << "seeds are not at distance 0" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  MetricType metric;
+  ImageType::RegionType region = input->GetLargestPossibleRegion();
+
+  typedef itk::ImageRegionConstIteratorWithIndex< DistanceImageType > IteratorType;
+  IteratorType it( distances, region );
+
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    ImageType::IndexType idx = it.GetIndex();
+    unsigned short label = labels->GetPixel( idx );
+
+    if( label != 1 && label != 2 )
+      {
+      std::cerr << "label[ " << idx << " ] = " << label << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    if( ( idx[0] % 16 != 0 ) || ( idx[1] % 16 != 0 ) )
+      {
+      continue;
+      }
+
+    // Walk back along the predecessors: the path ends on the seed of the same
+    // label and its length is the distance.
+    double totalDistance = 0.;
+    ImageType::IndexType current = idx;
+    ImageType::OffsetType step = predecessors->GetPixel( current );
+
+    while( step[0] != 0 || step[1] != 0 )
+      {
+      ImageType::IndexType previous = current + step;
+      if( labels->GetPixel( previous ) != label )
+        {
+        std::cerr << "label changes along the path from " << idx << std::endl;
+        return EXIT_FAILURE;
+        }
+      totalDistance += metric.Evaluate( input, previous, current );
+      current = previous;
+      step = predecessors->GetPixel( current );
+      }
+
+    if( current != ( label == 1 ? idx1 : idx2 ) )
+      {
+      std::cerr << "path from " << idx << " ends at " << current << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    if( totalDistance != it.Get() )
+      {
+      std::cerr << "distance[ " << idx << " ] = " << it.Get()
+                << " != " << totalDistance << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  ImageType::IndexType origin;
+  origin.Fill( 0 );
+
+  std::cout << "Distance: " << distances->GetPixel( origin ) << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,277 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkGraphConnectedComponentImageFilter.h"
+#include "itkGraphBreadthFirstDistanceImageFilter.h"
+
+#include <deque>
+
+// Sequential breadth-first search from the seeds, or, without seeds, flood
+// fill of each component from its first pixel in raster order.
+template< class TImage, class TOutputImage >
+unsigned int Reference( const TImage* iImage,
+                        const std::vector< typename TImage::OffsetType >& iOffsets,
+                        double iMaximumWeight,
+                        const std::vector< typename TImage::IndexType >& iSeeds,
+                        TOutputImage* oOutput )
+{
+  typedef typename TImage::IndexType                IndexType;
+  typedef typename TOutputImage::PixelType          OutputPixelType;
+
+  const typename TImage::RegionType region = iImage->GetLargestPossibleRegion();
+  const OutputPixelType unset = itk::NumericTraits< OutputPixelType >::max();
+  oOutput->FillBuffer( unset );
+
+  std::deque< IndexType > queue;
+  unsigned int count = 0;
+
+  itk::ImageRegionIteratorWithIndex< TOutputImage > it( oOutput, region );
+  for( it.GoToBegin(); !it.IsAtEnd() || !queue.empty(); )
+    {
+    if( queue.empty() )
+      {
+      if( !iSeeds.empty() )
+        {
+        if( count > 0 )
+          {
+          break;
+          }
+        for( size_t s = 0; s < iSeeds.size(); ++s )
+          {
+          if( oOutput->GetPixel( iSeeds[ s ] ) == unset )
+            {
+            oOutput->SetPixel( iSeeds[ s ], 0 );
+            queue.push_back( iSeeds[ s ] );
+            }
+          }
+        count = 1;
+        continue;
+        }
+      if( it.Get() == unset )
+        {
+        it.Set( ++count );
+        queue.push_back( it.GetIndex() );
+        }
+      ++it;
+      continue;
+      }
+
+    const IndexType index = queue.front();
+    queue.pop_front();
+
+    for( int sign = -1; sign <= 1; sign += 2 )
+      {
+      for( size_t k = 0; k < iOffsets.size(); ++k )
+        {
+        IndexType neighIndex = index;
+        for( unsigned int dim = 0; dim < TImage::ImageDimension; ++dim )
+          {
+          neighIndex[ dim ] += sign * iOffsets[ k ][ dim ];
+          }
+        if( !region.IsInside( neighIndex ) || oOutput->GetPixel( neighIndex ) != unset )
+          {
+          continue;
+          }
+        const double d = static_cast< double >( iImage->GetPixel( index ) ) - iImage->GetPixel( neighIndex );
+        if( d * d <= iMaximumWeight )
+          {
+          oOutput->SetPixel( neighIndex, iSeeds.empty() ?
+            oOutput->GetPixel( index ) : oOutput->GetPixel( index ) + 1 );
+          queue.push_back( neighIndex );
+          }
+        }
+      }
+    }
+  return count;
+}
+
+template< class TImage >
+bool Equal( const TImage* iA, const TImage* iB )
+{
+  const itk::SizeValueType n = iA->GetBufferedRegion().GetNumberOfPixels();
+  return std::equal( iA->GetBufferPointer(), iA->GetBufferPointer() + n, iB->GetBufferPointer() );
+}
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  typedef unsigned char PixelType;
+  const unsigned int Dimension = 2;
+
+  typedef itk::Image< PixelType, Dimension >      ImageType;
+  typedef itk::Image< unsigned int, Dimension >   LabelImageType;
+  typedef itk::ImageFileReader< ImageType >       ReaderType;
+
+  typedef itk::GraphConnectedComponentImageFilter< ImageType, LabelImageType >    ComponentFilterType;
+  typedef itk::GraphBreadthFirstDistanceImageFilter< ImageType, LabelImageType >  DistanceFilterType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+  const ImageType::RegionType region = input->GetLargestPossibleRegion();
+
+  // 8-connectivity, the opposite offsets being implied
+  std::vector< ImageType::OffsetType > offset( 4 );
+  offset[0][0] = 1;
+  offset[0][1] = 0;
+  offset[1][0] = 0;
+  offset[1][1] = 1;
+  offset[2][0] = 1;
+  offset[2][1] = 1;
+  offset[3][0] = 1;
+  offset[3][1] = -1;
+
+  // Edges between pixels differing by at most 6 gray levels
+  const double maximumWeight = 36.;
+
+  LabelImageType::Pointer expected = LabelImageType::New();
+  expected->SetRegions( region );
+  expected->Allocate();
+
+  const unsigned int numberOfComponents = Reference( input.GetPointer(), offset, maximumWeight,
+                                                     std::vector< ImageType::IndexType >(), expected.GetPointer() );
+  std::cout << numberOfComponents << " components" << std::endl;
+
+  const unsigned int threads[] = { 1, 2, 3, 8 };
+  for( unsigned int i = 0; i < 4; ++i )
+    {
+    ComponentFilterType::Pointer components = ComponentFilterType::New();
+    components->SetInput( input );
+    components->SetNeighbors( offset );
+    components->SetMaximumWeight( maximumWeight );
+    components->SetNumberOfThreads( threads[ i ] );
+    components->Update();
+
+    if( components->GetNumberOfComponents() != numberOfComponents ||
+        !Equal( components->GetOutput(), expected.GetPointer() ) )
+      {
+      std::cerr << "components differ with " << threads[ i ] << " threads: "
+                << components->GetNumberOfComponents() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Distances from one seed: the search only goes top-down on a grid
+  std::vector< ImageType::IndexType > seeds( 1 );
+  seeds[0][0] = region.GetSize()[0] / 2;
+  seeds[0][1] = region.GetSize()[1] / 2;
+
+  Reference( input.GetPointer(), offset, maximumWeight, seeds, expected.GetPointer() );
+
+  for( unsigned int i = 0; i < 4; ++i )
+    {
+    DistanceFilterType::Pointer distances = DistanceFilterType::New();
+    distances->SetInput( input );
+    distances->SetNeighbors( offset );
+    distances->SetMaximumWeight( maximumWeight );
+    distances->AddSeed( seeds[0] );
+    distances->SetNumberOfThreads( threads[ i ] );
+    distances->Update();
+
+    if( !Equal( distances->GetOutput(), expected.GetPointer() ) )
+      {
+      std::cerr << "distances differ with " << threads[ i ] << " threads" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Distances from a grid of seeds, without threshold: the frontier soon
+  // holds most unvisited pixels and the search goes bottom-up.
+  ImageType::Pointer seedImage = ImageType::New();
+  seedImage->SetRegions( region );
+  seedImage->Allocate();
+  seedImage->FillBuffer( 0 );
+
+  seeds.clear();
+  itk::ImageRegionIteratorWithIndex< ImageType > seedIt( seedImage, region );
+  for( seedIt.GoToBegin(); !seedIt.IsAtEnd(); ++seedIt )
+    {
+    if( seedIt.GetIndex()[0] % 8 == 0 && seedIt.GetIndex()[1] % 8 == 0 )
+      {
+      seedIt.Set( 1 );
+      seeds.push_back( seedIt.GetIndex() );
+      }
+    }
+
+  Reference( input.GetPointer(), offset, 1e30, seeds, expected.GetPointer() );
+
+  for( unsigned int i = 0; i < 4; ++i )
+    {
+    DistanceFilterType::Pointer distances = DistanceFilterType::New();
+    distances->SetInput( input );
+    distances->SetSeedImage( seedImage );
+    distances->SetNeighbors( offset );
+    distances->SetNumberOfThreads( threads[ i ] );
+    distances->Update();
+
+    std::cout << distances->GetNumberOfLevels() << " levels, "
+              << distances->GetNumberOfBottomUpLevels() << " bottom-up" << std::endl;
+
+    if( !Equal( distances->GetOutput(), expected.GetPointer() ) ||
+        distances->GetNumberOfBottomUpLevels() == 0 )
+      {
+      std::cerr << "distances differ with " << threads[ i ] << " threads" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // The same traversals on the graph of the adaptor, through its CSR export
+  typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::undirectedS,
+    boost::no_property, boost::property< boost::edge_weight_t, double > >     GraphType;
+  typedef itk::IndexMetric< ImageType, double >                               MetricType;
+  typedef itk::ImageBoostGraphAdaptor< ImageType, GraphType, MetricType >     AdaptorType;
+  typedef AdaptorType::CSRMatrixType                                          CSRMatrixType;
+  typedef itk::CompressedSparseRowNeighborhood< double >                      NeighborhoodType;
+  typedef itk::ParallelGraphTraversal< NeighborhoodType >                     TraversalType;
+
+  AdaptorType::Pointer adaptor = AdaptorType::New();
+  adaptor->SetInput( input );
+  adaptor->SetNeighbors( offset );
+
+  CSRMatrixType matrix;
+  adaptor->ExportCSR( matrix );
+
+  TraversalType traversal;
+  traversal.SetNumberOfThreads( 4 );
+
+  LabelImageType::Pointer labels = adaptor->CreateVertexImage< LabelImageType >();
+  traversal.ComputeConnectedComponents(
+    NeighborhoodType( &matrix, itk::WeightThresholdPredicate< double >( maximumWeight ) ),
+    labels->GetBufferPointer() );
+
+  Reference( input.GetPointer(), offset, maximumWeight,
+             std::vector< ImageType::IndexType >(), expected.GetPointer() );
+
+  if( traversal.GetNumberOfComponents() != numberOfComponents || !Equal( labels.GetPointer(), expected.GetPointer() ) )
+    {
+    std::cerr << "components of the adaptor graph differ" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  TraversalType::VertexContainerType vertices;
+  for( size_t s = 0; s < seeds.size(); ++s )
+    {
+    vertices.push_back( input->ComputeOffset( seeds[ s ] ) );
+    }
+
+  traversal.ComputeBreadthFirstDistances( NeighborhoodType( &matrix, itk::WeightThresholdPredicate< double >() ),
+                                          vertices, labels->GetBufferPointer() );
+
+  Reference( input.GetPointer(), offset, 1e30, seeds, expected.GetPointer() );
+
+  if( !Equal( labels.GetPointer(), expected.GetPointer() ) )
+    {
+    std::cerr << "distances on the adaptor graph differ" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::cout << "SUCCESS!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,474 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkGridMaxFlow.h"
+
+#include <boost/graph/compressed_sparse_row_graph.hpp>
+#include <boost/graph/boykov_kolmogorov_max_flow.hpp>
+
+#include <cmath>
+
+// Large capacities across flat regions, small ones across edges.
+template< class TImage >
+struct ContrastMetric
+  {
+  int Evaluate( const TImage* iImage,
+                const typename TImage::IndexType& iA,
+                const typename TImage::IndexType& iB ) const
+    {
+    const int d = static_cast< int >( iImage->GetPixel( iA ) ) - static_cast< int >( iImage->GetPixel( iB ) );
+    return 1 + 400 / ( 1 + d * d / 16 );
+    }
+  };
+
+// Maximum flow of the same problem with boost, through a flow graph whose
+// vertices are the pixels, the source and the sink.
+template< class TMaxFlow >
+int BoostMaxFlow( const TMaxFlow* iMaxFlow )
+{
+  typedef boost::compressed_sparse_row_graph< boost::directedS > GraphType;
+  typedef boost::graph_traits< GraphType >::edge_descriptor      EdgeType;
+
+  const size_t n = iMaxFlow->GetNumberOfVertices();
+  const unsigned int K = iMaxFlow->GetNumberOfNeighbors();
+  const size_t s = n;
+  const size_t t = n + 1;
+
+  // position of each edge in the edge list, for the reverse edges
+  std::vector< size_t > positions( n * K, 0 );
+  std::vector< std::pair< size_t, size_t > > edgeList;
+  std::vector< int > capacities;
+  std::vector< size_t > neighbors( n * K, n );
+
+  for( size_t u = 0; u < n; ++u )
+    {
+    const typename TMaxFlow::IndexType index = iMaxFlow->ComputeIndex( u );
+    for( unsigned int k = 0; k < K; ++k )
+      {
+      const typename TMaxFlow::IndexType neighIndex = index + iMaxFlow->GetOffsets()[ k ];
+      if( iMaxFlow->GetRegion().IsInside( neighIndex ) )
+        {
+        neighbors[ u * K + k ] = iMaxFlow->ComputeVertex( neighIndex );
+        positions[ u * K + k ] = edgeList.size();
+        edgeList.push_back( std::make_pair( u, neighbors[ u * K + k ] ) );
+        capacities.push_back( iMaxFlow->GetEdgeCapacities()[ u * K + k ] );
+        }
+      }
+    edgeList.push_back( std::make_pair( u, s ) );
+    capacities.push_back( 0 );
+    edgeList.push_back( std::make_pair( u, t ) );
+    capacities.push_back( iMaxFlow->GetSinkCapacities()[ u ] );
+    }
+  const size_t sourceEdges = edgeList.size();
+  for( size_t u = 0; u < n; ++u )
+    {
+    edgeList.push_back( std::make_pair( s, u ) );
+    capacities.push_back( iMaxFlow->GetSourceCapacities()[ u ] );
+    }
+  const size_t sinkEdges = edgeList.size();
+  for( size_t u = 0; u < n; ++u )
+    {
+    edgeList.push_back( std::make_pair( t, u ) );
+    capacities.push_back( 0 );
+    }
+
+  GraphType graph( boost::edges_are_sorted, edgeList.begin(), edgeList.end(), n + 2 );
+
+  std::vector< EdgeType > edgesByIndex;
+  boost::graph_traits< GraphType >::edge_iterator eIt, eEnd;
+  for( boost::tie( eIt, eEnd ) = edges( graph ); eIt != eEnd; ++eIt )
+    {
+    edgesByIndex.push_back( *eIt );
+    }
+
+  // the last two edges of the row of u go to the terminals
+  std::vector< size_t > rowEnds( n );
+  for( size_t e = 0, u = 0; e < sourceEdges; ++e )
+    {
+    if( edgeList[ e ].second == t )
+      {
+      rowEnds[ u++ ] = e + 1;
+      }
+    }
+
+  std::vector< EdgeType > reverses( edgeList.size() );
+  for( size_t u = 0; u < n; ++u )
+    {
+    for( unsigned int k = 0; k < K; ++k )
+      {
+      if( neighbors[ u * K + k ] < n )
+        {
+        const size_t v = neighbors[ u * K + k ];
+        unsigned int opposite = 0;
+        while( neighbors[ v * K + opposite ] != u )
+          {
+          ++opposite;
+          }
+        reverses[ positions[ u * K + k ] ] = edgesByIndex[ positions[ v * K + opposite ] ];
+        }
+      }
+    reverses[ rowEnds[ u ] - 2 ] = edgesByIndex[ sourceEdges + u ];
+    reverses[ rowEnds[ u ] - 1 ] = edgesByIndex[ sinkEdges + u ];
+    reverses[ sourceEdges + u ] = edgesByIndex[ rowEnds[ u ] - 2 ];
+    reverses[ sinkEdges + u ] = edgesByIndex[ rowEnds[ u ] - 1 ];
+    }
+
+  std::vector< int > residuals( edgeList.size() );
+  std::vector< EdgeType > predecessors( n + 2 );
+  std::vector< boost::default_color_type > colors( n + 2 );
+  std::vector< long > distances( n + 2 );
+
+  typedef boost::property_map< GraphType, boost::edge_index_t >::type   EdgeIndexMapType;
+  typedef boost::property_map< GraphType, boost::vertex_index_t >::type VertexIndexMapType;
+  EdgeIndexMapType   edgeIndex = get( boost::edge_index, graph );
+  VertexIndexMapType vertexIndex = get( boost::vertex_index, graph );
+
+  return boost::boykov_kolmogorov_max_flow( graph,
+    boost::make_iterator_property_map( capacities.begin(), edgeIndex ),
+    boost::make_iterator_property_map( residuals.begin(), edgeIndex ),
+    boost::make_iterator_property_map( reverses.begin(), edgeIndex ),
+    boost::make_iterator_property_map( predecessors.begin(), vertexIndex ),
+    boost::make_iterator_property_map( colors.begin(), vertexIndex ),
+    boost::make_iterator_property_map( distances.begin(), vertexIndex ),
+    vertexIndex, s, t );
+}
+
+// Capacity of the cut between the source side and the sink side.
+template< class TMaxFlow >
+int CutCapacity( const TMaxFlow* iMaxFlow,
+                 const std::vector< int >& iEdgeCapacities,
+                 const std::vector< int >& iSourceCapacities,
+                 const std::vector< int >& iSinkCapacities )
+{
+  const size_t n = iMaxFlow->GetNumberOfVertices();
+  const unsigned int K = iMaxFlow->GetNumberOfNeighbors();
+
+  int cut = 0;
+  for( size_t u = 0; u < n; ++u )
+    {
+    if( !iMaxFlow->IsSourceSide( u ) )
+      {
+      cut += iSourceCapacities[ u ];
+      continue;
+      }
+    cut += iSinkCapacities[ u ];
+
+    const typename TMaxFlow::IndexType index = iMaxFlow->ComputeIndex( u );
+    for( unsigned int k = 0; k < K; ++k )
+      {
+      const typename TMaxFlow::IndexType neighIndex = index + iMaxFlow->GetOffsets()[ k ];
+      if( iMaxFlow->GetRegion().IsInside( neighIndex ) &&
+          !iMaxFlow->IsSourceSide( iMaxFlow->ComputeVertex( neighIndex ) ) )
+        {
+        cut += iEdgeCapacities[ u * K + k ];
+        }
+      }
+    }
+  return cut;
+}
+
+// Solves the problem set up in iMaxFlow with several numbers of threads and
+// compares the flow, the cut and the segmentation with boost.
+template< class TMaxFlow >
+bool Check( TMaxFlow* iMaxFlow, const char* iName )
+{
+  const std::vector< int > edgeCapacities = iMaxFlow->GetEdgeCapacities();
+  const std::vector< int > sourceCapacities = iMaxFlow->GetSourceCapacities();
+  const std::vector< int > sinkCapacities = iMaxFlow->GetSinkCapacities();
+
+  const int expected = BoostMaxFlow( iMaxFlow );
+
+  std::cout << iName << ": boost " << expected << std::endl;
+
+  std::vector< bool > reference;
+  const unsigned int threads[] = { 1, 2, 4, 8 };
+  for( unsigned int i = 0; i < 4; ++i )
+    {
+    iMaxFlow->GetEdgeCapacities() = edgeCapacities;
+    iMaxFlow->GetSourceCapacities() = sourceCapacities;
+    iMaxFlow->GetSinkCapacities() = sinkCapacities;
+    iMaxFlow->SetNumberOfThreads( threads[ i ] );
+
+    const int flow = iMaxFlow->Solve();
+
+    const int cut = CutCapacity( iMaxFlow, edgeCapacities, sourceCapacities, sinkCapacities );
+
+    std::cout << "  " << threads[ i ] << " threads: " << flow << ", "
+              << iMaxFlow->GetNumberOfPasses() << " passes" << std::endl;
+
+    if( flow != expected || cut != flow )
+      {
+      std::cerr << "flow " << flow << ", cut " << cut << " != " << expected << std::endl;
+      return false;
+      }
+
+    // the source side of the minimum cut found is the smallest one
+    std::vector< bool > segmentation( iMaxFlow->GetNumberOfVertices() );
+    for( size_t u = 0; u < segmentation.size(); ++u )
+      {
+      segmentation[ u ] = iMaxFlow->IsSourceSide( u );
+      }
+    if( i == 0 )
+      {
+      reference = segmentation;
+      }
+    else if( segmentation != reference )
+      {
+      std::cerr << "segmentation differs with " << threads[ i ] << " threads" << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+// Deterministic pseudo-random numbers in [0, 1)
+double Random( unsigned int& ioState )
+{
+  ioState = ioState * 1664525u + 1013904223u;
+  return static_cast< double >( ioState >> 8 ) / 16777216.;
+}
+
+// Edits the capacities of a solved problem in rounds (seeds added and
+// removed, edge and terminal capacities raised and lowered) and compares
+// each Resolve() with boost on the edited capacities.
+template< class TMaxFlow >
+bool CheckDynamic( TMaxFlow* iMaxFlow, const char* iName )
+{
+  typedef typename TMaxFlow::VertexType VertexType;
+
+  std::vector< int > edgeCapacities = iMaxFlow->GetEdgeCapacities();
+  std::vector< int > sourceCapacities = iMaxFlow->GetSourceCapacities();
+  std::vector< int > sinkCapacities = iMaxFlow->GetSinkCapacities();
+
+  const VertexType n = iMaxFlow->GetNumberOfVertices();
+  const unsigned int K = iMaxFlow->GetNumberOfNeighbors();
+
+  iMaxFlow->SetNumberOfThreads( 4 );
+  iMaxFlow->Solve();
+
+  // seeds against the data: a block of 16 x 16 pixels to the source around
+  // the darkest pixel, and one to the sink around the brightest one
+  VertexType seeds[] = { 0, 0 };
+  for( VertexType u = 0; u < n; ++u )
+    {
+    if( sinkCapacities[ u ] > sinkCapacities[ seeds[0] ] )
+      {
+      seeds[0] = u;
+      }
+    if( sourceCapacities[ u ] > sourceCapacities[ seeds[1] ] )
+      {
+      seeds[1] = u;
+      }
+    }
+  unsigned int state = 5;
+
+  for( unsigned int round = 0; round < 5; ++round )
+    {
+    if( round < 3 )
+      {
+      const VertexType center = seeds[ round % 2 ];
+      const int delta = ( round == 2 ) ? -1000 : 1000;
+      const typename TMaxFlow::IndexType centerIndex = iMaxFlow->ComputeIndex( center );
+
+      for( VertexType u = 0; u < n; ++u )
+        {
+        const typename TMaxFlow::IndexType index = iMaxFlow->ComputeIndex( u );
+        if( std::abs( index[0] - centerIndex[0] ) < 8 && std::abs( index[1] - centerIndex[1] ) < 8 )
+          {
+          // the source seeds are removed again
+          const int source = ( round % 2 == 0 ) ? delta : 0;
+          const int sink = ( round % 2 == 1 ) ? delta : 0;
+          iMaxFlow->AddTerminalCapacities( u, source, sink );
+          sourceCapacities[ u ] += source;
+          sinkCapacities[ u ] += sink;
+          }
+        }
+      }
+    else
+      {
+      for( unsigned int edits = 0; edits < 300; ++edits )
+        {
+        const VertexType u = static_cast< VertexType >( Random( state ) * n );
+        const unsigned int k = static_cast< unsigned int >( Random( state ) * K );
+
+        if( round == 3 )
+          {
+          // only edges of the cut, drawn again otherwise
+          const typename TMaxFlow::IndexType neighIndex = iMaxFlow->ComputeIndex( u ) + iMaxFlow->GetOffsets()[ k ];
+          if( !iMaxFlow->GetRegion().IsInside( neighIndex ) ||
+              iMaxFlow->IsSourceSide( u ) == iMaxFlow->IsSourceSide( iMaxFlow->ComputeVertex( neighIndex ) ) )
+            {
+            --edits;
+            continue;
+            }
+          // from zero to twice the capacity
+          const int c = edgeCapacities[ u * K + k ];
+          const int delta = static_cast< int >( ( 2. * Random( state ) - 1. ) * c );
+          iMaxFlow->AddEdgeCapacity( u, k, delta );
+          edgeCapacities[ u * K + k ] += delta;
+          }
+        else
+          {
+          const int source = static_cast< int >( Random( state ) * 400 ) - sourceCapacities[ u ];
+          const int sink = static_cast< int >( Random( state ) * 400 ) - sinkCapacities[ u ];
+          iMaxFlow->AddTerminalCapacities( u, source, sink );
+          sourceCapacities[ u ] += source;
+          sinkCapacities[ u ] += sink;
+          }
+        }
+      }
+
+    const int flow = iMaxFlow->Resolve();
+
+    typename TMaxFlow::Pointer reference = TMaxFlow::New();
+    reference->Initialize( iMaxFlow->GetRegion(), iMaxFlow->GetOffsets() );
+    reference->GetEdgeCapacities() = edgeCapacities;
+    reference->GetSourceCapacities() = sourceCapacities;
+    reference->GetSinkCapacities() = sinkCapacities;
+
+    const int expected = BoostMaxFlow( reference.GetPointer() );
+    const int cut = CutCapacity( iMaxFlow, edgeCapacities, sourceCapacities, sinkCapacities );
+
+    std::cout << iName << ", edit " << round << ": " << flow << ", boost " << expected << std::endl;
+
+    if( flow != expected || cut != flow )
+      {
+      std::cerr << "flow " << flow << ", cut " << cut << " != " << expected << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  typedef unsigned char PixelType;
+  const unsigned int Dimension = 2;
+
+  typedef itk::Image< PixelType, Dimension > ImageType;
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+  typedef itk::GridMaxFlow< int, Dimension > MaxFlowType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+  const ImageType::RegionType region = input->GetLargestPossibleRegion();
+
+  // 4- and 8-connectivity; the opposite offsets are added by the solver
+  std::vector< ImageType::OffsetType > offset( 4 );
+  offset[0][0] = 1;
+  offset[0][1] = 0;
+  offset[1][0] = 0;
+  offset[1][1] = 1;
+  offset[2][0] = 1;
+  offset[2][1] = 1;
+  offset[3][0] = 1;
+  offset[3][1] = -1;
+
+  for( unsigned int connectivity = 2; connectivity <= 4; connectivity += 2 )
+    {
+    std::vector< ImageType::OffsetType > stencil( offset.begin(), offset.begin() + connectivity );
+
+    MaxFlowType::Pointer maxFlow = MaxFlowType::New();
+    maxFlow->Initialize( region, stencil );
+    maxFlow->FillEdgeCapacities( input.GetPointer(), ContrastMetric< ImageType >() );
+
+    if( maxFlow->GetNumberOfNeighbors() != 2 * connectivity )
+      {
+      std::cerr << "wrong number of neighbors" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    // bright pixels to the source, dark ones to the sink
+    itk::ImageRegionConstIteratorWithIndex< ImageType > it( input, region );
+    for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+      {
+      const MaxFlowType::VertexType u = maxFlow->ComputeVertex( it.GetIndex() );
+      const int value = static_cast< int >( it.Get() ) - 128;
+      maxFlow->GetSourceCapacities()[ u ] = std::max( value, 0 ) * 4;
+      maxFlow->GetSinkCapacities()[ u ] = std::max( -value, 0 ) * 4;
+      }
+
+    if( !Check( maxFlow.GetPointer(), connectivity == 2 ? "4-connected" : "8-connected" ) )
+      {
+      return EXIT_FAILURE;
+      }
+
+    // Dynamic: the problem again, edited after the first solve
+    maxFlow->Initialize( region, stencil );
+    maxFlow->FillEdgeCapacities( input.GetPointer(), ContrastMetric< ImageType >() );
+    for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+      {
+      const MaxFlowType::VertexType u = maxFlow->ComputeVertex( it.GetIndex() );
+      const int value = static_cast< int >( it.Get() ) - 128;
+      maxFlow->GetSourceCapacities()[ u ] = std::max( value, 0 ) * 4;
+      maxFlow->GetSinkCapacities()[ u ] = std::max( -value, 0 ) * 4;
+      }
+
+    if( !CheckDynamic( maxFlow.GetPointer(), connectivity == 2 ? "4-connected" : "8-connected" ) )
+      {
+      return EXIT_FAILURE;
+      }
+    }
+
+  // A noisy volume with a bright ball, 6-connected
+  typedef itk::Image< PixelType, 3 >     VolumeType;
+  typedef itk::GridMaxFlow< int, 3 >     VolumeMaxFlowType;
+
+  VolumeType::RegionType volumeRegion;
+  for( unsigned int dim = 0; dim < 3; ++dim )
+    {
+    volumeRegion.SetSize( dim, 48 );
+    }
+
+  VolumeType::Pointer volume = VolumeType::New();
+  volume->SetRegions( volumeRegion );
+  volume->Allocate();
+
+  unsigned int state = 11;
+  itk::ImageRegionIteratorWithIndex< VolumeType > volumeIt( volume, volumeRegion );
+  for( volumeIt.GoToBegin(); !volumeIt.IsAtEnd(); ++volumeIt )
+    {
+    double r2 = 0.;
+    for( unsigned int dim = 0; dim < 3; ++dim )
+      {
+      r2 += ( volumeIt.GetIndex()[ dim ] - 24. ) * ( volumeIt.GetIndex()[ dim ] - 24. );
+      }
+    const double value = ( r2 < 15. * 15. ? 170. : 80. ) + 120. * ( Random( state ) - 0.5 );
+    volumeIt.Set( static_cast< PixelType >( value ) );
+    }
+
+  std::vector< VolumeType::OffsetType > volumeOffset( 3 );
+  for( unsigned int k = 0; k < 3; ++k )
+    {
+    volumeOffset[k].Fill( 0 );
+    volumeOffset[k][k] = 1;
+    }
+
+  VolumeMaxFlowType::Pointer volumeMaxFlow = VolumeMaxFlowType::New();
+  volumeMaxFlow->Initialize( volumeRegion, volumeOffset );
+  volumeMaxFlow->FillEdgeCapacities( volume.GetPointer(), ContrastMetric< VolumeType >() );
+
+  for( volumeIt.GoToBegin(); !volumeIt.IsAtEnd(); ++volumeIt )
+    {
+    const VolumeMaxFlowType::VertexType u = volumeMaxFlow->ComputeVertex( volumeIt.GetIndex() );
+    const int value = static_cast< int >( volumeIt.Get() ) - 125;
+    volumeMaxFlow->GetSourceCapacities()[ u ] = std::max( value, 0 ) * 2;
+    volumeMaxFlow->GetSinkCapacities()[ u ] = std::max( -value, 0 ) * 2;
+    }
+
+  if( !Check( volumeMaxFlow.GetPointer(), "6-connected volume" ) )
+    {
+    return EXIT_FAILURE;
+    }
+
+  std::cout << "SUCCESS!" << std::endl;
+  return EXIT_SUCCESS;
+}
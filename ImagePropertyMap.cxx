@@ -0,0 +1,202 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkImagePropertyMap.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include <boost/graph/breadth_first_search.hpp>
+#include <boost/graph/dijkstra_shortest_paths.hpp>
+
+#include <algorithm>
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  typedef unsigned char PixelType;
+  const unsigned int Dimension = 2;
+
+  typedef itk::Image< PixelType, Dimension > ImageType;
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+
+  typedef double                                                              WeightType;
+
+  typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::undirectedS,
+    boost::no_property, boost::property< boost::edge_weight_t, WeightType > > GraphType;
+
+  typedef itk::IndexMetric< ImageType, WeightType >                           MetricType;
+  typedef itk::ImageBoostGraphAdaptor< ImageType, GraphType, MetricType >     AdaptorType;
+
+  std::vector< AdaptorType::NeighborhoodIteratorOffsetType > offset( 4 );
+
+  size_t k = 0;
+  offset[k][0] = -1;
+  offset[k][1] = 0;
+  k++;
+
+  offset[k][0] = 0;
+  offset[k][1] = -1;
+  k++;
+
+  offset[k][0] = 0;
+  offset[k][1] = 1;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = 0;
+  k++;
+
+  AdaptorType::Pointer adaptor = AdaptorType::New();
+  adaptor->SetInput( input );
+  adaptor->SetNeighbors( offset );
+  adaptor->Update();
+
+  typedef AdaptorType::GraphType GraphType;
+  const GraphType& graph = adaptor->GetOutput();
+
+  typedef AdaptorType::VertexDescriptorType   VertexDescriptorType;
+
+  ImageType::IndexType idx1;
+  idx1[0] = 320;
+  idx1[1] = 240;
+
+  bool inside = false;
+  VertexDescriptorType v1 = adaptor->GetVertexFromIndex( idx1, inside );
+
+  // Reference run with std::vector storage.
+  std::vector< VertexDescriptorType > Predecessors( num_vertices( graph ) );
+  std::vector< WeightType >           Distances( num_vertices( graph ) );
+
+  boost::dijkstra_shortest_paths( graph, v1,
+                                  boost::predecessor_map( &Predecessors[0] ).distance_map( &Distances[0] ) );
+
+  // Same run writing into images.
+  typedef itk::Image< WeightType, Dimension >           DistanceImageType;
+  typedef itk::Image< VertexDescriptorType, Dimension > PredecessorImageType;
+  typedef itk::Image< unsigned char, Dimension >        ColorImageType;
+
+  DistanceImageType::Pointer    distances     = adaptor->CreateVertexImage< DistanceImageType >();
+  PredecessorImageType::Pointer predecessors  = adaptor->CreateVertexImage< PredecessorImageType >();
+  ColorImageType::Pointer       colors        = adaptor->CreateVertexImage< ColorImageType >();
+
+  boost::dijkstra_shortest_paths( graph, v1,
+    boost::predecessor_map( itk::MakeImagePropertyMap( predecessors ) ).
+    distance_map( itk::MakeImagePropertyMap( distances ) ) );
+
+  boost::breadth_first_search( graph, v1,
+    boost::color_map( itk::MakeImagePropertyMap< boost::default_color_type >( colors ) ) );
+
+  typedef itk::ImageRegionConstIteratorWithIndex< DistanceImageType > IteratorType;
+  IteratorType it( distances, distances->GetBufferedRegion() );
+
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    ImageType::IndexType idx = it.GetIndex();
+    VertexDescriptorType v = adaptor->GetVertexFromIndex( idx, inside );
+
+    if( it.Get() != Distances[v] )
+      {
+      std::cerr << "distance[ " << idx << " ] = " << it.Get()
+                << " != " << Distances[v] << std::endl;
+      return EXIT_FAILURE;
+      }
+    if( predecessors->GetPixel( idx ) != Predecessors[v] )
+      {
+      std::cerr << "predecessor[ " << idx << " ] = " << predecessors->GetPixel( idx )
+                << " != " << Predecessors[v] << std::endl;
+      return EXIT_FAILURE;
+      }
+    if( colors->GetPixel( idx ) != boost::black_color )
+      {
+      std::cerr << "color[ " << idx << " ] = " << static_cast< int >( colors->GetPixel( idx ) ) << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Graph of a window of the buffer (requested region smaller than the
+  // buffered one): the vertex images cover the window.
+  ImageType::RegionType window;
+  window.SetIndex( 0, 100 );
+  window.SetIndex( 1, 50 );
+  window.SetSize( 0, 200 );
+  window.SetSize( 1, 150 );
+
+  ImageType::Pointer windowed = ImageType::New();
+  windowed->SetRegions( input->GetBufferedRegion() );
+  windowed->Allocate();
+  std::copy( input->GetBufferPointer(),
+             input->GetBufferPointer() + input->GetBufferedRegion().GetNumberOfPixels(),
+             windowed->GetBufferPointer() );
+  windowed->SetLargestPossibleRegion( window );
+  windowed->SetRequestedRegion( window );
+
+  AdaptorType::Pointer windowAdaptor = AdaptorType::New();
+  windowAdaptor->SetInput( windowed );
+  windowAdaptor->SetNeighbors( offset );
+  windowAdaptor->Update();
+
+  const GraphType& windowGraph = windowAdaptor->GetOutput();
+
+  ImageType::IndexType center;
+  center[0] = 200;
+  center[1] = 125;
+  VertexDescriptorType c = windowAdaptor->GetVertexFromIndex( center, inside );
+
+  Distances.assign( num_vertices( windowGraph ), 0. );
+  boost::dijkstra_shortest_paths( windowGraph, c, boost::distance_map( &Distances[0] ) );
+
+  DistanceImageType::Pointer windowDistances = windowAdaptor->CreateVertexImage< DistanceImageType >();
+  boost::dijkstra_shortest_paths( windowGraph, c,
+    boost::distance_map( itk::MakeImagePropertyMap( windowDistances ) ) );
+
+  if( windowDistances->GetBufferedRegion() != window )
+    {
+    std::cerr << "vertex image over " << windowDistances->GetBufferedRegion() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  IteratorType windowIt( windowDistances, window );
+  for( windowIt.GoToBegin(); !windowIt.IsAtEnd(); ++windowIt )
+    {
+    VertexDescriptorType v = windowAdaptor->GetVertexFromIndex( windowIt.GetIndex(), inside );
+    if( windowIt.Get() != Distances[v] )
+      {
+      std::cerr << "window distance[ " << windowIt.GetIndex() << " ] = " << windowIt.Get()
+                << " != " << Distances[v] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Tiled vertices are not buffer offsets: no vertex image.
+  AdaptorType::VertexOrderingType tiled;
+  tiled.SetOrder( AdaptorType::VertexOrderingType::TiledOrder );
+  windowAdaptor->SetVertexOrdering( tiled );
+  windowAdaptor->Update();
+
+  bool caught = false;
+  try
+    {
+    windowAdaptor->CreateVertexImage< DistanceImageType >();
+    }
+  catch( itk::ExceptionObject & )
+    {
+    caught = true;
+    }
+  if( !caught )
+    {
+    std::cerr << "vertex image of a tiled ordering" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::cout << "SUCCESS!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,195 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkImageStencil.h"
+
+typedef unsigned char PixelType;
+const unsigned int Dimension = 2;
+
+typedef itk::Image< PixelType, Dimension > ImageType;
+typedef double                             WeightType;
+
+typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::undirectedS,
+  boost::no_property, boost::property< boost::edge_weight_t, WeightType > > GraphType;
+
+typedef itk::IndexMetric< ImageType, WeightType >                           MetricType;
+typedef itk::ImageBoostGraphAdaptor< ImageType, GraphType, MetricType >     AdaptorType;
+
+typedef AdaptorType::VertexOrderingType             OrderingType;
+typedef AdaptorType::StencilType                    StencilType;
+typedef AdaptorType::NeighborhoodIteratorOffsetType OffsetType;
+
+/** Check that the stencil finds, for each pixel of the ordering and each
+ *  offset, the vertex that FindVertex() finds. */
+bool CheckStencil( const OrderingType& iOrdering, const std::vector< OffsetType >& iOffsets )
+{
+  StencilType stencil;
+  stencil.Initialize( iOrdering, iOffsets );
+
+  const OrderingType::RegionType& region = iOrdering.GetRegion();
+
+  ImageType::Pointer flags = ImageType::New();
+  flags->SetRegions( region );
+  flags->Allocate();
+
+  itk::ImageRegionConstIteratorWithIndex< ImageType > it( flags, region );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    const OrderingType::IndexType index = it.GetIndex();
+
+    OrderingType::VertexType u;
+    if( !iOrdering.FindVertex( index, u ) )
+      {
+      continue;
+      }
+
+    const bool interior = stencil.IsInterior( index );
+
+    for( unsigned int k = 0; k < stencil.GetNumberOfOffsets(); ++k )
+      {
+      OrderingType::VertexType expected = -1;
+      OrderingType::VertexType v = -1;
+
+      const bool inside = iOrdering.FindVertex( index + iOffsets[ k ], expected );
+
+      if( stencil.FindNeighbor( iOrdering, u, index, interior, k, v ) != inside ||
+          ( inside && v != expected ) || ( interior && !inside ) )
+        {
+        std::cerr << index << " + " << iOffsets[ k ] << ": " << v << " != " << expected << std::endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Sparse, long-range offsets, one longer than the test region along x.
+  std::vector< OffsetType > offset( 6 );
+  offset[0][0] = 1;
+  offset[0][1] = 0;
+  offset[1][0] = 0;
+  offset[1][1] = 1;
+  offset[2][0] = 5;
+  offset[2][1] = -3;
+  offset[3][0] = -12;
+  offset[3][1] = 7;
+  offset[4][0] = 0;
+  offset[4][1] = 16;
+  offset[5][0] = 40;
+  offset[5][1] = 2;
+
+  OrderingType::RegionType region;
+  region.SetIndex( 0, 3 );
+  region.SetIndex( 1, -2 );
+  region.SetSize( 0, 37 );
+  region.SetSize( 1, 21 );
+
+  OrderingType ordering;
+  ordering.Initialize( region );
+
+  if( !CheckStencil( ordering, offset ) )
+    {
+    std::cerr << "raster order" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  ordering.SetOrder( OrderingType::TiledOrder );
+  ordering.SetTileSizeExponent( 2 );
+  ordering.Initialize( region );
+
+  if( !CheckStencil( ordering, offset ) )
+    {
+    std::cerr << "tiled order" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Raster order with a checkerboard mask.
+  ImageType::Pointer mask = ImageType::New();
+  mask->SetRegions( region );
+  mask->Allocate();
+
+  itk::ImageRegionConstIteratorWithIndex< ImageType > maskIt( mask, region );
+  for( maskIt.GoToBegin(); !maskIt.IsAtEnd(); ++maskIt )
+    {
+    mask->SetPixel( maskIt.GetIndex(), ( maskIt.GetIndex()[0] + maskIt.GetIndex()[1] ) % 2 ? 1 : 0 );
+    }
+
+  ordering.SetOrder( OrderingType::RasterOrder );
+  ordering.Initialize( region );
+  ordering.InitializeMask( mask.GetPointer() );
+
+  if( !CheckStencil( ordering, offset ) )
+    {
+    std::cerr << "masked raster order" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Undirected graph of the image with the long-range offsets: the edges,
+  // counted by brute force, each built once.
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+  const ImageType::RegionType imageRegion = input->GetLargestPossibleRegion();
+
+  offset[5][0] = static_cast< itk::OffsetValueType >( imageRegion.GetSize()[0] ) + 1;
+
+  itk::SizeValueType expected = 0;
+  itk::ImageRegionConstIteratorWithIndex< ImageType > it( input, imageRegion );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    for( size_t k = 0; k < offset.size(); ++k )
+      {
+      expected += imageRegion.IsInside( it.GetIndex() + offset[ k ] );
+      }
+    }
+
+  AdaptorType::Pointer adaptor = AdaptorType::New();
+  adaptor->SetInput( input );
+  adaptor->SetNeighbors( offset );
+  adaptor->Update();
+
+  const GraphType& graph = adaptor->GetOutput();
+
+  if( num_edges( graph ) != expected || adaptor->ComputeNumberOfEdges() != expected )
+    {
+    std::cerr << num_edges( graph ) << " edges, " << adaptor->ComputeNumberOfEdges()
+              << " counted, " << expected << " expected" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Each edge joins two pixels one offset apart, in either direction.
+  boost::graph_traits< GraphType >::edge_iterator eIt, eEnd;
+  for( boost::tie( eIt, eEnd ) = edges( graph ); eIt != eEnd; ++eIt )
+    {
+    const ImageType::IndexType a = adaptor->GetVertexOrdering().ComputeIndex( source( *eIt, graph ) );
+    const ImageType::IndexType b = adaptor->GetVertexOrdering().ComputeIndex( target( *eIt, graph ) );
+
+    bool found = false;
+    for( size_t k = 0; k < offset.size() && !found; ++k )
+      {
+      found = ( a + offset[ k ] == b ) || ( b + offset[ k ] == a );
+      }
+    if( !found )
+      {
+      std::cerr << "edge " << a << " - " << b << " is not in the stencil" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  std::cout << expected << " edges" << std::endl;
+  std::cout << "SUCCESS!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,270 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkGeodesicDistanceMapImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+/** Half of the absolute intensity difference. */
+struct HalfMetric
+{
+  template< class TImage >
+  double Evaluate( const TImage* iImage, const typename TImage::IndexType& iA,
+                   const typename TImage::IndexType& iB ) const
+    {
+    return 0.5 * std::abs( static_cast< double >( iImage->GetPixel( iA ) ) -
+                           static_cast< double >( iImage->GetPixel( iB ) ) );
+    }
+};
+
+/** One plus half of the absolute intensity difference, rounded down. */
+struct StepMetric
+{
+  template< class TImage >
+  unsigned int Evaluate( const TImage* iImage, const typename TImage::IndexType& iA,
+                         const typename TImage::IndexType& iB ) const
+    {
+    const int a = iImage->GetPixel( iA );
+    const int b = iImage->GetPixel( iB );
+    return 1 + static_cast< unsigned int >( a > b ? a - b : b - a ) / 2;
+    }
+};
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  typedef unsigned char PixelType;
+  const unsigned int Dimension = 2;
+
+  typedef itk::Image< PixelType, Dimension > ImageType;
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+
+  // Integer distances (radix heap) and floating point ones (binary heap).
+  typedef itk::Image< unsigned int, Dimension >                               IntegerDistanceImageType;
+  typedef itk::Image< double, Dimension >                                     RealDistanceImageType;
+  typedef itk::Image< unsigned short, Dimension >                             LabelImageType;
+
+  typedef itk::GeodesicDistanceMapImageFilter< ImageType, IntegerDistanceImageType,
+    LabelImageType >                                                          IntegerFilterType;
+  typedef itk::GeodesicDistanceMapImageFilter< ImageType, RealDistanceImageType,
+    LabelImageType >                                                          RealFilterType;
+
+  std::vector< ImageType::OffsetType > offset( 8 );
+
+  size_t k = 0;
+  offset[k][0] = -1;
+  offset[k][1] = -1;
+  k++;
+
+  offset[k][0] = -1;
+  offset[k][1] = 0;
+  k++;
+
+  offset[k][0] = -1;
+  offset[k][1] = 1;
+  k++;
+
+  offset[k][0] = 0;
+  offset[k][1] = -1;
+  k++;
+
+  offset[k][0] = 0;
+  offset[k][1] = 1;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = -1;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = 0;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = 1;
+  k++;
+
+  ImageType::IndexType idx1, idx2;
+  idx1[0] = 320;
+  idx1[1] = 240;
+
+  idx2[0] = 160;
+  idx2[1] = 120;
+
+  IntegerFilterType::Pointer integerFilter = IntegerFilterType::New();
+  integerFilter->SetInput( input );
+  integerFilter->SetNeighbors( offset );
+  integerFilter->AddSeed( idx1, 1 );
+  integerFilter->Update();
+
+  RealFilterType::Pointer realFilter = RealFilterType::New();
+  realFilter->SetInput( input );
+  realFilter->SetNeighbors( offset );
+  realFilter->AddSeed( idx1, 1 );
+  realFilter->Update();
+
+  ImageType::RegionType region = input->GetLargestPossibleRegion();
+
+  itk::ImageRegionConstIterator< IntegerDistanceImageType > integerIt( integerFilter->GetDistanceMap(), region );
+  itk::ImageRegionConstIterator< RealDistanceImageType >    realIt( realFilter->GetDistanceMap(), region );
+
+  for( integerIt.GoToBegin(), realIt.GoToBegin(); !integerIt.IsAtEnd(); ++integerIt, ++realIt )
+    {
+    if( static_cast< double >( integerIt.Get() ) != realIt.Get() )
+      {
+      std::cerr << "distance: " << integerIt.Get() << " != " << realIt.Get() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Same distance as ShortestPath, stopping once the target is settled.
+  integerFilter->AddTarget( idx2 );
+  integerFilter->Update();
+
+  IntegerDistanceImageType::Pointer distances = integerFilter->GetDistanceMap();
+
+  if( distances->GetPixel( idx2 ) != realFilter->GetDistanceMap()->GetPixel( idx2 ) )
+    {
+    std::cerr << "distance with target: " << distances->GetPixel( idx2 ) << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Only the pixels settled before the target keep a distance: the ones
+  // just beyond its frontier, reached from a settled pixel but not settled,
+  // have the maximum distance, a zero label and a zero predecessor.
+  const unsigned int targetDistance = distances->GetPixel( idx2 );
+  const unsigned int maximum = itk::NumericTraits< unsigned int >::max();
+
+  LabelImageType::Pointer labels = integerFilter->GetVoronoiMap();
+  IntegerFilterType::PredecessorImageType::Pointer predecessors = integerFilter->GetPredecessorMap();
+
+  ImageType::OffsetType zeroOffset;
+  zeroOffset.Fill( 0 );
+
+  itk::SizeValueType frontier = 0;
+  itk::ImageRegionConstIteratorWithIndex< IntegerDistanceImageType > it( distances, region );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    const ImageType::IndexType index = it.GetIndex();
+    const double fullDistance = realFilter->GetDistanceMap()->GetPixel( index );
+
+    if( it.Get() == maximum )
+      {
+      if( labels->GetPixel( index ) != 0 || predecessors->GetPixel( index ) != zeroOffset )
+        {
+        std::cerr << index << " is not reached but has a label or a predecessor" << std::endl;
+        return EXIT_FAILURE;
+        }
+      if( fullDistance < targetDistance )
+        {
+        std::cerr << index << " is closer than the target but was not settled" << std::endl;
+        return EXIT_FAILURE;
+        }
+
+      // Beyond the frontier: one of its neighbors is settled.
+      bool nextToSettled = false;
+      for( k = 0; k < offset.size(); ++k )
+        {
+        const ImageType::IndexType neighIndex = index + offset[ k ];
+        nextToSettled = nextToSettled ||
+          ( region.IsInside( neighIndex ) && distances->GetPixel( neighIndex ) != maximum );
+        }
+      frontier += nextToSettled;
+      }
+    else if( static_cast< double >( it.Get() ) != fullDistance || it.Get() > targetDistance )
+      {
+      std::cerr << index << " keeps the tentative distance " << it.Get() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  if( frontier == 0 )
+    {
+    std::cerr << "propagation did not stop at the target" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Byte distances overflow on this image: they saturate at the maximum
+  // minus one instead of wrapping around.
+  typedef itk::Image< unsigned char, Dimension >                              ByteDistanceImageType;
+  typedef itk::GeodesicDistanceMapImageFilter< ImageType, ByteDistanceImageType,
+    LabelImageType, StepMetric >                                              ByteFilterType;
+  typedef itk::GeodesicDistanceMapImageFilter< ImageType, IntegerDistanceImageType,
+    LabelImageType, StepMetric >                                              StepFilterType;
+
+  ByteFilterType::Pointer byteFilter = ByteFilterType::New();
+  byteFilter->SetInput( input );
+  byteFilter->SetNeighbors( offset );
+  byteFilter->AddSeed( idx1, 1 );
+  byteFilter->Update();
+
+  StepFilterType::Pointer stepFilter = StepFilterType::New();
+  stepFilter->SetInput( input );
+  stepFilter->SetNeighbors( offset );
+  stepFilter->AddSeed( idx1, 1 );
+  stepFilter->Update();
+
+  const unsigned int byteLimit = itk::NumericTraits< unsigned char >::max() - 1;
+  itk::SizeValueType saturated = 0;
+
+  itk::ImageRegionConstIterator< ByteDistanceImageType >    byteIt( byteFilter->GetDistanceMap(), region );
+  itk::ImageRegionConstIterator< IntegerDistanceImageType > stepIt( stepFilter->GetDistanceMap(), region );
+  for( byteIt.GoToBegin(), stepIt.GoToBegin(); !byteIt.IsAtEnd(); ++byteIt, ++stepIt )
+    {
+    if( byteIt.Get() != std::min( stepIt.Get(), byteLimit ) )
+      {
+      std::cerr << "byte distance: " << static_cast< unsigned int >( byteIt.Get() )
+                << " != " << stepIt.Get() << std::endl;
+      return EXIT_FAILURE;
+      }
+    saturated += ( stepIt.Get() > byteLimit );
+    }
+
+  if( saturated == 0 )
+    {
+    std::cerr << "no byte distance saturates" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Fractional metric values are not truncated into integer distances.
+  typedef itk::GeodesicDistanceMapImageFilter< ImageType, IntegerDistanceImageType,
+    LabelImageType, HalfMetric >                                              HalfFilterType;
+
+  HalfFilterType::Pointer halfFilter = HalfFilterType::New();
+  halfFilter->SetInput( input );
+  halfFilter->SetNeighbors( offset );
+  halfFilter->AddSeed( idx1, 1 );
+
+  bool caught = false;
+  try
+    {
+    halfFilter->Update();
+    }
+  catch( itk::ExceptionObject & )
+    {
+    caught = true;
+    }
+
+  if( !caught )
+    {
+    std::cerr << "fractional metric values were accepted" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::cout << "Distance: " << distances->GetPixel( idx2 ) << ", "
+            << saturated << " saturated byte distances" << std::endl;
+
+  return EXIT_SUCCESS;
+}
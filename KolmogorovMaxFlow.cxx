@@ -70,7 +70,8 @@ int main( int argc, char* argv[] )
   std::cout << "Graph constructed" << std::endl;
 
   typedef AdaptorType::GraphType GraphType;
-  GraphType graph = adaptor->GetOutput();
+  GraphType graph;
+  adaptor->ReleaseOutput( graph );
 
   typedef AdaptorType::VertexDescriptorType   VertexDescriptorType;
   typedef AdaptorType::EdgeDescriptorType     EdgeDescriptorType;
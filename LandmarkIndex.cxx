@@ -0,0 +1,188 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkPhysicalDistanceMetric.h"
+#include "itkLandmarkShortestPathIndex.h"
+
+#include <boost/graph/dijkstra_shortest_paths.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  typedef unsigned char PixelType;
+  const unsigned int Dimension = 2;
+
+  typedef itk::Image< PixelType, Dimension > ImageType;
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+
+  typedef double                                                              WeightType;
+
+  typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::undirectedS,
+    boost::no_property, boost::property< boost::edge_weight_t, WeightType > > GraphType;
+
+  typedef itk::PhysicalDistanceMetric< ImageType, WeightType >                MetricType;
+  typedef itk::ImageBoostGraphAdaptor< ImageType, GraphType, MetricType >     AdaptorType;
+  typedef itk::LandmarkShortestPathIndex< AdaptorType >                       IndexType;
+
+  std::vector< AdaptorType::NeighborhoodIteratorOffsetType > offset;
+  for( int i = -1; i <= 1; ++i )
+    {
+    for( int j = -1; j <= 1; ++j )
+      {
+      if( i != 0 || j != 0 )
+        {
+        AdaptorType::NeighborhoodIteratorOffsetType o;
+        o[0] = i;
+        o[1] = j;
+        offset.push_back( o );
+        }
+      }
+    }
+
+  // Edge length plus a small intensity term
+  MetricType metric;
+  metric.SetDistanceWeight( 1. );
+  metric.SetIntensityWeight( 0.001 );
+
+  AdaptorType::Pointer adaptor = AdaptorType::New();
+  adaptor->SetInput( input );
+  adaptor->SetNeighbors( offset );
+  adaptor->SetMetric( metric );
+  adaptor->Update();
+
+  const GraphType& graph = adaptor->GetOutput();
+
+  IndexType::Pointer index = IndexType::New();
+  index->SetAdaptor( adaptor );
+  index->SetNumberOfLandmarks( 16 );
+  index->SetNumberOfThreads( 4 );
+  index->Build();
+
+  // Without landmarks, the queries are plain Dijkstra searches.
+  IndexType::Pointer dijkstra = IndexType::New();
+  dijkstra->SetAdaptor( adaptor );
+  dijkstra->SetNumberOfLandmarks( 0 );
+  dijkstra->Build();
+
+  typedef AdaptorType::VertexDescriptorType   VertexDescriptorType;
+
+  std::vector< VertexDescriptorType > predecessors( num_vertices( graph ) );
+  std::vector< WeightType >           distances( num_vertices( graph ) );
+
+  const ImageType::SizeType size = input->GetLargestPossibleRegion().GetSize();
+  unsigned int state = 1;
+
+  itk::SizeValueType settled = 0;
+  itk::SizeValueType dijkstraSettled = 0;
+
+  for( unsigned int s = 0; s < 5; ++s )
+    {
+    ImageType::IndexType source;
+    state = state * 1664525u + 1013904223u;
+    source[0] = ( state >> 8 ) % size[0];
+    state = state * 1664525u + 1013904223u;
+    source[1] = ( state >> 8 ) % size[1];
+
+    bool inside = false;
+    boost::dijkstra_shortest_paths( graph, adaptor->GetVertexFromIndex( source, inside ),
+                                    boost::predecessor_map( &predecessors[0] ).distance_map( &distances[0] ) );
+
+    for( unsigned int t = 0; t < 4; ++t )
+      {
+      ImageType::IndexType target;
+      state = state * 1664525u + 1013904223u;
+      target[0] = ( state >> 8 ) % size[0];
+      state = state * 1664525u + 1013904223u;
+      target[1] = ( state >> 8 ) % size[1];
+
+      const WeightType expected = distances[ adaptor->GetVertexFromIndex( target, inside ) ];
+
+      IndexType::PathType path;
+      if( !index->GetPath( source, target, path ) || path.front() != source || path.back() != target )
+        {
+        std::cerr << "no path from " << source << " to " << target << std::endl;
+        return EXIT_FAILURE;
+        }
+      settled += index->GetNumberOfSettledVertices();
+
+      // Length of the returned path
+      WeightType length = 0.;
+      for( size_t p = 1; p < path.size(); ++p )
+        {
+        length += metric.Evaluate( input, path[ p - 1 ], path[ p ] );
+        }
+
+      const WeightType distance = index->GetDistance( source, target );
+      const WeightType reference = dijkstra->GetDistance( source, target );
+      dijkstraSettled += dijkstra->GetNumberOfSettledVertices();
+
+      if( std::abs( distance - expected ) > 1e-9 * expected ||
+          std::abs( length - expected ) > 1e-9 * expected ||
+          std::abs( reference - expected ) > 1e-9 * expected )
+        {
+        std::cerr << source << " -> " << target << ": " << distance << ", " << length
+                  << ", " << reference << " != " << expected << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  std::cout << "Settled vertices: " << settled << " with landmarks, "
+            << dijkstraSettled << " without" << std::endl;
+
+  if( 3 * settled > dijkstraSettled )
+    {
+    std::cerr << "landmarks do not prune the search enough" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Saved and loaded, or used in place, the index gives the same bounds.
+  index->Write( "LandmarkIndex.alt" );
+
+  IndexType::Pointer loaded = IndexType::New();
+  loaded->SetAdaptor( adaptor );
+  loaded->Read( "LandmarkIndex.alt" );
+
+  std::vector< itk::uint64_t > block( ( index->GetDataSize() + 7 ) / 8 );
+  std::ifstream file( "LandmarkIndex.alt", std::ios::binary );
+  file.read( reinterpret_cast< char* >( &block[0] ), index->GetDataSize() );
+
+  IndexType::Pointer mapped = IndexType::New();
+  mapped->SetAdaptor( adaptor );
+  mapped->SetMappedData( &block[0], index->GetDataSize() );
+
+  if( loaded->GetLandmarks() != index->GetLandmarks() || mapped->GetLandmarks() != index->GetLandmarks() )
+    {
+    std::cerr << "landmarks differ" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  for( VertexDescriptorType v = 0; v < num_vertices( graph ); v += 997 )
+    {
+    const WeightType bound = index->ComputeLowerBound( 0, v );
+    if( loaded->ComputeLowerBound( 0, v ) != bound || mapped->ComputeLowerBound( 0, v ) != bound )
+      {
+      std::cerr << "bounds differ at vertex " << v << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  std::remove( "LandmarkIndex.alt" );
+
+  std::cout << "SUCCESS!" << std::endl;
+  return EXIT_SUCCESS;
+}
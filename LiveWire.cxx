@@ -0,0 +1,171 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkLiveWirePathFinder.h"
+
+#include <boost/graph/dijkstra_shortest_paths.hpp>
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  typedef unsigned char PixelType;
+  const unsigned int Dimension = 2;
+
+  typedef itk::Image< PixelType, Dimension > ImageType;
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+
+  typedef double                                                              WeightType;
+
+  typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::undirectedS,
+    boost::no_property, boost::property< boost::edge_weight_t, WeightType > > GraphType;
+
+  typedef itk::IndexMetric< ImageType, WeightType >                           MetricType;
+  typedef itk::ImageBoostGraphAdaptor< ImageType, GraphType, MetricType >     AdaptorType;
+
+  std::vector< AdaptorType::NeighborhoodIteratorOffsetType > offset( 8 );
+
+  size_t k = 0;
+  offset[k][0] = -1;
+  offset[k][1] = -1;
+  k++;
+
+  offset[k][0] = -1;
+  offset[k][1] = 0;
+  k++;
+
+  offset[k][0] = -1;
+  offset[k][1] = 1;
+  k++;
+
+  offset[k][0] = 0;
+  offset[k][1] = -1;
+  k++;
+
+  offset[k][0] = 0;
+  offset[k][1] = 1;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = -1;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = 0;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = 1;
+  k++;
+
+
+  AdaptorType::Pointer adaptor = AdaptorType::New();
+  adaptor->SetInput( input );
+  adaptor->SetNeighbors( offset );
+  adaptor->Update();
+
+  typedef AdaptorType::GraphType             GraphType;
+  typedef AdaptorType::VertexDescriptorType  VertexDescriptorType;
+  typedef itk::LiveWirePathFinder< AdaptorType > PathFinderType;
+
+  const GraphType& graph = adaptor->GetOutput();
+
+  ImageType::IndexType seeds[2], targets[3];
+  seeds[0][0] = 320;
+  seeds[0][1] = 240;
+
+  seeds[1][0] = 100;
+  seeds[1][1] = 400;
+
+  targets[0][0] = 330;
+  targets[0][1] = 250;
+
+  targets[1][0] = 160;
+  targets[1][1] = 120;
+
+  targets[2][0] = 600;
+  targets[2][1] = 50;
+
+  PathFinderType::Pointer finder = PathFinderType::New();
+  finder->SetAdaptor( adaptor );
+
+  std::vector< VertexDescriptorType > Predecessors( num_vertices( graph ) );
+  std::vector< WeightType >           Distances( num_vertices( graph ) );
+
+  MetricType metric;
+  bool inside = false;
+
+  for( unsigned int s = 0; s < 2; ++s )
+    {
+    // Reference: full Dijkstra from the seed.
+    VertexDescriptorType seed = adaptor->GetVertexFromIndex( seeds[s], inside );
+    boost::dijkstra_shortest_paths( graph, seed,
+                                    boost::predecessor_map( &Predecessors[0] ).distance_map( &Distances[0] ) );
+
+    finder->SetSeed( seeds[s] );
+
+    for( unsigned int t = 0; t < 3; ++t )
+      {
+      VertexDescriptorType v = adaptor->GetVertexFromIndex( targets[t], inside );
+
+      PathFinderType::PathType path;
+      if( !finder->GetPath( targets[t], path ) )
+        {
+        std::cerr << "no path to " << targets[t] << std::endl;
+        return EXIT_FAILURE;
+        }
+
+      // The first query only settles the pixels closer than the target.
+      if( s == 0 && t == 0 && finder->GetNumberOfSettledVertices() >= num_vertices( graph ) / 10 )
+        {
+        std::cerr << "search not lazy: " << finder->GetNumberOfSettledVertices() << std::endl;
+        return EXIT_FAILURE;
+        }
+
+      if( path.front() != seeds[s] || path.back() != targets[t] )
+        {
+        std::cerr << "path from " << path.front() << " to " << path.back() << std::endl;
+        return EXIT_FAILURE;
+        }
+
+      WeightType length = 0.;
+      for( size_t i = 1; i < path.size(); ++i )
+        {
+        length += metric.Evaluate( input, path[i - 1], path[i] );
+        }
+
+      if( length != Distances[v] || finder->GetDistance( targets[t] ) != Distances[v] )
+        {
+        std::cerr << "distance to " << targets[t] << ": " << length
+                  << " != " << Distances[v] << std::endl;
+        return EXIT_FAILURE;
+        }
+
+      std::cout << seeds[s] << " -> " << targets[t] << ": " << length
+                << " (" << finder->GetNumberOfSettledVertices() << " settled)" << std::endl;
+      }
+    }
+
+  // Once settled, a query does not expand the search any further.
+  itk::SizeValueType settled = finder->GetNumberOfSettledVertices();
+
+  PathFinderType::PathType path;
+  finder->GetPath( targets[0], path );
+
+  if( !finder->IsSettled( targets[0] ) || finder->GetNumberOfSettledVertices() != settled )
+    {
+    std::cerr << "settled pixel expanded again" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
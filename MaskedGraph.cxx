@@ -0,0 +1,158 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  typedef unsigned char PixelType;
+  const unsigned int Dimension = 2;
+
+  typedef itk::Image< PixelType, Dimension > ImageType;
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+
+  typedef double                                                              WeightType;
+
+  typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::undirectedS,
+    boost::no_property, boost::property< boost::edge_weight_t, WeightType > > GraphType;
+
+  typedef itk::IndexMetric< ImageType, WeightType >                           MetricType;
+  typedef itk::ImageBoostGraphAdaptor< ImageType, GraphType, MetricType >     AdaptorType;
+
+  std::vector< AdaptorType::NeighborhoodIteratorOffsetType > offset( 4 );
+
+  size_t k = 0;
+  offset[k][0] = -1;
+  offset[k][1] = 0;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = 0;
+  k++;
+
+  offset[k][0] = 0;
+  offset[k][1] = -1;
+  k++;
+
+  offset[k][0] = 0;
+  offset[k][1] = 1;
+  k++;
+
+  // Foreground: the bright pixels.
+  typedef AdaptorType::MaskImageType MaskImageType;
+
+  ImageType::RegionType region = input->GetLargestPossibleRegion();
+
+  MaskImageType::Pointer mask = MaskImageType::New();
+  mask->CopyInformation( input );
+  mask->SetRegions( region );
+  mask->Allocate();
+
+  itk::SizeValueType numberOfForegroundPixels = 0;
+
+  typedef itk::ImageRegionConstIteratorWithIndex< ImageType > IteratorType;
+  IteratorType it( input, region );
+
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    const bool foreground = ( it.Get() > 128 );
+    mask->SetPixel( it.GetIndex(), foreground ? 1 : 0 );
+    numberOfForegroundPixels += foreground ? 1 : 0;
+    }
+
+  // Edges between two foreground pixels.
+  itk::SizeValueType numberOfForegroundEdges = 0;
+
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    ImageType::IndexType idx = it.GetIndex();
+    for( k = 0; k < offset.size(); ++k )
+      {
+      ImageType::IndexType neighIdx = idx + offset[k];
+      if( region.IsInside( neighIdx ) && mask->GetPixel( idx ) && mask->GetPixel( neighIdx ) )
+        {
+        ++numberOfForegroundEdges;
+        }
+      }
+    }
+  numberOfForegroundEdges /= 2;
+
+  AdaptorType::Pointer adaptor = AdaptorType::New();
+  adaptor->SetInput( input );
+  adaptor->SetMaskImage( mask );
+  adaptor->SetNeighbors( offset );
+  adaptor->Update();
+
+  typedef AdaptorType::VertexDescriptorType VertexDescriptorType;
+
+  const GraphType& graph = adaptor->GetOutput();
+
+  std::cout << numberOfForegroundPixels << " / " << region.GetNumberOfPixels() << " pixels, "
+            << num_edges( graph ) << " edges" << std::endl;
+
+  if( num_vertices( graph ) != numberOfForegroundPixels ||
+      num_edges( graph ) != numberOfForegroundEdges ||
+      adaptor->ComputeNumberOfEdges() != numberOfForegroundEdges )
+    {
+    std::cerr << "graph size: " << num_vertices( graph ) << " vertices, "
+              << num_edges( graph ) << " edges" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Compact numbering: foreground pixels are the vertices 0 .. n - 1, in
+  // raster order; background pixels have no vertex.
+  VertexDescriptorType expected = 0;
+
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    bool inside = false;
+    VertexDescriptorType v = adaptor->GetVertexFromIndex( it.GetIndex(), inside );
+
+    if( inside != static_cast< bool >( mask->GetPixel( it.GetIndex() ) ) )
+      {
+      std::cerr << "pixel " << it.GetIndex() << " inside: " << inside << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    if( inside )
+      {
+      if( v != expected || adaptor->GetIndexFromVertex( v ) != it.GetIndex() )
+        {
+        std::cerr << "vertex of " << it.GetIndex() << ": " << v << " != " << expected << std::endl;
+        return EXIT_FAILURE;
+        }
+      ++expected;
+      }
+    }
+
+  // Edges join neighbor pixels, with the metric as weight.
+  MetricType metric;
+
+  AdaptorType::GraphTraits::edge_iterator eIt, eEnd;
+  for( boost::tie( eIt, eEnd ) = edges( graph ); eIt != eEnd; ++eIt )
+    {
+    ImageType::IndexType a = adaptor->GetIndexFromVertex( source( *eIt, graph ) );
+    ImageType::IndexType b = adaptor->GetIndexFromVertex( target( *eIt, graph ) );
+
+    if( std::abs( a[0] - b[0] ) + std::abs( a[1] - b[1] ) != 1 ||
+        get( boost::edge_weight, graph, *eIt ) != metric.Evaluate( input, a, b ) )
+      {
+      std::cerr << "edge " << a << " - " << b << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  std::cout << "SUCCESS!" << std::endl;
+  return EXIT_SUCCESS;
+}
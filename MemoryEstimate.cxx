@@ -0,0 +1,204 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkImageRegionIterator.h"
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  typedef unsigned char PixelType;
+  const unsigned int Dimension = 2;
+
+  typedef itk::Image< PixelType, Dimension > ImageType;
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+
+  typedef double                                                              WeightType;
+
+  typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::undirectedS,
+    boost::no_property, boost::property< boost::edge_weight_t, WeightType > > GraphType;
+
+  typedef itk::IndexMetric< ImageType, WeightType >                           MetricType;
+  typedef itk::ImageBoostGraphAdaptor< ImageType, GraphType, MetricType >     AdaptorType;
+
+  std::vector< AdaptorType::NeighborhoodIteratorOffsetType > offset;
+  for( int i = -1; i <= 1; ++i )
+    {
+    for( int j = -1; j <= 1; ++j )
+      {
+      if( i != 0 || j != 0 )
+        {
+        AdaptorType::NeighborhoodIteratorOffsetType o;
+        o[0] = i;
+        o[1] = j;
+        offset.push_back( o );
+        }
+      }
+    }
+
+  AdaptorType::Pointer adaptor = AdaptorType::New();
+  adaptor->SetInput( input );
+  adaptor->SetNeighbors( offset );
+
+  typedef itk::GraphMemoryEstimate EstimateType;
+
+  EstimateType estimate;
+  adaptor->EstimateMemory( estimate );
+
+  for( unsigned int r = 0; r < EstimateType::NumberOfRepresentations; ++r )
+    {
+    std::cout << EstimateType::GetRepresentationName( static_cast< EstimateType::RepresentationType >( r ) )
+              << ": " << estimate.Bytes[ r ] << " bytes" << std::endl;
+    }
+
+  const itk::SizeValueType adjacencyListBytes = estimate.Bytes[ EstimateType::AdjacencyListRepresentation ];
+
+  if( estimate.Bytes[ EstimateType::ImplicitRepresentation ] >= estimate.Bytes[ EstimateType::COORepresentation ] ||
+      estimate.Bytes[ EstimateType::COORepresentation ] >= estimate.Bytes[ EstimateType::CSRRepresentation ] ||
+      estimate.Bytes[ EstimateType::CSRRepresentation ] >= adjacencyListBytes )
+    {
+    std::cerr << "unexpected ranking of the representations" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Cheapest representation for the concepts of a few algorithms.
+  EstimateType::RepresentationType representation;
+
+  // Dijkstra on the stencil
+  if( !estimate.SelectRepresentation( EstimateType::IncidenceGraphConcept, 0, representation ) ||
+      representation != EstimateType::ImplicitRepresentation )
+    {
+    std::cerr << "incidence: " << representation << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // sparse linear algebra
+  if( !estimate.SelectRepresentation( EstimateType::IncidenceGraphConcept | EstimateType::StoredWeightsConcept,
+                                      0, representation ) ||
+      representation != EstimateType::CSRRepresentation )
+    {
+    std::cerr << "stored incidence: " << representation << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Kruskal
+  if( !estimate.SelectRepresentation( EstimateType::EdgeListGraphConcept | EstimateType::StoredWeightsConcept,
+                                      0, representation ) ||
+      representation != EstimateType::COORepresentation )
+    {
+    std::cerr << "edge list: " << representation << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // max-flow on a residual graph, without enough memory
+  if( estimate.SelectRepresentation( EstimateType::MutableGraphConcept, adjacencyListBytes / 2, representation ) )
+    {
+    std::cerr << "mutable graph within half of its size" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Update() refuses to go over the budget, and builds nothing.
+  adaptor->SetMemoryBudget( adjacencyListBytes / 2 );
+
+  bool thrown = false;
+  try
+    {
+    adaptor->Update();
+    }
+  catch( itk::ExceptionObject& e )
+    {
+    std::cout << e.GetDescription() << std::endl;
+    thrown = true;
+    }
+
+  if( !thrown || num_vertices( adaptor->GetOutput() ) != 0 )
+    {
+    std::cerr << "graph built over the budget" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  adaptor->SetMemoryBudget( adjacencyListBytes );
+  adaptor->Update();
+
+  if( num_vertices( adaptor->GetOutput() ) != estimate.NumberOfVertices ||
+      num_edges( adaptor->GetOutput() ) != estimate.NumberOfEdges )
+    {
+    std::cerr << "estimated " << estimate.NumberOfVertices << " vertices and "
+              << estimate.NumberOfEdges << " edges, built "
+              << num_vertices( adaptor->GetOutput() ) << " and "
+              << num_edges( adaptor->GetOutput() ) << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Counts with a mask: the bright half of the image.
+  AdaptorType::MaskImageType::Pointer mask = AdaptorType::MaskImageType::New();
+  mask->CopyInformation( input );
+  mask->SetRegions( input->GetLargestPossibleRegion() );
+  mask->Allocate();
+
+  itk::ImageRegionIterator< AdaptorType::MaskImageType > maskIt( mask, mask->GetLargestPossibleRegion() );
+  for( maskIt.GoToBegin(); !maskIt.IsAtEnd(); ++maskIt )
+    {
+    maskIt.Set( input->GetPixel( maskIt.GetIndex() ) > 128 ? 1 : 0 );
+    }
+
+  adaptor->SetMaskImage( mask );
+  adaptor->EstimateMemory( estimate );
+  adaptor->Update();
+
+  if( num_vertices( adaptor->GetOutput() ) != estimate.NumberOfVertices ||
+      num_edges( adaptor->GetOutput() ) != estimate.NumberOfEdges )
+    {
+    std::cerr << "masked: estimated " << estimate.NumberOfVertices << " vertices and "
+              << estimate.NumberOfEdges << " edges, built "
+              << num_vertices( adaptor->GetOutput() ) << " and "
+              << num_edges( adaptor->GetOutput() ) << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The containers are reserved with their final sizes: one allocation per
+  // incidence list, and one for all the edges with a vecS edge list.
+  typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::bidirectionalS,
+    boost::no_property, boost::property< boost::edge_weight_t, WeightType >,
+    boost::no_property, boost::vecS >                                         VectorGraphType;
+  typedef itk::ImageBoostGraphAdaptor< ImageType, VectorGraphType, MetricType > VectorAdaptorType;
+
+  VectorAdaptorType::Pointer vectorAdaptor = VectorAdaptorType::New();
+  vectorAdaptor->SetInput( input );
+  vectorAdaptor->SetNeighbors( offset.begin(), offset.begin() + 5 );
+  vectorAdaptor->SetMaskImage( mask );
+  vectorAdaptor->Update();
+
+  const VectorGraphType& vectorGraph = vectorAdaptor->GetOutput();
+
+  if( vectorGraph.m_edges.capacity() != num_edges( vectorGraph ) )
+    {
+    std::cerr << "edge list capacity " << vectorGraph.m_edges.capacity() << " for "
+              << num_edges( vectorGraph ) << " edges" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  for( VectorAdaptorType::VertexDescriptorType v = 0; v < num_vertices( vectorGraph ); ++v )
+    {
+    if( vectorGraph.m_vertices[ v ].m_out_edges.capacity() != out_degree( v, vectorGraph ) ||
+        vectorGraph.m_vertices[ v ].m_in_edges.capacity() != in_degree( v, vectorGraph ) )
+      {
+      std::cerr << "vertex " << v << ": capacities " << vectorGraph.m_vertices[ v ].m_out_edges.capacity()
+                << " and " << vectorGraph.m_vertices[ v ].m_in_edges.capacity() << " for degrees "
+                << out_degree( v, vectorGraph ) << " and " << in_degree( v, vectorGraph ) << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  std::cout << "SUCCESS!" << std::endl;
+  return EXIT_SUCCESS;
+}
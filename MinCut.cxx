@@ -60,7 +60,7 @@ int main( int argc, char* argv[] )
   std::cout << "Graph constructed" << std::endl;
 
   typedef AdaptorType::GraphType GraphType;
-  GraphType graph = adaptor->GetOutput();
+  const GraphType& graph = adaptor->GetOutput();
 
   typedef AdaptorType::VertexDescriptorType   VertexDescriptorType;
   typedef AdaptorType::EdgeValueType          WeightType;
@@ -0,0 +1,282 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkMultiLabelGraphCutImageFilter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIterator.h"
+
+#include <cmath>
+
+// Potts energy of a labeling, each edge of the stencil counted once.
+template< class TCostImage, class TLabelImage >
+double Energy( const std::vector< typename TCostImage::Pointer >& iCosts,
+               const TLabelImage* iLabels,
+               const std::vector< typename TLabelImage::OffsetType >& iOffsets,
+               double iSmoothness )
+{
+  const typename TLabelImage::RegionType region = iLabels->GetLargestPossibleRegion();
+  itk::ImageRegionConstIteratorWithIndex< TLabelImage > it( iLabels, region );
+
+  double energy = 0.;
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    energy += iCosts[ it.Get() ]->GetPixel( it.GetIndex() );
+    for( size_t k = 0; k < iOffsets.size(); ++k )
+      {
+      const typename TLabelImage::IndexType neighbor = it.GetIndex() + iOffsets[ k ];
+      if( region.IsInside( neighbor ) && iLabels->GetPixel( neighbor ) != it.Get() )
+        {
+        energy += iSmoothness;
+        }
+      }
+    }
+  return energy;
+}
+
+template< class TImage >
+typename TImage::Pointer NewImage( const typename TImage::RegionType& iRegion )
+{
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions( iRegion );
+  image->Allocate();
+  image->FillBuffer( 0 );
+  return image;
+}
+
+// Deterministic pseudo-random numbers in [0, 1)
+double Random( unsigned int& ioState )
+{
+  ioState = ioState * 1664525u + 1013904223u;
+  return static_cast< double >( ioState >> 8 ) / 16777216.;
+}
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  typedef unsigned char PixelType;
+  const unsigned int Dimension = 2;
+
+  typedef itk::Image< PixelType, Dimension > ImageType;
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  typedef itk::Image< unsigned char, Dimension >                              LabelImageType;
+  typedef itk::MultiLabelGraphCutImageFilter< ImageType, LabelImageType >     FilterType;
+  typedef FilterType::CostImageType                                           CostImageType;
+
+  std::vector< ImageType::OffsetType > offset( 2 );
+  offset[0][0] = 1;
+  offset[0][1] = 0;
+  offset[1][0] = 0;
+  offset[1][1] = 1;
+
+  // Random costs on a 4 x 3 image: the energies are compared with the
+  // optimum, found by enumerating the 3^12 labelings.
+  ImageType::RegionType smallRegion;
+  smallRegion.SetSize( 0, 4 );
+  smallRegion.SetSize( 1, 3 );
+
+  const unsigned int numberOfLabels = 3;
+  const double smoothness = 0.35;
+  unsigned int state = 7;
+
+  ImageType::Pointer smallInput = NewImage< ImageType >( smallRegion );
+  std::vector< CostImageType::Pointer > smallCosts( numberOfLabels );
+  for( unsigned int l = 0; l < numberOfLabels; ++l )
+    {
+    smallCosts[ l ] = NewImage< CostImageType >( smallRegion );
+    itk::ImageRegionIterator< CostImageType > it( smallCosts[ l ], smallRegion );
+    for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+      {
+      it.Set( static_cast< float >( Random( state ) ) );
+      }
+    }
+
+  LabelImageType::Pointer candidate = NewImage< LabelImageType >( smallRegion );
+  const unsigned int numberOfPixels = smallRegion.GetNumberOfPixels();
+
+  double optimum[ numberOfLabels + 1 ];
+  for( unsigned int n = 2; n <= numberOfLabels; ++n )
+    {
+    std::vector< CostImageType::Pointer > costs( smallCosts.begin(), smallCosts.begin() + n );
+    optimum[ n ] = 1e30;
+
+    unsigned int count = 1;
+    for( unsigned int p = 0; p < numberOfPixels; ++p )
+      {
+      count *= n;
+      }
+    for( unsigned int c = 0; c < count; ++c )
+      {
+      unsigned int code = c;
+      for( unsigned int p = 0; p < numberOfPixels; ++p, code /= n )
+        {
+        candidate->GetBufferPointer()[ p ] = code % n;
+        }
+      optimum[ n ] = std::min( optimum[ n ],
+        Energy< CostImageType, LabelImageType >( costs, candidate, offset, smoothness ) );
+      }
+    }
+
+  for( unsigned int n = 2; n <= numberOfLabels; ++n )
+    {
+    for( int move = FilterType::AlphaExpansion; move <= FilterType::AlphaBetaSwap; ++move )
+      {
+      FilterType::Pointer filter = FilterType::New();
+      filter->SetInput( smallInput );
+      filter->SetNeighbors( offset );
+      filter->SetSmoothness( smoothness );
+      filter->SetMoveType( static_cast< FilterType::MoveType >( move ) );
+      for( unsigned int l = 0; l < n; ++l )
+        {
+        filter->SetDataCost( l, smallCosts[ l ] );
+        }
+      filter->Update();
+
+      std::vector< CostImageType::Pointer > costs( smallCosts.begin(), smallCosts.begin() + n );
+      const double energy = Energy< CostImageType, LabelImageType >( costs, filter->GetOutput(), offset, smoothness );
+
+      std::cout << n << " labels, move " << move << ": " << energy
+                << " (optimum " << optimum[ n ] << ")" << std::endl;
+
+      if( std::abs( energy - filter->GetEnergy() ) > 1e-5 )
+        {
+        std::cerr << "energy " << filter->GetEnergy() << " != " << energy << std::endl;
+        return EXIT_FAILURE;
+        }
+
+      // A single move is exact with two labels; expansion is within a
+      // factor 2 of the optimum for the Potts model.
+      const double bound = ( n == 2 ) ? optimum[ n ] :
+        ( move == FilterType::AlphaExpansion ? 2. * optimum[ n ] : 1e30 );
+      if( energy < optimum[ n ] - 1e-5 || energy > bound + 1e-5 )
+        {
+        std::cerr << "energy " << energy << " is not within bounds" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  // Three intensity classes on the input image: the moves lower the energy
+  // of the cheapest labels.
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+  const ImageType::RegionType region = input->GetLargestPossibleRegion();
+
+  const double means[ numberOfLabels ] = { 30., 128., 225. };
+  std::vector< CostImageType::Pointer > costs( numberOfLabels );
+  for( unsigned int l = 0; l < numberOfLabels; ++l )
+    {
+    costs[ l ] = NewImage< CostImageType >( region );
+    itk::ImageRegionConstIterator< ImageType > inIt( input, region );
+    itk::ImageRegionIterator< CostImageType > it( costs[ l ], region );
+    for( inIt.GoToBegin(), it.GoToBegin(); !it.IsAtEnd(); ++inIt, ++it )
+      {
+      it.Set( static_cast< float >( std::abs( inIt.Get() - means[ l ] ) / 50. ) );
+      }
+    }
+
+  LabelImageType::Pointer cheapest = NewImage< LabelImageType >( region );
+  itk::ImageRegionIterator< LabelImageType > cheapestIt( cheapest, region );
+  for( cheapestIt.GoToBegin(); !cheapestIt.IsAtEnd(); ++cheapestIt )
+    {
+    for( unsigned int l = 1; l < numberOfLabels; ++l )
+      {
+      if( costs[ l ]->GetPixel( cheapestIt.GetIndex() ) < costs[ cheapestIt.Get() ]->GetPixel( cheapestIt.GetIndex() ) )
+        {
+        cheapestIt.Set( l );
+        }
+      }
+    }
+  const double initialEnergy = Energy< CostImageType, LabelImageType >( costs, cheapest, offset, 1. );
+
+  for( int move = FilterType::AlphaExpansion; move <= FilterType::AlphaBetaSwap; ++move )
+    {
+    FilterType::Pointer filter = FilterType::New();
+    filter->SetInput( input );
+    filter->SetNeighbors( offset );
+    filter->SetMoveType( static_cast< FilterType::MoveType >( move ) );
+    for( unsigned int l = 0; l < numberOfLabels; ++l )
+      {
+      filter->SetDataCost( l, costs[ l ] );
+      }
+    filter->Update();
+
+    const double energy = Energy< CostImageType, LabelImageType >( costs, filter->GetOutput(), offset, 1. );
+
+    std::cout << "move " << move << ": " << initialEnergy << " -> " << energy
+              << " in " << filter->GetNumberOfIterations() << " cycles" << std::endl;
+
+    if( std::abs( energy - filter->GetEnergy() ) > 1e-6 * energy || energy >= initialEnergy )
+      {
+      std::cerr << "energy " << filter->GetEnergy() << " / " << energy << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Two noisy halves of a volume, 6-connected.
+  typedef itk::Image< PixelType, 3 >                                          VolumeType;
+  typedef itk::Image< unsigned char, 3 >                                      VolumeLabelType;
+  typedef itk::MultiLabelGraphCutImageFilter< VolumeType, VolumeLabelType >   VolumeFilterType;
+  typedef VolumeFilterType::CostImageType                                     VolumeCostType;
+
+  VolumeType::RegionType volumeRegion;
+  for( unsigned int dim = 0; dim < 3; ++dim )
+    {
+    volumeRegion.SetSize( dim, 16 );
+    }
+
+  VolumeType::Pointer volume = NewImage< VolumeType >( volumeRegion );
+  std::vector< VolumeCostType::Pointer > volumeCosts( 2 );
+  volumeCosts[0] = NewImage< VolumeCostType >( volumeRegion );
+  volumeCosts[1] = NewImage< VolumeCostType >( volumeRegion );
+
+  itk::ImageRegionIterator< VolumeType > volumeIt( volume, volumeRegion );
+  for( volumeIt.GoToBegin(); !volumeIt.IsAtEnd(); ++volumeIt )
+    {
+    const double value = ( volumeIt.GetIndex()[2] < 8 ? 80. : 170. ) + 160. * ( Random( state ) - 0.5 );
+    volumeIt.Set( static_cast< PixelType >( value ) );
+    volumeCosts[0]->SetPixel( volumeIt.GetIndex(), static_cast< float >( std::abs( value - 80. ) / 45. ) );
+    volumeCosts[1]->SetPixel( volumeIt.GetIndex(), static_cast< float >( std::abs( value - 170. ) / 45. ) );
+    }
+
+  std::vector< VolumeType::OffsetType > volumeOffset( 3 );
+  for( unsigned int k = 0; k < 3; ++k )
+    {
+    volumeOffset[k].Fill( 0 );
+    volumeOffset[k][k] = 1;
+    }
+
+  VolumeFilterType::Pointer volumeFilter = VolumeFilterType::New();
+  volumeFilter->SetInput( volume );
+  volumeFilter->SetNeighbors( volumeOffset );
+  volumeFilter->SetDataCost( 0, volumeCosts[0] );
+  volumeFilter->SetDataCost( 1, volumeCosts[1] );
+  volumeFilter->Update();
+
+  size_t agree = 0;
+  itk::ImageRegionConstIteratorWithIndex< VolumeLabelType > labelIt( volumeFilter->GetOutput(), volumeRegion );
+  for( labelIt.GoToBegin(); !labelIt.IsAtEnd(); ++labelIt )
+    {
+    if( labelIt.Get() == ( labelIt.GetIndex()[2] < 8 ? 0 : 1 ) )
+      {
+      ++agree;
+      }
+    }
+
+  const double ratio = static_cast< double >( agree ) / static_cast< double >( volumeRegion.GetNumberOfPixels() );
+  std::cout << "Volume agreement: " << ratio << std::endl;
+
+  if( ratio < 0.99 )
+    {
+    return EXIT_FAILURE;
+    }
+
+  std::cout << "SUCCESS!" << std::endl;
+  return EXIT_SUCCESS;
+}
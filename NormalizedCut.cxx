@@ -0,0 +1,170 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkNormalizedCutImageFilter.h"
+
+#include <map>
+
+typedef unsigned char PixelType;
+const unsigned int Dimension = 2;
+
+typedef itk::Image< PixelType, Dimension >                                        ImageType;
+typedef itk::Image< unsigned char, Dimension >                                    LabelImageType;
+typedef itk::NormalizedCutImageFilter< ImageType, LabelImageType >                FilterType;
+
+// Fraction of the pixels whose label is the one expected from the gray level
+// class of the input, classes being matched to labels by first occurrence.
+double Agreement( const ImageType* iClasses, const LabelImageType* iLabels )
+{
+  const ImageType::RegionType region = iClasses->GetLargestPossibleRegion();
+
+  itk::ImageRegionConstIterator< ImageType >      classIt( iClasses, region );
+  itk::ImageRegionConstIterator< LabelImageType > labelIt( iLabels, region );
+
+  std::map< PixelType, unsigned char > match;
+  size_t agree = 0;
+  size_t total = 0;
+
+  for( classIt.GoToBegin(), labelIt.GoToBegin(); !classIt.IsAtEnd(); ++classIt, ++labelIt, ++total )
+    {
+    if( match.find( classIt.Get() ) == match.end() )
+      {
+      match[ classIt.Get() ] = labelIt.Get();
+      }
+    if( match[ classIt.Get() ] == labelIt.Get() )
+      {
+      ++agree;
+      }
+    }
+  return static_cast< double >( agree ) / static_cast< double >( total );
+}
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The filter adds the opposite offsets.
+  std::vector< ImageType::OffsetType > offset( 2 );
+  offset[0][0] = 1;
+  offset[0][1] = 0;
+  offset[1][0] = 0;
+  offset[1][1] = 1;
+
+  // Three flat vertical bands, with noise: three clusters, for any number
+  // of threads.
+  ImageType::RegionType bandRegion;
+  ImageType::SizeType   bandSize;
+  bandSize[0] = 90;
+  bandSize[1] = 40;
+  bandRegion.SetSize( bandSize );
+
+  ImageType::Pointer bands = ImageType::New();
+  bands->SetRegions( bandRegion );
+  bands->Allocate();
+
+  ImageType::Pointer classes = ImageType::New();
+  classes->SetRegions( bandRegion );
+  classes->Allocate();
+
+  unsigned int state = 1;
+  itk::ImageRegionIteratorWithIndex< ImageType > bandIt( bands, bandRegion );
+  for( bandIt.GoToBegin(); !bandIt.IsAtEnd(); ++bandIt )
+    {
+    const unsigned int band = bandIt.GetIndex()[0] / 30;
+    state = state * 1103515245u + 12345u;
+    bandIt.Set( static_cast< PixelType >( 40 + 80 * band + ( state >> 16 ) % 9 ) );
+    classes->SetPixel( bandIt.GetIndex(), static_cast< PixelType >( band ) );
+    }
+
+  const unsigned int threads[] = { 1, 2, 5 };
+  for( unsigned int i = 0; i < 3; ++i )
+    {
+    FilterType::Pointer filter = FilterType::New();
+    filter->SetInput( bands );
+    filter->SetNeighbors( offset );
+    filter->SetNumberOfClusters( 3 );
+    filter->SetNumberOfThreads( threads[ i ] );
+    filter->Update();
+
+    const std::vector< double >& eigenvalues = filter->GetEigenvalues();
+    std::cout << "Bands, " << threads[ i ] << " threads: " << filter->GetNumberOfIterations()
+              << " iterations, eigenvalues " << eigenvalues[0] << " "
+              << eigenvalues[1] << " " << eigenvalues[2] << std::endl;
+
+    if( eigenvalues.size() != 3 || eigenvalues[1] < 0. || eigenvalues[1] > eigenvalues[2] ||
+        eigenvalues[2] > 1e-2 )
+      {
+      std::cerr << "unexpected eigenvalues" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    if( Agreement( classes.GetPointer(), filter->GetOutput() ) != 1. )
+      {
+      std::cerr << "bands are not separated" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Yin-yang: the disk, both of its halves, against the white background
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( input );
+  filter->SetNeighbors( offset );
+  filter->Update();
+
+  std::cout << filter->GetNumberOfLevels() << " levels, " << filter->GetNumberOfIterations()
+            << " iterations on the image, eigenvalue " << filter->GetEigenvalues()[1] << std::endl;
+
+  // The dark pixels all lie in the disk, the border of the image outside.
+  const ImageType::RegionType region = input->GetLargestPossibleRegion();
+  const LabelImageType* labels = filter->GetOutput();
+  const unsigned char outside = labels->GetPixel( region.GetIndex() );
+  unsigned char inside = 0;
+  size_t disk = 0;
+  size_t misplaced = 0;
+
+  itk::ImageRegionIteratorWithIndex< ImageType > inIt( input, region );
+  for( inIt.GoToBegin(); !inIt.IsAtEnd(); ++inIt )
+    {
+    const ImageType::IndexType index = inIt.GetIndex();
+    const unsigned char label = labels->GetPixel( index );
+
+    bool border = false;
+    for( unsigned int dim = 0; dim < Dimension; ++dim )
+      {
+      border = border || index[ dim ] == region.GetIndex()[ dim ] ||
+               index[ dim ] == region.GetIndex()[ dim ] + static_cast< itk::IndexValueType >( region.GetSize()[ dim ] ) - 1;
+      }
+    if( border && label != outside )
+      {
+      ++misplaced;
+      }
+    if( inIt.Get() < 128 )
+      {
+      inside = ( inside == 0 ) ? label : inside;
+      misplaced += ( label != inside );
+      }
+    disk += ( label != outside );
+    }
+
+  std::cout << disk << " pixels in the disk, " << misplaced << " misplaced" << std::endl;
+
+  if( inside == 0 || inside == outside || misplaced > 0 )
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageBoostGraphAdaptor.h"
+
+typedef unsigned char PixelType;
+const unsigned int Dimension = 2;
+
+typedef itk::Image< PixelType, Dimension > ImageType;
+typedef double                             WeightType;
+
+typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::undirectedS,
+  boost::no_property, boost::property< boost::edge_weight_t, WeightType > > GraphType;
+
+typedef itk::IndexMetric< ImageType, WeightType >                           MetricType;
+typedef itk::ImageBoostGraphAdaptor< ImageType, GraphType, MetricType >     AdaptorType;
+
+typedef AdaptorType::CSRMatrixType        CSRMatrixType;
+typedef AdaptorType::PatchGraphArenaType  ArenaType;
+typedef AdaptorType::ExportIndexType      ExportIndexType;
+
+// Each block of the arena against ExportCSR() on the region of its patch.
+bool CheckPatches( ImageType* ioInput, AdaptorType* iAdaptor,
+                   const std::vector< ImageType::RegionType >& iRegions, const ArenaType& iArena )
+{
+  if( iArena.GetNumberOfPatches() != iRegions.size() )
+    {
+    std::cerr << iArena.GetNumberOfPatches() << " patches for " << iRegions.size() << " regions" << std::endl;
+    return false;
+    }
+
+  const ImageType::RegionType requested = ioInput->GetRequestedRegion();
+  bool ok = true;
+
+  for( itk::SizeValueType p = 0; p < iRegions.size() && ok; ++p )
+    {
+    ioInput->SetRequestedRegion( iRegions[ p ] );
+
+    CSRMatrixType matrix;
+    iAdaptor->ExportCSR( matrix );
+
+    const ExportIndexType numberOfVertices = iArena.GetNumberOfVertices( p );
+    const ExportIndexType* rows = iArena.GetRowPointers( p );
+
+    if( numberOfVertices != matrix.GetNumberOfRows() ||
+        iArena.GetNumberOfEntries( p ) != matrix.GetNumberOfEntries() )
+      {
+      std::cerr << "patch " << p << ": " << numberOfVertices << " vertices, "
+                << iArena.GetNumberOfEntries( p ) << " entries" << std::endl;
+      ok = false;
+      break;
+      }
+
+    for( ExportIndexType u = 0; u <= numberOfVertices && ok; ++u )
+      {
+      ok = ( rows[ u ] == matrix.GetRowPointers()[ u ] );
+      }
+    for( ExportIndexType e = 0; e < matrix.GetNumberOfEntries() && ok; ++e )
+      {
+      ok = ( iArena.GetColumns( p )[ e ] == matrix.GetColumns()[ e ] &&
+             iArena.GetValues( p )[ e ] == matrix.GetValues()[ e ] );
+      }
+    if( !ok )
+      {
+      std::cerr << "patch " << p << " " << iRegions[ p ] << " differs from ExportCSR" << std::endl;
+      }
+    }
+
+  ioInput->SetRequestedRegion( requested );
+  return ok;
+}
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+  const ImageType::RegionType region = input->GetLargestPossibleRegion();
+
+  // 8-connectivity, and a long-range offset so that patches have rows of
+  // several lengths.
+  std::vector< AdaptorType::NeighborhoodIteratorOffsetType > offset( 5 );
+  offset[0][0] = 1;
+  offset[0][1] = 0;
+  offset[1][0] = 0;
+  offset[1][1] = 1;
+  offset[2][0] = 1;
+  offset[2][1] = 1;
+  offset[3][0] = 1;
+  offset[3][1] = -1;
+  offset[4][0] = 3;
+  offset[4][1] = 0;
+
+  // Overlapping 16 x 12 windows, clipped by the image (so of several sizes),
+  // and an empty one.
+  std::vector< ImageType::RegionType > regions;
+  for( itk::IndexValueType y = 0; y < static_cast< itk::IndexValueType >( region.GetSize()[1] ); y += 9 )
+    {
+    for( itk::IndexValueType x = 0; x < static_cast< itk::IndexValueType >( region.GetSize()[0] ); x += 13 )
+      {
+      ImageType::IndexType index;
+      index[0] = region.GetIndex()[0] + x;
+      index[1] = region.GetIndex()[1] + y;
+
+      ImageType::SizeType size;
+      size[0] = 16;
+      size[1] = 12;
+
+      ImageType::RegionType window( index, size );
+      window.Crop( region );
+      regions.push_back( window );
+      }
+    }
+  regions.push_back( ImageType::RegionType() );
+
+  AdaptorType::Pointer adaptor = AdaptorType::New();
+  adaptor->SetInput( input );
+  adaptor->SetNeighbors( offset );
+  adaptor->SetNumberOfThreads( 3 );
+
+  ArenaType arena;
+  adaptor->ExportPatches( regions, arena );
+
+  if( !CheckPatches( input, adaptor, regions, arena ) )
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << arena.GetNumberOfPatches() << " patches, "
+            << arena.GetNumberOfTopologies() << " topologies, "
+            << arena.GetVertexStarts().back() << " vertices, "
+            << arena.GetEdgeStarts().back() << " entries" << std::endl;
+
+  // Patches of the same size share their rows and columns.
+  for( itk::SizeValueType p = 1; p < regions.size(); ++p )
+    {
+    const bool sameSize = ( regions[ p ].GetSize() == regions[ 0 ].GetSize() );
+    if( sameSize != ( arena.GetRowPointers( p ) == arena.GetRowPointers( 0 ) ) ||
+        sameSize != ( arena.GetColumns( p ) == arena.GetColumns( 0 ) ) )
+      {
+      std::cerr << "patch " << p << " " << regions[ p ] << " does not share the topology of "
+                << regions[ 0 ] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Masked: topologies per patch. The arena is reused.
+  typedef AdaptorType::MaskImageType MaskImageType;
+
+  MaskImageType::Pointer mask = MaskImageType::New();
+  mask->SetRegions( region );
+  mask->Allocate();
+
+  itk::ImageRegionConstIteratorWithIndex< ImageType > it( input, region );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    mask->SetPixel( it.GetIndex(), it.Get() > 128 ? 1 : 0 );
+    }
+
+  adaptor->SetMaskImage( mask );
+  adaptor->ExportPatches( regions, arena );
+
+  if( !CheckPatches( input, adaptor, regions, arena ) )
+    {
+    return EXIT_FAILURE;
+    }
+  if( arena.GetNumberOfTopologies() != regions.size() )
+    {
+    std::cerr << arena.GetNumberOfTopologies() << " masked topologies" << std::endl;
+    return EXIT_FAILURE;
+    }
+  std::cout << "masked: " << arena.GetVertexStarts().back() << " vertices, "
+            << arena.GetEdgeStarts().back() << " entries" << std::endl;
+
+  // A patch outside the image.
+  ImageType::IndexType shifted = region.GetIndex();
+  shifted[0] += 1;
+
+  std::vector< ImageType::RegionType > outside( 1, ImageType::RegionType( shifted, region.GetSize() ) );
+
+  try
+    {
+    adaptor->ExportPatches( outside, arena );
+    std::cerr << "no exception for a patch outside the image" << std::endl;
+    return EXIT_FAILURE;
+    }
+  catch( itk::ExceptionObject& )
+    {
+    }
+
+  std::cout << "SUCCESS!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkGeodesicDistanceMapImageFilter.h"
+#include "itkPhysicalDistanceMetric.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include <cmath>
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  typedef unsigned char PixelType;
+  const unsigned int Dimension = 2;
+
+  typedef itk::Image< PixelType, Dimension > ImageType;
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+  input->DisconnectPipeline();
+
+  // Anisotropic pixels
+  ImageType::SpacingType spacing;
+  spacing[0] = 1.;
+  spacing[1] = 2.5;
+  input->SetSpacing( spacing );
+
+  std::vector< ImageType::OffsetType > offset;
+  for( int i = -1; i <= 1; ++i )
+    {
+    for( int j = -1; j <= 1; ++j )
+      {
+      if( i != 0 || j != 0 )
+        {
+        ImageType::OffsetType o;
+        o[0] = i;
+        o[1] = j;
+        offset.push_back( o );
+        }
+      }
+    }
+
+  // Purely geometric cost: the geodesic distance is the length of the
+  // shortest 8-connected path in physical units.
+  typedef itk::Image< double, Dimension >                                     DistanceImageType;
+  typedef itk::Image< unsigned short, Dimension >                             LabelImageType;
+  typedef itk::PhysicalDistanceMetric< ImageType, double >                    DistanceMetricType;
+  typedef itk::GeodesicDistanceMapImageFilter< ImageType, DistanceImageType,
+    LabelImageType, DistanceMetricType >                                      FilterType;
+
+  DistanceMetricType distanceMetric;
+  distanceMetric.SetIntensityWeight( 0. );
+  distanceMetric.SetDistanceWeight( 1. );
+
+  ImageType::IndexType seed;
+  seed[0] = 320;
+  seed[1] = 240;
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( input );
+  filter->SetNeighbors( offset );
+  filter->SetMetric( distanceMetric );
+  filter->AddSeed( seed, 1 );
+  filter->Update();
+
+  const double diagonal = std::sqrt( spacing[0] * spacing[0] + spacing[1] * spacing[1] );
+
+  itk::ImageRegionConstIteratorWithIndex< DistanceImageType >
+    it( filter->GetDistanceMap(), input->GetLargestPossibleRegion() );
+
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    const double dx = std::abs( it.GetIndex()[0] - seed[0] );
+    const double dy = std::abs( it.GetIndex()[1] - seed[1] );
+    const double m = std::min( dx, dy );
+    const double expected = m * diagonal + ( dx - m ) * spacing[0] + ( dy - m ) * spacing[1];
+
+    if( std::abs( it.Get() - expected ) > 1e-6 * ( 1. + expected ) )
+      {
+      std::cerr << "distance at " << it.GetIndex() << ": " << it.Get()
+                << " != " << expected << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Intensity cost scaled by the edge length on the graph.
+  typedef float WeightType;
+
+  typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::undirectedS,
+    boost::no_property,
+    boost::property< boost::edge_weight_t, WeightType > >                     GraphType;
+  typedef itk::IndexMetric< ImageType, WeightType >                           IntensityMetricType;
+  typedef itk::PhysicalDistanceMetric< ImageType, WeightType >                MetricType;
+  typedef itk::ImageBoostGraphAdaptor< ImageType, GraphType, MetricType >     AdaptorType;
+
+  AdaptorType::Pointer adaptor = AdaptorType::New();
+  adaptor->SetInput( input );
+  adaptor->SetNeighbors( offset );
+  adaptor->Update();
+
+  const GraphType& graph = adaptor->GetOutput();
+  IntensityMetricType intensityMetric;
+
+  AdaptorType::GraphTraits::edge_iterator eIt, eEnd;
+  for( boost::tie( eIt, eEnd ) = edges( graph ); eIt != eEnd; ++eIt )
+    {
+    ImageType::IndexType a = adaptor->GetIndexFromVertex( source( *eIt, graph ) );
+    ImageType::IndexType b = adaptor->GetIndexFromVertex( target( *eIt, graph ) );
+
+    const double length = ( a[0] != b[0] && a[1] != b[1] ) ? diagonal :
+                          ( a[0] != b[0] ? spacing[0] : spacing[1] );
+    const double expected = length * intensityMetric.Evaluate( input, a, b );
+    const double weight = get( boost::edge_weight, graph, *eIt );
+
+    if( std::abs( weight - expected ) > 1e-4 * ( 1. + expected ) )
+      {
+      std::cerr << "edge " << a << " - " << b << ": " << weight
+                << " != " << expected << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Long-range offsets: a table entry each, read by offset id, and the
+  // pairs given without an id computed on the fly.
+  std::vector< ImageType::OffsetType > longRange( 2 );
+  longRange[0][0] = static_cast< itk::OffsetValueType >( input->GetLargestPossibleRegion().GetSize()[0] ) + 1;
+  longRange[0][1] = 0;
+  longRange[1][0] = -3;
+  longRange[1][1] = 1000;
+
+  distanceMetric.Initialize( input, longRange );
+
+  ImageType::IndexType origin;
+  origin.Fill( 0 );
+
+  ImageType::OffsetType zeroOffset;
+  zeroOffset.Fill( 0 );
+
+  std::vector< ImageType::OffsetType > probes( longRange );
+  for( size_t k = 0; k < longRange.size(); ++k )
+    {
+    probes.push_back( zeroOffset - longRange[ k ] );
+    }
+  probes.push_back( offset[0] );
+
+  for( size_t k = 0; k < probes.size(); ++k )
+    {
+    const double dx = spacing[0] * probes[ k ][0];
+    const double dy = spacing[1] * probes[ k ][1];
+    const double expected = std::sqrt( dx * dx + dy * dy );
+    const double length = ( k < longRange.size() ) ?
+      distanceMetric.Evaluate( input, origin, origin + probes[ k ], static_cast< unsigned int >( k ) ) :
+      distanceMetric.Evaluate( input, origin, origin + probes[ k ] );
+
+    if( std::abs( length - expected ) > 1e-6 * expected )
+      {
+      std::cerr << "length of " << probes[ k ] << ": " << length << " != " << expected << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  std::cout << "SUCCESS!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,135 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageBoostGraphAdaptor.h"
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  typedef unsigned char PixelType;
+  const unsigned int Dimension = 2;
+
+  typedef itk::Image< PixelType, Dimension > ImageType;
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+  input->DisconnectPipeline();
+
+  typedef double                                                              WeightType;
+
+  typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::undirectedS,
+    boost::no_property, boost::property< boost::edge_weight_t, WeightType > > GraphType;
+
+  typedef itk::IndexMetric< ImageType, WeightType >                           MetricType;
+  typedef itk::ImageBoostGraphAdaptor< ImageType, GraphType, MetricType >     AdaptorType;
+
+  std::vector< AdaptorType::NeighborhoodIteratorOffsetType > offset( 2 );
+
+  size_t k = 0;
+  offset[k][0] = -1;
+  offset[k][1] = 0;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = 0;
+  k++;
+
+  AdaptorType::Pointer adaptor = AdaptorType::New();
+  adaptor->SetInput( input );
+  adaptor->SetNeighbors( offset );
+  adaptor->Update();
+
+  const AdaptorType::GraphObjectType* output = adaptor->GetGraphOutput();
+
+  itk::ModifiedTimeType buildTime = output->GetUpdateMTime();
+  size_t numberOfEdges = num_edges( adaptor->GetOutput() );
+
+  ImageType::SizeType size = input->GetLargestPossibleRegion().GetSize();
+
+  if( numberOfEdges != ( size[0] - 1 ) * size[1] )
+    {
+    std::cerr << "number of edges: " << numberOfEdges << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Nothing changed: the graph must not be generated again.
+  adaptor->Update();
+
+  if( output->GetUpdateMTime() != buildTime )
+    {
+    std::cerr << "graph generated again without any modification" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Pixel values changed: same edges, new weights.
+  ImageType::IndexType idx, neighIdx;
+  idx[0] = 10;
+  idx[1] = 10;
+  neighIdx[0] = 11;
+  neighIdx[1] = 10;
+
+  input->SetPixel( idx, 0 );
+  input->SetPixel( neighIdx, 200 );
+  input->Modified();
+
+  adaptor->Update();
+
+  if( output->GetUpdateMTime() == buildTime )
+    {
+    std::cerr << "graph not updated after input modification" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const GraphType& graph = adaptor->GetOutput();
+
+  if( num_edges( graph ) != numberOfEdges )
+    {
+    std::cerr << "number of edges after reweighting: " << num_edges( graph ) << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  bool inside = false;
+  AdaptorType::VertexDescriptorType u = adaptor->GetVertexFromIndex( idx, inside );
+  AdaptorType::VertexDescriptorType v = adaptor->GetVertexFromIndex( neighIdx, inside );
+
+  std::pair< AdaptorType::EdgeDescriptorType, bool > e = edge( u, v, graph );
+
+  if( !e.second || get( boost::edge_weight, graph, e.first ) != 200. * 200. )
+    {
+    std::cerr << "weight not updated" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Stencil changed: the topology is built again.
+  offset.resize( 4 );
+  offset[k][0] = 0;
+  offset[k][1] = -1;
+  k++;
+
+  offset[k][0] = 0;
+  offset[k][1] = 1;
+  k++;
+
+  adaptor->ClearNeighbors();
+  adaptor->SetNeighbors( offset );
+  adaptor->Update();
+
+  numberOfEdges = ( size[0] - 1 ) * size[1] + size[0] * ( size[1] - 1 );
+
+  if( num_edges( adaptor->GetOutput() ) != numberOfEdges )
+    {
+    std::cerr << "number of edges after stencil modification: "
+              << num_edges( adaptor->GetOutput() ) << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::cout << "SUCCESS!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,167 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkRandomWalkerImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  typedef unsigned char PixelType;
+  const unsigned int Dimension = 2;
+
+  typedef itk::Image< PixelType, Dimension > ImageType;
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+
+  typedef itk::Image< unsigned char, Dimension >                              LabelImageType;
+  typedef itk::IndexMetric< ImageType, double >                               MetricType;
+  typedef itk::RandomWalkerImageFilter< ImageType, LabelImageType, MetricType > FilterType;
+
+  // The filter adds the opposite offsets.
+  std::vector< ImageType::OffsetType > offset( 2 );
+
+  size_t k = 0;
+  offset[k][0] = 1;
+  offset[k][1] = 0;
+  k++;
+
+  offset[k][0] = 0;
+  offset[k][1] = 1;
+  k++;
+
+  // One seed in the black half, one in the white half and one in the
+  // background, separated from the white half by the thin outline.
+  LabelImageType::Pointer seeds = LabelImageType::New();
+  seeds->CopyInformation( input );
+  seeds->SetRegions( input->GetLargestPossibleRegion() );
+  seeds->Allocate();
+  seeds->FillBuffer( 0 );
+
+  ImageType::IndexType idx1, idx2, idx3;
+  idx1[0] = 200;
+  idx1[1] = 200;
+
+  idx2[0] = 10;
+  idx2[1] = 10;
+
+  idx3[0] = 270;
+  idx3[1] = 110;
+
+  seeds->SetPixel( idx1, 1 );
+  seeds->SetPixel( idx2, 2 );
+  seeds->SetPixel( idx3, 3 );
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( input );
+  filter->SetSeedImage( seeds );
+  filter->SetNeighbors( offset );
+  filter->Update();
+
+  LabelImageType::Pointer labels = filter->GetOutput();
+
+  std::cout << "Iterations: " << filter->GetNumberOfIterations() << std::endl;
+
+  // Compare with a threshold of the (almost binary) input: black pixels
+  // must get label 1, white ones label 2 or 3.
+  ImageType::RegionType region = input->GetLargestPossibleRegion();
+
+  itk::ImageRegionConstIterator< ImageType >      inIt( input, region );
+  itk::ImageRegionConstIterator< LabelImageType > labelIt( labels, region );
+
+  size_t agree = 0;
+  size_t total = 0;
+
+  for( inIt.GoToBegin(), labelIt.GoToBegin(); !inIt.IsAtEnd(); ++inIt, ++labelIt, ++total )
+    {
+    if( ( inIt.Get() < 128 ) == ( labelIt.Get() == 1 ) )
+      {
+      ++agree;
+      }
+    }
+
+  const double ratio = static_cast< double >( agree ) / static_cast< double >( total );
+  std::cout << "Agreement with threshold: " << ratio << std::endl;
+
+  if( ratio < 0.95 )
+    {
+    return EXIT_FAILURE;
+    }
+
+  ImageType::IndexType idx;
+  idx[0] = 10;
+  idx[1] = 300;
+
+  if( labels->GetPixel( idx ) != 2 )
+    {
+    std::cerr << "label[ " << idx << " ] = " << static_cast< int >( labels->GetPixel( idx ) ) << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  idx[0] = 350;
+  idx[1] = 130;
+
+  if( labels->GetPixel( idx ) != 3 )
+    {
+    std::cerr << "label[ " << idx << " ] = " << static_cast< int >( labels->GetPixel( idx ) ) << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // On a 5x1 line with the stencil +-3, pixels 0-3 and 1-4 are linked and
+  // pixel 2 is isolated: it must be left unlabeled, without spoiling the
+  // solve of the others.
+  ImageType::RegionType lineRegion;
+  lineRegion.SetIndex( region.GetIndex() );
+  ImageType::SizeType lineSize;
+  lineSize[0] = 5;
+  lineSize[1] = 1;
+  lineRegion.SetSize( lineSize );
+
+  ImageType::Pointer line = ImageType::New();
+  line->SetRegions( lineRegion );
+  line->Allocate();
+  line->FillBuffer( 100 );
+
+  LabelImageType::Pointer lineSeeds = LabelImageType::New();
+  lineSeeds->SetRegions( lineRegion );
+  lineSeeds->Allocate();
+  lineSeeds->FillBuffer( 0 );
+
+  idx = lineRegion.GetIndex();
+  lineSeeds->SetPixel( idx, 1 );
+  idx[0] += 4;
+  lineSeeds->SetPixel( idx, 2 );
+
+  std::vector< ImageType::OffsetType > lineOffset( 1 );
+  lineOffset[0][0] = 3;
+  lineOffset[0][1] = 0;
+
+  FilterType::Pointer lineFilter = FilterType::New();
+  lineFilter->SetInput( line );
+  lineFilter->SetSeedImage( lineSeeds );
+  lineFilter->SetNeighbors( lineOffset );
+  lineFilter->Update();
+
+  const unsigned char expected[5] = { 1, 2, 0, 1, 2 };
+  for( unsigned int i = 0; i < 5; ++i )
+    {
+    idx = lineRegion.GetIndex();
+    idx[0] += i;
+    if( lineFilter->GetOutput()->GetPixel( idx ) != expected[i] )
+      {
+      std::cerr << "line label[ " << i << " ] = "
+                << static_cast< int >( lineFilter->GetOutput()->GetPixel( idx ) ) << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,101 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageBoostGraphAdaptor.h"
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  typedef unsigned char PixelType;
+  const unsigned int Dimension = 2;
+
+  typedef itk::Image< PixelType, Dimension > ImageType;
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+
+  typedef double                                                              WeightType;
+
+  typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::undirectedS,
+    boost::no_property, boost::property< boost::edge_weight_t, WeightType > > GraphType;
+
+  typedef itk::IndexMetric< ImageType, WeightType >                           MetricType;
+  typedef itk::ImageBoostGraphAdaptor< ImageType, GraphType, MetricType >     AdaptorType;
+
+  std::vector< AdaptorType::NeighborhoodIteratorOffsetType > offset( 2 );
+
+  size_t k = 0;
+  offset[k][0] = -1;
+  offset[k][1] = 0;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = 0;
+  k++;
+
+  AdaptorType::Pointer adaptor = AdaptorType::New();
+  adaptor->SetInput( input );
+  adaptor->SetNeighbors( offset );
+  adaptor->Update();
+
+  const size_t numberOfVertices = input->GetLargestPossibleRegion().GetNumberOfPixels();
+  const size_t numberOfEdges    = num_edges( adaptor->GetOutput() );
+
+  // Take the graph over without copying it.
+  GraphType graph;
+  adaptor->ReleaseOutput( graph );
+
+  if( num_vertices( graph ) != numberOfVertices || num_edges( graph ) != numberOfEdges )
+    {
+    std::cerr << "released graph: " << num_vertices( graph ) << " vertices, "
+              << num_edges( graph ) << " edges" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( num_vertices( adaptor->GetOutput() ) != 0 )
+    {
+    std::cerr << "adaptor still holds " << num_vertices( adaptor->GetOutput() )
+              << " vertices" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The next update builds the graph again.
+  adaptor->Update();
+
+  if( num_edges( adaptor->GetOutput() ) != numberOfEdges )
+    {
+    std::cerr << "rebuilt graph has " << num_edges( adaptor->GetOutput() ) << " edges" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Share the graph: it outlives the adaptor once disconnected.
+  AdaptorType::GraphObjectType::Pointer shared = adaptor->GetGraphOutput();
+  shared->DisconnectPipeline();
+
+  adaptor->Update();
+
+  if( adaptor->GetGraphOutput() == shared.GetPointer() ||
+      num_edges( adaptor->GetOutput() ) != numberOfEdges )
+    {
+    std::cerr << "adaptor did not generate a new output" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  adaptor = NULL;
+
+  if( num_edges( shared->Get() ) != numberOfEdges )
+    {
+    std::cerr << "shared graph has " << num_edges( shared->Get() ) << " edges" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::cout << "SUCCESS!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,126 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkImageRegionIterator.h"
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  typedef unsigned char PixelType;
+  const unsigned int Dimension = 2;
+
+  typedef itk::Image< PixelType, Dimension > ImageType;
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+  ImageType::RegionType region = input->GetLargestPossibleRegion();
+
+  typedef float                                                               WeightType;
+
+  typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::undirectedS,
+    boost::no_property, boost::property< boost::edge_weight_t, WeightType > > GraphType;
+
+  typedef itk::IndexMetric< ImageType, WeightType >                           MetricType;
+  typedef itk::ImageBoostGraphAdaptor< ImageType, GraphType, MetricType >     AdaptorType;
+  typedef AdaptorType::ExportIndexType                                        IndexType;
+
+  // A series of frames with the geometry of the input.
+  const unsigned int numberOfFrames = 3;
+
+  std::vector< ImageType::Pointer > frames( numberOfFrames );
+  for( unsigned int f = 0; f < numberOfFrames; ++f )
+    {
+    frames[ f ] = ImageType::New();
+    frames[ f ]->CopyInformation( input );
+    frames[ f ]->SetRegions( region );
+    frames[ f ]->Allocate();
+
+    itk::ImageRegionIterator< ImageType > it( frames[ f ], region );
+    for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+      {
+      const unsigned int v = input->GetPixel( it.GetIndex() );
+      it.Set( static_cast< PixelType >( ( f == 0 ) ? v : ( ( f == 1 ) ? 255 - v : v / 2 ) ) );
+      }
+    }
+
+  std::vector< AdaptorType::NeighborhoodIteratorOffsetType > offset;
+  for( int i = -1; i <= 1; ++i )
+    {
+    for( int j = -1; j <= 1; ++j )
+      {
+      if( i != 0 || j != 0 )
+        {
+        AdaptorType::NeighborhoodIteratorOffsetType o;
+        o[0] = i;
+        o[1] = j;
+        offset.push_back( o );
+        }
+      }
+    }
+
+  AdaptorType::Pointer adaptor = AdaptorType::New();
+  adaptor->SetInput( input );
+
+  for( unsigned int pass = 0; pass < 2; ++pass )
+    {
+    // 8-connected, then 4-connected: the topology is computed again.
+    std::vector< AdaptorType::NeighborhoodIteratorOffsetType > stencil = offset;
+    if( pass == 1 )
+      {
+      stencil.clear();
+      stencil.push_back( offset[1] );
+      stencil.push_back( offset[3] );
+      }
+
+    adaptor->ClearNeighbors();
+    adaptor->SetNeighbors( stencil );
+
+    const itk::SizeValueType numberOfEdges = adaptor->ComputeNumberOfEdges();
+
+    std::vector< std::vector< WeightType > > weights( numberOfFrames,
+                                                      std::vector< WeightType >( numberOfEdges ) );
+    std::vector< const ImageType* > framePointers( numberOfFrames );
+    std::vector< WeightType* > weightPointers( numberOfFrames );
+    for( unsigned int f = 0; f < numberOfFrames; ++f )
+      {
+      framePointers[ f ] = frames[ f ];
+      weightPointers[ f ] = &weights[ f ][0];
+      }
+
+    // Twice: the second call reuses the topology of the first one.
+    adaptor->ComputeWeights( framePointers, weightPointers );
+    adaptor->ComputeWeights( framePointers, weightPointers );
+
+    // Same weights, in the same order, as a full export of each frame.
+    std::vector< IndexType > sources( numberOfEdges );
+    std::vector< IndexType > targets( numberOfEdges );
+    std::vector< WeightType > expected( numberOfEdges );
+
+    for( unsigned int f = 0; f < numberOfFrames; ++f )
+      {
+      AdaptorType::Pointer frameAdaptor = AdaptorType::New();
+      frameAdaptor->SetInput( frames[ f ] );
+      frameAdaptor->SetNeighbors( stencil );
+      frameAdaptor->ExportCOO( &sources[0], &targets[0], &expected[0] );
+
+      if( weights[ f ] != expected )
+        {
+        std::cerr << "pass " << pass << ", frame " << f << ": weights differ from the export" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+
+    std::cout << numberOfEdges << " edges, " << numberOfFrames << " frames" << std::endl;
+    }
+
+  std::cout << "SUCCESS!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -76,7 +76,7 @@ int main( int argc, char* argv[] )
   std::cout << "Graph constructed" << std::endl;
 
   typedef AdaptorType::GraphType GraphType;
-  GraphType graph = adaptor->GetOutput();
+  const GraphType& graph = adaptor->GetOutput();
 
   ImageType::IndexType idx1, idx2;
   idx1[0] = 320;
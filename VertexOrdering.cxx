@@ -0,0 +1,209 @@
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageVertexOrdering.h"
+
+#include <boost/graph/dijkstra_shortest_paths.hpp>
+
+/** Check that iOrdering numbers the pixels of iRegion from 0 to n - 1, each
+ *  once, and that ComputeIndex inverts ComputeVertex. */
+template< class TOrdering >
+bool CheckBijection( TOrdering& iOrdering, const typename TOrdering::RegionType& iRegion )
+{
+  typedef typename TOrdering::RegionType RegionType;
+  typedef itk::Image< unsigned char, RegionType::ImageDimension > FlagImageType;
+
+  iOrdering.Initialize( iRegion );
+
+  typename FlagImageType::Pointer flags = FlagImageType::New();
+  flags->SetRegions( iRegion );
+  flags->Allocate();
+
+  std::vector< bool > used( iRegion.GetNumberOfPixels(), false );
+  std::vector< typename TOrdering::IndexType > indices;
+
+  itk::ImageRegionConstIteratorWithIndex< FlagImageType > it( flags, iRegion );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    indices.push_back( it.GetIndex() );
+
+    typename TOrdering::VertexType v = iOrdering.ComputeVertex( it.GetIndex() );
+
+    if( v < 0 || v >= static_cast< typename TOrdering::VertexType >( used.size() ) || used[v] )
+      {
+      std::cerr << "vertex " << v << " of " << it.GetIndex() << " is invalid or used twice" << std::endl;
+      return false;
+      }
+    used[v] = true;
+
+    if( iOrdering.ComputeIndex( v ) != it.GetIndex() )
+      {
+      std::cerr << "vertex " << v << ": " << iOrdering.ComputeIndex( v )
+                << " != " << it.GetIndex() << std::endl;
+      return false;
+      }
+    }
+
+  // Batch conversions agree with the single ones.
+  std::vector< typename TOrdering::VertexType > vertices( indices.size() );
+  std::vector< typename TOrdering::IndexType >  back( indices.size() );
+
+  iOrdering.ComputeVertices( indices.begin(), indices.end(), vertices.begin() );
+  iOrdering.ComputeIndices( vertices.begin(), vertices.end(), back.begin() );
+
+  for( size_t i = 0; i < indices.size(); ++i )
+    {
+    if( vertices[i] != iOrdering.ComputeVertex( indices[i] ) || back[i] != indices[i] )
+      {
+      std::cerr << "batch conversion of " << indices[i] << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cerr << argv[0] << " <InputImage>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  typedef unsigned char PixelType;
+  const unsigned int Dimension = 2;
+
+  typedef itk::Image< PixelType, Dimension > ImageType;
+  typedef itk::ImageFileReader< ImageType >  ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+  reader->Update();
+
+  ImageType::Pointer input = reader->GetOutput();
+
+  typedef double                                                              WeightType;
+
+  typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::undirectedS,
+    boost::no_property, boost::property< boost::edge_weight_t, WeightType > > GraphType;
+
+  typedef itk::IndexMetric< ImageType, WeightType >                           MetricType;
+  typedef itk::ImageBoostGraphAdaptor< ImageType, GraphType, MetricType >     AdaptorType;
+
+  std::vector< AdaptorType::NeighborhoodIteratorOffsetType > offset( 8 );
+
+  size_t k = 0;
+  offset[k][0] = -1;
+  offset[k][1] = -1;
+  k++;
+
+  offset[k][0] = -1;
+  offset[k][1] = 0;
+  k++;
+
+  offset[k][0] = -1;
+  offset[k][1] = 1;
+  k++;
+
+  offset[k][0] = 0;
+  offset[k][1] = -1;
+  k++;
+
+  offset[k][0] = 0;
+  offset[k][1] = 1;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = -1;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = 0;
+  k++;
+
+  offset[k][0] = 1;
+  offset[k][1] = 1;
+  k++;
+
+
+  // Bijections on regions that are not a whole number of tiles.
+  typedef itk::ImageVertexOrdering< 2 > Ordering2DType;
+  typedef itk::ImageVertexOrdering< 3 > Ordering3DType;
+
+  Ordering2DType::RegionType region2D;
+  region2D.SetIndex( 0, 3 );
+  region2D.SetIndex( 1, -2 );
+  region2D.SetSize( 0, 37 );
+  region2D.SetSize( 1, 21 );
+
+  Ordering3DType::RegionType region3D;
+  region3D.SetIndex( 0, 1 );
+  region3D.SetIndex( 1, 2 );
+  region3D.SetIndex( 2, 3 );
+  region3D.SetSize( 0, 19 );
+  region3D.SetSize( 1, 10 );
+  region3D.SetSize( 2, 7 );
+
+  for( int order = Ordering2DType::RasterOrder; order <= Ordering2DType::MortonOrder; ++order )
+    {
+    Ordering2DType ordering2D;
+    ordering2D.SetOrder( static_cast< Ordering2DType::OrderType >( order ) );
+
+    Ordering3DType ordering3D;
+    ordering3D.SetOrder( static_cast< Ordering3DType::OrderType >( order ) );
+    ordering3D.SetTileSizeExponent( 2 );
+
+    if( !CheckBijection( ordering2D, region2D ) || !CheckBijection( ordering3D, region3D ) )
+      {
+      std::cerr << "order " << order << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Same shortest path distance whatever the numbering.
+  ImageType::IndexType idx1, idx2;
+  idx1[0] = 320;
+  idx1[1] = 240;
+
+  idx2[0] = 160;
+  idx2[1] = 120;
+
+  typedef AdaptorType::VertexDescriptorType VertexDescriptorType;
+  typedef AdaptorType::VertexOrderingType   VertexOrderingType;
+
+  WeightType reference = 0.;
+
+  for( int order = VertexOrderingType::RasterOrder; order <= VertexOrderingType::MortonOrder; ++order )
+    {
+    VertexOrderingType ordering;
+    ordering.SetOrder( static_cast< VertexOrderingType::OrderType >( order ) );
+
+    AdaptorType::Pointer adaptor = AdaptorType::New();
+    adaptor->SetInput( input );
+    adaptor->SetNeighbors( offset );
+    adaptor->SetVertexOrdering( ordering );
+    adaptor->Update();
+
+    const GraphType& graph = adaptor->GetOutput();
+
+    bool inside = false;
+    VertexDescriptorType v1 = adaptor->GetVertexFromIndex( idx1, inside );
+    VertexDescriptorType v2 = adaptor->GetVertexFromIndex( idx2, inside );
+
+    std::vector< WeightType > Distances( num_vertices( graph ) );
+    boost::dijkstra_shortest_paths( graph, v1, boost::distance_map( &Distances[0] ) );
+
+    std::cout << "order " << order << ": " << Distances[v2] << std::endl;
+
+    if( order == VertexOrderingType::RasterOrder )
+      {
+      reference = Distances[v2];
+      }
+    else if( Distances[v2] != reference )
+      {
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
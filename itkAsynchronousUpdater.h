@@ -0,0 +1,492 @@
+#ifndef __itkAsynchronousUpdater_h
+#define __itkAsynchronousUpdater_h
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkCommand.h"
+#include "itkProcessObject.h"
+#include "itkMultiThreader.h"
+#include "itkMutexLock.h"
+#include "itkConditionVariable.h"
+
+namespace itk
+{
+/** \class AsynchronousUpdater
+ *  \brief Run the Update() of a process object on a worker thread, so that
+ *  it can be waited for, polled or cancelled.
+ *
+ *  Start() returns immediately; Wait() blocks until the update is over and
+ *  tells whether it completed. The process object uses its own number of
+ *  threads for the threaded parts of the update (SetNumberOfThreads()).
+ *
+ *  The jobs of all the updaters run on a shared pool of worker threads: at
+ *  most GetGlobalMaximumNumberOfJobs() updates run at once, the jobs started
+ *  beyond are Queued and run in the order of their Start(). Cancelling a
+ *  queued job removes it from the queue.
+ *
+ *  Cancel() raises the AbortGenerateData flag, which ImageBoostGraphAdaptor
+ *  and the filters of this module check at chunk boundaries (every percent
+ *  of the vertices, or every solver iteration). The update then throws
+ *  ProcessAborted, which is caught on the worker thread, and the outputs of
+ *  the process object are released. The process object clears the flag
+ *  after its StartEvent, so a cancellation which comes before its
+ *  GenerateData() would be lost: the flag is raised again on each of its
+ *  ProgressEvents, and such a cancellation takes effect at the first check
+ *  which follows one.
+ *
+ *  GetProgress() is the progress of the process object, as of its last
+ *  ProgressEvent. Observers of its ProgressEvent, EndEvent and AbortEvent
+ *  are callbacks for the job, and are invoked from the worker thread.
+ *
+ *  The process object must not be used from another thread while the job
+ *  runs.
+ */
+class AsynchronousUpdater : public Object
+  {
+public:
+  typedef AsynchronousUpdater         Self;
+  typedef Object                      Superclass;
+  typedef SmartPointer< Self >        Pointer;
+  typedef SmartPointer< const Self >  ConstPointer;
+
+  /** Method for creation through object factory */
+  itkNewMacro( Self );
+
+  itkTypeMacro( AsynchronousUpdater, Object );
+
+  typedef enum
+    {
+    Idle = 0,
+    Queued,
+    Running,
+    Completed,
+    Cancelled,
+    Failed
+    } StatusType;
+
+  void SetProcessObject( ProcessObject* iProcess )
+    {
+    if( this->IsRunning() )
+      {
+      itkExceptionMacro( << "cannot change the process object of a running job" );
+      }
+
+    if( this->m_ProcessObject == iProcess )
+      {
+      return;
+      }
+
+    if( this->m_ProcessObject )
+      {
+      this->m_ProcessObject->RemoveObserver( this->m_ProgressObserverTag );
+      }
+
+    this->m_ProcessObject = iProcess;
+    this->m_Status = Idle;
+
+    if( iProcess )
+      {
+      typedef SimpleMemberCommand< Self > CommandType;
+      CommandType::Pointer command = CommandType::New();
+      command->SetCallbackFunction( this, &Self::OnProgress );
+      this->m_ProgressObserverTag = iProcess->AddObserver( ProgressEvent(), command );
+      }
+    this->Modified();
+    }
+
+  ProcessObject* GetProcessObject() const
+    {
+    return this->m_ProcessObject.GetPointer();
+    }
+
+  /** Number of threads the process object uses during the update. */
+  void SetNumberOfThreads( ThreadIdType iNumberOfThreads )
+    {
+    if( !this->m_ProcessObject )
+      {
+      itkExceptionMacro( << "process object is null" );
+      }
+    this->m_ProcessObject->SetNumberOfThreads( iNumberOfThreads );
+    }
+
+  /** Maximum number of updates running at once, over all the updaters
+   *  (by default the default number of threads of MultiThreader). */
+  static void SetGlobalMaximumNumberOfJobs( ThreadIdType iNumberOfJobs )
+    {
+    GetJobPool().SetMaximumNumberOfJobs( iNumberOfJobs );
+    }
+
+  static ThreadIdType GetGlobalMaximumNumberOfJobs()
+    {
+    return GetJobPool().GetMaximumNumberOfJobs();
+    }
+
+  /** Queue the update, which starts on a worker thread as soon as one is
+   *  available. */
+  void Start()
+    {
+    if( !this->m_ProcessObject )
+      {
+      itkExceptionMacro( << "process object is null" );
+      }
+
+    if( this->IsRunning() )
+      {
+      itkExceptionMacro( << "job is already running" );
+      }
+
+    this->m_Lock.Lock();
+    this->m_Status          = Queued;
+    this->m_CancelRequested = false;
+    this->m_ErrorMessage    = "";
+    this->m_Progress        = 0.f;
+    this->m_Lock.Unlock();
+
+    this->m_ProcessObject->AbortGenerateDataOff();
+
+    GetJobPool().Push( this );
+    }
+
+  /** Remove the job from the queue, or ask the running update to stop at
+   *  its next chunk boundary. */
+  void Cancel()
+    {
+    if( this->GetStatus() == Queued && GetJobPool().Remove( this ) )
+      {
+      this->Finish( Cancelled, "" );
+      return;
+      }
+
+    this->m_Lock.Lock();
+    if( this->m_Status == Queued || this->m_Status == Running )
+      {
+      this->m_CancelRequested = true;
+      this->m_ProcessObject->AbortGenerateDataOn();
+      }
+    this->m_Lock.Unlock();
+    }
+
+  /** Block until the update is over. Returns true if it completed, false
+   *  if it was cancelled; an update which failed throws its error again. */
+  bool Wait()
+    {
+    const StatusType status = this->WaitForJob();
+    if( status == Failed )
+      {
+      itkExceptionMacro( << "update failed: " << this->GetErrorMessage() );
+      }
+    return status == Completed;
+    }
+
+  StatusType GetStatus() const
+    {
+    this->m_Lock.Lock();
+    const StatusType status = this->m_Status;
+    this->m_Lock.Unlock();
+    return status;
+    }
+
+  /** Whether the job is queued or running. */
+  bool IsRunning() const
+    {
+    const StatusType status = this->GetStatus();
+    return status == Queued || status == Running;
+    }
+
+  /** Progress of the update, in [0, 1]. */
+  float GetProgress() const
+    {
+    this->m_Lock.Lock();
+    const float progress = this->m_Progress;
+    this->m_Lock.Unlock();
+    return progress;
+    }
+
+  std::string GetErrorMessage() const
+    {
+    this->m_Lock.Lock();
+    const std::string message = this->m_ErrorMessage;
+    this->m_Lock.Unlock();
+    return message;
+    }
+
+protected:
+  AsynchronousUpdater() :
+    m_ProgressObserverTag( 0 ),
+    m_Status( Idle ),
+    m_CancelRequested( false ),
+    m_Progress( 0.f )
+    {
+    this->m_Done = ConditionVariable::New();
+    }
+
+  ~AsynchronousUpdater()
+    {
+    this->Cancel();
+    this->WaitForJob();
+    if( this->m_ProcessObject )
+      {
+      this->m_ProcessObject->RemoveObserver( this->m_ProgressObserverTag );
+      }
+    }
+
+  ProcessObject::Pointer  m_ProcessObject;
+  unsigned long           m_ProgressObserverTag;
+
+  /** Guards the status, the cancellation request, the error message and
+   *  the progress, which both threads access; m_Done is signalled when the
+   *  job is over. */
+  mutable SimpleMutexLock     m_Lock;
+  ConditionVariable::Pointer  m_Done;
+  StatusType                  m_Status;
+  bool                        m_CancelRequested;
+  std::string                 m_ErrorMessage;
+  float                       m_Progress;
+
+  /** Block until the job is neither queued nor running. */
+  StatusType WaitForJob()
+    {
+    this->m_Lock.Lock();
+    while( this->m_Status == Queued || this->m_Status == Running )
+      {
+      this->m_Done->Wait( &this->m_Lock );
+      }
+    const StatusType status = this->m_Status;
+    this->m_Lock.Unlock();
+    return status;
+    }
+
+  void Finish( StatusType iStatus, const std::string& iMessage )
+    {
+    this->m_Lock.Lock();
+    this->m_Status = iStatus;
+    this->m_ErrorMessage = iMessage;
+    this->m_Done->Broadcast();
+    this->m_Lock.Unlock();
+    }
+
+  /** On the worker thread, which alone writes the progress of the process
+   *  object: mirror it. The process object clears the abort flag after its
+   *  StartEvent; raise it again before the next check. */
+  void OnProgress()
+    {
+    const float progress = this->m_ProcessObject->GetProgress();
+
+    this->m_Lock.Lock();
+    this->m_Progress = progress;
+    if( this->m_CancelRequested && !this->m_ProcessObject->GetAbortGenerateData() )
+      {
+      this->m_ProcessObject->AbortGenerateDataOn();
+      }
+    this->m_Lock.Unlock();
+    }
+
+  /** The job, on a worker thread of the pool. */
+  void Run()
+    {
+    this->m_Lock.Lock();
+    this->m_Status = Running;
+    this->m_Lock.Unlock();
+
+    StatusType status = Completed;
+    std::string message;
+
+    try
+      {
+      this->m_ProcessObject->Update();
+      }
+    catch( ProcessAborted& )
+      {
+      status = Cancelled;
+      }
+    catch( ExceptionObject& e )
+      {
+      status = Failed;
+      message = e.GetDescription();
+      }
+    catch( std::exception& e )
+      {
+      status = Failed;
+      message = e.what();
+      }
+
+    if( status != Completed )
+      {
+      ProcessObject::DataObjectPointerArray outputs = this->m_ProcessObject->GetOutputs();
+      for( size_t i = 0; i < outputs.size(); ++i )
+        {
+        if( outputs[ i ] )
+          {
+          outputs[ i ]->ReleaseData();
+          }
+        }
+      }
+
+    this->Finish( status, message );
+    }
+
+  /** Worker threads shared by all the updaters, spawned as needed up to the
+   *  maximum number of jobs and kept until the end of the program. A worker
+   *  takes the first queued job when fewer than the maximum are running. */
+  class JobPool
+    {
+  public:
+    JobPool() :
+      m_MaximumNumberOfJobs( MultiThreader::GetGlobalDefaultNumberOfThreads() ),
+      m_NumberOfRunningJobs( 0 ),
+      m_NumberOfIdleWorkers( 0 ),
+      m_Shutdown( false )
+      {
+      this->m_Threader = MultiThreader::New();
+      this->m_Condition = ConditionVariable::New();
+      }
+
+    ~JobPool()
+      {
+      this->m_Lock.Lock();
+      this->m_Shutdown = true;
+      this->m_Condition->Broadcast();
+      this->m_Lock.Unlock();
+
+      for( size_t i = 0; i < this->m_Workers.size(); ++i )
+        {
+        this->m_Threader->TerminateThread( this->m_Workers[ i ] );
+        }
+      }
+
+    void SetMaximumNumberOfJobs( ThreadIdType iNumberOfJobs )
+      {
+      this->m_Lock.Lock();
+      this->m_MaximumNumberOfJobs = ( iNumberOfJobs > 0 ) ? iNumberOfJobs : 1;
+      this->SpawnWorkers();
+      this->m_Condition->Broadcast();
+      this->m_Lock.Unlock();
+      }
+
+    ThreadIdType GetMaximumNumberOfJobs()
+      {
+      this->m_Lock.Lock();
+      const ThreadIdType numberOfJobs = this->m_MaximumNumberOfJobs;
+      this->m_Lock.Unlock();
+      return numberOfJobs;
+      }
+
+    void Push( Self* iJob )
+      {
+      this->m_Lock.Lock();
+      this->m_Queue.push_back( iJob );
+      this->SpawnWorkers();
+      this->m_Condition->Broadcast();
+      this->m_Lock.Unlock();
+      }
+
+    /** Whether iJob was still queued. */
+    bool Remove( Self* iJob )
+      {
+      this->m_Lock.Lock();
+      bool found = false;
+      for( std::deque< Self* >::iterator it = this->m_Queue.begin();
+           it != this->m_Queue.end() && !found; ++it )
+        {
+        if( *it == iJob )
+          {
+          this->m_Queue.erase( it );
+          found = true;
+          }
+        }
+      this->m_Lock.Unlock();
+      return found;
+      }
+
+  protected:
+    SimpleMutexLock             m_Lock;
+    ConditionVariable::Pointer  m_Condition;
+    MultiThreader::Pointer      m_Threader;
+    std::vector< ThreadIdType > m_Workers;
+    std::deque< Self* >         m_Queue;
+    ThreadIdType                m_MaximumNumberOfJobs;
+    ThreadIdType                m_NumberOfRunningJobs;
+    ThreadIdType                m_NumberOfIdleWorkers;
+    bool                        m_Shutdown;
+
+    /** A worker for each queued job which could run now and that no idle
+     *  worker will take; called with the lock held. */
+    void SpawnWorkers()
+      {
+      const SizeValueType free = ( this->m_NumberOfRunningJobs < this->m_MaximumNumberOfJobs ) ?
+        this->m_MaximumNumberOfJobs - this->m_NumberOfRunningJobs : 0;
+      const SizeValueType runnable = std::min( free, static_cast< SizeValueType >( this->m_Queue.size() ) );
+
+      while( this->m_NumberOfIdleWorkers < runnable &&
+             this->m_Workers.size() < this->m_MaximumNumberOfJobs )
+        {
+        this->m_Workers.push_back( this->m_Threader->SpawnThread( WorkerFunction, this ) );
+        ++this->m_NumberOfIdleWorkers;
+        }
+      }
+
+    void Work()
+      {
+      this->m_Lock.Lock();
+      while( true )
+        {
+        if( !this->m_Queue.empty() && this->m_NumberOfRunningJobs < this->m_MaximumNumberOfJobs )
+          {
+          Self* job = this->m_Queue.front();
+          this->m_Queue.pop_front();
+          --this->m_NumberOfIdleWorkers;
+          ++this->m_NumberOfRunningJobs;
+          this->m_Lock.Unlock();
+
+          job->Run();
+
+          this->m_Lock.Lock();
+          --this->m_NumberOfRunningJobs;
+          ++this->m_NumberOfIdleWorkers;
+          this->m_Condition->Broadcast();
+          }
+        else if( this->m_Shutdown )
+          {
+          break;
+          }
+        else
+          {
+          this->m_Condition->Wait( &this->m_Lock );
+          }
+        }
+      this->m_Lock.Unlock();
+      }
+
+    static ITK_THREAD_RETURN_TYPE WorkerFunction( void* arg )
+      {
+      MultiThreader::ThreadInfoStruct* info = static_cast< MultiThreader::ThreadInfoStruct* >( arg );
+      static_cast< JobPool* >( info->UserData )->Work();
+      return ITK_THREAD_RETURN_VALUE;
+      }
+    };
+
+  static JobPool& GetJobPool()
+    {
+    static JobPool pool;
+    return pool;
+    }
+
+  void PrintSelf( std::ostream& os, Indent indent ) const
+    {
+    Superclass::PrintSelf( os, indent );
+    os << indent << "Status: " << this->GetStatus() << std::endl;
+    }
+
+private:
+  AsynchronousUpdater( const Self& );
+  void operator = ( const Self& );
+};
+
+}
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef __itkCompressedSparseRowMatrix_h
+#define __itkCompressedSparseRowMatrix_h
+
+#include <vector>
+
+#include "itkRangeThreader.h"
+
+namespace itk
+{
+/** \class CompressedSparseRowMatrix
+ *  \brief Sparse matrix in CSR layout with a multithreaded product.
+ *
+ *  Row r holds the columns m_Columns[ m_RowPointers[ r ] ...
+ *  m_RowPointers[ r + 1 ] ) and the matching m_Values. The containers are
+ *  exposed so that assemblers can fill them in place, row blocks in
+ *  parallel once the row pointers are known.
+ */
+template< class TValue >
+class CompressedSparseRowMatrix
+  {
+public:
+  typedef TValue                          ValueType;
+  typedef SizeValueType                   IndexType;
+  typedef std::vector< IndexType >        IndexContainerType;
+  typedef std::vector< ValueType >        ValueContainerType;
+
+  CompressedSparseRowMatrix() : m_NumberOfColumns( 0 ), m_RowPointers( 1, 0 ) {}
+
+  /** Allocate the row pointers of an iRows x iColumns matrix. */
+  void SetSize( IndexType iRows, IndexType iColumns )
+    {
+    this->m_NumberOfColumns = iColumns;
+    this->m_RowPointers.assign( iRows + 1, 0 );
+    this->m_Columns.clear();
+    this->m_Values.clear();
+    }
+
+  /** Allocate the entries once the row pointers are filled. */
+  void AllocateEntries()
+    {
+    this->m_Columns.resize( this->m_RowPointers.back() );
+    this->m_Values.resize( this->m_RowPointers.back() );
+    }
+
+  IndexType GetNumberOfRows() const
+    {
+    return this->m_RowPointers.size() - 1;
+    }
+
+  IndexType GetNumberOfColumns() const
+    {
+    return this->m_NumberOfColumns;
+    }
+
+  IndexType GetNumberOfEntries() const
+    {
+    return this->m_RowPointers.back();
+    }
+
+  IndexContainerType& GetRowPointers() { return this->m_RowPointers; }
+  const IndexContainerType& GetRowPointers() const { return this->m_RowPointers; }
+
+  IndexContainerType& GetColumns() { return this->m_Columns; }
+  const IndexContainerType& GetColumns() const { return this->m_Columns; }
+
+  ValueContainerType& GetValues() { return this->m_Values; }
+  const ValueContainerType& GetValues() const { return this->m_Values; }
+
+  /** oY = A * iX where iX and oY hold iNumberOfVectors interleaved vectors
+   *  (row-major, iX[ i * iNumberOfVectors + j ] is entry i of vector j), so
+   *  that several right-hand sides share one pass over the matrix. */
+  void Multiply( const ValueType* iX, ValueType* oY,
+                 unsigned int iNumberOfVectors,
+                 ThreadIdType iNumberOfThreads ) const
+    {
+    MultiplyFunctor functor;
+    functor.Matrix          = this;
+    functor.X               = iX;
+    functor.Y               = oY;
+    functor.NumberOfVectors = iNumberOfVectors;
+
+    RangeThreader< MultiplyFunctor >::Run( this->GetNumberOfRows(), iNumberOfThreads, functor );
+    }
+
+protected:
+  IndexType           m_NumberOfColumns;
+  IndexContainerType  m_RowPointers;
+  IndexContainerType  m_Columns;
+  ValueContainerType  m_Values;
+
+  struct MultiplyFunctor
+    {
+    const CompressedSparseRowMatrix*  Matrix;
+    const ValueType*                  X;
+    ValueType*                        Y;
+    unsigned int                      NumberOfVectors;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      const IndexType* rows     = &Matrix->m_RowPointers[0];
+      const IndexType* columns  = Matrix->m_Columns.empty() ? 0 : &Matrix->m_Columns[0];
+      const ValueType* values   = Matrix->m_Values.empty() ? 0 : &Matrix->m_Values[0];
+      const unsigned int m      = NumberOfVectors;
+
+      // a single vector is accumulated in a register, Y possibly aliasing X
+      // as far as the compiler knows
+      if( m == 1 )
+        {
+        for( SizeValueType r = iBegin; r < iEnd; ++r )
+          {
+          ValueType sum = 0;
+          for( IndexType e = rows[ r ]; e < rows[ r + 1 ]; ++e )
+            {
+            sum += values[ e ] * X[ columns[ e ] ];
+            }
+          Y[ r ] = sum;
+          }
+        return;
+        }
+
+      for( SizeValueType r = iBegin; r < iEnd; ++r )
+        {
+        ValueType* y = Y + r * m;
+        for( unsigned int j = 0; j < m; ++j )
+          {
+          y[ j ] = 0;
+          }
+
+        for( IndexType e = rows[ r ]; e < rows[ r + 1 ]; ++e )
+          {
+          const ValueType  a = values[ e ];
+          const ValueType* x = X + columns[ e ] * m;
+          for( unsigned int j = 0; j < m; ++j )
+            {
+            y[ j ] += a * x[ j ];
+            }
+          }
+        }
+      }
+    };
+};
+
+}
+
+#endif
@@ -0,0 +1,373 @@
+#ifndef __itkGeodesicDistanceMapImageFilter_h
+#define __itkGeodesicDistanceMapImageFilter_h
+
+#include <cmath>
+#include <vector>
+
+#include "itkImageGraphToImageFilter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkNumericTraits.h"
+#include "itkProgressReporter.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkImageStencil.h"
+#include "itkImageVertexOrdering.h"
+#include "itkRadixHeap.h"
+
+namespace itk
+{
+/** \class GeodesicDistanceMapImageFilter
+ *  \brief Multi-source geodesic distance map over the pixel graph.
+ *
+ *  Runs a multi-source Dijkstra over the graph ImageBoostGraphAdaptor would
+ *  build for the same stencil and metric, without materializing it: vertices
+ *  are linear offsets in the output buffers and neighbors are visited through
+ *  the per-offset buffer deltas of an ImageStencil, without bound checks in
+ *  its interior. With an integer output pixel type, e.g. with IndexMetric on
+ *  an integer image, the priority queue is a RadixHeap instead of a binary
+ *  heap; integer distances saturate at the maximum minus one, and metric
+ *  values which are not integers throw.
+ *
+ *  Seeds are the non-zero pixels of the optional seed image (input 1) plus
+ *  the ones given through AddSeed(). Three outputs are written in place:
+ *  the geodesic distance map (output 0), the label of the nearest seed, i.e.
+ *  the geodesic Voronoi partition (output 1), and, for each pixel, the offset
+ *  to its predecessor on the shortest path (output 2, zero on seeds).
+ *
+ *  Shortest paths are global, so the whole largest possible region is
+ *  requested and produced.
+ */
+template< class TInputImage,
+          class TOutputImage = Image< float, TInputImage::ImageDimension >,
+          class TLabelImage = Image< unsigned short, TInputImage::ImageDimension >,
+          class TMetric = IndexMetric< TInputImage, typename TOutputImage::PixelType > >
+class GeodesicDistanceMapImageFilter :
+  public ImageGraphToImageFilter< TInputImage, TOutputImage, TMetric >
+  {
+public:
+  typedef GeodesicDistanceMapImageFilter                                 Self;
+  typedef ImageGraphToImageFilter< TInputImage, TOutputImage, TMetric >  Superclass;
+  typedef SmartPointer< Self >                                           Pointer;
+  typedef SmartPointer< const Self >                                     ConstPointer;
+
+  /** Method for creation through object factory */
+  itkNewMacro( Self );
+
+  itkTypeMacro( GeodesicDistanceMapImageFilter, ImageGraphToImageFilter );
+
+  itkStaticConstMacro( ImageDimension, unsigned int, TInputImage::ImageDimension );
+
+  typedef TInputImage                             InputImageType;
+  typedef typename InputImageType::RegionType     InputImageRegionType;
+  typedef typename InputImageType::IndexType      InputIndexType;
+  typedef typename InputImageType::OffsetType     InputOffsetType;
+  typedef typename InputImageType::OffsetValueType OffsetValueType;
+  typedef typename InputImageType::SizeValueType  SizeValueType;
+
+  typedef TOutputImage                            OutputImageType;
+  typedef typename OutputImageType::PixelType     OutputPixelType;
+
+  typedef TLabelImage                             LabelImageType;
+  typedef typename LabelImageType::PixelType      LabelPixelType;
+
+  typedef Image< InputOffsetType, itkGetStaticConstMacro( ImageDimension ) > PredecessorImageType;
+
+  typedef TMetric MetricType;
+
+  typedef typename Superclass::DataObjectPointer              DataObjectPointer;
+  typedef ProcessObject::DataObjectPointerArraySizeType       DataObjectPointerArraySizeType;
+
+  /** Image whose non-zero pixels are seeds labelled with their value. */
+  void SetSeedImage( const LabelImageType* iSeeds )
+    {
+    this->ProcessObject::SetNthInput( 1, const_cast< LabelImageType* >( iSeeds ) );
+    }
+
+  const LabelImageType* GetSeedImage() const
+    {
+    return static_cast< const LabelImageType* >( this->ProcessObject::GetInput( 1 ) );
+    }
+
+  /** Seeds given by index, in addition to the seed image. */
+  void AddSeed( const InputIndexType& iIndex, const LabelPixelType& iLabel )
+    {
+    this->m_Seeds.push_back( std::make_pair( iIndex, iLabel ) );
+    this->Modified();
+    }
+
+  void ClearSeeds()
+    {
+    this->m_Seeds.clear();
+    this->Modified();
+    }
+
+  /** Pixels whose distance is needed: when some are given, the propagation
+   *  stops as soon as they are all settled. The pixels which are not settled
+   *  by then, including the ones already reached, keep the maximum distance,
+   *  a zero label and a zero predecessor offset. */
+  void AddTarget( const InputIndexType& iIndex )
+    {
+    this->m_Targets.push_back( iIndex );
+    this->Modified();
+    }
+
+  void ClearTargets()
+    {
+    this->m_Targets.clear();
+    this->Modified();
+    }
+
+  OutputImageType* GetDistanceMap()
+    {
+    return dynamic_cast< OutputImageType* >( this->ProcessObject::GetOutput( 0 ) );
+    }
+
+  LabelImageType* GetVoronoiMap()
+    {
+    return dynamic_cast< LabelImageType* >( this->ProcessObject::GetOutput( 1 ) );
+    }
+
+  PredecessorImageType* GetPredecessorMap()
+    {
+    return dynamic_cast< PredecessorImageType* >( this->ProcessObject::GetOutput( 2 ) );
+    }
+
+  using Superclass::MakeOutput;
+  DataObjectPointer MakeOutput( DataObjectPointerArraySizeType idx )
+    {
+    switch( idx )
+      {
+      case 1:
+        return LabelImageType::New().GetPointer();
+      case 2:
+        return PredecessorImageType::New().GetPointer();
+      default:
+        return OutputImageType::New().GetPointer();
+      }
+    }
+
+protected:
+  GeodesicDistanceMapImageFilter()
+    {
+    this->SetNumberOfRequiredOutputs( 3 );
+    this->ProcessObject::SetNthOutput( 1, this->MakeOutput( 1 ) );
+    this->ProcessObject::SetNthOutput( 2, this->MakeOutput( 2 ) );
+    }
+  ~GeodesicDistanceMapImageFilter() {}
+
+  typedef std::pair< InputIndexType, LabelPixelType > SeedType;
+  typedef std::vector< SeedType >                     SeedContainerType;
+  SeedContainerType m_Seeds;
+
+  typedef std::vector< InputIndexType > TargetContainerType;
+  TargetContainerType m_Targets;
+
+  typedef typename Superclass::OffsetContainerType OffsetContainerType;
+  typedef ImageVertexOrdering< ImageDimension >    VertexOrderingType;
+  typedef ImageStencil< ImageDimension >           StencilType;
+
+  /** Radix heap for integer distances, binary heap otherwise. */
+  typedef MonotonePriorityQueue< OutputPixelType, OffsetValueType > QueueType;
+
+  template< bool VInteger > struct DistanceTag {};
+
+  /** iD + iW. Integer distances saturate below the maximum, which marks the
+   *  pixels not reached, and the metric values they cannot hold (negative,
+   *  fractional or too large) are rejected rather than truncated. */
+  template< class TValue >
+  OutputPixelType AddMetric( const OutputPixelType& iD, const TValue& iW ) const
+    {
+    return this->AddMetric( iD, iW, DistanceTag< NumericTraits< OutputPixelType >::is_integer >() );
+    }
+
+  template< class TValue >
+  OutputPixelType AddMetric( const OutputPixelType& iD, const TValue& iW, DistanceTag< false > ) const
+    {
+    return iD + static_cast< OutputPixelType >( iW );
+    }
+
+  template< class TValue >
+  OutputPixelType AddMetric( const OutputPixelType& iD, const TValue& iW, DistanceTag< true > ) const
+    {
+    const OutputPixelType limit = NumericTraits< OutputPixelType >::max() - 1;
+    const double w = static_cast< double >( iW );
+
+    if( w < 0. || w != std::floor( w ) || w > static_cast< double >( limit ) )
+      {
+      itkExceptionMacro( << "metric value " << w << " is not an integer distance in [0, " << limit << "]" );
+      }
+    const OutputPixelType integerW = static_cast< OutputPixelType >( w );
+    return ( integerW > limit - iD ) ? limit : static_cast< OutputPixelType >( iD + integerW );
+    }
+
+  template< class TImage >
+  void AllocateMap( TImage* oImage, const typename TImage::PixelType& iValue )
+    {
+    oImage->SetBufferedRegion( oImage->GetRequestedRegion() );
+    oImage->Allocate();
+    oImage->FillBuffer( iValue );
+    }
+
+  void GenerateData()
+    {
+    const InputImageType* input = this->GetInput();
+
+    OutputImageType*      distanceMap     = this->GetDistanceMap();
+    LabelImageType*       voronoiMap      = this->GetVoronoiMap();
+    PredecessorImageType* predecessorMap  = this->GetPredecessorMap();
+
+    InputOffsetType zeroOffset;
+    zeroOffset.Fill( 0 );
+
+    this->AllocateMap( distanceMap, NumericTraits< OutputPixelType >::max() );
+    this->AllocateMap( voronoiMap, NumericTraits< LabelPixelType >::Zero );
+    this->AllocateMap( predecessorMap, zeroOffset );
+
+    const InputImageRegionType region = distanceMap->GetBufferedRegion();
+
+    // Raster numbering of the output buffers, so that a vertex is its
+    // linear offset and a neighbor is at a constant delta.
+    VertexOrderingType ordering;
+    ordering.Initialize( region );
+
+    OffsetContainerType offsets;
+    StencilType::GenerateOffsets( this->m_OffsetList, offsets, false );
+    InitializeMetric( this->m_Metric, input, offsets );
+
+    StencilType stencil;
+    stencil.Initialize( region, offsets );
+
+    OutputPixelType*  distances     = distanceMap->GetBufferPointer();
+    LabelPixelType*   labels        = voronoiMap->GetBufferPointer();
+    InputOffsetType*  predecessors  = predecessorMap->GetBufferPointer();
+
+    QueueType queue;
+    bool hasSeed = false;
+
+    const OutputPixelType zero = NumericTraits< OutputPixelType >::Zero;
+
+    const LabelImageType* seedImage = this->GetSeedImage();
+    if( seedImage )
+      {
+      ImageRegionConstIteratorWithIndex< LabelImageType > it( seedImage, region );
+
+      for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+        {
+        if( it.Get() != NumericTraits< LabelPixelType >::Zero )
+          {
+          OffsetValueType v = ordering.ComputeVertex( it.GetIndex() );
+          distances[ v ] = zero;
+          labels[ v ] = it.Get();
+          queue.Push( zero, v );
+          hasSeed = true;
+          }
+        }
+      }
+
+    for( typename SeedContainerType::const_iterator it = this->m_Seeds.begin();
+         it != this->m_Seeds.end(); ++it )
+      {
+      if( !region.IsInside( it->first ) )
+        {
+        itkExceptionMacro( << "seed " << it->first << " is outside of " << region );
+        }
+      OffsetValueType v = ordering.ComputeVertex( it->first );
+      distances[ v ] = zero;
+      labels[ v ] = it->second;
+      queue.Push( zero, v );
+      hasSeed = true;
+      }
+
+    if( !hasSeed )
+      {
+      itkExceptionMacro( << "no seed" );
+      }
+
+    // Targets: the propagation stops once they are all settled.
+    std::vector< bool > isTarget;
+    SizeValueType numberOfTargets = 0;
+    if( !this->m_Targets.empty() )
+      {
+      isTarget.assign( region.GetNumberOfPixels(), false );
+      for( typename TargetContainerType::const_iterator it = this->m_Targets.begin();
+           it != this->m_Targets.end(); ++it )
+        {
+        if( region.IsInside( *it ) && !isTarget[ ordering.ComputeVertex( *it ) ] )
+          {
+          isTarget[ ordering.ComputeVertex( *it ) ] = true;
+          ++numberOfTargets;
+          }
+        }
+      }
+
+    ProgressReporter progress( this, 0, region.GetNumberOfPixels() );
+
+    while( !queue.IsEmpty() )
+      {
+      OutputPixelType d;
+      OffsetValueType u;
+      queue.Pop( d, u );
+
+      // lazy deletion: u has already been settled with a shorter distance
+      if( d > distances[ u ] )
+        {
+        continue;
+        }
+
+      if( !isTarget.empty() && isTarget[ u ] )
+        {
+        isTarget[ u ] = false;
+        if( --numberOfTargets == 0 )
+          {
+          break;
+          }
+        }
+
+      const InputIndexType index = ordering.ComputeIndex( u );
+      const bool           isInterior = stencil.IsInterior( index );
+
+      for( unsigned int k = 0; k < stencil.GetNumberOfOffsets(); ++k )
+        {
+        if( isInterior || stencil.IsInside( index, k ) )
+          {
+          const InputIndexType  neighIndex = index + offsets[ k ];
+          const OffsetValueType v = u + stencil.GetDelta( k );
+          const OutputPixelType alt = this->AddMetric( d,
+                EvaluateMetric< double >( this->m_Metric, input, index, neighIndex, k ) );
+
+          if( alt < distances[ v ] )
+            {
+            distances[ v ] = alt;
+            labels[ v ] = labels[ u ];
+            predecessors[ v ] = index - neighIndex;
+            queue.Push( alt, v );
+            }
+          }
+        }
+      progress.CompletedPixel();
+      }
+
+    // Stopped at the targets: the vertices left in the queue with their
+    // current distance were reached but not settled.
+    while( !queue.IsEmpty() )
+      {
+      OutputPixelType d;
+      OffsetValueType u;
+      queue.Pop( d, u );
+
+      if( d == distances[ u ] )
+        {
+        distances[ u ] = NumericTraits< OutputPixelType >::max();
+        labels[ u ] = NumericTraits< LabelPixelType >::Zero;
+        predecessors[ u ] = zeroOffset;
+        }
+      }
+    }
+
+private:
+  GeodesicDistanceMapImageFilter( const Self& );
+  void operator = ( const Self& );
+};
+
+}
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef __itkGraphBreadthFirstDistanceImageFilter_h
+#define __itkGraphBreadthFirstDistanceImageFilter_h
+
+#include <vector>
+
+#include "itkImageGraphToImageFilter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkNumericTraits.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkParallelGraphTraversal.h"
+
+namespace itk
+{
+/** \class GraphBreadthFirstDistanceImageFilter
+ *  \brief Hop distance to the nearest seed in the pixel graph, keeping the
+ *  edges whose metric value is at most MaximumWeight.
+ *
+ *  Seeds are the non-zero pixels of the optional seed image (input 1) plus
+ *  the ones given through AddSeed(). The search is the parallel,
+ *  direction-optimizing one of ParallelGraphTraversal; pixels that cannot
+ *  be reached keep the maximum of the output pixel type.
+ *
+ *  Distances are global, so the whole largest possible region is requested
+ *  and produced.
+ */
+template< class TInputImage,
+          class TOutputImage = Image< unsigned int, TInputImage::ImageDimension >,
+          class TMetric = IndexMetric< TInputImage, double > >
+class GraphBreadthFirstDistanceImageFilter :
+  public ImageGraphToImageFilter< TInputImage, TOutputImage, TMetric >
+  {
+public:
+  typedef GraphBreadthFirstDistanceImageFilter                           Self;
+  typedef ImageGraphToImageFilter< TInputImage, TOutputImage, TMetric >  Superclass;
+  typedef SmartPointer< Self >                                           Pointer;
+  typedef SmartPointer< const Self >                                     ConstPointer;
+
+  /** Method for creation through object factory */
+  itkNewMacro( Self );
+
+  itkTypeMacro( GraphBreadthFirstDistanceImageFilter, ImageGraphToImageFilter );
+
+  itkStaticConstMacro( ImageDimension, unsigned int, TInputImage::ImageDimension );
+
+  typedef TInputImage                             InputImageType;
+  typedef typename InputImageType::RegionType     InputImageRegionType;
+  typedef typename InputImageType::IndexType      InputIndexType;
+  typedef typename InputImageType::OffsetType     InputOffsetType;
+
+  typedef TOutputImage                            OutputImageType;
+  typedef typename OutputImageType::PixelType     OutputPixelType;
+
+  typedef Image< unsigned char, itkGetStaticConstMacro( ImageDimension ) > SeedImageType;
+
+  typedef TMetric                                 MetricType;
+  typedef typename MetricType::OutputType         WeightType;
+  typedef WeightThresholdPredicate< WeightType >  PredicateType;
+
+  typedef ImageGraphNeighborhood< InputImageType, MetricType, PredicateType > NeighborhoodType;
+  typedef ParallelGraphTraversal< NeighborhoodType >                          TraversalType;
+
+  /** Image whose non-zero pixels are seeds. */
+  void SetSeedImage( const SeedImageType* iSeeds )
+    {
+    this->ProcessObject::SetNthInput( 1, const_cast< SeedImageType* >( iSeeds ) );
+    }
+
+  const SeedImageType* GetSeedImage() const
+    {
+    return static_cast< const SeedImageType* >( this->ProcessObject::GetInput( 1 ) );
+    }
+
+  /** Seeds given by index, in addition to the seed image. */
+  void AddSeed( const InputIndexType& iIndex )
+    {
+    this->m_Seeds.push_back( iIndex );
+    this->Modified();
+    }
+
+  void ClearSeeds()
+    {
+    this->m_Seeds.clear();
+    this->Modified();
+    }
+
+  /** Edges whose metric value is larger are not followed. */
+  itkSetMacro( MaximumWeight, WeightType );
+  itkGetConstMacro( MaximumWeight, WeightType );
+
+  /** Direction switches, see ParallelGraphTraversal. */
+  itkSetMacro( Alpha, double );
+  itkGetConstMacro( Alpha, double );
+  itkSetMacro( Beta, double );
+  itkGetConstMacro( Beta, double );
+
+  /** Levels of the last search, and how many of them went bottom-up. */
+  itkGetConstMacro( NumberOfLevels, SizeValueType );
+  itkGetConstMacro( NumberOfBottomUpLevels, SizeValueType );
+
+protected:
+  GraphBreadthFirstDistanceImageFilter() :
+    m_MaximumWeight( NumericTraits< WeightType >::max() ),
+    m_Alpha( 14. ),
+    m_Beta( 24. ),
+    m_NumberOfLevels( 0 ),
+    m_NumberOfBottomUpLevels( 0 )
+    {}
+  ~GraphBreadthFirstDistanceImageFilter() {}
+
+  typedef std::vector< InputIndexType > SeedContainerType;
+  SeedContainerType m_Seeds;
+
+  WeightType    m_MaximumWeight;
+  double        m_Alpha;
+  double        m_Beta;
+  SizeValueType m_NumberOfLevels;
+  SizeValueType m_NumberOfBottomUpLevels;
+
+  void GenerateData()
+    {
+    const InputImageType* input = this->GetInput();
+    OutputImageType* output = this->GetOutput();
+
+    output->SetBufferedRegion( output->GetRequestedRegion() );
+    output->Allocate();
+
+    const InputImageRegionType region = output->GetBufferedRegion();
+
+    NeighborhoodType neighborhood;
+    neighborhood.Initialize( input, region, this->m_OffsetList,
+                             this->m_Metric, PredicateType( this->m_MaximumWeight ) );
+
+    typename TraversalType::VertexContainerType seeds;
+
+    const SeedImageType* seedImage = this->GetSeedImage();
+    if( seedImage )
+      {
+      ImageRegionConstIteratorWithIndex< SeedImageType > it( seedImage, region );
+
+      for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+        {
+        if( it.Get() != NumericTraits< typename SeedImageType::PixelType >::Zero )
+          {
+          seeds.push_back( neighborhood.GetVertexOrdering().ComputeVertex( it.GetIndex() ) );
+          }
+        }
+      }
+
+    for( typename SeedContainerType::const_iterator it = this->m_Seeds.begin();
+         it != this->m_Seeds.end(); ++it )
+      {
+      if( !region.IsInside( *it ) )
+        {
+        itkExceptionMacro( << "seed " << *it << " is outside of " << region );
+        }
+      seeds.push_back( neighborhood.GetVertexOrdering().ComputeVertex( *it ) );
+      }
+
+    if( seeds.empty() )
+      {
+      itkExceptionMacro( << "no seed" );
+      }
+
+    TraversalType traversal;
+    traversal.SetNumberOfThreads( this->GetNumberOfThreads() );
+    traversal.SetAlpha( this->m_Alpha );
+    traversal.SetBeta( this->m_Beta );
+    traversal.ComputeBreadthFirstDistances( neighborhood, seeds, output->GetBufferPointer() );
+
+    this->m_NumberOfLevels = traversal.GetNumberOfLevels();
+    this->m_NumberOfBottomUpLevels = traversal.GetNumberOfBottomUpLevels();
+    }
+
+  void PrintSelf( std::ostream& os, Indent indent ) const
+    {
+    Superclass::PrintSelf( os, indent );
+    os << indent << "MaximumWeight: " << this->m_MaximumWeight << std::endl;
+    os << indent << "Alpha: " << this->m_Alpha << std::endl;
+    os << indent << "Beta: " << this->m_Beta << std::endl;
+    os << indent << "NumberOfLevels: " << this->m_NumberOfLevels << std::endl;
+    }
+
+private:
+  GraphBreadthFirstDistanceImageFilter( const Self& );
+  void operator = ( const Self& );
+};
+
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef __itkGraphConnectedComponentImageFilter_h
+#define __itkGraphConnectedComponentImageFilter_h
+
+#include <vector>
+
+#include "itkImageGraphToImageFilter.h"
+#include "itkNumericTraits.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkParallelGraphTraversal.h"
+
+namespace itk
+{
+/** \class GraphConnectedComponentImageFilter
+ *  \brief Connected components of the pixel graph, keeping the edges whose
+ *  metric value is at most MaximumWeight.
+ *
+ *  The graph ImageBoostGraphAdaptor would build for the same stencil and
+ *  metric is not materialized; components are found in parallel by
+ *  ParallelGraphTraversal. Every pixel is labelled, from 1, in the raster
+ *  order of the first pixel of each component, so that the output does not
+ *  depend on the number of threads.
+ *
+ *  Components are global, so the whole largest possible region is
+ *  requested and produced.
+ */
+template< class TInputImage,
+          class TOutputImage = Image< unsigned int, TInputImage::ImageDimension >,
+          class TMetric = IndexMetric< TInputImage, double > >
+class GraphConnectedComponentImageFilter :
+  public ImageGraphToImageFilter< TInputImage, TOutputImage, TMetric >
+  {
+public:
+  typedef GraphConnectedComponentImageFilter                             Self;
+  typedef ImageGraphToImageFilter< TInputImage, TOutputImage, TMetric >  Superclass;
+  typedef SmartPointer< Self >                                           Pointer;
+  typedef SmartPointer< const Self >                                     ConstPointer;
+
+  /** Method for creation through object factory */
+  itkNewMacro( Self );
+
+  itkTypeMacro( GraphConnectedComponentImageFilter, ImageGraphToImageFilter );
+
+  itkStaticConstMacro( ImageDimension, unsigned int, TInputImage::ImageDimension );
+
+  typedef TInputImage                             InputImageType;
+  typedef typename InputImageType::RegionType     InputImageRegionType;
+  typedef typename InputImageType::OffsetType     InputOffsetType;
+
+  typedef TOutputImage                            OutputImageType;
+  typedef typename OutputImageType::PixelType     OutputPixelType;
+
+  typedef TMetric                                 MetricType;
+  typedef typename MetricType::OutputType         WeightType;
+  typedef WeightThresholdPredicate< WeightType >  PredicateType;
+
+  typedef ImageGraphNeighborhood< InputImageType, MetricType, PredicateType > NeighborhoodType;
+  typedef ParallelGraphTraversal< NeighborhoodType >                          TraversalType;
+
+  /** Edges whose metric value is larger do not connect pixels. */
+  itkSetMacro( MaximumWeight, WeightType );
+  itkGetConstMacro( MaximumWeight, WeightType );
+
+  itkGetConstMacro( NumberOfComponents, SizeValueType );
+
+protected:
+  GraphConnectedComponentImageFilter() :
+    m_MaximumWeight( NumericTraits< WeightType >::max() ),
+    m_NumberOfComponents( 0 )
+    {}
+  ~GraphConnectedComponentImageFilter() {}
+
+  WeightType    m_MaximumWeight;
+  SizeValueType m_NumberOfComponents;
+
+  void GenerateData()
+    {
+    const InputImageType* input = this->GetInput();
+    OutputImageType* output = this->GetOutput();
+
+    output->SetBufferedRegion( output->GetRequestedRegion() );
+    output->Allocate();
+
+    NeighborhoodType neighborhood;
+    neighborhood.Initialize( input, output->GetBufferedRegion(), this->m_OffsetList,
+                             this->m_Metric, PredicateType( this->m_MaximumWeight ) );
+
+    TraversalType traversal;
+    traversal.SetNumberOfThreads( this->GetNumberOfThreads() );
+    this->m_NumberOfComponents =
+      traversal.ComputeConnectedComponents( neighborhood, output->GetBufferPointer() );
+    }
+
+  void PrintSelf( std::ostream& os, Indent indent ) const
+    {
+    Superclass::PrintSelf( os, indent );
+    os << indent << "MaximumWeight: " << this->m_MaximumWeight << std::endl;
+    os << indent << "NumberOfComponents: " << this->m_NumberOfComponents << std::endl;
+    }
+
+private:
+  GraphConnectedComponentImageFilter( const Self& );
+  void operator = ( const Self& );
+};
+
+}
+
+#endif
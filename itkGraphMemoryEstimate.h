@@ -0,0 +1,179 @@
+#ifndef __itkGraphMemoryEstimate_h
+#define __itkGraphMemoryEstimate_h
+
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/type_traits/is_same.hpp>
+
+#include "itkIntTypes.h"
+
+namespace itk
+{
+/** \class AdjacencyListMemoryModel
+ *  \brief Bytes held by a boost::adjacency_list with a vecS vertex list, for
+ *  a given number of vertices and edges, from the sizes of its stored types.
+ *
+ *  Undirected and bidirectional graphs keep each edge in a global edge list
+ *  (one node per edge for listS, a single block for vecS) and two references
+ *  to it in the incidence lists; directed graphs keep the target and a
+ *  heap-allocated property in the out-edge list. vecS incidence lists have
+ *  the exact capacity of their degree, as reserved by the adaptor, and heap
+ *  blocks are assumed to carry 8 bytes of header rounded to 16 bytes, as
+ *  with glibc.
+ */
+template< class TGraph >
+struct AdjacencyListMemoryModel
+  {
+  typedef TGraph                                    GraphType;
+  typedef typename GraphType::stored_vertex         StoredVertexType;
+  typedef typename GraphType::StoredEdge            StoredEdgeType;
+  typedef typename GraphType::EdgeContainer         EdgeContainerType;
+  typedef typename GraphType::edge_property_type    EdgePropertyType;
+  typedef typename GraphType::directed_selector     DirectedType;
+  typedef typename GraphType::out_edge_list_selector OutEdgeListSelectorType;
+  typedef typename GraphType::edge_list_selector    EdgeListSelectorType;
+
+  static SizeValueType HeapBlockSize( SizeValueType iSize )
+    {
+    const SizeValueType block = ( iSize + 8 + 15 ) & ~static_cast< SizeValueType >( 15 );
+    return block < 32 ? 32 : block;
+    }
+
+  static SizeValueType ComputeBytes( SizeValueType iNumberOfVertices,
+                                     SizeValueType iNumberOfEdges )
+    {
+    const bool directed = boost::is_same< DirectedType, boost::directedS >::value;
+    const bool bidirectional = boost::is_same< DirectedType, boost::bidirectionalS >::value;
+
+    // incidence lists per vertex, and entries over all of them
+    const SizeValueType lists   = bidirectional ? 2 : 1;
+    const SizeValueType entries = directed ? iNumberOfEdges : 2 * iNumberOfEdges;
+
+    SizeValueType bytes = iNumberOfVertices * sizeof( StoredVertexType );
+
+    if( iNumberOfVertices > 0 )
+      {
+      if( boost::is_same< OutEdgeListSelectorType, boost::vecS >::value )
+        {
+        const SizeValueType numberOfLists = lists * iNumberOfVertices;
+        const SizeValueType degree = ( entries + numberOfLists - 1 ) / numberOfLists;
+        bytes += numberOfLists * HeapBlockSize( degree * sizeof( StoredEdgeType ) );
+        }
+      else
+        {
+        bytes += entries * HeapBlockSize( sizeof( StoredEdgeType ) + 2 * sizeof( void* ) );
+        }
+      }
+
+    if( directed )
+      {
+      bytes += iNumberOfEdges * HeapBlockSize( sizeof( EdgePropertyType ) );
+      }
+    else
+      {
+      typedef typename EdgeContainerType::value_type ListEdgeType;
+      if( boost::is_same< EdgeListSelectorType, boost::vecS >::value )
+        {
+        bytes += HeapBlockSize( iNumberOfEdges * sizeof( ListEdgeType ) );
+        }
+      else
+        {
+        bytes += iNumberOfEdges * HeapBlockSize( sizeof( ListEdgeType ) + 2 * sizeof( void* ) );
+        }
+      }
+
+    return bytes;
+    }
+};
+
+/** \class GraphMemoryEstimate
+ *  \brief Size of the pixel graph an adaptor would build, and the memory
+ *  of each way to represent it, computed before building anything (see
+ *  ImageBoostGraphAdaptorBase::EstimateMemory()).
+ *
+ *  The representations are the adaptor output (its boost graph type), the
+ *  ExportCSR() and ExportCOO() arrays, and the implicit graph: the stencil
+ *  walked on the fly, as GeodesicDistanceMapImageFilter does, which stores
+ *  nothing. Each one models some of the boost graph concepts;
+ *  SelectRepresentation() picks the smallest one modelling the concepts an
+ *  algorithm requires, within a memory budget.
+ */
+class GraphMemoryEstimate
+  {
+public:
+  typedef enum
+    {
+    AdjacencyListRepresentation = 0,
+    CSRRepresentation,
+    COORepresentation,
+    ImplicitRepresentation,
+    NumberOfRepresentations
+    } RepresentationType;
+
+  /** Graph concepts, to be combined with | */
+  typedef enum
+    {
+    IncidenceGraphConcept     = 1,  // out_edges()
+    BidirectionalGraphConcept = 2,  // in_edges()
+    EdgeListGraphConcept      = 4,  // edges()
+    MutableGraphConcept       = 8,  // add_edge(), remove_edge()
+    StoredWeightsConcept      = 16  // weights kept, not evaluated on each visit
+    } ConceptType;
+
+  SizeValueType NumberOfVertices;
+  SizeValueType NumberOfEdges;
+
+  SizeValueType Bytes[ NumberOfRepresentations ];
+  unsigned int  Concepts[ NumberOfRepresentations ];
+
+  GraphMemoryEstimate() :
+    NumberOfVertices( 0 ),
+    NumberOfEdges( 0 )
+    {
+    for( unsigned int r = 0; r < NumberOfRepresentations; ++r )
+      {
+      this->Bytes[ r ] = 0;
+      this->Concepts[ r ] = 0;
+      }
+    }
+
+  /** Smallest representation modelling all of iConcepts in at most iBudget
+   *  bytes (0: no limit). Returns false if there is none. */
+  bool SelectRepresentation( unsigned int iConcepts,
+                             SizeValueType iBudget,
+                             RepresentationType& oRepresentation ) const
+    {
+    bool found = false;
+    for( unsigned int r = 0; r < NumberOfRepresentations; ++r )
+      {
+      if( ( this->Concepts[ r ] & iConcepts ) == iConcepts &&
+          ( iBudget == 0 || this->Bytes[ r ] <= iBudget ) &&
+          ( !found || this->Bytes[ r ] < this->Bytes[ oRepresentation ] ) )
+        {
+        oRepresentation = static_cast< RepresentationType >( r );
+        found = true;
+        }
+      }
+    return found;
+    }
+
+  static const char* GetRepresentationName( RepresentationType iRepresentation )
+    {
+    switch( iRepresentation )
+      {
+      case AdjacencyListRepresentation:
+        return "AdjacencyList";
+      case CSRRepresentation:
+        return "CSR";
+      case COORepresentation:
+        return "COO";
+      case ImplicitRepresentation:
+        return "Implicit";
+      default:
+        return "Unknown";
+      }
+    }
+};
+
+}
+
+#endif
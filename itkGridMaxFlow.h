@@ -0,0 +1,948 @@
+#ifndef __itkGridMaxFlow_h
+#define __itkGridMaxFlow_h
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkImageRegion.h"
+#include "itkNumericTraits.h"
+#include "itkRangeThreader.h"
+#include "itkInitializeMetric.h"
+#include "itkImageStencil.h"
+
+namespace itk
+{
+/** \class GridMaxFlow
+ *  \brief Parallel s-t max-flow / min-cut on the pixel grid of a stencil.
+ *
+ *  Vertices are the pixels of a region in raster order, each with a source
+ *  and a sink capacity, and an edge to the pixel at every offset of the
+ *  (symmetrized) stencil. All capacities are flat arrays: the capacity of
+ *  the edge from u along offset k is GetEdgeCapacities()[ u * K + k ], zero
+ *  when the neighbor is outside of the region; the neighbor of an edge is
+ *  found by adding a buffer delta, never through an adjacency structure.
+ *
+ *  Solve() splits the raster range into one slab per region, along the last
+ *  dimension, and runs Boykov-Kolmogorov augmenting paths on every slab in
+ *  parallel, ignoring the edges between slabs. Adjacent slabs are then
+ *  merged pairwise and solved again on the residual capacities, until a
+ *  last pass over the whole grid (Liu and Sun, 2010). The search trees of
+ *  the merged slabs stay valid, so a merge only reactivates the vertices
+ *  along the seam instead of growing the trees again. Flows of the passes
+ *  add up, so the result is the exact maximum flow, whatever the number of
+ *  regions; most of it is found by the parallel passes.
+ *
+ *  Solve() turns the capacities into residual capacities. Afterwards
+ *  IsSourceSide() tells the side of the minimum cut of each pixel: the
+ *  pixels still reachable from the source.
+ *
+ *  For interactive use the solver is dynamic: capacities edited afterwards
+ *  through AddTerminalCapacities() and AddEdgeCapacity() (seeds added or
+ *  removed, weights changed) are applied to the residual capacities, and
+ *  Resolve() repairs the search trees around the edited pixels and grows
+ *  them again, instead of solving from scratch (Kohli and Torr, 2005).
+ */
+template< class TCapacity, unsigned int VDimension >
+class GridMaxFlow : public Object
+  {
+public:
+  typedef GridMaxFlow                 Self;
+  typedef Object                      Superclass;
+  typedef SmartPointer< Self >        Pointer;
+  typedef SmartPointer< const Self >  ConstPointer;
+
+  /** Method for creation through object factory */
+  itkNewMacro( Self );
+
+  itkTypeMacro( GridMaxFlow, Object );
+
+  itkStaticConstMacro( Dimension, unsigned int, VDimension );
+
+  typedef TCapacity                                     CapacityType;
+  typedef std::vector< CapacityType >                   CapacityContainerType;
+
+  typedef ImageRegion< VDimension >                     RegionType;
+  typedef typename RegionType::IndexType                IndexType;
+  typedef Offset< VDimension >                          OffsetType;
+  typedef typename OffsetType::OffsetValueType          OffsetValueType;
+  typedef SizeValueType                                 VertexType;
+
+  typedef ImageVertexOrdering< VDimension >             VertexOrderingType;
+  typedef ImageStencil< VDimension >                    StencilType;
+
+  /** Allocate zero capacities for the pixels of iRegion and the offsets of
+   *  iOffsets, to which their opposites are added. */
+  template< class TOffsetContainer >
+  void Initialize( const RegionType& iRegion, const TOffsetContainer& iOffsets )
+    {
+    this->m_Region = iRegion;
+
+    StencilType::GenerateOffsets( iOffsets, this->m_Offsets, true );
+
+    if( this->m_Offsets.size() >= static_cast< size_t >( TerminalParent() ) )
+      {
+      itkExceptionMacro( << "too many offsets" );
+      }
+
+    const unsigned int numberOfNeighbors = this->m_Offsets.size();
+
+    this->m_Ordering.Initialize( iRegion );
+    this->m_Stencil.Initialize( iRegion, this->m_Offsets );
+
+    OffsetType zeroOffset;
+    zeroOffset.Fill( 0 );
+
+    this->m_Opposites.resize( numberOfNeighbors );
+    this->m_MaximumDelta = 0;
+    for( unsigned int k = 0; k < numberOfNeighbors; ++k )
+      {
+      this->m_MaximumDelta = std::max( this->m_MaximumDelta, std::abs( this->m_Stencil.GetDelta( k ) ) );
+      this->m_Opposites[ k ] = std::find( this->m_Offsets.begin(), this->m_Offsets.end(),
+                                          zeroOffset - this->m_Offsets[ k ] ) - this->m_Offsets.begin();
+      }
+
+    const VertexType numberOfVertices = iRegion.GetNumberOfPixels();
+
+    this->m_EdgeCapacities.assign( numberOfVertices * numberOfNeighbors, NumericTraits< CapacityType >::Zero );
+    this->m_SourceCapacities.assign( numberOfVertices, NumericTraits< CapacityType >::Zero );
+    this->m_SinkCapacities.assign( numberOfVertices, NumericTraits< CapacityType >::Zero );
+
+    this->m_Parents.assign( numberOfVertices, NoParent() );
+    this->m_Trees.assign( numberOfVertices, FreeTree );
+    this->m_Active.assign( numberOfVertices, 0 );
+    this->m_Timestamps.assign( numberOfVertices, 0 );
+    this->m_Distances.assign( numberOfVertices, 0 );
+
+    this->m_MaximumFlow = NumericTraits< CapacityType >::Zero;
+    this->m_NumberOfPasses = 0;
+    this->m_Time = 0;
+    this->m_ChangedVertices.clear();
+    this->Modified();
+    }
+
+  /** Edge capacities from a metric on iImage: the capacity of each edge is
+   *  iMetric.Evaluate( image, u, v ), computed in parallel. */
+  template< class TImage, class TMetric >
+  void FillEdgeCapacities( const TImage* iImage, TMetric iMetric )
+    {
+    InitializeMetric( iMetric, iImage, this->m_Offsets );
+
+    FillFunctor< TImage, TMetric > fill;
+    fill.Solver = this;
+    fill.Image  = iImage;
+    fill.Metric = &iMetric;
+
+    RangeThreader< FillFunctor< TImage, TMetric > >::Run( this->GetNumberOfVertices(),
+                                                          this->m_NumberOfThreads, fill );
+    this->Modified();
+    }
+
+  VertexType GetNumberOfVertices() const
+    {
+    return this->m_SourceCapacities.size();
+    }
+
+  unsigned int GetNumberOfNeighbors() const
+    {
+    return this->m_Offsets.size();
+    }
+
+  const std::vector< OffsetType >& GetOffsets() const
+    {
+    return this->m_Offsets;
+    }
+
+  const RegionType& GetRegion() const
+    {
+    return this->m_Region;
+    }
+
+  CapacityContainerType& GetEdgeCapacities() { return this->m_EdgeCapacities; }
+  const CapacityContainerType& GetEdgeCapacities() const { return this->m_EdgeCapacities; }
+
+  CapacityContainerType& GetSourceCapacities() { return this->m_SourceCapacities; }
+  const CapacityContainerType& GetSourceCapacities() const { return this->m_SourceCapacities; }
+
+  CapacityContainerType& GetSinkCapacities() { return this->m_SinkCapacities; }
+  const CapacityContainerType& GetSinkCapacities() const { return this->m_SinkCapacities; }
+
+  IndexType ComputeIndex( VertexType iV ) const
+    {
+    return this->m_Ordering.ComputeIndex( static_cast< OffsetValueType >( iV ) );
+    }
+
+  /** Vertex of the pixel at iIndex, which must be inside the region. */
+  VertexType ComputeVertex( const IndexType& iIndex ) const
+    {
+    return static_cast< VertexType >( this->m_Ordering.ComputeVertex( iIndex ) );
+    }
+
+  itkSetMacro( NumberOfThreads, ThreadIdType );
+  itkGetConstMacro( NumberOfThreads, ThreadIdType );
+
+  /** Slabs of the first pass; 0, the default, gives one per thread. */
+  itkSetMacro( NumberOfRegions, unsigned int );
+  itkGetConstMacro( NumberOfRegions, unsigned int );
+
+  /** Maximum flow from the source to the sink. */
+  CapacityType Solve()
+    {
+    const VertexType numberOfVertices = this->GetNumberOfVertices();
+    OffsetValueType slab = 1;
+    for( unsigned int dim = 0; dim + 1 < VDimension; ++dim )
+      {
+      slab *= static_cast< OffsetValueType >( this->m_Region.GetSize()[ dim ] );
+      }
+    const OffsetValueType numberOfSlabs = static_cast< OffsetValueType >( this->m_Region.GetSize()[ VDimension - 1 ] );
+
+    OffsetValueType numberOfRegions = ( this->m_NumberOfRegions > 0 ) ?
+      this->m_NumberOfRegions : this->m_NumberOfThreads;
+    numberOfRegions = std::max( std::min( numberOfRegions, numberOfSlabs ), static_cast< OffsetValueType >( 1 ) );
+
+    std::vector< VertexType > bounds( numberOfRegions + 1 );
+    for( OffsetValueType r = 0; r <= numberOfRegions; ++r )
+      {
+      bounds[ r ] = static_cast< VertexType >( ( r * numberOfSlabs / numberOfRegions ) * slab );
+      }
+    bounds[ numberOfRegions ] = numberOfVertices;
+
+    // the first pass starts from the terminals, the next ones from the seams
+    std::vector< VertexType > seams( bounds.begin(), bounds.end() - 1 );
+
+    this->m_MaximumFlow = NumericTraits< CapacityType >::Zero;
+    this->m_NumberOfPasses = 0;
+
+    while( true )
+      {
+      const VertexType n = bounds.size() - 1;
+
+      SolveFunctor solve;
+      solve.Solver = this;
+      solve.Bounds = &bounds;
+      solve.Seams  = &seams;
+      solve.Flows.assign( n, NumericTraits< CapacityType >::Zero );
+
+      RangeThreader< SolveFunctor >::Run( n, this->m_NumberOfThreads, solve );
+
+      for( VertexType r = 0; r < n; ++r )
+        {
+        this->m_MaximumFlow += solve.Flows[ r ];
+        }
+      ++this->m_NumberOfPasses;
+
+      if( n == 1 )
+        {
+        break;
+        }
+
+      // merge adjacent regions
+      std::vector< VertexType > merged;
+      seams.clear();
+      for( VertexType r = 0; r < n; r += 2 )
+        {
+        merged.push_back( bounds[ r ] );
+        seams.push_back( ( r + 1 < n ) ? bounds[ r + 1 ] : numberOfVertices );
+        }
+      merged.push_back( numberOfVertices );
+      bounds.swap( merged );
+      }
+
+    this->m_Time = *std::max_element( this->m_Timestamps.begin(), this->m_Timestamps.end() );
+    this->m_ChangedVertices.clear();
+
+    this->Modified();
+    return this->m_MaximumFlow;
+    }
+
+  /** Add iSource and iSink to the capacities from the source and to the
+   *  sink of iV (e.g. for a seed added or removed), once Solve() has run;
+   *  the capacities must stay non-negative. The residual capacities are
+   *  updated at once, and the flow by the next Resolve(). When the flow
+   *  through a terminal edge exceeds its new capacity, both capacities of
+   *  iV are raised by the excess, which shifts the flow and the cost of
+   *  every cut by the same amount (Kohli and Torr, 2005). */
+  void AddTerminalCapacities( VertexType iV, CapacityType iSource, CapacityType iSink )
+    {
+    const CapacityType zero = NumericTraits< CapacityType >::Zero;
+    CapacityType& rs = this->m_SourceCapacities[ iV ];
+    CapacityType& rt = this->m_SinkCapacities[ iV ];
+
+    rs += iSource;
+    rt += iSink;
+
+    const CapacityType excess = std::max( zero - rs, zero - rt );
+    if( excess > zero )
+      {
+      rs += excess;
+      rt += excess;
+      this->m_MaximumFlow -= excess;
+      }
+    this->m_ChangedVertices.push_back( iV );
+    this->Modified();
+    }
+
+  /** Add iDelta to the capacity of the edge from iV along its neighbor
+   *  iNeighbor, as AddTerminalCapacities(). When the flow on the edge
+   *  exceeds its new capacity, the excess is sent back, from the source to
+   *  the neighbor and from iV to the sink, through terminal capacities
+   *  raised on both ends. */
+  void AddEdgeCapacity( VertexType iV, unsigned int iNeighbor, CapacityType iDelta )
+    {
+    if( !this->m_Stencil.IsInside( this->ComputeIndex( iV ), iNeighbor ) )
+      {
+      itkExceptionMacro( << "no neighbor " << iNeighbor << " for vertex " << iV );
+      }
+
+    const unsigned int K = this->m_Offsets.size();
+    const CapacityType zero = NumericTraits< CapacityType >::Zero;
+    const VertexType   v = iV + this->m_Stencil.GetDelta( iNeighbor );
+
+    CapacityType& r = this->m_EdgeCapacities[ iV * K + iNeighbor ];
+    r += iDelta;
+
+    if( r < zero )
+      {
+      const CapacityType excess = zero - r;
+      r = zero;
+      this->m_EdgeCapacities[ v * K + this->m_Opposites[ iNeighbor ] ] -= excess;
+      this->m_SourceCapacities[ iV ] += excess;
+      this->m_SinkCapacities[ v ] += excess;
+      this->m_MaximumFlow -= excess;
+      }
+    this->m_ChangedVertices.push_back( iV );
+    this->m_ChangedVertices.push_back( v );
+    this->Modified();
+    }
+
+  /** Maximum flow after the changes made since the last Solve() or
+   *  Resolve(), found from the current flow and search trees: only the
+   *  trees around the changed vertices are repaired and grown again, in a
+   *  single thread, so that the cost depends on the extent of the changes
+   *  rather than on the size of the grid. Solves from scratch if Solve()
+   *  has not run. */
+  CapacityType Resolve()
+    {
+    if( this->m_NumberOfPasses == 0 )
+      {
+      return this->Solve();
+      }
+
+    const unsigned int K = this->m_Offsets.size();
+    const CapacityType zero = NumericTraits< CapacityType >::Zero;
+    const CapacityType* r = this->m_EdgeCapacities.empty() ? 0 : &this->m_EdgeCapacities[0];
+    CapacityType* rs = &this->m_SourceCapacities[0];
+    CapacityType* rt = &this->m_SinkCapacities[0];
+
+    std::vector< VertexType > queue;
+    std::vector< VertexType > orphans;
+    unsigned int time = ++this->m_Time;
+
+    for( size_t i = 0; i < this->m_ChangedVertices.size(); ++i )
+      {
+      const VertexType u = this->m_ChangedVertices[ i ];
+
+      // s -> u -> t paths directly
+      const CapacityType m = std::min( rs[ u ], rt[ u ] );
+      rs[ u ] -= m;
+      rt[ u ] -= m;
+      this->m_MaximumFlow += m;
+
+      const unsigned char tree = this->m_Trees[ u ];
+      const CapacityType own = ( tree == SourceTree ) ? rs[ u ] : rt[ u ];
+      const CapacityType other = ( tree == SourceTree ) ? rt[ u ] : rs[ u ];
+
+      if( tree == FreeTree || other > zero )
+        {
+        // u joins the tree of its terminal
+        this->ReleaseNeighbors( u, queue, orphans );
+        if( rs[ u ] > zero || rt[ u ] > zero )
+          {
+          this->m_Trees[ u ] = ( rs[ u ] > zero ) ? SourceTree : SinkTree;
+          this->m_Parents[ u ] = TerminalParent();
+          this->m_Timestamps[ u ] = time;
+          this->m_Distances[ u ] = 1;
+          }
+        else
+          {
+          this->m_Trees[ u ] = FreeTree;
+          this->m_Parents[ u ] = NoParent();
+          }
+        }
+      else if( own > zero )
+        {
+        this->m_Parents[ u ] = TerminalParent();
+        this->m_Timestamps[ u ] = time;
+        this->m_Distances[ u ] = 1;
+        }
+      else if( this->m_Parents[ u ] != OrphanParent() )
+        {
+        // the edge to the terminal or to the parent may be saturated
+        bool saturated = ( this->m_Parents[ u ] == TerminalParent() );
+        if( this->HasEdgeParent( u ) )
+          {
+          const unsigned int k = this->m_Parents[ u ];
+          const VertexType p = this->Parent( u );
+          saturated = ( ( tree == SourceTree ) ? r[ p * K + this->m_Opposites[ k ] ] : r[ u * K + k ] ) <= zero;
+          }
+        if( saturated )
+          {
+          this->m_Parents[ u ] = OrphanParent();
+          orphans.push_back( u );
+          }
+        }
+
+      if( this->m_Trees[ u ] != FreeTree && !this->m_Active[ u ] )
+        {
+        this->m_Active[ u ] = 1;
+        queue.push_back( u );
+        }
+      }
+    this->m_ChangedVertices.clear();
+
+    const OffsetValueType end = static_cast< OffsetValueType >( this->GetNumberOfVertices() );
+    while( !orphans.empty() )
+      {
+      const VertexType o = orphans.back();
+      orphans.pop_back();
+      if( this->m_Parents[ o ] == OrphanParent() )
+        {
+        this->Adopt( o, 0, end, time, queue, orphans );
+        }
+      }
+
+    this->m_MaximumFlow += this->Grow( 0, end, time, queue );
+    this->m_Time = time;
+    ++this->m_NumberOfPasses;
+
+    this->Modified();
+    return this->m_MaximumFlow;
+    }
+
+  itkGetConstMacro( MaximumFlow, CapacityType );
+
+  /** Parallel and sequential passes of the last Solve(), and Resolve()
+   *  calls since. */
+  itkGetConstMacro( NumberOfPasses, unsigned int );
+
+  /** Whether iV is on the source side of the minimum cut. */
+  bool IsSourceSide( VertexType iV ) const
+    {
+    return this->m_Trees[ iV ] == SourceTree;
+    }
+
+protected:
+  GridMaxFlow() :
+    m_MaximumDelta( 0 ),
+    m_NumberOfThreads( 1 ),
+    m_NumberOfRegions( 0 ),
+    m_NumberOfPasses( 0 ),
+    m_Time( 0 )
+    {
+    this->m_MaximumFlow = NumericTraits< CapacityType >::Zero;
+    this->m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+    }
+  ~GridMaxFlow() {}
+
+  typedef enum
+    {
+    FreeTree = 0,
+    SourceTree,
+    SinkTree
+    } TreeType;
+
+  /** Parents are the offset of the edge to the parent vertex, or one of: */
+  static unsigned char TerminalParent() { return 253; }
+  static unsigned char OrphanParent() { return 254; }
+  static unsigned char NoParent() { return 255; }
+
+  RegionType                      m_Region;
+  std::vector< OffsetType >       m_Offsets;
+  VertexOrderingType              m_Ordering;
+  StencilType                     m_Stencil;
+  std::vector< unsigned int >     m_Opposites;
+  OffsetValueType                 m_MaximumDelta;
+
+  CapacityContainerType           m_EdgeCapacities;
+  CapacityContainerType           m_SourceCapacities;
+  CapacityContainerType           m_SinkCapacities;
+
+  /** Search trees; each pass only touches the vertices of its region. */
+  std::vector< unsigned char >    m_Parents;
+  std::vector< unsigned char >    m_Trees;
+  std::vector< unsigned char >    m_Active;
+  std::vector< unsigned int >     m_Timestamps;
+  std::vector< unsigned int >     m_Distances;
+
+  ThreadIdType                    m_NumberOfThreads;
+  unsigned int                    m_NumberOfRegions;
+  unsigned int                    m_NumberOfPasses;
+  CapacityType                    m_MaximumFlow;
+
+  /** Timestamp of the last augmentation, and the vertices changed since. */
+  unsigned int                    m_Time;
+  std::vector< VertexType >       m_ChangedVertices;
+
+  template< class TImage, class TMetric >
+  struct FillFunctor
+    {
+    Self*           Solver;
+    const TImage*   Image;
+    const TMetric*  Metric;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      const unsigned int numberOfNeighbors = Solver->m_Offsets.size();
+      CapacityType* capacities = &Solver->m_EdgeCapacities[0];
+
+      for( VertexType u = iBegin; u < iEnd; ++u )
+        {
+        const IndexType index = Solver->ComputeIndex( u );
+        const bool interior = Solver->m_Stencil.IsInterior( index );
+        for( unsigned int k = 0; k < numberOfNeighbors; ++k )
+          {
+          capacities[ u * numberOfNeighbors + k ] = ( interior || Solver->m_Stencil.IsInside( index, k ) ) ?
+            EvaluateMetric< CapacityType >( *Metric, Image, index, index + Solver->m_Offsets[ k ], k ) :
+            NumericTraits< CapacityType >::Zero;
+          }
+        }
+      }
+    };
+
+  /** Solve the regions [iBegin, iEnd) of a pass */
+  struct SolveFunctor
+    {
+    Self*                             Solver;
+    const std::vector< VertexType >*  Bounds;
+    const std::vector< VertexType >*  Seams;
+    std::vector< CapacityType >       Flows;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      for( SizeValueType r = iBegin; r < iEnd; ++r )
+        {
+        this->Flows[ r ] = Solver->SolveRange( ( *Bounds )[ r ], ( *Bounds )[ r + 1 ], ( *Seams )[ r ] );
+        }
+      }
+    };
+
+  VertexType Parent( VertexType iV ) const
+    {
+    return iV + this->m_Stencil.GetDelta( this->m_Parents[ iV ] );
+    }
+
+  bool HasEdgeParent( VertexType iV ) const
+    {
+    return this->m_Parents[ iV ] < TerminalParent();
+    }
+
+  /** Boykov-Kolmogorov on the vertices [iBegin, iEnd), edges leaving the
+   *  range being ignored. Only the state of these vertices is touched, so
+   *  that disjoint ranges are solved concurrently. With iSeam == iBegin the
+   *  trees are grown from the terminals; otherwise [iBegin, iSeam) and
+   *  [iSeam, iEnd) were solved and their trees are extended across iSeam. */
+  CapacityType SolveRange( VertexType iBegin, VertexType iEnd, VertexType iSeam )
+    {
+    const CapacityType zero = NumericTraits< CapacityType >::Zero;
+
+    CapacityType* rs = &this->m_SourceCapacities[0];
+    CapacityType* rt = &this->m_SinkCapacities[0];
+
+    const OffsetValueType begin = static_cast< OffsetValueType >( iBegin );
+    const OffsetValueType end   = static_cast< OffsetValueType >( iEnd );
+
+    std::vector< VertexType > queue;
+
+    CapacityType flow = zero;
+    unsigned int time = 0;
+
+    if( iSeam == iBegin )
+      {
+      for( VertexType u = iBegin; u < iEnd; ++u )
+        {
+        // s -> u -> t paths directly
+        const CapacityType m = std::min( rs[ u ], rt[ u ] );
+        rs[ u ] -= m;
+        rt[ u ] -= m;
+        flow += m;
+
+        this->m_Timestamps[ u ] = 0;
+        this->m_Distances[ u ] = 1;
+        this->m_Active[ u ] = 0;
+
+        if( rs[ u ] > zero || rt[ u ] > zero )
+          {
+          this->m_Trees[ u ] = ( rs[ u ] > zero ) ? SourceTree : SinkTree;
+          this->m_Parents[ u ] = TerminalParent();
+          this->m_Active[ u ] = 1;
+          queue.push_back( u );
+          }
+        else
+          {
+          this->m_Trees[ u ] = FreeTree;
+          this->m_Parents[ u ] = NoParent();
+          }
+        }
+      }
+    else
+      {
+      // the trees keep their timestamps, which must all be older than the
+      // paths checked in this pass
+      time = *std::max_element( this->m_Timestamps.begin() + iBegin, this->m_Timestamps.begin() + iEnd );
+
+      // only the vertices with an edge across the seam have unexplored edges
+      const OffsetValueType seam = static_cast< OffsetValueType >( iSeam );
+      const OffsetValueType first = std::max( seam - this->m_MaximumDelta, begin );
+      const OffsetValueType last  = std::min( seam + this->m_MaximumDelta, end );
+      for( OffsetValueType u = first; u < last; ++u )
+        {
+        if( this->m_Trees[ u ] != FreeTree )
+          {
+          this->m_Active[ u ] = 1;
+          queue.push_back( static_cast< VertexType >( u ) );
+          }
+        }
+      }
+
+    return flow + this->Grow( begin, end, time, queue );
+    }
+
+  /** Growth, augmentation and adoption on the vertices [iBegin, iEnd) from
+   *  the active vertices of ioQueue, until the trees cannot grow. ioTime is
+   *  the timestamp of the last augmentation. */
+  CapacityType Grow( OffsetValueType iBegin, OffsetValueType iEnd, unsigned int& ioTime,
+                     std::vector< VertexType >& ioQueue )
+    {
+    const unsigned int K = this->m_Offsets.size();
+    const CapacityType zero = NumericTraits< CapacityType >::Zero;
+
+    CapacityType* r  = this->m_EdgeCapacities.empty() ? 0 : &this->m_EdgeCapacities[0];
+    CapacityType* rs = &this->m_SourceCapacities[0];
+    CapacityType* rt = &this->m_SinkCapacities[0];
+
+    std::vector< VertexType > orphans;
+    size_t head = 0;
+
+    CapacityType flow = zero;
+
+    while( true )
+      {
+      // Growth: find an edge from the source tree to the sink tree
+      VertexType   pathSource = 0;
+      unsigned int pathEdge = 0;
+      bool         found = false;
+
+      while( head < ioQueue.size() && !found )
+        {
+        const VertexType u = ioQueue[ head ];
+        const unsigned char tree = this->m_Trees[ u ];
+
+        if( tree == FreeTree )
+          {
+          this->m_Active[ u ] = 0;
+          ++head;
+          continue;
+          }
+
+        for( unsigned int k = 0; k < K; ++k )
+          {
+          const OffsetValueType vv = static_cast< OffsetValueType >( u ) + this->m_Stencil.GetDelta( k );
+          if( vv < iBegin || vv >= iEnd )
+            {
+            continue;
+            }
+          const VertexType v = static_cast< VertexType >( vv );
+          const unsigned int opposite = this->m_Opposites[ k ];
+
+          // residual capacity from the tree towards v
+          const CapacityType c = ( tree == SourceTree ) ? r[ u * K + k ] : r[ v * K + opposite ];
+          if( c <= zero )
+            {
+            continue;
+            }
+
+          if( this->m_Trees[ v ] == FreeTree )
+            {
+            this->m_Trees[ v ] = tree;
+            this->m_Parents[ v ] = opposite;
+            this->m_Timestamps[ v ] = this->m_Timestamps[ u ];
+            this->m_Distances[ v ] = this->m_Distances[ u ] + 1;
+            if( !this->m_Active[ v ] )
+              {
+              this->m_Active[ v ] = 1;
+              ioQueue.push_back( v );
+              }
+            }
+          else if( this->m_Trees[ v ] != tree )
+            {
+            pathSource = ( tree == SourceTree ) ? u : v;
+            pathEdge = ( tree == SourceTree ) ? k : opposite;
+            found = true;
+            break;
+            }
+          else if( this->m_Timestamps[ v ] <= this->m_Timestamps[ u ] &&
+                   this->m_Distances[ v ] > this->m_Distances[ u ] )
+            {
+            // shorter path to the terminal
+            this->m_Parents[ v ] = opposite;
+            this->m_Timestamps[ v ] = this->m_Timestamps[ u ];
+            this->m_Distances[ v ] = this->m_Distances[ u ] + 1;
+            }
+          }
+
+        if( !found )
+          {
+          this->m_Active[ u ] = 0;
+          ++head;
+          }
+        }
+
+      if( !found )
+        {
+        break;
+        }
+
+      // the queue is compacted once its consumed part dominates
+      if( head > 4096 && head > ioQueue.size() / 2 )
+        {
+        ioQueue.erase( ioQueue.begin(), ioQueue.begin() + head );
+        head = 0;
+        }
+
+      ++ioTime;
+
+      // Augmentation along source root ... pathSource -> pathSink ... sink root
+      const VertexType pathSink = pathSource + this->m_Stencil.GetDelta( pathEdge );
+
+      CapacityType bottleneck = r[ pathSource * K + pathEdge ];
+      VertexType w;
+      for( w = pathSource; this->HasEdgeParent( w ); w = this->Parent( w ) )
+        {
+        const VertexType p = this->Parent( w );
+        bottleneck = std::min( bottleneck, r[ p * K + this->m_Opposites[ this->m_Parents[ w ] ] ] );
+        }
+      bottleneck = std::min( bottleneck, rs[ w ] );
+      for( w = pathSink; this->HasEdgeParent( w ); w = this->Parent( w ) )
+        {
+        bottleneck = std::min( bottleneck, r[ w * K + this->m_Parents[ w ] ] );
+        }
+      bottleneck = std::min( bottleneck, rt[ w ] );
+
+      r[ pathSource * K + pathEdge ] -= bottleneck;
+      r[ pathSink * K + this->m_Opposites[ pathEdge ] ] += bottleneck;
+
+      for( w = pathSource; this->HasEdgeParent( w ); )
+        {
+        const unsigned int k = this->m_Parents[ w ];
+        const VertexType p = this->Parent( w );
+        r[ p * K + this->m_Opposites[ k ] ] -= bottleneck;
+        r[ w * K + k ] += bottleneck;
+        if( r[ p * K + this->m_Opposites[ k ] ] <= zero )
+          {
+          this->m_Parents[ w ] = OrphanParent();
+          orphans.push_back( w );
+          }
+        w = p;
+        }
+      rs[ w ] -= bottleneck;
+      if( rs[ w ] <= zero )
+        {
+        this->m_Parents[ w ] = OrphanParent();
+        orphans.push_back( w );
+        }
+
+      for( w = pathSink; this->HasEdgeParent( w ); )
+        {
+        const unsigned int k = this->m_Parents[ w ];
+        const VertexType p = this->Parent( w );
+        r[ w * K + k ] -= bottleneck;
+        r[ p * K + this->m_Opposites[ k ] ] += bottleneck;
+        if( r[ w * K + k ] <= zero )
+          {
+          this->m_Parents[ w ] = OrphanParent();
+          orphans.push_back( w );
+          }
+        w = p;
+        }
+      rt[ w ] -= bottleneck;
+      if( rt[ w ] <= zero )
+        {
+        this->m_Parents[ w ] = OrphanParent();
+        orphans.push_back( w );
+        }
+
+      flow += bottleneck;
+
+      // Adoption
+      while( !orphans.empty() )
+        {
+        const VertexType o = orphans.back();
+        orphans.pop_back();
+        this->Adopt( o, iBegin, iEnd, ioTime, ioQueue, orphans );
+        }
+      }
+
+    return flow;
+    }
+
+  /** Before iU joins or changes trees: its children in its tree become
+   *  orphans, and its neighbors in a tree are activated, since the edges
+   *  between them and iU may now cross trees. */
+  void ReleaseNeighbors( VertexType iU, std::vector< VertexType >& ioQueue,
+                         std::vector< VertexType >& ioOrphans )
+    {
+    const unsigned int    K = this->m_Offsets.size();
+    const OffsetValueType end = static_cast< OffsetValueType >( this->GetNumberOfVertices() );
+
+    for( unsigned int k = 0; k < K; ++k )
+      {
+      const OffsetValueType vv = static_cast< OffsetValueType >( iU ) + this->m_Stencil.GetDelta( k );
+      if( vv < 0 || vv >= end )
+        {
+        continue;
+        }
+      const VertexType v = static_cast< VertexType >( vv );
+      if( this->m_Trees[ v ] == FreeTree )
+        {
+        continue;
+        }
+      if( !this->m_Active[ v ] )
+        {
+        this->m_Active[ v ] = 1;
+        ioQueue.push_back( v );
+        }
+      if( this->m_Trees[ v ] == this->m_Trees[ iU ] && this->m_Parents[ v ] == this->m_Opposites[ k ] )
+        {
+        this->m_Parents[ v ] = OrphanParent();
+        ioOrphans.push_back( v );
+        }
+      }
+    }
+
+  /** Find a new parent for the orphan iO in its tree, or free it. */
+  void Adopt( VertexType iO, OffsetValueType iBegin, OffsetValueType iEnd, unsigned int iTime,
+              std::vector< VertexType >& ioQueue, std::vector< VertexType >& ioOrphans )
+    {
+    const unsigned int K = this->m_Offsets.size();
+    const CapacityType zero = NumericTraits< CapacityType >::Zero;
+    const CapacityType* r = &this->m_EdgeCapacities[0];
+    const unsigned char tree = this->m_Trees[ iO ];
+    const unsigned int infinite = NumericTraits< unsigned int >::max();
+
+    unsigned int bestEdge = NoParent();
+    unsigned int bestDistance = infinite;
+
+    for( unsigned int k = 0; k < K; ++k )
+      {
+      const OffsetValueType vv = static_cast< OffsetValueType >( iO ) + this->m_Stencil.GetDelta( k );
+      if( vv < iBegin || vv >= iEnd )
+        {
+        continue;
+        }
+      const VertexType v = static_cast< VertexType >( vv );
+      const CapacityType c = ( tree == SourceTree ) ? r[ v * K + this->m_Opposites[ k ] ] : r[ iO * K + k ];
+
+      if( this->m_Trees[ v ] != tree || c <= zero )
+        {
+        continue;
+        }
+
+      // distance of v to its terminal, if it still has one
+      unsigned int d = 0;
+      VertexType j = v;
+      while( true )
+        {
+        if( this->m_Timestamps[ j ] == iTime )
+          {
+          d += this->m_Distances[ j ];
+          break;
+          }
+        ++d;
+        if( this->m_Parents[ j ] == TerminalParent() )
+          {
+          this->m_Timestamps[ j ] = iTime;
+          this->m_Distances[ j ] = 1;
+          break;
+          }
+        if( this->m_Parents[ j ] == OrphanParent() )
+          {
+          d = infinite;
+          break;
+          }
+        j = this->Parent( j );
+        }
+
+      if( d < infinite )
+        {
+        if( d < bestDistance )
+          {
+          bestEdge = k;
+          bestDistance = d;
+          }
+        for( j = v; this->m_Timestamps[ j ] != iTime; j = this->Parent( j ) )
+          {
+          this->m_Timestamps[ j ] = iTime;
+          this->m_Distances[ j ] = d--;
+          }
+        }
+      }
+
+    if( bestEdge != NoParent() )
+      {
+      this->m_Parents[ iO ] = static_cast< unsigned char >( bestEdge );
+      this->m_Timestamps[ iO ] = iTime;
+      this->m_Distances[ iO ] = bestDistance + 1;
+      return;
+      }
+
+    // no parent: iO leaves the tree, its children become orphans
+    for( unsigned int k = 0; k < K; ++k )
+      {
+      const OffsetValueType vv = static_cast< OffsetValueType >( iO ) + this->m_Stencil.GetDelta( k );
+      if( vv < iBegin || vv >= iEnd )
+        {
+        continue;
+        }
+      const VertexType v = static_cast< VertexType >( vv );
+      if( this->m_Trees[ v ] != tree )
+        {
+        continue;
+        }
+
+      const CapacityType c = ( tree == SourceTree ) ? r[ v * K + this->m_Opposites[ k ] ] : r[ iO * K + k ];
+      if( c > zero && !this->m_Active[ v ] )
+        {
+        this->m_Active[ v ] = 1;
+        ioQueue.push_back( v );
+        }
+      if( this->m_Parents[ v ] == this->m_Opposites[ k ] )
+        {
+        this->m_Parents[ v ] = OrphanParent();
+        ioOrphans.push_back( v );
+        }
+      }
+
+    this->m_Trees[ iO ] = FreeTree;
+    this->m_Parents[ iO ] = NoParent();
+    }
+
+  void PrintSelf( std::ostream& os, Indent indent ) const
+    {
+    Superclass::PrintSelf( os, indent );
+    os << indent << "Region: " << this->m_Region << std::endl;
+    os << indent << "NumberOfNeighbors: " << this->m_Offsets.size() << std::endl;
+    os << indent << "NumberOfThreads: " << this->m_NumberOfThreads << std::endl;
+    os << indent << "NumberOfRegions: " << this->m_NumberOfRegions << std::endl;
+    os << indent << "MaximumFlow: " << this->m_MaximumFlow << std::endl;
+    }
+
+private:
+  GridMaxFlow( const Self& );
+  void operator = ( const Self& );
+};
+
+}
+
+#endif
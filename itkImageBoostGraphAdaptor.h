@@ -1,11 +1,125 @@
+#ifndef __itkImageBoostGraphAdaptor_h
+#define __itkImageBoostGraphAdaptor_h
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+#include <boost/version.hpp>
 #include <boost/graph/graph_traits.hpp>
 #include <boost/graph/adjacency_list.hpp>
 
-#include "itkLightObject.h"
+#include "itkImage.h"
+#include "itkProcessObject.h"
+#include "itkProgressReporter.h"
+#include "itkSimpleDataObjectDecorator.h"
 #include "itkConstShapedNeighborhoodIterator.h"
+#include "itkImageVertexOrdering.h"
+#include "itkImageStencil.h"
+#include "itkCompressedSparseRowMatrix.h"
+#include "itkPatchGraphArena.h"
+#include "itkGraphMemoryEstimate.h"
+#include "itkRangeThreader.h"
+#include "itkInitializeMetric.h"
 
 namespace itk
 {
+/** Value type held by a boost property; no_property does not define one. */
+template< class TProperty >
+struct BoostPropertyValue
+  {
+  typedef typename TProperty::value_type Type;
+  };
+
+template<>
+struct BoostPropertyValue< boost::no_property >
+  {
+  typedef boost::no_property Type;
+  };
+
+/** \class AdjacencyListReserve
+ *  \brief Capacity reservation in the incidence and edge lists of a graph,
+ *  before it is filled with add_edge().
+ *
+ *  boost::adjacency_list has no public way to reserve its lists, so this
+ *  relies on its storage: out_edge_list() and in_edge_list() of a vecS
+ *  vertex list, and its m_edges member. Only adjacency_list with a vecS
+ *  vertex list, with the layout of Boost 1.35 to 1.8x, is supported; other
+ *  graph types, and other Boost versions, are built without reservation
+ *  (Supported is false and the methods do nothing).
+ */
+template< class TGraph >
+struct AdjacencyListReserve
+  {
+  static const bool Supported = false;
+
+  static void ReserveOutEdges( TGraph&, SizeValueType, SizeValueType ) {}
+  static void ReserveInEdges( TGraph&, SizeValueType, SizeValueType ) {}
+  static void ReserveEdges( TGraph&, SizeValueType ) {}
+  };
+
+#if BOOST_VERSION >= 103500 && BOOST_VERSION < 109000
+template< class TOutEdgeListS, class TDirectedS, class TVertexProperty,
+          class TEdgeProperty, class TGraphProperty, class TEdgeListS >
+struct AdjacencyListReserve< boost::adjacency_list< TOutEdgeListS, boost::vecS, TDirectedS,
+                                                    TVertexProperty, TEdgeProperty,
+                                                    TGraphProperty, TEdgeListS > >
+  {
+  typedef boost::adjacency_list< TOutEdgeListS, boost::vecS, TDirectedS,
+                                 TVertexProperty, TEdgeProperty,
+                                 TGraphProperty, TEdgeListS >  GraphType;
+
+  static const bool Supported = true;
+
+  static void ReserveOutEdges( GraphType& ioGraph, SizeValueType iVertex, SizeValueType iSize )
+    {
+    Reserve( ioGraph.out_edge_list( iVertex ), iSize );
+    }
+
+  /** In-edges are stored apart in bidirectional graphs only. */
+  static void ReserveInEdges( GraphType& ioGraph, SizeValueType iVertex, SizeValueType iSize )
+    {
+    ReserveInEdges( ioGraph, iVertex, iSize, TDirectedS() );
+    }
+
+  template< class TDirected >
+  static void ReserveInEdges( GraphType&, SizeValueType, SizeValueType, TDirected ) {}
+
+  static void ReserveInEdges( GraphType& ioGraph, SizeValueType iVertex, SizeValueType iSize,
+                              boost::bidirectionalS )
+    {
+    Reserve( in_edge_list( ioGraph, iVertex ), iSize );
+    }
+
+  /** The global edge list of undirected and bidirectional graphs. */
+  static void ReserveEdges( GraphType& ioGraph, SizeValueType iSize )
+    {
+    Reserve( ioGraph.m_edges, iSize );
+    }
+
+  template< class TList >
+  static void Reserve( TList&, SizeValueType ) {}
+
+  template< class T, class TAllocator >
+  static void Reserve( std::vector< T, TAllocator >& ioList, SizeValueType iSize )
+    {
+    ioList.reserve( iSize );
+    }
+  };
+#endif
+
+/** \class IndexMetric
+ *  \brief Squared intensity difference between the two pixels of an edge.
+ *
+ *  A metric provides Evaluate( image, a, b ). It may also provide
+ *  Initialize( image, offsets ), which the adaptor and the filters then call
+ *  with the distinct offsets of the stencil before any Evaluate(), so that
+ *  per-offset terms are computed once, and Evaluate( image, a, b, k ) for
+ *  b = a + offsets[ k ], which they call instead of the former when they walk
+ *  the stencil (see PhysicalDistanceMetric, InitializeMetric() and
+ *  EvaluateMetric()).
+ */
 template< class TImage, class TOutput >
 class IndexMetric
   {
@@ -31,15 +145,15 @@ public:
 template< class TInputImage,
           class TGraph,
           class TMetric > // Metric< TInputImage, typename TGraph::edge_property_type::value_type >
-class ImageBoostGraphAdaptorBase : public LightObject
+class ImageBoostGraphAdaptorBase : public ProcessObject
   {
 public:
   typedef ImageBoostGraphAdaptorBase      Self;
   typedef SmartPointer< Self >        Pointer;
   typedef SmartPointer< const Self >  ConstPointer;
-  typedef LightObject                 Superclass;
+  typedef ProcessObject               Superclass;
 
-  itkTypeMacro( ImageBoostGraphAdaptorBase, LightObject );
+  itkTypeMacro( ImageBoostGraphAdaptorBase, ProcessObject );
 
   typedef TInputImage                             InputImageType;
   typedef typename InputImageType::ConstPointer   InputImageConstPointer;
@@ -53,6 +167,13 @@ public:
 
   typedef TMetric MetricType;
 
+  typedef ImageVertexOrdering< InputImageType::ImageDimension > VertexOrderingType;
+
+  /** Neighbors of the vertices through linear deltas, see ImageStencil. */
+  typedef ImageStencil< InputImageType::ImageDimension > StencilType;
+
+  typedef Image< unsigned char, InputImageType::ImageDimension > MaskImageType;
+
   typedef TGraph GraphType;
 
   typedef typename GraphType::directed_selector     GraphDirectedType;
@@ -62,22 +183,49 @@ public:
   typedef typename GraphTraits::edge_descriptor     EdgeDescriptorType;
 
   typedef typename GraphType::vertex_property_type  VertexPropertyType;
-  typedef typename VertexPropertyType::value_type   VertexValueType;
+  typedef typename BoostPropertyValue< VertexPropertyType >::Type VertexValueType;
 
   typedef typename GraphType::edge_property_type    EdgePropertyType;
-  typedef typename EdgePropertyType::value_type     EdgeValueType;
+  typedef typename BoostPropertyValue< EdgePropertyType >::Type   EdgeValueType;
 
   typedef typename boost::property_map< GraphType,
                                         boost::edge_weight_t >::type  WeightMapType;
 
+  /** Flat export of the edges, see ExportCSR() and ExportCOO(). */
+  typedef CompressedSparseRowMatrix< EdgeValueType >  CSRMatrixType;
+  typedef typename CSRMatrixType::IndexType           ExportIndexType;
+
+  /** Graphs of many patches of the input, see ExportPatches(). */
+  typedef PatchGraphArena< EdgeValueType >            PatchGraphArenaType;
+
+  /** The graph is the output of the adaptor, decorated as a DataObject. */
+  typedef SimpleDataObjectDecorator< GraphType >            GraphObjectType;
+
+  typedef typename Superclass::DataObjectPointer            DataObjectPointer;
+  typedef ProcessObject::DataObjectPointerArraySizeType     DataObjectPointerArraySizeType;
+
   void SetInput( const InputImageType* Image )
     {
-    this->m_Image = Image;
+    this->ProcessObject::SetNthInput( 0, const_cast< InputImageType* >( Image ) );
+    }
+
+  const InputImageType* GetInput() const
+    {
+    return static_cast< const InputImageType* >( this->ProcessObject::GetInput( 0 ) );
+    }
+
+  /** Optional mask (input 1): only its non-zero pixels become vertices,
+   *  numbered consecutively in raster order, and only edges between two of
+   *  them are created. The vertex ordering is then ignored. */
+  void SetMaskImage( const MaskImageType* iMask )
+    {
+    this->ProcessObject::SetNthInput( 1, const_cast< MaskImageType* >( iMask ) );
+    this->m_StencilTime.Modified();
     }
 
-  const InputImageType* GetInput()
+  const MaskImageType* GetMaskImage() const
     {
-    return static_cast< const InputImageType* >( this->m_Image.GetPointer() );
+    return static_cast< const MaskImageType* >( this->ProcessObject::GetInput( 1 ) );
     }
 
   template< class T >
@@ -99,86 +247,1058 @@ public:
       this->m_OffsetList.push_back( *it );
       ++it;
       }
+    this->m_StencilTime.Modified();
+    this->Modified();
+    }
+
+  void ClearNeighbors()
+    {
+    this->m_OffsetList.clear();
+    this->m_StencilTime.Modified();
+    this->Modified();
     }
 
-  void Update()
+  /** Changing the metric only triggers a reweighting of the existing edges. */
+  void SetMetric( const MetricType& iMetric )
     {
-    this->GenerateData();
+    this->m_Metric = iMetric;
+    this->Modified();
+    }
+
+  const MetricType& GetMetric() const
+    {
+    return this->m_Metric;
+    }
+
+  /** Numbering of the vertices (raster order by default). Tiled and Morton
+   *  orders keep the neighbors of a pixel close in the vertex and edge
+   *  storage. The graph is built again with the new numbering. */
+  void SetVertexOrdering( const VertexOrderingType& iOrdering )
+    {
+    this->m_VertexOrdering = iOrdering;
+    this->m_StencilTime.Modified();
+    this->Modified();
+    }
+
+  const VertexOrderingType& GetVertexOrdering() const
+    {
+    return this->m_VertexOrdering;
     }
 
   const GraphType & GetOutput() const
     {
-    return this->m_Graph;
+    return this->GetGraphOutput()->Get();
+    }
+
+  /** Graph owned by the adaptor, for algorithms working in place (e.g.
+   *  max-flow residual capacities). It is regenerated by the next Update()
+   *  only if the input or the adaptor was modified. */
+  GraphType & GetModifiableOutput()
+    {
+    return this->GetGraphOutput()->Get();
+    }
+
+  /** Hand the graph over to the caller without copying it: the output is
+   *  swapped into oGraph and the adaptor is left with an empty graph, which
+   *  the next Update() builds again.
+   *
+   *  To share the graph instead, keep a GraphObjectType::Pointer on
+   *  GetGraphOutput() and call DisconnectPipeline() on it. */
+  void ReleaseOutput( GraphType& oGraph )
+    {
+    GraphType empty;
+    oGraph.swap( empty );
+    oGraph.swap( this->GetModifiableOutput() );
+    this->Modified();
+    }
+
+  GraphObjectType* GetGraphOutput()
+    {
+    return static_cast< GraphObjectType* >( this->ProcessObject::GetOutput( 0 ) );
+    }
+
+  const GraphObjectType* GetGraphOutput() const
+    {
+    return static_cast< const GraphObjectType* >( this->ProcessObject::GetOutput( 0 ) );
+    }
+
+  using Superclass::MakeOutput;
+  DataObjectPointer MakeOutput( DataObjectPointerArraySizeType )
+    {
+    return GraphObjectType::New().GetPointer();
     }
 
+  /** Vertex of the pixel idx in the last generated graph. */
   VertexDescriptorType GetVertexFromIndex( const InputIndexType& idx,
                                            bool& oIsInside ) const
     {
-    typename InputImageType::OffsetValueType res = 0;
-    InputImageRegionType region = this->m_Image->GetLargestPossibleRegion();
-    oIsInside = region.IsInside( idx );
-    if( oIsInside )
+    typename VertexOrderingType::VertexType res = 0;
+    oIsInside = this->m_VertexOrdering.FindVertex( idx, res );
+    if( !oIsInside )
+      {
+      res = 0;
+      }
+    return vertex( res, this->GetOutput() );
+    }
+
+  InputIndexType GetIndexFromVertex( const VertexDescriptorType& iV ) const
+    {
+    return this->m_VertexOrdering.ComputeIndex(
+      static_cast< typename VertexOrderingType::VertexType >( iV ) );
+    }
+
+  /** Allocate an image aligned with the vertex numbering of the graph built
+   *  or exported from the input, so that it can back an ImagePropertyMap:
+   *  its buffer is the numbered region (the requested region of the input),
+   *  where vertex v is the pixel at offset v. Only raster orderings without
+   *  a mask number the vertices this way; the others throw. */
+  template< class TVertexImage >
+  typename TVertexImage::Pointer CreateVertexImage() const
+    {
+    const InputImageType* input = this->GetInput();
+
+    if( !input )
+      {
+      itkGenericExceptionMacro( << "input is null" );
+      }
+
+    VertexOrderingType ordering = this->m_VertexOrdering;
+    this->InitializeVertexOrdering( ordering );
+
+    if( ordering.GetOrder() != VertexOrderingType::RasterOrder || ordering.IsMasked() )
       {
-      res = this->m_Image->ComputeOffset( idx );
+      itkGenericExceptionMacro( << "vertices are not the buffer offsets of an image: "
+                                << "the ordering is not raster or a mask is set" );
       }
-    return vertex( res, this->m_Graph );
+
+    typename TVertexImage::Pointer image = TVertexImage::New();
+    image->CopyInformation( input );
+    image->SetBufferedRegion( ordering.GetRegion() );
+    image->SetRequestedRegion( ordering.GetRegion() );
+    image->Allocate();
+    return image;
+    }
+
+  /** Number of edges of the graph the adaptor builds, counted from the input
+   *  and the stencil without building it. */
+  SizeValueType ComputeNumberOfEdges()
+    {
+    ExportType exporter;
+    this->InitializeExport( exporter, !this->IsUndirected() );
+
+    return this->ComputeNumberOfEdges( exporter );
     }
 
-  InputIndexType GetIndexFromVertex( const VertexDescriptorType& iV )
+  /** Graph size and memory of each representation, from the input (which
+   *  must be up to date), the mask and the stencil, without building
+   *  anything. The counts are exact; the bytes of the adaptor output are
+   *  modelled from its boost types (see AdjacencyListMemoryModel). */
+  void EstimateMemory( GraphMemoryEstimate& oEstimate )
     {
-    return this->m_Image->ComputeIndex( static_cast< typename InputImageType::OffsetValueType >( iV ) );
+    ExportType exporter;
+    this->InitializeExport( exporter, !this->IsUndirected() );
+
+    const SizeValueType numberOfVertices = exporter.Ordering.GetNumberOfVertices();
+    const SizeValueType numberOfEdges = this->ComputeNumberOfEdges( exporter );
+    const SizeValueType numberOfEntries = this->IsUndirected() ? 2 * numberOfEdges : numberOfEdges;
+
+    oEstimate = GraphMemoryEstimate();
+    oEstimate.NumberOfVertices = numberOfVertices;
+    oEstimate.NumberOfEdges    = numberOfEdges;
+
+    oEstimate.Bytes[ GraphMemoryEstimate::AdjacencyListRepresentation ] =
+      AdjacencyListMemoryModel< GraphType >::ComputeBytes( numberOfVertices, numberOfEdges );
+    oEstimate.Bytes[ GraphMemoryEstimate::CSRRepresentation ] =
+      ( numberOfVertices + 1 ) * sizeof( ExportIndexType ) +
+      numberOfEntries * ( sizeof( ExportIndexType ) + sizeof( EdgeValueType ) );
+    oEstimate.Bytes[ GraphMemoryEstimate::COORepresentation ] =
+      numberOfEdges * ( 2 * sizeof( ExportIndexType ) + sizeof( EdgeValueType ) );
+    oEstimate.Bytes[ GraphMemoryEstimate::ImplicitRepresentation ] = 0;
+
+    // in_edges() of a directed graph are only available from an explicit
+    // bidirectional graph, or from the stencil for the implicit one
+    const unsigned int symmetric = boost::is_same< GraphDirectedType, boost::directedS >::value ?
+      0 : GraphMemoryEstimate::BidirectionalGraphConcept;
+
+    oEstimate.Concepts[ GraphMemoryEstimate::AdjacencyListRepresentation ] =
+      GraphMemoryEstimate::IncidenceGraphConcept | GraphMemoryEstimate::EdgeListGraphConcept |
+      GraphMemoryEstimate::MutableGraphConcept | GraphMemoryEstimate::StoredWeightsConcept | symmetric;
+    oEstimate.Concepts[ GraphMemoryEstimate::CSRRepresentation ] =
+      GraphMemoryEstimate::IncidenceGraphConcept | GraphMemoryEstimate::StoredWeightsConcept |
+      ( this->IsUndirected() ? GraphMemoryEstimate::BidirectionalGraphConcept : 0 );
+    oEstimate.Concepts[ GraphMemoryEstimate::COORepresentation ] =
+      GraphMemoryEstimate::EdgeListGraphConcept | GraphMemoryEstimate::StoredWeightsConcept;
+    oEstimate.Concepts[ GraphMemoryEstimate::ImplicitRepresentation ] =
+      GraphMemoryEstimate::IncidenceGraphConcept | GraphMemoryEstimate::BidirectionalGraphConcept;
+    }
+
+  /** Update() throws instead of building a graph whose estimated size
+   *  exceeds this many bytes (0, the default: no limit). */
+  itkSetMacro( MemoryBudget, SizeValueType );
+  itkGetConstMacro( MemoryBudget, SizeValueType );
+
+  /** Write the edges as arrays of sources, targets and weights, which must
+   *  hold ComputeNumberOfEdges() elements each. Undirected edges are written
+   *  once. oWeights may be null. Returns the number of edges.
+   *
+   *  Like ExportCSR(), it reads the input (which must be up to date) and the
+   *  stencil directly, in parallel over the vertices, and never builds the
+   *  boost graph: vertex numbers and weights are the ones the graph would
+   *  have. */
+  SizeValueType ExportCOO( ExportIndexType* oSources,
+                           ExportIndexType* oTargets,
+                           EdgeValueType* oWeights )
+    {
+    ExportType exporter;
+    this->InitializeExport( exporter, !this->IsUndirected() );
+
+    std::vector< SizeValueType > chunkStarts;
+    this->CountEdges( exporter, 0, chunkStarts );
+
+    SizeValueType numberOfEdges = 0;
+    for( size_t i = 0; i < chunkStarts.size(); ++i )
+      {
+      const SizeValueType count = chunkStarts[ i ];
+      chunkStarts[ i ] = numberOfEdges;
+      numberOfEdges += count;
+      }
+
+    ExportFunctor fill;
+    fill.Exporter     = &exporter;
+    fill.RowPointers  = 0;
+    fill.Chunks       = &chunkStarts;
+    fill.Sources      = oSources;
+    fill.Targets      = oTargets;
+    fill.Weights      = oWeights;
+    fill.OffsetIds    = 0;
+    fill.Fill         = true;
+
+    RangeThreader< ExportFunctor >::Run( exporter.Ordering.GetNumberOfVertices(),
+                                         this->GetNumberOfThreads(), fill );
+    return numberOfEdges;
+    }
+
+  /** Write the adjacency matrix: row u holds the out-neighbors of u, or all
+   *  its neighbors for an undirected graph (each edge then appears in two
+   *  rows), with the edge weights as values. */
+  void ExportCSR( CSRMatrixType& oMatrix )
+    {
+    ExportType exporter;
+    this->InitializeExport( exporter, true );
+
+    const SizeValueType numberOfVertices = exporter.Ordering.GetNumberOfVertices();
+
+    oMatrix.SetSize( numberOfVertices, numberOfVertices );
+
+    std::vector< SizeValueType > chunkCounts;
+    ExportIndexType* rowPointers = &oMatrix.GetRowPointers()[0];
+    this->CountEdges( exporter, rowPointers, chunkCounts );
+
+    for( SizeValueType r = 0; r < numberOfVertices; ++r )
+      {
+      rowPointers[ r + 1 ] += rowPointers[ r ];
+      }
+    oMatrix.AllocateEntries();
+
+    ExportFunctor fill;
+    fill.Exporter     = &exporter;
+    fill.RowPointers  = rowPointers;
+    fill.Chunks       = 0;
+    fill.Sources      = 0;
+    fill.Targets      = oMatrix.GetColumns().empty() ? 0 : &oMatrix.GetColumns()[0];
+    fill.Weights      = oMatrix.GetValues().empty() ? 0 : &oMatrix.GetValues()[0];
+    fill.OffsetIds    = 0;
+    fill.Fill         = true;
+
+    RangeThreader< ExportFunctor >::Run( numberOfVertices, this->GetNumberOfThreads(), fill );
+    }
+
+  /** Weights of the edges for each frame of a series sharing the geometry
+   *  of the input (e.g. time points or echoes): oWeights[ f ][ e ] is the
+   *  weight of edge e of ExportCOO() for iFrames[ f ], and must hold
+   *  ComputeNumberOfEdges() values.
+   *
+   *  The topology (the edges of each vertex and their offsets) is computed
+   *  by the first call from the input, the mask and the stencil, and kept
+   *  until one of them changes. Each call is then a single threaded pass
+   *  over the edges, in which the neighbors of a vertex are located once
+   *  for all the frames. */
+  void ComputeWeights( const std::vector< const InputImageType* >& iFrames,
+                       const std::vector< EdgeValueType* >& oWeights )
+    {
+    if( iFrames.size() != oWeights.size() )
+      {
+      itkExceptionMacro( << iFrames.size() << " frames for " << oWeights.size() << " weight arrays" );
+      }
+
+    this->UpdateWeightTopology();
+
+    const InputImageRegionType& region = this->m_WeightTopology.Exporter.Ordering.GetRegion();
+
+    std::vector< MetricType > metrics( iFrames.size(), this->m_Metric );
+    for( size_t f = 0; f < iFrames.size(); ++f )
+      {
+      if( !iFrames[ f ] || !iFrames[ f ]->GetBufferedRegion().IsInside( region ) )
+        {
+        itkExceptionMacro( << "frame " << f << " does not cover " << region );
+        }
+      InitializeMetric( metrics[ f ], iFrames[ f ], this->m_WeightTopology.Exporter.Offsets );
+      }
+
+    WeightFunctor weight;
+    weight.Topology = &this->m_WeightTopology;
+    weight.Frames   = &iFrames;
+    weight.Metrics  = &metrics;
+    weight.Weights  = &oWeights;
+
+    RangeThreader< WeightFunctor >::Run( this->m_WeightTopology.Exporter.Ordering.GetNumberOfVertices(),
+                                         this->GetNumberOfThreads(), weight );
+    }
+
+  /** Same as above for a single frame. */
+  void ComputeWeights( const InputImageType* iFrame, EdgeValueType* oWeights )
+    {
+    this->ComputeWeights( std::vector< const InputImageType* >( 1, iFrame ),
+                          std::vector< EdgeValueType* >( 1, oWeights ) );
+    }
+
+  /** Graphs of many small regions of the input in one call (e.g. the
+   *  windows of a detector): the block of patch p of oArena holds the
+   *  adjacency matrix ExportCSR() would write with iRegions[ p ] as the
+   *  requested region, its vertices being numbered in raster order within
+   *  the region (and the mask, if any). The regions may overlap, and must be
+   *  buffered by the input and the mask.
+   *
+   *  No adaptor, iterator nor boost graph is made per patch. Without a mask
+   *  the rows and columns of a patch only depend on its size: they are
+   *  computed and stored once per distinct size, as a topology of oArena
+   *  shared by the patches of that size, a patch then costing one pass of
+   *  metric evaluations. The patches are distributed over the threads. */
+  void ExportPatches( const std::vector< InputImageRegionType >& iRegions,
+                      PatchGraphArenaType& oArena )
+    {
+    const InputImageType* input = this->GetInput();
+    const MaskImageType*  mask = this->GetMaskImage();
+
+    if( !input )
+      {
+      itkExceptionMacro( << "input is null" );
+      }
+
+    const SizeValueType numberOfPatches = iRegions.size();
+    for( SizeValueType p = 0; p < numberOfPatches; ++p )
+      {
+      if( iRegions[ p ].GetNumberOfPixels() > 0 &&
+          ( !input->GetBufferedRegion().IsInside( iRegions[ p ] ) ||
+            ( mask && !mask->GetBufferedRegion().IsInside( iRegions[ p ] ) ) ) )
+        {
+        itkExceptionMacro( << "patch " << p << " " << iRegions[ p ] << " is not buffered" );
+        }
+      }
+
+    OffsetVectorType offsets;
+    this->GenerateOffsets( offsets, this->IsUndirected() );
+
+    MetricType metric = this->m_Metric;
+    InitializeMetric( metric, input, offsets );
+
+    std::vector< PatchTopologyType > topologies;
+
+    PatchFunctor patches;
+    patches.Image       = input;
+    patches.Metric      = &metric;
+    patches.Offsets     = &offsets;
+    patches.Regions     = &iRegions;
+    patches.Mask        = mask;
+    patches.Topologies  = &topologies;
+    patches.Arena       = &oArena;
+    patches.Fill        = false;
+
+    if( mask )
+      {
+      oArena.SetNumberOfPatches( numberOfPatches, numberOfPatches );
+      topologies.resize( numberOfPatches );
+      for( SizeValueType p = 0; p < numberOfPatches; ++p )
+        {
+        oArena.GetTopologyIds()[ p ] = p;
+        }
+      RangeThreader< PatchFunctor >::Run( numberOfPatches, this->GetNumberOfThreads(), patches );
+      oArena.AllocateBlocks();
+      }
+    else
+      {
+      std::vector< SizeValueType > topologyIds( numberOfPatches );
+      std::map< std::vector< SizeValueType >, SizeValueType > sizeIds;
+
+      for( SizeValueType p = 0; p < numberOfPatches; ++p )
+        {
+        const InputImageSizeType size = iRegions[ p ].GetSize();
+        std::vector< SizeValueType > key( InputImageType::ImageDimension );
+        for( unsigned int dim = 0; dim < InputImageType::ImageDimension; ++dim )
+          {
+          key[ dim ] = size[ dim ];
+          }
+
+        typename std::map< std::vector< SizeValueType >, SizeValueType >::iterator it = sizeIds.find( key );
+        if( it == sizeIds.end() )
+          {
+          it = sizeIds.insert( std::make_pair( key, static_cast< SizeValueType >( topologies.size() ) ) ).first;
+          topologies.push_back( PatchTopologyType() );
+          topologies.back().Ordering.Initialize( InputImageRegionType( size ) );
+          ComputePatchTopology( offsets, topologies.back() );
+          }
+        topologyIds[ p ] = it->second;
+        }
+
+      oArena.SetNumberOfPatches( numberOfPatches, topologies.size() );
+      for( SizeValueType p = 0; p < numberOfPatches; ++p )
+        {
+        const PatchTopologyType& topology = topologies[ topologyIds[ p ] ];
+        oArena.GetTopologyIds()[ p ] = topologyIds[ p ];
+        oArena.GetVertexStarts()[ p + 1 ] = topology.RowPointers.size() - 1;
+        oArena.GetEdgeStarts()[ p + 1 ] = topology.Columns.size();
+        }
+      oArena.AllocateBlocks();
+
+      for( SizeValueType t = 0; t < topologies.size(); ++t )
+        {
+        CopyPatchTopology( topologies[ t ], t, oArena );
+        }
+      }
+
+    patches.Fill = true;
+    RangeThreader< PatchFunctor >::Run( numberOfPatches, this->GetNumberOfThreads(), patches );
     }
 
 protected:
-  ImageBoostGraphAdaptorBase(){}
+  ImageBoostGraphAdaptorBase() :
+    m_MemoryBudget( 0 )
+    {
+    this->SetNumberOfRequiredInputs( 1 );
+    this->SetNumberOfRequiredOutputs( 1 );
+    this->ProcessObject::SetNthOutput( 0, this->MakeOutput( 0 ) );
+    }
   virtual ~ImageBoostGraphAdaptorBase() {}
 
-  GraphType               m_Graph;
-  InputImageConstPointer  m_Image;
   MetricType              m_Metric;
+  VertexOrderingType      m_VertexOrdering;
+  SizeValueType           m_MemoryBudget;
 
   typedef std::list< NeighborhoodIteratorOffsetType > NeighborhoodIteratorOffsetContainerType;
   NeighborhoodIteratorOffsetContainerType m_OffsetList;
 
-  void GenerateNeighborhoodIterator( InputImageRegionType& oRegion,
-                                     NeighborhoodIteratorType& oIt )
+  /** Last modification of the stencil, and region and time of the last
+   *  topology build: when neither the stencil nor the region changed since,
+   *  the edges are kept and only their weights are evaluated again. */
+  TimeStamp               m_StencilTime;
+  TimeStamp               m_TopologyTime;
+  InputImageRegionType    m_TopologyRegion;
+
+  bool IsTopologyUpToDate() const
+    {
+    const InputImageRegionType region = this->GetInput()->GetRequestedRegion();
+    const MaskImageType* mask = this->GetMaskImage();
+
+    return ( this->m_TopologyTime.GetMTime() > this->m_StencilTime.GetMTime() ) &&
+           ( !mask || this->m_TopologyTime.GetMTime() > mask->GetMTime() ) &&
+           ( region == this->m_TopologyRegion ) &&
+           ( num_vertices( this->GetOutput() ) ==
+             static_cast< SizeValueType >( this->m_VertexOrdering.GetNumberOfVertices() ) );
+    }
+
+  /** Number the pixels of the requested region, or of the mask. */
+  void InitializeVertexOrdering( VertexOrderingType& oOrdering ) const
+    {
+    oOrdering.Initialize( this->GetInput()->GetRequestedRegion() );
+
+    const MaskImageType* mask = this->GetMaskImage();
+    if( mask )
+      {
+      oOrdering.InitializeMask( mask );
+      }
+    }
+
+  void GenerateData()
     {
-    if( !this->m_Image )
+    if( !this->GetInput() )
       {
       itkGenericExceptionMacro( << "input is null" );
       }
 
-    oRegion = this->m_Image->GetRequestedRegion();
+    this->InitializeVertexOrdering( this->m_VertexOrdering );
+
+    // Progress is reported, and AbortGenerateData checked, every percent of
+    // the vertices. An aborted build frees the partial graph.
+    try
+      {
+      if( this->IsTopologyUpToDate() )
+        {
+        this->GenerateWeights();
+        }
+      else
+        {
+        if( this->m_MemoryBudget > 0 )
+          {
+          GraphMemoryEstimate estimate;
+          this->EstimateMemory( estimate );
 
-    InputImageSizeValueType numberOfVertices = oRegion.GetNumberOfPixels();
-    this->m_Graph = GraphType( numberOfVertices );
+          const SizeValueType bytes = estimate.Bytes[ GraphMemoryEstimate::AdjacencyListRepresentation ];
+          if( bytes > this->m_MemoryBudget )
+            {
+            itkExceptionMacro( << "graph of " << estimate.NumberOfVertices << " vertices and "
+                               << estimate.NumberOfEdges << " edges needs about " << bytes
+                               << " bytes, over the budget of " << this->m_MemoryBudget );
+            }
+          }
 
-    typename NeighborhoodIteratorType::RadiusType radius;
-    radius.Fill( 0 );
+        this->GenerateGraph();
 
-    for( typename NeighborhoodIteratorOffsetContainerType::const_iterator it = m_OffsetList.begin();
-         it != m_OffsetList.end(); ++it )
+        this->m_TopologyRegion = this->GetInput()->GetRequestedRegion();
+        this->m_TopologyTime.Modified();
+        }
+      }
+    catch( ProcessAborted& )
       {
-      for( unsigned int dim = 0; dim < InputImageType::ImageDimension; ++dim )
+      GraphType empty;
+      this->GetModifiableOutput().swap( empty );
+      throw;
+      }
+    }
+
+  /** Evaluate the metric again on every existing edge. */
+  void GenerateWeights()
+    {
+    const InputImageType* image = this->GetInput();
+    GraphType& graph = this->GetModifiableOutput();
+    const VertexOrderingType& ordering = this->m_VertexOrdering;
+
+    WeightMapType weightmap = get( boost::edge_weight, graph );
+
+    // The offset of an edge is not known here: the metric is evaluated on
+    // its ends.
+    OffsetVectorType offsets;
+    this->GenerateOffsets( offsets, this->IsUndirected() );
+    InitializeMetric( this->m_Metric, image, offsets );
+
+    ProgressReporter progress( this, 0, num_edges( graph ) );
+
+    typename GraphTraits::edge_iterator eIt, eEnd;
+    for( boost::tie( eIt, eEnd ) = edges( graph ); eIt != eEnd; ++eIt, progress.CompletedPixel() )
+      {
+      weightmap[ *eIt ] = this->m_Metric.Evaluate( image,
+                                                   ordering.ComputeIndex( source( *eIt, graph ) ),
+                                                   ordering.ComputeIndex( target( *eIt, graph ) ) );
+      }
+    }
+
+  typedef std::vector< NeighborhoodIteratorOffsetType > OffsetVectorType;
+
+  static bool IsUndirected()
+    {
+    return boost::is_same< GraphDirectedType, boost::undirectedS >::value;
+    }
+
+  /** Distinct non-zero offsets of the stencil. With iSymmetric, the opposite
+   *  offsets are added. */
+  void GenerateOffsets( OffsetVectorType& oOffsets, bool iSymmetric = false ) const
+    {
+    StencilType::GenerateOffsets( this->m_OffsetList, oOffsets, iSymmetric );
+    }
+
+  /** One offset of each pair of opposite offsets of the symmetrized
+   *  stencil: the one whose last non-zero component is positive, from which
+   *  each undirected edge is found once. */
+  void GenerateHalfOffsets( OffsetVectorType& oOffsets ) const
+    {
+    OffsetVectorType offsets;
+    this->GenerateOffsets( offsets, true );
+
+    oOffsets.clear();
+    for( size_t k = 0; k < offsets.size(); ++k )
+      {
+      int dim = InputImageType::ImageDimension - 1;
+      while( offsets[ k ][ dim ] == 0 )
+        {
+        --dim;
+        }
+      if( offsets[ k ][ dim ] > 0 )
+        {
+        oOffsets.push_back( offsets[ k ] );
+        }
+      }
+    }
+
+  /** Allocate the vertices of the requested region and return the distinct
+   *  non-zero offsets of the stencil, one per pair of opposite offsets for
+   *  an undirected graph. GenerateGraph() visits the vertices in
+   *  the order of their numbers, so that the edges are laid out in the same
+   *  order. */
+  void GenerateVertices( InputImageRegionType& oRegion,
+                         OffsetVectorType& oOffsets )
+    {
+    oRegion = this->GetInput()->GetRequestedRegion();
+
+    InputImageSizeValueType numberOfVertices = this->m_VertexOrdering.GetNumberOfVertices();
+    this->GetModifiableOutput() = GraphType( numberOfVertices );
+
+    if( IsUndirected() )
+      {
+      this->GenerateHalfOffsets( oOffsets );
+      }
+    else
+      {
+      this->GenerateOffsets( oOffsets );
+      }
+    this->ReserveEdgeLists();
+    }
+
+  /** Give the std::vector containers of the new graph their exact final
+   *  capacity, so that add_edge() never grows them: the incidence lists of
+   *  a vecS out-edge list, and the edge list of an undirected or
+   *  bidirectional graph with a vecS edge list, which then holds all the
+   *  edges in a single block. The degrees are counted from the stencil, in
+   *  parallel, as for ExportCSR(). Only the graph types supported by
+   *  AdjacencyListReserve are reserved. */
+  void ReserveEdgeLists()
+    {
+    typedef AdjacencyListReserve< GraphType >           ReserveType;
+    typedef typename GraphType::out_edge_list_selector  OutEdgeListSelectorType;
+    typedef typename GraphType::edge_list_selector      EdgeListSelectorType;
+
+    const bool vectorIncidenceLists = boost::is_same< OutEdgeListSelectorType, boost::vecS >::value;
+    const bool vectorEdgeList = boost::is_same< EdgeListSelectorType, boost::vecS >::value &&
+                                !boost::is_same< GraphDirectedType, boost::directedS >::value;
+
+    if( !ReserveType::Supported || ( !vectorIncidenceLists && !vectorEdgeList ) )
+      {
+      return;
+      }
+
+    GraphType& graph = this->GetModifiableOutput();
+    const SizeValueType numberOfVertices = num_vertices( graph );
+
+    ExportType exporter;
+    this->InitializeExport( exporter, true );
+
+    std::vector< ExportIndexType > degrees( numberOfVertices + 1, 0 );
+    std::vector< SizeValueType > chunkCounts;
+
+    this->CountEdges( exporter, &degrees[0], chunkCounts );
+
+    SizeValueType numberOfEntries = 0;
+    for( SizeValueType u = 0; u < numberOfVertices; ++u )
+      {
+      ReserveType::ReserveOutEdges( graph, u, degrees[ u + 1 ] );
+      numberOfEntries += degrees[ u + 1 ];
+      }
+
+    if( vectorEdgeList )
+      {
+      // each undirected edge is in the lists of both its ends
+      ReserveType::ReserveEdges( graph, IsUndirected() ? numberOfEntries / 2 : numberOfEntries );
+      }
+
+    if( boost::is_same< GraphDirectedType, boost::bidirectionalS >::value && vectorIncidenceLists )
+      {
+      // in-degrees are the out-degrees for the opposite stencil
+      NeighborhoodIteratorOffsetType zeroOffset;
+      zeroOffset.Fill( 0 );
+      for( size_t k = 0; k < exporter.Offsets.size(); ++k )
+        {
+        exporter.Offsets[ k ] = zeroOffset - exporter.Offsets[ k ];
+        }
+      exporter.Stencil.Initialize( exporter.Ordering, exporter.Offsets );
+
+      this->CountEdges( exporter, &degrees[0], chunkCounts );
+      for( SizeValueType u = 0; u < numberOfVertices; ++u )
+        {
+        ReserveType::ReserveInEdges( graph, u, degrees[ u + 1 ] );
+        }
+      }
+    }
+
+  /** State of an export, shared by its threads. */
+  struct ExportType
+    {
+    const InputImageType* Image;
+    MetricType            Metric;
+    VertexOrderingType    Ordering;
+    OffsetVectorType      Offsets;
+    StencilType           Stencil;
+    };
+
+  /** iAllNeighbors: every edge from each vertex, in both directions for an
+   *  undirected graph; otherwise each undirected edge only once, from the
+   *  offset whose last non-zero component is positive. */
+  void InitializeExport( ExportType& oExporter, bool iAllNeighbors ) const
+    {
+    const InputImageType* input = this->GetInput();
+
+    if( !input )
+      {
+      itkGenericExceptionMacro( << "input is null" );
+      }
+
+    oExporter.Image     = input;
+    oExporter.Metric    = this->m_Metric;
+    oExporter.Ordering  = this->m_VertexOrdering;
+    this->InitializeVertexOrdering( oExporter.Ordering );
+
+    if( IsUndirected() && !iAllNeighbors )
+      {
+      this->GenerateHalfOffsets( oExporter.Offsets );
+      }
+    else
+      {
+      this->GenerateOffsets( oExporter.Offsets, IsUndirected() );
+      }
+    oExporter.Stencil.Initialize( oExporter.Ordering, oExporter.Offsets );
+    InitializeMetric( oExporter.Metric, input, oExporter.Offsets );
+    }
+
+  /** Edges from the vertices [iBegin, iEnd): counted (row lengths in
+   *  RowPointers[ u + 1 ], totals per chunk in Chunks), or written from
+   *  RowPointers[ iBegin ] or from the start of the chunk. */
+  struct ExportFunctor
+    {
+    const ExportType*             Exporter;
+    ExportIndexType*              RowPointers;
+    std::vector< SizeValueType >* Chunks;
+    ExportIndexType*              Sources;
+    ExportIndexType*              Targets;
+    EdgeValueType*                Weights;
+    unsigned int*                 OffsetIds;
+    bool                          Fill;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType iThreadId )
+      {
+      const VertexOrderingType&   ordering = Exporter->Ordering;
+      const OffsetVectorType&     offsets = Exporter->Offsets;
+      const StencilType&          stencil = Exporter->Stencil;
+      const unsigned int          numberOfOffsets = stencil.GetNumberOfOffsets();
+
+      SizeValueType e = 0;
+      if( Fill )
+        {
+        e = RowPointers ? RowPointers[ iBegin ] : ( *Chunks )[ iThreadId ];
+        }
+
+      for( SizeValueType u = iBegin; u < iEnd; ++u )
+        {
+        const InputIndexType index = ordering.ComputeIndex( u );
+        const bool interior = stencil.IsInterior( index );
+        const SizeValueType rowStart = e;
+
+        if( !Fill && interior )
+          {
+          // every offset gives an edge
+          e += numberOfOffsets;
+          }
+
+        for( unsigned int k = 0; k < numberOfOffsets && ( Fill || !interior ); ++k )
+          {
+          typename VertexOrderingType::VertexType v;
+
+          if( stencil.FindNeighbor( ordering, u, index, interior, k, v ) )
+            {
+            if( Fill )
+              {
+              if( Sources )
+                {
+                Sources[ e ] = u;
+                }
+              if( Targets )
+                {
+                Targets[ e ] = v;
+                }
+              if( OffsetIds )
+                {
+                OffsetIds[ e ] = static_cast< unsigned int >( k );
+                }
+              if( Weights )
+                {
+                Weights[ e ] = EvaluateMetric< EdgeValueType >( Exporter->Metric, Exporter->Image,
+                                                                index, index + offsets[ k ], k );
+                }
+              }
+            ++e;
+            }
+          }
+
+        if( !Fill && RowPointers )
+          {
+          RowPointers[ u + 1 ] = e - rowStart;
+          }
+        }
+
+      if( !Fill )
+        {
+        ( *Chunks )[ iThreadId ] = e;
+        }
+      }
+    };
+
+  /** Per-chunk edge counts, and row lengths if oRowLengths is not null. */
+  void CountEdges( const ExportType& iExporter,
+                   ExportIndexType* oRowLengths,
+                   std::vector< SizeValueType >& oChunkCounts ) const
+    {
+    const ThreadIdType numberOfThreads = this->GetNumberOfThreads();
+
+    oChunkCounts.assign( numberOfThreads, 0 );
+
+    ExportFunctor count;
+    count.Exporter    = &iExporter;
+    count.RowPointers = oRowLengths;
+    count.Chunks      = &oChunkCounts;
+    count.Sources     = 0;
+    count.Targets     = 0;
+    count.Weights     = 0;
+    count.OffsetIds   = 0;
+    count.Fill        = false;
+
+    RangeThreader< ExportFunctor >::Run( iExporter.Ordering.GetNumberOfVertices(),
+                                         numberOfThreads, count );
+    }
+
+  /** Edges of an export. Without a mask, an offset o gives one edge per
+   *  pixel p such that p + o is in the region, i.e. prod( size - |o| ). */
+  SizeValueType ComputeNumberOfEdges( const ExportType& iExporter ) const
+    {
+    SizeValueType numberOfEdges = 0;
+
+    if( !iExporter.Ordering.IsMasked() )
+      {
+      const InputImageSizeType size = iExporter.Ordering.GetRegion().GetSize();
+
+      for( size_t k = 0; k < iExporter.Offsets.size(); ++k )
+        {
+        SizeValueType count = 1;
+        for( unsigned int dim = 0; dim < InputImageType::ImageDimension; ++dim )
+          {
+          const SizeValueType length = static_cast< SizeValueType >(
+            std::abs( static_cast< long >( iExporter.Offsets[ k ][ dim ] ) ) );
+          count *= ( size[ dim ] > length ) ? size[ dim ] - length : 0;
+          }
+        numberOfEdges += count;
+        }
+      return numberOfEdges;
+      }
+
+    std::vector< SizeValueType > chunkCounts;
+    this->CountEdges( iExporter, 0, chunkCounts );
+
+    for( size_t i = 0; i < chunkCounts.size(); ++i )
+      {
+      numberOfEdges += chunkCounts[ i ];
+      }
+    return numberOfEdges;
+    }
+
+  /** Edges in the order of ExportCOO(): those of vertex u are
+   *  [ RowPointers[ u ], RowPointers[ u + 1 ] ), to the neighbor at offset
+   *  Exporter.Offsets[ OffsetIds[ e ] ]. */
+  struct WeightTopologyType
+    {
+    ExportType                      Exporter;
+    std::vector< ExportIndexType >  RowPointers;
+    std::vector< unsigned int >     OffsetIds;
+    TimeStamp                       Time;
+    };
+
+  WeightTopologyType m_WeightTopology;
+
+  void UpdateWeightTopology()
+    {
+    WeightTopologyType& topology = this->m_WeightTopology;
+    const MaskImageType* mask = this->GetMaskImage();
+
+    if( !topology.RowPointers.empty() &&
+        topology.Time.GetMTime() > this->m_StencilTime.GetMTime() &&
+        ( !mask || topology.Time.GetMTime() > mask->GetMTime() ) &&
+        topology.Exporter.Ordering.GetRegion() == this->GetInput()->GetRequestedRegion() )
+      {
+      return;
+      }
+
+    this->InitializeExport( topology.Exporter, !this->IsUndirected() );
+
+    const SizeValueType numberOfVertices = topology.Exporter.Ordering.GetNumberOfVertices();
+
+    topology.RowPointers.assign( numberOfVertices + 1, 0 );
+
+    std::vector< SizeValueType > chunkCounts;
+    this->CountEdges( topology.Exporter, &topology.RowPointers[0], chunkCounts );
+
+    for( SizeValueType u = 0; u < numberOfVertices; ++u )
+      {
+      topology.RowPointers[ u + 1 ] += topology.RowPointers[ u ];
+      }
+    topology.OffsetIds.resize( topology.RowPointers.back() );
+
+    ExportFunctor fill;
+    fill.Exporter     = &topology.Exporter;
+    fill.RowPointers  = &topology.RowPointers[0];
+    fill.Chunks       = 0;
+    fill.Sources      = 0;
+    fill.Targets      = 0;
+    fill.Weights      = 0;
+    fill.OffsetIds    = topology.OffsetIds.empty() ? 0 : &topology.OffsetIds[0];
+    fill.Fill         = true;
+
+    RangeThreader< ExportFunctor >::Run( numberOfVertices, this->GetNumberOfThreads(), fill );
+
+    topology.Time.Modified();
+    }
+
+  /** Weights of the edges of the vertices [iBegin, iEnd) for all frames. */
+  struct WeightFunctor
+    {
+    const WeightTopologyType*                   Topology;
+    const std::vector< const InputImageType* >* Frames;
+    const std::vector< MetricType >*            Metrics;
+    const std::vector< EdgeValueType* >*        Weights;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      const VertexOrderingType& ordering = Topology->Exporter.Ordering;
+      const OffsetVectorType&   offsets = Topology->Exporter.Offsets;
+      const ExportIndexType*    rows = &Topology->RowPointers[0];
+      const size_t              numberOfFrames = Frames->size();
+
+      for( SizeValueType u = iBegin; u < iEnd; ++u )
         {
-        typename NeighborhoodIteratorOffsetType::OffsetValueType absValue = vnl_math_abs( ( *it )[ dim ] );
-        if( absValue > radius[ dim ] )
+        const InputIndexType index = ordering.ComputeIndex( u );
+
+        for( ExportIndexType e = rows[ u ]; e < rows[ u + 1 ]; ++e )
           {
-          radius[ dim ] = absValue;
+          const unsigned int   k = Topology->OffsetIds[ e ];
+          const InputIndexType neighIndex = index + offsets[ k ];
+
+          for( size_t f = 0; f < numberOfFrames; ++f )
+            {
+            ( *Weights )[ f ][ e ] =
+              EvaluateMetric< EdgeValueType >( ( *Metrics )[ f ], ( *Frames )[ f ], index, neighIndex, k );
+            }
           }
         }
       }
+    };
+
+  /** Rows of a patch graph, to vertices numbered within the patch, and the
+   *  offset of each entry. Shared by the patches of a size without a mask,
+   *  in which case the region of the ordering starts at the origin. */
+  struct PatchTopologyType
+    {
+    VertexOrderingType              Ordering;
+    std::vector< ExportIndexType >  RowPointers;
+    std::vector< ExportIndexType >  Columns;
+    std::vector< unsigned int >     OffsetIds;
+    };
+
+  /** Rows of the vertices of ioTopology.Ordering, in a single thread. */
+  static void ComputePatchTopology( const OffsetVectorType& iOffsets, PatchTopologyType& ioTopology )
+    {
+    const VertexOrderingType& ordering = ioTopology.Ordering;
+    const SizeValueType       numberOfVertices = ordering.GetNumberOfVertices();
+
+    StencilType stencil;
+    stencil.Initialize( ordering, iOffsets );
 
-    oIt = NeighborhoodIteratorType( radius, this->m_Image, oRegion );
+    ioTopology.RowPointers.assign( numberOfVertices + 1, 0 );
+    ioTopology.Columns.clear();
+    ioTopology.OffsetIds.clear();
+    ioTopology.Columns.reserve( numberOfVertices * iOffsets.size() );
+    ioTopology.OffsetIds.reserve( numberOfVertices * iOffsets.size() );
 
-    for( typename NeighborhoodIteratorOffsetContainerType::const_iterator it = m_OffsetList.begin();
-         it != m_OffsetList.end(); ++it )
+    for( SizeValueType u = 0; u < numberOfVertices; ++u )
       {
-      oIt.ActivateOffset( *it );
+      const InputIndexType index = ordering.ComputeIndex( u );
+      const bool interior = stencil.IsInterior( index );
+
+      for( unsigned int k = 0; k < stencil.GetNumberOfOffsets(); ++k )
+        {
+        typename VertexOrderingType::VertexType v;
+        if( stencil.FindNeighbor( ordering, u, index, interior, k, v ) )
+          {
+          ioTopology.Columns.push_back( v );
+          ioTopology.OffsetIds.push_back( static_cast< unsigned int >( k ) );
+          }
+        }
+      ioTopology.RowPointers[ u + 1 ] = ioTopology.Columns.size();
       }
     }
 
-  virtual void GenerateData() = 0;
+  /** Rows and columns of ioArena's topology iT, from iTopology. */
+  static void CopyPatchTopology( const PatchTopologyType& iTopology, SizeValueType iT,
+                                 PatchGraphArenaType& ioArena )
+    {
+    std::copy( iTopology.RowPointers.begin(), iTopology.RowPointers.end(),
+               ioArena.GetRowPointers().begin() + ( ioArena.GetTopologyVertexStarts()[ iT ] + iT ) );
+    std::copy( iTopology.Columns.begin(), iTopology.Columns.end(),
+               ioArena.GetColumns().begin() + ioArena.GetTopologyEdgeStarts()[ iT ] );
+    }
+
+  /** Patches [iBegin, iEnd) of ExportPatches(): masked topologies computed
+   *  and counted, or blocks weighted (and their masked topology copied). */
+  struct PatchFunctor
+    {
+    const InputImageType*                       Image;
+    const MetricType*                           Metric;
+    const OffsetVectorType*                     Offsets;
+    const std::vector< InputImageRegionType >*  Regions;
+    const MaskImageType*                        Mask;
+    std::vector< PatchTopologyType >*           Topologies;
+    PatchGraphArenaType*                        Arena;
+    bool                                        Fill;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      for( SizeValueType p = iBegin; p < iEnd; ++p )
+        {
+        if( !Fill )
+          {
+          PatchTopologyType& topology = ( *Topologies )[ p ];
+          topology.Ordering.Initialize( ( *Regions )[ p ] );
+          topology.Ordering.InitializeMask( Mask );
+          ComputePatchTopology( *Offsets, topology );
+
+          Arena->GetVertexStarts()[ p + 1 ] = topology.RowPointers.size() - 1;
+          Arena->GetEdgeStarts()[ p + 1 ] = topology.Columns.size();
+          continue;
+          }
+
+        const SizeValueType      t = Arena->GetTopologyId( p );
+        const PatchTopologyType& topology = ( *Topologies )[ t ];
+        const SizeValueType      numberOfVertices = topology.RowPointers.size() - 1;
+        const SizeValueType      first = Arena->GetEdgeStarts()[ p ];
+
+        if( Mask )
+          {
+          CopyPatchTopology( topology, t, *Arena );
+          }
+
+        const NeighborhoodIteratorOffsetType shift =
+          ( *Regions )[ p ].GetIndex() - topology.Ordering.GetRegion().GetIndex();
+        const ExportIndexType* rows = &topology.RowPointers[0];
+
+        for( SizeValueType u = 0; u < numberOfVertices; ++u )
+          {
+          const InputIndexType index = topology.Ordering.ComputeIndex( u ) + shift;
+
+          for( ExportIndexType e = rows[ u ]; e < rows[ u + 1 ]; ++e )
+            {
+            const unsigned int k = topology.OffsetIds[ e ];
+            Arena->GetValues()[ first + e ] =
+              EvaluateMetric< EdgeValueType >( *Metric, Image, index, index + ( *Offsets )[ k ], k );
+            }
+          }
+        }
+      }
+    };
+
+  /** Build the edges for the stencil and evaluate their weights. */
+  virtual void GenerateGraph() = 0;
 
 private:
   ImageBoostGraphAdaptorBase( const Self& );
@@ -250,48 +1370,47 @@ protected:
   ImageBoostGraphAdaptor() {}
   ~ImageBoostGraphAdaptor() {}
 
-  void GenerateData()
+  void GenerateGraph()
     {
-    WeightMapType weightmap = get( boost::edge_weight, this->m_Graph );
+    const InputImageType* image = this->GetInput();
 
     InputImageRegionType region;
+    typename Superclass::OffsetVectorType offsets;
 
-    NeighborhoodIteratorType neighIt;
+    this->GenerateVertices( region, offsets );
+    InitializeMetric( this->m_Metric, image, offsets );
 
-    this->GenerateNeighborhoodIterator( region, neighIt );
+    GraphType& graph = this->GetModifiableOutput();
+    WeightMapType weightmap = get( boost::edge_weight, graph );
 
-    for( neighIt.GoToBegin(); !neighIt.IsAtEnd(); ++neighIt )
-      {
-      InputIndexType index = neighIt.GetIndex();
-      bool inside = false;
+    const VertexDescriptorType numberOfVertices = num_vertices( graph );
+    const typename Superclass::VertexOrderingType& ordering = this->GetVertexOrdering();
 
-      VertexDescriptorType u = this->GetVertexFromIndex( index, inside );
+    typename Superclass::StencilType stencil;
+    stencil.Initialize( ordering, offsets );
 
-//      itkAssertInDebugAndIgnoreInReleaseMacro( inside );
+    ProgressReporter progress( this, 0, numberOfVertices );
 
-      for( typename NeighborhoodIteratorType::ConstIterator internalIt = neighIt.Begin();
-           !internalIt.IsAtEnd(); ++internalIt )
-        {
-        unsigned int i = internalIt.GetNeighborhoodIndex();
-        InputIndexType neighIndex = neighIt.GetIndex( i );
+    for( VertexDescriptorType u = 0; u < numberOfVertices; ++u, progress.CompletedPixel() )
+      {
+      InputIndexType index = ordering.ComputeIndex( u );
+      const bool interior = stencil.IsInterior( index );
 
-        bool IsInBounds = region.IsInside( neighIndex );
+      for( unsigned int k = 0; k < stencil.GetNumberOfOffsets(); ++k )
+        {
+        typename Superclass::VertexOrderingType::VertexType neighVertex;
 
-        if( IsInBounds && index != neighIndex )
+        if( stencil.FindNeighbor( ordering, u, index, interior, k, neighVertex ) )
           {
-          VertexDescriptorType v = this->GetVertexFromIndex( neighIndex, inside );
-//          itkAssertInDebugAndIgnoreInReleaseMacro( inside );
+          InputIndexType neighIndex = index + offsets[ k ];
+          VertexDescriptorType v = neighVertex;
 
+          // each edge is found once, from the half stencil
           EdgeDescriptorType e;
 
-          std::pair< EdgeDescriptorType, bool> retrievedEdge = edge( u, v, this->m_Graph );
-
-          if( !retrievedEdge.second )
-            {
-            bool inserted = false;
-            boost::tie(e, inserted) = add_edge( u, v, this->m_Graph );
-            weightmap[ e ] = this->m_Metric.Evaluate( this->m_Image, index, neighIndex );
-            }
+          bool inserted = false;
+          boost::tie(e, inserted) = add_edge( u, v, graph );
+          weightmap[ e ] = EvaluateMetric< EdgeValueType >( this->m_Metric, image, index, neighIndex, k );
           }
         }
       }
@@ -359,41 +1478,46 @@ protected:
   ImageBoostGraphAdaptor() {}
   ~ImageBoostGraphAdaptor() {}
 
-  void GenerateData()
+  void GenerateGraph()
     {
-    WeightMapType weightmap = get( boost::edge_weight, this->m_Graph );
+    const InputImageType* image = this->GetInput();
 
     InputImageRegionType region;
-    NeighborhoodIteratorType neighIt;
+    typename Superclass::OffsetVectorType offsets;
 
-    this->GenerateNeighborhoodIterator( region, neighIt );
+    this->GenerateVertices( region, offsets );
+    InitializeMetric( this->m_Metric, image, offsets );
 
-    for( neighIt.GoToBegin(); !neighIt.IsAtEnd(); ++neighIt )
-      {
-      InputIndexType index = neighIt.GetIndex();
-      bool inside = false;
+    GraphType& graph = this->GetModifiableOutput();
+    WeightMapType weightmap = get( boost::edge_weight, graph );
 
-      VertexDescriptorType u = this->GetVertexFromIndex( index, inside );
+    const VertexDescriptorType numberOfVertices = num_vertices( graph );
+    const typename Superclass::VertexOrderingType& ordering = this->GetVertexOrdering();
 
-//      itkAssertInDebugAndIgnoreInReleaseMacro( inside );
+    typename Superclass::StencilType stencil;
+    stencil.Initialize( ordering, offsets );
 
-      for( typename NeighborhoodIteratorType::ConstIterator internalIt = neighIt.Begin();
-           !internalIt.IsAtEnd(); ++internalIt )
-        {
-        unsigned int i = internalIt.GetNeighborhoodIndex();
-        InputIndexType neighIndex = neighIt.GetIndex( i );
+    ProgressReporter progress( this, 0, numberOfVertices );
 
-        bool IsInBounds = region.IsInside( neighIndex );
+    for( VertexDescriptorType u = 0; u < numberOfVertices; ++u, progress.CompletedPixel() )
+      {
+      InputIndexType index = ordering.ComputeIndex( u );
+      const bool interior = stencil.IsInterior( index );
+
+      for( unsigned int k = 0; k < stencil.GetNumberOfOffsets(); ++k )
+        {
+        typename Superclass::VertexOrderingType::VertexType neighVertex;
 
-        if( IsInBounds && index != neighIndex )
+        if( stencil.FindNeighbor( ordering, u, index, interior, k, neighVertex ) )
           {
-          VertexDescriptorType v = this->GetVertexFromIndex( neighIndex, inside );
+          InputIndexType neighIndex = index + offsets[ k ];
+          VertexDescriptorType v = neighVertex;
 
           EdgeDescriptorType e;
 
           bool inserted = false;
-          boost::tie(e, inserted) = add_edge( u, v, this->m_Graph );
-          weightmap[ e ] = this->m_Metric.Evaluate( this->m_Image, index, neighIndex );
+          boost::tie(e, inserted) = add_edge( u, v, graph );
+          weightmap[ e ] = EvaluateMetric< EdgeValueType >( this->m_Metric, image, index, neighIndex, k );
           }
         }
       }
@@ -461,41 +1585,46 @@ protected:
   ImageBoostGraphAdaptor() {}
   ~ImageBoostGraphAdaptor() {}
 
-  void GenerateData()
+  void GenerateGraph()
     {
-    WeightMapType weightmap = get( boost::edge_weight, this->m_Graph );
+    const InputImageType* image = this->GetInput();
 
     InputImageRegionType region;
-    NeighborhoodIteratorType neighIt;
+    typename Superclass::OffsetVectorType offsets;
 
-    this->GenerateNeighborhoodIterator( region, neighIt );
+    this->GenerateVertices( region, offsets );
+    InitializeMetric( this->m_Metric, image, offsets );
 
-    for( neighIt.GoToBegin(); !neighIt.IsAtEnd(); ++neighIt )
-      {
-      InputIndexType index = neighIt.GetIndex();
-      bool inside = false;
+    GraphType& graph = this->GetModifiableOutput();
+    WeightMapType weightmap = get( boost::edge_weight, graph );
 
-      VertexDescriptorType u = this->GetVertexFromIndex( index, inside );
+    const VertexDescriptorType numberOfVertices = num_vertices( graph );
+    const typename Superclass::VertexOrderingType& ordering = this->GetVertexOrdering();
 
-//      itkAssertInDebugAndIgnoreInReleaseMacro( inside );
+    typename Superclass::StencilType stencil;
+    stencil.Initialize( ordering, offsets );
 
-      for( typename NeighborhoodIteratorType::ConstIterator internalIt = neighIt.Begin();
-           !internalIt.IsAtEnd(); ++internalIt )
-        {
-        unsigned int i = internalIt.GetNeighborhoodIndex();
-        InputIndexType neighIndex = neighIt.GetIndex( i );
+    ProgressReporter progress( this, 0, numberOfVertices );
 
-        bool IsInBounds = region.IsInside( neighIndex );
+    for( VertexDescriptorType u = 0; u < numberOfVertices; ++u, progress.CompletedPixel() )
+      {
+      InputIndexType index = ordering.ComputeIndex( u );
+      const bool interior = stencil.IsInterior( index );
+
+      for( unsigned int k = 0; k < stencil.GetNumberOfOffsets(); ++k )
+        {
+        typename Superclass::VertexOrderingType::VertexType neighVertex;
 
-        if( IsInBounds && index != neighIndex )
+        if( stencil.FindNeighbor( ordering, u, index, interior, k, neighVertex ) )
           {
-          VertexDescriptorType v = this->GetVertexFromIndex( neighIndex, inside );
+          InputIndexType neighIndex = index + offsets[ k ];
+          VertexDescriptorType v = neighVertex;
 
           EdgeDescriptorType e;
 
           bool inserted = false;
-          boost::tie(e, inserted) = add_edge( u, v, this->m_Graph );
-          weightmap[ e ] = this->m_Metric.Evaluate( this->m_Image, index, neighIndex );
+          boost::tie(e, inserted) = add_edge( u, v, graph );
+          weightmap[ e ] = EvaluateMetric< EdgeValueType >( this->m_Metric, image, index, neighIndex, k );
           }
         }
       }
@@ -508,3 +1637,4 @@ private:
 
 }
 
+#endif
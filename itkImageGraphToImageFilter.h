@@ -0,0 +1,100 @@
+#ifndef __itkImageGraphToImageFilter_h
+#define __itkImageGraphToImageFilter_h
+
+#include <vector>
+
+#include "itkImageToImageFilter.h"
+
+namespace itk
+{
+/** \class ImageGraphToImageFilter
+ *  \brief Base of the filters which work on the pixel graph of their input,
+ *  given by a stencil (SetNeighbors()) and an edge metric (SetMetric()).
+ *
+ *  The problems these filters solve are global, so the whole largest
+ *  possible region of each input is requested and each output is produced
+ *  on its largest possible region.
+ */
+template< class TInputImage, class TOutputImage, class TMetric >
+class ImageGraphToImageFilter :
+  public ImageToImageFilter< TInputImage, TOutputImage >
+  {
+public:
+  typedef ImageGraphToImageFilter                         Self;
+  typedef ImageToImageFilter< TInputImage, TOutputImage > Superclass;
+  typedef SmartPointer< Self >                            Pointer;
+  typedef SmartPointer< const Self >                      ConstPointer;
+
+  itkTypeMacro( ImageGraphToImageFilter, ImageToImageFilter );
+
+  typedef TInputImage                             InputImageType;
+  typedef typename InputImageType::OffsetType     InputOffsetType;
+  typedef std::vector< InputOffsetType >          OffsetContainerType;
+
+  typedef TMetric                                 MetricType;
+
+  template< class T >
+  void SetNeighbors( const T & iOffsets )
+    {
+    this->SetNeighbors( iOffsets.begin(), iOffsets.end() );
+    }
+
+  template< class TIterator >
+  void SetNeighbors( const TIterator& iBegin, const TIterator& iEnd )
+    {
+    TIterator it = iBegin;
+
+    while( it != iEnd )
+      {
+      this->m_OffsetList.push_back( *it );
+      ++it;
+      }
+    this->Modified();
+    }
+
+  void SetMetric( const MetricType& iMetric )
+    {
+    this->m_Metric = iMetric;
+    this->Modified();
+    }
+
+  const MetricType& GetMetric() const
+    {
+    return this->m_Metric;
+    }
+
+protected:
+  ImageGraphToImageFilter() {}
+  ~ImageGraphToImageFilter() {}
+
+  OffsetContainerType m_OffsetList;
+  MetricType          m_Metric;
+
+  void GenerateInputRequestedRegion()
+    {
+    for( unsigned int i = 0; i < this->GetNumberOfInputs(); ++i )
+      {
+      DataObject* input = this->ProcessObject::GetInput( i );
+      if( input )
+        {
+        input->SetRequestedRegionToLargestPossibleRegion();
+        }
+      }
+    }
+
+  void EnlargeOutputRequestedRegion( DataObject* )
+    {
+    for( unsigned int i = 0; i < this->GetNumberOfOutputs(); ++i )
+      {
+      this->ProcessObject::GetOutput( i )->SetRequestedRegionToLargestPossibleRegion();
+      }
+    }
+
+private:
+  ImageGraphToImageFilter( const Self& );
+  void operator = ( const Self& );
+};
+
+}
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef __itkImagePropertyMap_h
+#define __itkImagePropertyMap_h
+
+#include <cstddef>
+
+#include <boost/property_map/property_map.hpp>
+
+#include "itkSmartPointer.h"
+
+namespace itk
+{
+/** \class ImagePropertyMap
+ *  \brief boost lvalue property map whose storage is an itk::Image buffer.
+ *
+ *  The key is a vertex descriptor of the adaptor's graph, i.e., with the
+ *  default raster ordering and no mask, the offset of the pixel in the
+ *  region the graph was built on. Allocating the image with
+ *  ImageBoostGraphAdaptorBase::CreateVertexImage() keeps it aligned with the
+ *  vertex numbering, so BGL algorithms (distance, predecessor, label maps)
+ *  write their results straight into the image.
+ */
+template< class TImage >
+class ImagePropertyMap :
+  public boost::put_get_helper< typename TImage::PixelType&, ImagePropertyMap< TImage > >
+  {
+public:
+  typedef TImage                          ImageType;
+  typedef typename ImageType::Pointer     ImagePointer;
+  typedef typename ImageType::PixelType   PixelType;
+
+  typedef std::size_t                     key_type;
+  typedef PixelType                       value_type;
+  typedef PixelType&                      reference;
+  typedef boost::lvalue_property_map_tag  category;
+
+  ImagePropertyMap() : m_Buffer( 0 ) {}
+
+  explicit ImagePropertyMap( ImageType* iImage ) :
+    m_Image( iImage ), m_Buffer( iImage->GetBufferPointer() ) {}
+
+  reference operator[]( const key_type& iKey ) const
+    {
+    return this->m_Buffer[ iKey ];
+    }
+
+  ImageType* GetImage() const
+    {
+    return this->m_Image.GetPointer();
+    }
+
+private:
+  ImagePointer  m_Image;
+  PixelType*    m_Buffer;
+};
+
+/** \class ImageConvertingPropertyMap
+ *  \brief Read/write property map storing TValue in an image of another
+ *  pixel type.
+ *
+ *  Covers the maps whose value type cannot be a pixel type directly, e.g.
+ *  boost::default_color_type color maps or bool parity maps stored in an
+ *  unsigned char image.
+ */
+template< class TImage, class TValue >
+class ImageConvertingPropertyMap
+  {
+public:
+  typedef TImage                            ImageType;
+  typedef typename ImageType::Pointer       ImagePointer;
+  typedef typename ImageType::PixelType     PixelType;
+
+  typedef std::size_t                       key_type;
+  typedef TValue                            value_type;
+  typedef TValue                            reference;
+  typedef boost::read_write_property_map_tag category;
+
+  ImageConvertingPropertyMap() : m_Buffer( 0 ) {}
+
+  explicit ImageConvertingPropertyMap( ImageType* iImage ) :
+    m_Image( iImage ), m_Buffer( iImage->GetBufferPointer() ) {}
+
+  value_type Get( const key_type& iKey ) const
+    {
+    return static_cast< value_type >( this->m_Buffer[ iKey ] );
+    }
+
+  void Put( const key_type& iKey, const value_type& iValue ) const
+    {
+    this->m_Buffer[ iKey ] = static_cast< PixelType >( iValue );
+    }
+
+  ImageType* GetImage() const
+    {
+    return this->m_Image.GetPointer();
+    }
+
+private:
+  ImagePointer  m_Image;
+  PixelType*    m_Buffer;
+};
+
+template< class TImage, class TValue, class TKey >
+inline TValue get( const ImageConvertingPropertyMap< TImage, TValue >& iMap,
+                   const TKey& iKey )
+{
+  return iMap.Get( iKey );
+}
+
+template< class TImage, class TValue, class TKey >
+inline void put( const ImageConvertingPropertyMap< TImage, TValue >& iMap,
+                 const TKey& iKey, const TValue& iValue )
+{
+  iMap.Put( iKey, iValue );
+}
+
+template< class TImage >
+inline ImagePropertyMap< TImage >
+MakeImagePropertyMap( TImage* iImage )
+{
+  return ImagePropertyMap< TImage >( iImage );
+}
+
+template< class TImage >
+inline ImagePropertyMap< TImage >
+MakeImagePropertyMap( const SmartPointer< TImage >& iImage )
+{
+  return ImagePropertyMap< TImage >( iImage.GetPointer() );
+}
+
+template< class TValue, class TImage >
+inline ImageConvertingPropertyMap< TImage, TValue >
+MakeImagePropertyMap( TImage* iImage )
+{
+  return ImageConvertingPropertyMap< TImage, TValue >( iImage );
+}
+
+template< class TValue, class TImage >
+inline ImageConvertingPropertyMap< TImage, TValue >
+MakeImagePropertyMap( const SmartPointer< TImage >& iImage )
+{
+  return ImageConvertingPropertyMap< TImage, TValue >( iImage.GetPointer() );
+}
+
+}
+
+#endif
@@ -0,0 +1,227 @@
+#ifndef __itkImageStencil_h
+#define __itkImageStencil_h
+
+#include <algorithm>
+#include <vector>
+
+#include "itkImageRegion.h"
+#include "itkOffset.h"
+#include "itkImageVertexOrdering.h"
+
+namespace itk
+{
+/** \class ImageStencil
+ *  \brief The offsets of a stencil on the vertices of an ImageVertexOrdering,
+ *  as linear deltas with the range of pixels where each offset stays inside.
+ *
+ *  Finding the neighbors of a vertex costs the same for every offset,
+ *  whatever its length: a sparse, long-range or dilated stencil costs as
+ *  much as a dense local one with as many offsets, and nothing is sized to
+ *  the radius of the stencil.
+ *
+ *  For a raster ordering without a mask, offset k of vertex u leads to
+ *  u + GetDelta( k ), provided the pixel of u lies in the bounds of k (the
+ *  pixels p such that p + offset is in the region). In the interior, where
+ *  every offset stays inside, no bound is checked at all. Other orderings
+ *  fall back to ImageVertexOrdering::FindVertex(). Code which numbers the
+ *  pixels of a region in raster order itself initializes the stencil from
+ *  the region, and GenerateOffsets() gives the symmetrized stencil of an
+ *  offset list.
+ */
+template< unsigned int VDimension >
+class ImageStencil
+  {
+public:
+  typedef ImageStencil Self;
+
+  itkStaticConstMacro( ImageDimension, unsigned int, VDimension );
+
+  typedef ImageVertexOrdering< VDimension >       VertexOrderingType;
+  typedef typename VertexOrderingType::VertexType VertexType;
+  typedef ImageRegion< VDimension >               RegionType;
+  typedef typename RegionType::IndexType          IndexType;
+  typedef Offset< VDimension >                    OffsetType;
+
+  ImageStencil() :
+    m_Linear( false )
+    {
+    }
+
+  /** The offsets of iOffsets, without the zero offset and the duplicates,
+   *  each followed by its opposite if iSymmetric. */
+  template< class TOffsetContainer >
+  static void GenerateOffsets( const TOffsetContainer& iOffsets, std::vector< OffsetType >& oOffsets,
+                               bool iSymmetric )
+    {
+    OffsetType zeroOffset;
+    zeroOffset.Fill( 0 );
+
+    oOffsets.clear();
+    for( typename TOffsetContainer::const_iterator it = iOffsets.begin(); it != iOffsets.end(); ++it )
+      {
+      if( *it == zeroOffset )
+        {
+        continue;
+        }
+      if( std::find( oOffsets.begin(), oOffsets.end(), *it ) == oOffsets.end() )
+        {
+        oOffsets.push_back( *it );
+        }
+      if( iSymmetric && std::find( oOffsets.begin(), oOffsets.end(), zeroOffset - *it ) == oOffsets.end() )
+        {
+        oOffsets.push_back( zeroOffset - *it );
+        }
+      }
+    }
+
+  /** Offsets of iOffsets on the vertices of iOrdering, which must be
+   *  initialized (region, mask) before. */
+  template< class TOffsetContainer >
+  void Initialize( const VertexOrderingType& iOrdering, const TOffsetContainer& iOffsets )
+    {
+    this->Initialize( iOrdering.GetRegion(), iOffsets );
+    this->m_Linear = ( iOrdering.GetOrder() == VertexOrderingType::RasterOrder ) && !iOrdering.IsMasked();
+    }
+
+  /** Offsets of iOffsets on the pixels of iRegion, numbered in raster
+   *  order. */
+  template< class TOffsetContainer >
+  void Initialize( const RegionType& iRegion, const TOffsetContainer& iOffsets )
+    {
+    this->m_Linear = true;
+    this->m_Offsets.assign( iOffsets.begin(), iOffsets.end() );
+
+    const size_t numberOfOffsets = this->m_Offsets.size();
+    this->m_Deltas.resize( numberOfOffsets );
+    this->m_Lower.resize( numberOfOffsets * VDimension );
+    this->m_Upper.resize( numberOfOffsets * VDimension );
+
+    OffsetValueType strides[ VDimension ];
+    strides[ 0 ] = 1;
+    for( unsigned int dim = 1; dim < VDimension; ++dim )
+      {
+      strides[ dim ] = strides[ dim - 1 ] * static_cast< OffsetValueType >( iRegion.GetSize()[ dim - 1 ] );
+      }
+
+    for( unsigned int dim = 0; dim < VDimension; ++dim )
+      {
+      this->m_InteriorLower[ dim ] = iRegion.GetIndex()[ dim ];
+      this->m_InteriorUpper[ dim ] = iRegion.GetIndex()[ dim ] +
+        static_cast< OffsetValueType >( iRegion.GetSize()[ dim ] );
+      }
+
+    for( size_t k = 0; k < numberOfOffsets; ++k )
+      {
+      const OffsetType& offset = this->m_Offsets[ k ];
+
+      this->m_Deltas[ k ] = 0;
+      for( unsigned int dim = 0; dim < VDimension; ++dim )
+        {
+        this->m_Deltas[ k ] += offset[ dim ] * strides[ dim ];
+
+        // [ lower, upper ) along dim
+        const OffsetValueType lower = iRegion.GetIndex()[ dim ] - std::min( offset[ dim ], OffsetValueType( 0 ) );
+        const OffsetValueType upper = iRegion.GetIndex()[ dim ] +
+          static_cast< OffsetValueType >( iRegion.GetSize()[ dim ] ) - std::max( offset[ dim ], OffsetValueType( 0 ) );
+
+        this->m_Lower[ k * VDimension + dim ] = lower;
+        this->m_Upper[ k * VDimension + dim ] = upper;
+        this->m_InteriorLower[ dim ] = std::max( this->m_InteriorLower[ dim ], lower );
+        this->m_InteriorUpper[ dim ] = std::min( this->m_InteriorUpper[ dim ], upper );
+        }
+      }
+    }
+
+  unsigned int GetNumberOfOffsets() const
+    {
+    return static_cast< unsigned int >( this->m_Offsets.size() );
+    }
+
+  const OffsetType& GetOffset( unsigned int iK ) const
+    {
+    return this->m_Offsets[ iK ];
+    }
+
+  const std::vector< OffsetType >& GetOffsets() const
+    {
+    return this->m_Offsets;
+    }
+
+  /** Vertex delta of offset iK, for a raster ordering without a mask. */
+  OffsetValueType GetDelta( unsigned int iK ) const
+    {
+    return this->m_Deltas[ iK ];
+    }
+
+  /** Whether the vertices are numbered in raster order, without a mask, so
+   *  that the deltas apply. */
+  bool IsLinear() const
+    {
+    return this->m_Linear;
+    }
+
+  /** Whether every offset of iIndex stays inside, for a linear ordering
+   *  (always false otherwise). */
+  bool IsInterior( const IndexType& iIndex ) const
+    {
+    if( !this->m_Linear )
+      {
+      return false;
+      }
+    for( unsigned int dim = 0; dim < VDimension; ++dim )
+      {
+      if( iIndex[ dim ] < this->m_InteriorLower[ dim ] || iIndex[ dim ] >= this->m_InteriorUpper[ dim ] )
+        {
+        return false;
+        }
+      }
+    return true;
+    }
+
+  /** Whether offset iK of iIndex, in the region, stays inside. */
+  bool IsInside( const IndexType& iIndex, unsigned int iK ) const
+    {
+    const OffsetValueType* lower = &this->m_Lower[ iK * VDimension ];
+    const OffsetValueType* upper = &this->m_Upper[ iK * VDimension ];
+    for( unsigned int dim = 0; dim < VDimension; ++dim )
+      {
+      if( iIndex[ dim ] < lower[ dim ] || iIndex[ dim ] >= upper[ dim ] )
+        {
+        return false;
+        }
+      }
+    return true;
+    }
+
+  /** Neighbor oV of the vertex iU of iOrdering, whose pixel is iIndex, along
+   *  offset iK; iInterior is IsInterior( iIndex ), computed once for all
+   *  the offsets. Returns false if there is none. */
+  bool FindNeighbor( const VertexOrderingType& iOrdering, VertexType iU, const IndexType& iIndex,
+                     bool iInterior, unsigned int iK, VertexType& oV ) const
+    {
+    if( iInterior || ( this->m_Linear && this->IsInside( iIndex, iK ) ) )
+      {
+      oV = iU + this->m_Deltas[ iK ];
+      return true;
+      }
+    if( this->m_Linear )
+      {
+      return false;
+      }
+    return iOrdering.FindVertex( iIndex + this->m_Offsets[ iK ], oV );
+    }
+
+private:
+  bool                            m_Linear;
+  std::vector< OffsetType >       m_Offsets;
+  std::vector< OffsetValueType >  m_Deltas;
+  /** Bounds of the pixels of each offset, VDimension per offset. */
+  std::vector< OffsetValueType >  m_Lower;
+  std::vector< OffsetValueType >  m_Upper;
+  OffsetValueType                 m_InteriorLower[ VDimension ];
+  OffsetValueType                 m_InteriorUpper[ VDimension ];
+  };
+
+}
+
+#endif
@@ -0,0 +1,525 @@
+#ifndef __itkImageVertexOrdering_h
+#define __itkImageVertexOrdering_h
+
+#include <algorithm>
+#include <vector>
+
+#include "itkImageRegion.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkIntTypes.h"
+
+namespace itk
+{
+/** \class ImageVertexOrdering
+ *  \brief Bijection between the pixels of a region and the vertex numbers
+ *  0 .. n - 1 of the pixel graph.
+ *
+ *  - RasterOrder is the offset of the pixel in the region (ComputeOffset).
+ *  - TiledOrder cuts the region into cubic tiles of 2^k pixels per side,
+ *    numbered in raster order, and numbers the pixels of each tile
+ *    consecutively, in raster order within the tile. Tiles on the upper
+ *    borders are clipped, so that no vertex number is wasted.
+ *  - MortonOrder is TiledOrder with a Z-order curve (interleaved bits)
+ *    within the full tiles; clipped tiles keep the raster order.
+ *
+ *  In the last two, the stencil neighbors of a pixel are mostly in the same
+ *  tile, hence close in vertex number and in every per-vertex storage.
+ *
+ *  With a mask (InitializeMask()), only the pixels of the mask are numbered,
+ *  consecutively in raster order, whatever the order. Each row along the
+ *  first axis keeps its runs of mask pixels, so that a conversion is a
+ *  binary search among the runs of a row (index to vertex) or among all the
+ *  runs (vertex to index).
+ *
+ *  Strides are computed once in Initialize(). When the region has less than
+ *  2^32 pixels, the divisions of the raster ComputeIndex() are replaced by
+ *  multiplications by precomputed reciprocals. ComputeVertices() and
+ *  ComputeIndices() convert whole sequences (paths, seed lists) with the
+ *  order tested once.
+ */
+template< unsigned int VDimension >
+class ImageVertexOrdering
+  {
+public:
+  typedef ImageVertexOrdering Self;
+
+  itkStaticConstMacro( ImageDimension, unsigned int, VDimension );
+
+  typedef ImageRegion< VDimension >     RegionType;
+  typedef typename RegionType::IndexType IndexType;
+  typedef typename RegionType::SizeType  SizeType;
+  typedef typename IndexType::IndexValueType IndexValueType;
+  typedef OffsetValueType               VertexType;
+
+  enum OrderType
+    {
+    RasterOrder,
+    TiledOrder,
+    MortonOrder
+    };
+
+  ImageVertexOrdering() :
+    m_Order( RasterOrder ),
+    m_TileSizeExponent( VDimension < 3 ? 4 : 3 ),
+    m_NumberOfMaskVertices( 0 )
+    {
+    this->Initialize( RegionType() );
+    }
+
+  void SetOrder( OrderType iOrder )
+    {
+    this->m_Order = iOrder;
+    }
+
+  OrderType GetOrder() const
+    {
+    return this->m_Order;
+    }
+
+  /** Tiles have 2^iExponent pixels per side. */
+  void SetTileSizeExponent( unsigned int iExponent )
+    {
+    this->m_TileSizeExponent = iExponent;
+    this->Initialize( this->m_Region );
+    }
+
+  unsigned int GetTileSizeExponent() const
+    {
+    return this->m_TileSizeExponent;
+    }
+
+  /** Region whose pixels are numbered. Removes the mask. */
+  void Initialize( const RegionType& iRegion )
+    {
+    this->m_Region = iRegion;
+    this->m_Masked = false;
+    this->m_Runs.clear();
+    this->m_RowRuns.clear();
+    this->m_Strides[ 0 ] = 1;
+    for( unsigned int dim = 1; dim < VDimension; ++dim )
+      {
+      this->m_Strides[ dim ] = this->m_Strides[ dim - 1 ] *
+        static_cast< VertexType >( iRegion.GetSize()[ dim - 1 ] );
+      }
+
+    this->m_FastDivision =
+      ( static_cast< uint64_t >( iRegion.GetNumberOfPixels() ) < ( static_cast< uint64_t >( 1 ) << 32 ) );
+    for( unsigned int dim = 0; dim < VDimension; ++dim )
+      {
+      if( this->m_FastDivision && this->m_Strides[ dim ] > 0 )
+        {
+        this->m_Divisors[ dim ].Initialize( static_cast< uint32_t >( this->m_Strides[ dim ] ) );
+        }
+      }
+    }
+
+  /** Number only the non-zero pixels of iMask in the region given to
+   *  Initialize(), which iMask must buffer. */
+  template< class TMaskImage >
+  void InitializeMask( const TMaskImage* iMask )
+    {
+    const VertexType rowLength = this->m_Region.GetSize()[ 0 ];
+    const VertexType numberOfRows = ( rowLength > 0 ) ?
+      static_cast< VertexType >( this->m_Region.GetNumberOfPixels() ) / rowLength : 0;
+
+    this->m_Masked = true;
+    this->m_Runs.clear();
+    this->m_RowRuns.assign( numberOfRows + 1, 0 );
+
+    ImageRegionConstIterator< TMaskImage > it( iMask, this->m_Region );
+    it.GoToBegin();
+
+    VertexType numberOfVertices = 0;
+    for( VertexType row = 0; row < numberOfRows; ++row )
+      {
+      this->m_RowRuns[ row ] = this->m_Runs.size();
+
+      bool inRun = false;
+      for( VertexType x = 0; x < rowLength; ++x, ++it )
+        {
+        const bool inside = ( it.Get() != NumericTraits< typename TMaskImage::PixelType >::Zero );
+        if( inside && !inRun )
+          {
+          RunType run;
+          run.Start       = x;
+          run.End         = x;
+          run.FirstVertex = numberOfVertices;
+          run.Row         = row;
+          this->m_Runs.push_back( run );
+          }
+        if( inside )
+          {
+          ++this->m_Runs.back().End;
+          ++numberOfVertices;
+          }
+        inRun = inside;
+        }
+      }
+    this->m_RowRuns[ numberOfRows ] = this->m_Runs.size();
+    this->m_NumberOfMaskVertices = numberOfVertices;
+    }
+
+  bool IsMasked() const
+    {
+    return this->m_Masked;
+    }
+
+  const RegionType& GetRegion() const
+    {
+    return this->m_Region;
+    }
+
+  VertexType GetNumberOfVertices() const
+    {
+    return this->m_Masked ? this->m_NumberOfMaskVertices :
+      static_cast< VertexType >( this->m_Region.GetNumberOfPixels() );
+    }
+
+  /** Whether iIndex is numbered, i.e. inside the region and the mask. */
+  bool IsInside( const IndexType& iIndex ) const
+    {
+    VertexType v;
+    return this->FindVertex( iIndex, v );
+    }
+
+  /** Vertex of iIndex, if it is numbered. */
+  bool FindVertex( const IndexType& iIndex, VertexType& oVertex ) const
+    {
+    if( !this->m_Region.IsInside( iIndex ) )
+      {
+      return false;
+      }
+    if( this->m_Masked )
+      {
+      oVertex = this->ComputeMaskVertex( iIndex );
+      return ( oVertex >= 0 );
+      }
+    oVertex = this->ComputeVertex( iIndex );
+    return true;
+    }
+
+  /** Vertex of iIndex, which must be numbered. */
+  VertexType ComputeVertex( const IndexType& iIndex ) const
+    {
+    const IndexType& start = this->m_Region.GetIndex();
+
+    if( this->m_Masked )
+      {
+      return this->ComputeMaskVertex( iIndex );
+      }
+
+    if( this->m_Order == RasterOrder )
+      {
+      return this->ComputeRasterVertex( iIndex );
+      }
+
+    const unsigned int k = this->m_TileSizeExponent;
+    const VertexType   tileSize = static_cast< VertexType >( 1 ) << k;
+
+    VertexType inTile[ VDimension ];
+    VertexType extent[ VDimension ];
+    VertexType v = 0;
+    VertexType upper = 1;
+    bool       full = true;
+
+    // pixels of the tiles before this one: the tiles with a lower
+    // coordinate along dim all have a full extent along dim
+    for( int dim = VDimension - 1; dim >= 0; --dim )
+      {
+      const VertexType rel = iIndex[ dim ] - start[ dim ];
+      const VertexType tileStart = ( rel >> k ) << k;
+
+      extent[ dim ] = std::min( tileSize,
+        static_cast< VertexType >( this->m_Region.GetSize()[ dim ] ) - tileStart );
+      inTile[ dim ] = rel - tileStart;
+      full = full && ( extent[ dim ] == tileSize );
+
+      v += tileStart * this->m_Strides[ dim ] * upper;
+      upper *= extent[ dim ];
+      }
+
+    return v + this->ComputeInTileVertex( inTile, extent, full );
+    }
+
+  IndexType ComputeIndex( VertexType iV ) const
+    {
+    if( this->m_Masked )
+      {
+      typename RunContainerType::const_iterator run =
+        std::upper_bound( this->m_Runs.begin(), this->m_Runs.end(), iV, FirstVertexCompare() ) - 1;
+
+      return this->ComputeRasterIndex( run->Row * static_cast< VertexType >( this->m_Region.GetSize()[ 0 ] ) +
+                                       run->Start + iV - run->FirstVertex );
+      }
+
+    if( this->m_Order == RasterOrder )
+      {
+      return this->ComputeRasterIndex( iV );
+      }
+
+    const IndexType& start = this->m_Region.GetIndex();
+    IndexType index;
+
+    const unsigned int k = this->m_TileSizeExponent;
+    const VertexType   tileSize = static_cast< VertexType >( 1 ) << k;
+
+    VertexType tileStart[ VDimension ];
+    VertexType extent[ VDimension ];
+    VertexType upper = 1;
+    bool       full = true;
+
+    for( int dim = VDimension - 1; dim >= 0; --dim )
+      {
+      const VertexType slab = this->m_Strides[ dim ] * upper;
+
+      tileStart[ dim ] = ( ( iV / slab ) >> k ) << k;
+      iV -= tileStart[ dim ] * slab;
+
+      extent[ dim ] = std::min( tileSize,
+        static_cast< VertexType >( this->m_Region.GetSize()[ dim ] ) - tileStart[ dim ] );
+      full = full && ( extent[ dim ] == tileSize );
+      upper *= extent[ dim ];
+      }
+
+    VertexType inTile[ VDimension ];
+    this->ComputeInTileIndex( iV, extent, full, inTile );
+
+    for( unsigned int dim = 0; dim < VDimension; ++dim )
+      {
+      index[ dim ] = start[ dim ] + static_cast< IndexValueType >( tileStart[ dim ] + inTile[ dim ] );
+      }
+    return index;
+    }
+
+  /** Vertices of the indices in [iBegin, iEnd), written to oVertices. */
+  template< class TIndexIterator, class TVertexIterator >
+  void ComputeVertices( TIndexIterator iBegin, TIndexIterator iEnd,
+                        TVertexIterator oVertices ) const
+    {
+    if( this->m_Order == RasterOrder && !this->m_Masked )
+      {
+      for( ; iBegin != iEnd; ++iBegin, ++oVertices )
+        {
+        *oVertices = this->ComputeRasterVertex( *iBegin );
+        }
+      }
+    else
+      {
+      for( ; iBegin != iEnd; ++iBegin, ++oVertices )
+        {
+        *oVertices = this->ComputeVertex( *iBegin );
+        }
+      }
+    }
+
+  /** Indices of the vertices in [iBegin, iEnd), written to oIndices. */
+  template< class TVertexIterator, class TIndexIterator >
+  void ComputeIndices( TVertexIterator iBegin, TVertexIterator iEnd,
+                       TIndexIterator oIndices ) const
+    {
+    if( this->m_Order == RasterOrder && !this->m_Masked )
+      {
+      for( ; iBegin != iEnd; ++iBegin, ++oIndices )
+        {
+        *oIndices = this->ComputeRasterIndex( static_cast< VertexType >( *iBegin ) );
+        }
+      }
+    else
+      {
+      for( ; iBegin != iEnd; ++iBegin, ++oIndices )
+        {
+        *oIndices = this->ComputeIndex( static_cast< VertexType >( *iBegin ) );
+        }
+      }
+    }
+
+protected:
+  /** Unsigned 32 bit division by a constant through a multiplication and
+   *  shifts (Granlund and Montgomery, 1994). */
+  struct DivisorType
+    {
+    uint32_t      Multiplier;
+    unsigned int  Shift;
+
+    void Initialize( uint32_t iDivisor )
+      {
+      Shift = 0;
+      while( ( static_cast< uint64_t >( 1 ) << Shift ) < iDivisor )
+        {
+        ++Shift;
+        }
+      Multiplier = static_cast< uint32_t >(
+        ( ( static_cast< uint64_t >( 1 ) << 32 ) *
+          ( ( static_cast< uint64_t >( 1 ) << Shift ) - iDivisor ) ) / iDivisor + 1 );
+      }
+
+    uint32_t Divide( uint32_t iN ) const
+      {
+      if( Shift == 0 )
+        {
+        return iN;
+        }
+      const uint32_t t = static_cast< uint32_t >( ( static_cast< uint64_t >( Multiplier ) * iN ) >> 32 );
+      return ( t + ( ( iN - t ) >> 1 ) ) >> ( Shift - 1 );
+      }
+    };
+
+  OrderType     m_Order;
+  unsigned int  m_TileSizeExponent;
+  RegionType    m_Region;
+  VertexType    m_Strides[ VDimension ];
+  bool          m_FastDivision;
+  DivisorType   m_Divisors[ VDimension ];
+
+  /** Run of mask pixels [Start, End) along the first axis in a row, whose
+   *  first pixel is vertex FirstVertex. */
+  struct RunType
+    {
+    VertexType Start;
+    VertexType End;
+    VertexType FirstVertex;
+    VertexType Row;
+    };
+  typedef std::vector< RunType > RunContainerType;
+
+  struct StartCompare
+    {
+    bool operator()( VertexType iX, const RunType& iRun ) const
+      {
+      return iX < iRun.Start;
+      }
+    };
+
+  struct FirstVertexCompare
+    {
+    bool operator()( VertexType iV, const RunType& iRun ) const
+      {
+      return iV < iRun.FirstVertex;
+      }
+    };
+
+  bool                        m_Masked;
+  RunContainerType            m_Runs;
+  std::vector< VertexType >   m_RowRuns;
+  VertexType                  m_NumberOfMaskVertices;
+
+  /** Vertex of a pixel of the region, -1 if it is not in the mask. */
+  VertexType ComputeMaskVertex( const IndexType& iIndex ) const
+    {
+    const IndexType& start = this->m_Region.GetIndex();
+    const VertexType x = iIndex[ 0 ] - start[ 0 ];
+    const VertexType rowStart = this->ComputeRasterVertex( iIndex ) - x;
+    const VertexType row = ( VDimension > 1 && this->m_FastDivision ) ?
+      static_cast< VertexType >( this->m_Divisors[ VDimension > 1 ? 1 : 0 ].Divide( static_cast< uint32_t >( rowStart ) ) ) :
+      rowStart / static_cast< VertexType >( this->m_Region.GetSize()[ 0 ] );
+
+    typename RunContainerType::const_iterator begin = this->m_Runs.begin() + this->m_RowRuns[ row ];
+    typename RunContainerType::const_iterator end = this->m_Runs.begin() + this->m_RowRuns[ row + 1 ];
+    typename RunContainerType::const_iterator run = std::upper_bound( begin, end, x, StartCompare() );
+
+    if( run == begin || x >= ( run - 1 )->End )
+      {
+      return -1;
+      }
+    --run;
+    return run->FirstVertex + x - run->Start;
+    }
+
+  VertexType ComputeRasterVertex( const IndexType& iIndex ) const
+    {
+    const IndexType& start = this->m_Region.GetIndex();
+
+    VertexType v = 0;
+    for( unsigned int dim = 0; dim < VDimension; ++dim )
+      {
+      v += ( iIndex[ dim ] - start[ dim ] ) * this->m_Strides[ dim ];
+      }
+    return v;
+    }
+
+  IndexType ComputeRasterIndex( VertexType iV ) const
+    {
+    const IndexType& start = this->m_Region.GetIndex();
+    IndexType index;
+
+    if( this->m_FastDivision )
+      {
+      uint32_t r = static_cast< uint32_t >( iV );
+      for( unsigned int dim = VDimension - 1; dim > 0; --dim )
+        {
+        const uint32_t q = this->m_Divisors[ dim ].Divide( r );
+        index[ dim ] = start[ dim ] + static_cast< IndexValueType >( q );
+        r -= q * static_cast< uint32_t >( this->m_Strides[ dim ] );
+        }
+      index[ 0 ] = start[ 0 ] + static_cast< IndexValueType >( r );
+      return index;
+      }
+
+    for( unsigned int dim = VDimension - 1; dim > 0; --dim )
+      {
+      index[ dim ] = start[ dim ] + static_cast< IndexValueType >( iV / this->m_Strides[ dim ] );
+      iV %= this->m_Strides[ dim ];
+      }
+    index[ 0 ] = start[ 0 ] + static_cast< IndexValueType >( iV );
+    return index;
+    }
+
+  VertexType ComputeInTileVertex( const VertexType* iInTile,
+                                  const VertexType* iExtent,
+                                  bool iFull ) const
+    {
+    VertexType v = 0;
+
+    if( this->m_Order == MortonOrder && iFull )
+      {
+      for( unsigned int bit = 0; bit < this->m_TileSizeExponent; ++bit )
+        {
+        for( unsigned int dim = 0; dim < VDimension; ++dim )
+          {
+          v |= ( ( iInTile[ dim ] >> bit ) & 1 ) << ( bit * VDimension + dim );
+          }
+        }
+      return v;
+      }
+
+    VertexType stride = 1;
+    for( unsigned int dim = 0; dim < VDimension; ++dim )
+      {
+      v += iInTile[ dim ] * stride;
+      stride *= iExtent[ dim ];
+      }
+    return v;
+    }
+
+  void ComputeInTileIndex( VertexType iV,
+                           const VertexType* iExtent,
+                           bool iFull,
+                           VertexType* oInTile ) const
+    {
+    if( this->m_Order == MortonOrder && iFull )
+      {
+      for( unsigned int dim = 0; dim < VDimension; ++dim )
+        {
+        oInTile[ dim ] = 0;
+        }
+      for( unsigned int bit = 0; bit < this->m_TileSizeExponent; ++bit )
+        {
+        for( unsigned int dim = 0; dim < VDimension; ++dim )
+          {
+          oInTile[ dim ] |= ( ( iV >> ( bit * VDimension + dim ) ) & 1 ) << bit;
+          }
+        }
+      return;
+      }
+
+    for( unsigned int dim = 0; dim < VDimension; ++dim )
+      {
+      oInTile[ dim ] = iV % iExtent[ dim ];
+      iV /= iExtent[ dim ];
+      }
+    }
+};
+
+}
+
+#endif
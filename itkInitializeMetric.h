@@ -0,0 +1,134 @@
+#ifndef __itkInitializeMetric_h
+#define __itkInitializeMetric_h
+
+namespace itk
+{
+/** Whether TMetric has a member Initialize( const TImage*, const
+ *  TOffsetContainer& ), plain, const or template. */
+template< class TMetric, class TImage, class TOffsetContainer >
+struct MetricHasInitialize
+  {
+  typedef char YesType;
+  typedef char NoType[ 2 ];
+
+  typedef void ( TMetric::*MemberType )( const TImage*, const TOffsetContainer& );
+  typedef void ( TMetric::*ConstMemberType )( const TImage*, const TOffsetContainer& ) const;
+
+  template< MemberType > struct Member {};
+  template< ConstMemberType > struct ConstMember {};
+
+  template< class U > static YesType& Test( Member< &U::Initialize >* );
+  template< class U > static NoType&  Test( ... );
+
+  template< class U > static YesType& TestConst( ConstMember< &U::Initialize >* );
+  template< class U > static NoType&  TestConst( ... );
+
+  static const bool Value = ( sizeof( Test< TMetric >( 0 ) ) == sizeof( YesType ) ) ||
+                            ( sizeof( TestConst< TMetric >( 0 ) ) == sizeof( YesType ) );
+  };
+
+template< class TMetric, class TImage, class TOffsetContainer,
+          bool VHasInitialize = MetricHasInitialize< TMetric, TImage, TOffsetContainer >::Value >
+struct MetricInitializer
+  {
+  static void Initialize( TMetric& ioMetric, const TImage* iImage, const TOffsetContainer& iOffsets )
+    {
+    ioMetric.Initialize( iImage, iOffsets );
+    }
+  };
+
+template< class TMetric, class TImage, class TOffsetContainer >
+struct MetricInitializer< TMetric, TImage, TOffsetContainer, false >
+  {
+  static void Initialize( TMetric&, const TImage*, const TOffsetContainer& ) {}
+  };
+
+/** Give iMetric the stencil iOffsets before its first Evaluate(), if it
+ *  has an Initialize() (see PhysicalDistanceMetric); metrics which only
+ *  provide Evaluate() are left as they are. iOffsets is the vector of
+ *  distinct offsets the caller then walks (ImageStencil::GenerateOffsets()),
+ *  whose positions are the offset ids given to EvaluateMetric(). */
+template< class TMetric, class TImage, class TOffsetContainer >
+void InitializeMetric( TMetric& ioMetric, const TImage* iImage, const TOffsetContainer& iOffsets )
+{
+  MetricInitializer< TMetric, TImage, TOffsetContainer >::Initialize( ioMetric, iImage, iOffsets );
+}
+
+/** Whether TMetric declares its OutputType. */
+template< class TMetric >
+struct MetricHasOutputType
+  {
+  typedef char YesType;
+  typedef char NoType[ 2 ];
+
+  template< class U > static YesType& Test( typename U::OutputType* );
+  template< class U > static NoType&  Test( ... );
+
+  static const bool Value = ( sizeof( Test< TMetric >( 0 ) ) == sizeof( YesType ) );
+  };
+
+/** Whether TMetric has a member OutputType Evaluate( const TImage*, a, b,
+ *  unsigned int k ) const, for pixels b = a + offset k of the stencil given
+ *  to Initialize(). */
+template< class TMetric, class TImage,
+          bool VHasOutputType = MetricHasOutputType< TMetric >::Value >
+struct MetricHasOffsetEvaluate
+  {
+  typedef char YesType;
+  typedef char NoType[ 2 ];
+
+  typedef typename TImage::IndexType IndexType;
+  typedef typename TMetric::OutputType ( TMetric::*MemberType )( const TImage*, const IndexType&,
+                                                                 const IndexType&, unsigned int ) const;
+
+  template< MemberType > struct Member {};
+
+  template< class U > static YesType& Test( Member< &U::Evaluate >* );
+  template< class U > static NoType&  Test( ... );
+
+  static const bool Value = ( sizeof( Test< TMetric >( 0 ) ) == sizeof( YesType ) );
+  };
+
+template< class TMetric, class TImage >
+struct MetricHasOffsetEvaluate< TMetric, TImage, false >
+  {
+  static const bool Value = false;
+  };
+
+template< class TOutput, class TMetric, class TImage,
+          bool VHasOffsetEvaluate = MetricHasOffsetEvaluate< TMetric, TImage >::Value >
+struct MetricEvaluator
+  {
+  static TOutput Evaluate( const TMetric& iMetric, const TImage* iImage,
+                           const typename TImage::IndexType& iA, const typename TImage::IndexType& iB,
+                           unsigned int iK )
+    {
+    return static_cast< TOutput >( iMetric.Evaluate( iImage, iA, iB, iK ) );
+    }
+  };
+
+template< class TOutput, class TMetric, class TImage >
+struct MetricEvaluator< TOutput, TMetric, TImage, false >
+  {
+  static TOutput Evaluate( const TMetric& iMetric, const TImage* iImage,
+                           const typename TImage::IndexType& iA, const typename TImage::IndexType& iB,
+                           unsigned int )
+    {
+    return static_cast< TOutput >( iMetric.Evaluate( iImage, iA, iB ) );
+    }
+  };
+
+/** iMetric on the edge from iA to iB = iA + offset iK of the stencil given
+ *  to InitializeMetric(), as a TOutput. Metrics with per-offset terms take
+ *  them at iK without any lookup; the others are evaluated on iA and iB. */
+template< class TOutput, class TMetric, class TImage >
+TOutput EvaluateMetric( const TMetric& iMetric, const TImage* iImage,
+                        const typename TImage::IndexType& iA, const typename TImage::IndexType& iB,
+                        unsigned int iK )
+{
+  return MetricEvaluator< TOutput, TMetric, TImage >::Evaluate( iMetric, iImage, iA, iB, iK );
+}
+
+}
+
+#endif
@@ -0,0 +1,651 @@
+#ifndef __itkLandmarkShortestPathIndex_h
+#define __itkLandmarkShortestPathIndex_h
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <boost/type_traits/is_same.hpp>
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkIntTypes.h"
+#include "itkNumericTraits.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkSearchStateArray.h"
+#include "itkRangeThreader.h"
+
+namespace itk
+{
+/** \class LandmarkShortestPathIndex
+ *  \brief Landmark (ALT) index for repeated shortest path queries on the
+ *  undirected graph of an ImageBoostGraphAdaptor.
+ *
+ *  Build() picks NumberOfLandmarks vertices spread over the image (farthest
+ *  point sampling on the pixel indices) and runs one Dijkstra per landmark,
+ *  landmarks being split between threads. The distances d( l, v ) are
+ *  stored as 16-bit multiples of a common scale, vertex-major so that the
+ *  bounds of a vertex are read at once.
+ *
+ *  Queries run A* with the bound
+ *
+ *    d( v, t ) >= max_l | d( l, t ) - d( l, v ) |
+ *
+ *  lowered by one quantization step, which keeps it admissible; vertices
+ *  are reopened when a shorter path to them is found, so that paths are
+ *  exact. Per-vertex state is allocated once and reset by a generation
+ *  counter, as in LiveWirePathFinder.
+ *
+ *  The index is a flat block: a FileHeaderType, the landmarks as 64-bit
+ *  vertices, then the table. Write() saves it as is; Read() loads it, and
+ *  SetMappedData() uses a block mapped by the caller in place, without any
+ *  copy. The index must have been built for the same image, stencil and
+ *  metric as the graph of the adaptor.
+ */
+template< class TAdaptor >
+class LandmarkShortestPathIndex : public Object
+  {
+public:
+  typedef LandmarkShortestPathIndex   Self;
+  typedef Object                      Superclass;
+  typedef SmartPointer< Self >        Pointer;
+  typedef SmartPointer< const Self >  ConstPointer;
+
+  /** Method for creation through object factory */
+  itkNewMacro( Self );
+
+  itkTypeMacro( LandmarkShortestPathIndex, Object );
+
+  typedef TAdaptor                                    AdaptorType;
+  typedef typename AdaptorType::GraphType             GraphType;
+  typedef typename AdaptorType::GraphTraits           GraphTraits;
+  typedef typename AdaptorType::GraphDirectedType     GraphDirectedType;
+  typedef typename AdaptorType::VertexDescriptorType  VertexDescriptorType;
+  typedef typename AdaptorType::EdgeValueType         EdgeValueType;
+  typedef typename AdaptorType::InputIndexType        InputIndexType;
+
+  typedef std::vector< InputIndexType >               PathType;
+  typedef std::vector< VertexDescriptorType >         VertexPathType;
+
+  /** Quantized distance; the largest value marks unreachable vertices. */
+  typedef uint16_t                                    QuantizedDistanceType;
+
+  struct FileHeaderType
+    {
+    char      Magic[ 8 ];
+    uint64_t  NumberOfVertices;
+    uint64_t  NumberOfLandmarks;
+    double    Scale;
+    };
+
+  void SetAdaptor( const AdaptorType* iAdaptor )
+    {
+    if( this->m_Adaptor != iAdaptor )
+      {
+      this->m_Adaptor = iAdaptor;
+      this->Modified();
+      }
+    }
+
+  const AdaptorType* GetAdaptor() const
+    {
+    return this->m_Adaptor.GetPointer();
+    }
+
+  itkSetMacro( NumberOfLandmarks, unsigned int );
+  itkGetConstMacro( NumberOfLandmarks, unsigned int );
+
+  /** Threads for Build(); 0, the default, uses the ones of the adaptor. */
+  itkSetMacro( NumberOfThreads, ThreadIdType );
+  itkGetConstMacro( NumberOfThreads, ThreadIdType );
+
+  /** Pick the landmarks and compute their distance tables on the adaptor
+   *  output, which must be up to date. */
+  void Build()
+    {
+    if( !this->m_Adaptor )
+      {
+      itkExceptionMacro( << "adaptor is null" );
+      }
+    if( !boost::is_same< GraphDirectedType, boost::undirectedS >::value )
+      {
+      itkExceptionMacro( << "landmark bounds need an undirected graph" );
+      }
+
+    const GraphType& graph = this->m_Adaptor->GetOutput();
+    const SizeValueType numberOfVertices = num_vertices( graph );
+    const SizeValueType numberOfLandmarks = std::min(
+      static_cast< SizeValueType >( this->m_NumberOfLandmarks ), numberOfVertices );
+
+    std::vector< VertexDescriptorType > landmarks;
+    this->SelectLandmarks( numberOfLandmarks, landmarks );
+
+    // Exact distances, landmark-major
+    std::vector< EdgeValueType > distances( numberOfLandmarks * numberOfVertices );
+
+    DistanceFunctor distance;
+    distance.Graph      = &graph;
+    distance.Landmarks  = &landmarks;
+    distance.Distances  = &distances;
+
+    const ThreadIdType numberOfThreads = ( this->m_NumberOfThreads > 0 ) ?
+      this->m_NumberOfThreads : this->m_Adaptor->GetNumberOfThreads();
+    RangeThreader< DistanceFunctor >::Run( numberOfLandmarks, numberOfThreads, distance );
+
+    EdgeValueType maximum = NumericTraits< EdgeValueType >::Zero;
+    for( size_t i = 0; i < distances.size(); ++i )
+      {
+      if( distances[ i ] != NumericTraits< EdgeValueType >::max() )
+        {
+        maximum = std::max( maximum, distances[ i ] );
+        }
+      }
+
+    const double steps = static_cast< double >( UnreachableDistance() - 1 );
+    const double scale = ( maximum > NumericTraits< EdgeValueType >::Zero ) ?
+      static_cast< double >( maximum ) / steps : 1.;
+
+    this->Allocate( numberOfVertices, numberOfLandmarks, scale );
+
+    uint64_t* landmarkData = this->GetLandmarkData();
+    for( SizeValueType l = 0; l < numberOfLandmarks; ++l )
+      {
+      landmarkData[ l ] = landmarks[ l ];
+      }
+    this->m_Landmarks = landmarks;
+
+    QuantizedDistanceType* table = const_cast< QuantizedDistanceType* >( this->m_Table );
+    for( SizeValueType v = 0; v < numberOfVertices; ++v )
+      {
+      for( SizeValueType l = 0; l < numberOfLandmarks; ++l )
+        {
+        const EdgeValueType d = distances[ l * numberOfVertices + v ];
+        table[ v * numberOfLandmarks + l ] = ( d == NumericTraits< EdgeValueType >::max() ) ?
+          UnreachableDistance() :
+          static_cast< QuantizedDistanceType >( std::min( static_cast< double >( d ) / scale, steps ) );
+        }
+      }
+    this->Modified();
+    }
+
+  /** Save the index block. */
+  void Write( const std::string& iFileName ) const
+    {
+    if( !this->m_Data )
+      {
+      itkExceptionMacro( << "index is empty" );
+      }
+
+    std::ofstream file( iFileName.c_str(), std::ios::binary );
+    file.write( this->m_Data, this->GetDataSize() );
+    if( !file )
+      {
+      itkExceptionMacro( << "cannot write " << iFileName );
+      }
+    }
+
+  /** Load an index block written by Write(). */
+  void Read( const std::string& iFileName )
+    {
+    std::ifstream file( iFileName.c_str(), std::ios::binary | std::ios::ate );
+    if( !file )
+      {
+      itkExceptionMacro( << "cannot read " << iFileName );
+      }
+    const SizeValueType size = static_cast< SizeValueType >( file.tellg() );
+    if( size < sizeof( FileHeaderType ) )
+      {
+      itkExceptionMacro( << iFileName << " is not a landmark index" );
+      }
+    file.seekg( 0 );
+
+    this->m_Buffer.assign( ( size + sizeof( uint64_t ) - 1 ) / sizeof( uint64_t ), 0 );
+    file.read( reinterpret_cast< char* >( &this->m_Buffer[0] ), size );
+    if( !file )
+      {
+      itkExceptionMacro( << "cannot read " << iFileName );
+      }
+
+    this->SetData( reinterpret_cast< const char* >( &this->m_Buffer[0] ), size );
+    this->Modified();
+    }
+
+  /** Use an index block of iSize bytes kept by the caller, e.g. a file
+   *  written by Write() and mapped in memory; it must be 8-byte aligned and
+   *  outlive the queries. */
+  void SetMappedData( const void* iData, SizeValueType iSize )
+    {
+    this->m_Buffer.clear();
+    this->SetData( static_cast< const char* >( iData ), iSize );
+    this->Modified();
+    }
+
+  /** Size in bytes of the index block. */
+  SizeValueType GetDataSize() const
+    {
+    return ComputeDataSize( this->m_NumberOfIndexVertices, this->m_Landmarks.size() );
+    }
+
+  const std::vector< VertexDescriptorType >& GetLandmarks() const
+    {
+    return this->m_Landmarks;
+    }
+
+  /** Shortest path from iSource to iTarget (both included). Returns false
+   *  if one of them is outside of the image or iTarget is not reachable. */
+  bool GetPath( const InputIndexType& iSource, const InputIndexType& iTarget, PathType& oPath )
+    {
+    if( !this->GetVertexPath( iSource, iTarget, this->m_VertexPath ) )
+      {
+      oPath.clear();
+      return false;
+      }
+
+    oPath.resize( this->m_VertexPath.size() );
+    this->m_Adaptor->GetVertexOrdering().ComputeIndices( this->m_VertexPath.begin(),
+                                                         this->m_VertexPath.end(),
+                                                         oPath.begin() );
+    return true;
+    }
+
+  /** Same as GetPath(), as vertices of the adaptor graph. */
+  bool GetVertexPath( const InputIndexType& iSource, const InputIndexType& iTarget, VertexPathType& oPath )
+    {
+    oPath.clear();
+
+    VertexDescriptorType s, t;
+    if( !this->GetVertices( iSource, iTarget, s, t ) || !this->Search( s, t ) )
+      {
+      return false;
+      }
+
+    for( VertexDescriptorType v = t; v != s; v = this->m_Predecessors[ v ] )
+      {
+      oPath.push_back( v );
+      }
+    oPath.push_back( s );
+
+    std::reverse( oPath.begin(), oPath.end() );
+    return true;
+    }
+
+  /** Length of the shortest path from iSource to iTarget;
+   *  NumericTraits< EdgeValueType >::max() if there is none. */
+  EdgeValueType GetDistance( const InputIndexType& iSource, const InputIndexType& iTarget )
+    {
+    VertexDescriptorType s, t;
+    if( !this->GetVertices( iSource, iTarget, s, t ) || !this->Search( s, t ) )
+      {
+      return NumericTraits< EdgeValueType >::max();
+      }
+    return this->m_Distances[ t ];
+    }
+
+  /** Lower bound of the distance between two vertices from the tables. */
+  EdgeValueType ComputeLowerBound( VertexDescriptorType iU, VertexDescriptorType iV ) const
+    {
+    const SizeValueType numberOfLandmarks = this->m_Landmarks.size();
+    return this->ComputeBound( this->m_Table + iU * numberOfLandmarks,
+                               this->m_Table + iV * numberOfLandmarks );
+    }
+
+  /** Vertices expanded by the last query. */
+  itkGetConstMacro( NumberOfSettledVertices, SizeValueType );
+
+protected:
+  LandmarkShortestPathIndex() :
+    m_NumberOfLandmarks( 16 ),
+    m_NumberOfThreads( 0 ),
+    m_Data( 0 ),
+    m_Table( 0 ),
+    m_Scale( 1. ),
+    m_NumberOfIndexVertices( 0 ),
+    m_NumberOfSettledVertices( 0 )
+    {
+    }
+  ~LandmarkShortestPathIndex() {}
+
+  typedef std::pair< EdgeValueType, VertexDescriptorType > QueueElementType;
+  typedef std::greater< QueueElementType >                 QueueCompareType;
+
+  typename AdaptorType::ConstPointer  m_Adaptor;
+  unsigned int                        m_NumberOfLandmarks;
+  ThreadIdType                        m_NumberOfThreads;
+
+  /** Index block, owned by m_Buffer unless mapped by the caller */
+  std::vector< uint64_t >             m_Buffer;
+  const char*                         m_Data;
+  const QuantizedDistanceType*        m_Table;
+  double                              m_Scale;
+  SizeValueType                       m_NumberOfIndexVertices;
+  std::vector< VertexDescriptorType > m_Landmarks;
+
+  /** Query state: v is reached by the current query, with its bound in
+   *  m_Bounds, then settled once it is expanded. */
+  SearchStateArray                    m_States;
+  std::vector< EdgeValueType >        m_Distances;
+  std::vector< EdgeValueType >        m_Bounds;
+  std::vector< VertexDescriptorType > m_Predecessors;
+  std::vector< QueueElementType >     m_Queue;
+
+  SizeValueType                       m_NumberOfSettledVertices;
+
+  VertexPathType                      m_VertexPath;
+
+  static QuantizedDistanceType UnreachableDistance()
+    {
+    return NumericTraits< QuantizedDistanceType >::max();
+    }
+
+  static SizeValueType ComputeDataSize( SizeValueType iNumberOfVertices, SizeValueType iNumberOfLandmarks )
+    {
+    return sizeof( FileHeaderType ) + iNumberOfLandmarks * sizeof( uint64_t ) +
+           iNumberOfVertices * iNumberOfLandmarks * sizeof( QuantizedDistanceType );
+    }
+
+  uint64_t* GetLandmarkData()
+    {
+    return reinterpret_cast< uint64_t* >( &this->m_Buffer[0] ) + sizeof( FileHeaderType ) / sizeof( uint64_t );
+    }
+
+  /** Allocate an owned block for the given sizes. */
+  void Allocate( SizeValueType iNumberOfVertices, SizeValueType iNumberOfLandmarks, double iScale )
+    {
+    const SizeValueType size = ComputeDataSize( iNumberOfVertices, iNumberOfLandmarks );
+    this->m_Buffer.assign( ( size + sizeof( uint64_t ) - 1 ) / sizeof( uint64_t ), 0 );
+
+    FileHeaderType* header = reinterpret_cast< FileHeaderType* >( &this->m_Buffer[0] );
+    std::memcpy( header->Magic, "ITKALT1", 8 );
+    header->NumberOfVertices  = iNumberOfVertices;
+    header->NumberOfLandmarks = iNumberOfLandmarks;
+    header->Scale             = iScale;
+
+    this->SetData( reinterpret_cast< const char* >( &this->m_Buffer[0] ), size );
+    }
+
+  /** Point the index at a block, after checking its header. */
+  void SetData( const char* iData, SizeValueType iSize )
+    {
+    this->m_Data = 0;
+    this->m_Table = 0;
+    this->m_Landmarks.clear();
+    this->m_NumberOfIndexVertices = 0;
+
+    if( iSize < sizeof( FileHeaderType ) )
+      {
+      itkExceptionMacro( << "index block is too small" );
+      }
+
+    const FileHeaderType* header = reinterpret_cast< const FileHeaderType* >( iData );
+    if( std::memcmp( header->Magic, "ITKALT1", 8 ) != 0 ||
+        iSize < ComputeDataSize( header->NumberOfVertices, header->NumberOfLandmarks ) )
+      {
+      itkExceptionMacro( << "not a landmark index" );
+      }
+
+    const uint64_t* landmarks = reinterpret_cast< const uint64_t* >( iData + sizeof( FileHeaderType ) );
+
+    this->m_Data  = iData;
+    this->m_Table = reinterpret_cast< const QuantizedDistanceType* >( landmarks + header->NumberOfLandmarks );
+    this->m_Scale = header->Scale;
+    this->m_NumberOfIndexVertices = header->NumberOfVertices;
+    this->m_Landmarks.assign( landmarks, landmarks + header->NumberOfLandmarks );
+    }
+
+  /** Farthest point sampling on the pixel indices, from the vertex
+   *  farthest from vertex 0. */
+  void SelectLandmarks( SizeValueType iNumberOfLandmarks, std::vector< VertexDescriptorType >& oLandmarks ) const
+    {
+    oLandmarks.clear();
+
+    const SizeValueType numberOfVertices = num_vertices( this->m_Adaptor->GetOutput() );
+    if( iNumberOfLandmarks == 0 || numberOfVertices == 0 )
+      {
+      return;
+      }
+
+    const unsigned int Dimension = AdaptorType::InputImageType::ImageDimension;
+
+    std::vector< InputIndexType > indices( numberOfVertices );
+    std::vector< VertexDescriptorType > vertices( numberOfVertices );
+    for( SizeValueType v = 0; v < numberOfVertices; ++v )
+      {
+      vertices[ v ] = v;
+      }
+    this->m_Adaptor->GetVertexOrdering().ComputeIndices( vertices.begin(), vertices.end(), indices.begin() );
+
+    std::vector< double > nearest( numberOfVertices, NumericTraits< double >::max() );
+    VertexDescriptorType next = 0;
+
+    for( SizeValueType l = 0; l <= iNumberOfLandmarks; ++l )
+      {
+      const InputIndexType landmark = indices[ next ];
+      if( l > 0 )
+        {
+        oLandmarks.push_back( next );
+        }
+
+      double farthest = -1.;
+      for( SizeValueType v = 0; v < numberOfVertices; ++v )
+        {
+        double d = 0.;
+        for( unsigned int dim = 0; dim < Dimension; ++dim )
+          {
+          const double x = static_cast< double >( indices[ v ][ dim ] - landmark[ dim ] );
+          d += x * x;
+          }
+        // the starting vertex is not a landmark
+        nearest[ v ] = ( l > 0 ) ? std::min( nearest[ v ], d ) : d;
+        if( nearest[ v ] > farthest )
+          {
+          farthest = nearest[ v ];
+          next = v;
+          }
+        }
+      }
+    }
+
+  /** Dijkstra from each landmark of [iBegin, iEnd) */
+  struct DistanceFunctor
+    {
+    const GraphType*                            Graph;
+    const std::vector< VertexDescriptorType >*  Landmarks;
+    std::vector< EdgeValueType >*               Distances;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      const GraphType& graph = *Graph;
+      const SizeValueType numberOfVertices = num_vertices( graph );
+
+      typedef typename boost::property_map< GraphType, boost::edge_weight_t >::const_type WeightMapType;
+      WeightMapType weightmap = get( boost::edge_weight, graph );
+
+      std::vector< QueueElementType > queue;
+      std::vector< bool > settled;
+
+      for( SizeValueType l = iBegin; l < iEnd; ++l )
+        {
+        EdgeValueType* distances = &( *Distances )[ l * numberOfVertices ];
+        std::fill( distances, distances + numberOfVertices, NumericTraits< EdgeValueType >::max() );
+        settled.assign( numberOfVertices, false );
+
+        const VertexDescriptorType landmark = ( *Landmarks )[ l ];
+        distances[ landmark ] = NumericTraits< EdgeValueType >::Zero;
+        queue.push_back( QueueElementType( distances[ landmark ], landmark ) );
+
+        while( !queue.empty() )
+          {
+          std::pop_heap( queue.begin(), queue.end(), QueueCompareType() );
+          const QueueElementType top = queue.back();
+          queue.pop_back();
+
+          const VertexDescriptorType u = top.second;
+          if( settled[ u ] )
+            {
+            continue;
+            }
+          settled[ u ] = true;
+
+          typename GraphTraits::out_edge_iterator eIt, eEnd;
+          for( boost::tie( eIt, eEnd ) = out_edges( u, graph ); eIt != eEnd; ++eIt )
+            {
+            const VertexDescriptorType v = target( *eIt, graph );
+            const EdgeValueType alt = top.first + get( weightmap, *eIt );
+            if( !settled[ v ] && alt < distances[ v ] )
+              {
+              distances[ v ] = alt;
+              queue.push_back( QueueElementType( alt, v ) );
+              std::push_heap( queue.begin(), queue.end(), QueueCompareType() );
+              }
+            }
+          }
+        }
+      }
+    };
+
+  /** Largest landmark bound between two rows of the table, lowered by one
+   *  quantization step; max() if one vertex is reachable from a landmark
+   *  and the other is not. */
+  EdgeValueType ComputeBound( const QuantizedDistanceType* iU, const QuantizedDistanceType* iV ) const
+    {
+    const SizeValueType numberOfLandmarks = this->m_Landmarks.size();
+    const QuantizedDistanceType unreachable = UnreachableDistance();
+
+    int bound = 0;
+    for( SizeValueType l = 0; l < numberOfLandmarks; ++l )
+      {
+      if( ( iU[ l ] == unreachable ) != ( iV[ l ] == unreachable ) )
+        {
+        return NumericTraits< EdgeValueType >::max();
+        }
+      const int difference = static_cast< int >( iU[ l ] ) - static_cast< int >( iV[ l ] );
+      bound = std::max( bound, ( difference < 0 ? -difference : difference ) - 1 );
+      }
+    return static_cast< EdgeValueType >( bound * this->m_Scale );
+    }
+
+  bool GetVertices( const InputIndexType& iSource, const InputIndexType& iTarget,
+                    VertexDescriptorType& oSource, VertexDescriptorType& oTarget ) const
+    {
+    if( !this->m_Adaptor )
+      {
+      itkExceptionMacro( << "adaptor is null" );
+      }
+    if( !this->m_Data )
+      {
+      itkExceptionMacro( << "index is empty" );
+      }
+    if( this->m_NumberOfIndexVertices != num_vertices( this->m_Adaptor->GetOutput() ) )
+      {
+      itkExceptionMacro( << "index was built for another graph" );
+      }
+
+    bool sourceInside = false, targetInside = false;
+    oSource = this->m_Adaptor->GetVertexFromIndex( iSource, sourceInside );
+    oTarget = this->m_Adaptor->GetVertexFromIndex( iTarget, targetInside );
+    return sourceInside && targetInside;
+    }
+
+  /** A* from iSource until iTarget is expanded. */
+  bool Search( VertexDescriptorType iSource, VertexDescriptorType iTarget )
+    {
+    const GraphType& graph = this->m_Adaptor->GetOutput();
+    const SizeValueType numberOfVertices = num_vertices( graph );
+    const SizeValueType numberOfLandmarks = this->m_Landmarks.size();
+
+    this->m_States.Restart( numberOfVertices );
+    this->m_Distances.resize( numberOfVertices );
+    this->m_Bounds.resize( numberOfVertices );
+    this->m_Predecessors.resize( numberOfVertices );
+
+    const EdgeValueType infinity = NumericTraits< EdgeValueType >::max();
+    const QuantizedDistanceType* targetRow = this->m_Table + iTarget * numberOfLandmarks;
+
+    typedef typename boost::property_map< GraphType, boost::edge_weight_t >::const_type WeightMapType;
+    WeightMapType weightmap = get( boost::edge_weight, graph );
+
+    this->m_NumberOfSettledVertices = 0;
+    this->m_Queue.clear();
+
+    this->m_States.SetReached( iSource );
+    this->m_Distances[ iSource ] = NumericTraits< EdgeValueType >::Zero;
+    this->m_Bounds[ iSource ] = this->ComputeBound( this->m_Table + iSource * numberOfLandmarks, targetRow );
+    this->m_Predecessors[ iSource ] = iSource;
+
+    if( this->m_Bounds[ iSource ] == infinity )
+      {
+      return false;
+      }
+    this->m_Queue.push_back( QueueElementType( this->m_Bounds[ iSource ], iSource ) );
+
+    while( !this->m_Queue.empty() )
+      {
+      std::pop_heap( this->m_Queue.begin(), this->m_Queue.end(), QueueCompareType() );
+      const QueueElementType top = this->m_Queue.back();
+      this->m_Queue.pop_back();
+
+      const VertexDescriptorType u = top.second;
+
+      // lazy deletion: u has been reached again with a shorter distance
+      if( top.first > this->m_Distances[ u ] + this->m_Bounds[ u ] )
+        {
+        continue;
+        }
+      if( u == iTarget )
+        {
+        return true;
+        }
+      this->m_States.SetSettled( u );
+      ++this->m_NumberOfSettledVertices;
+
+      typename GraphTraits::out_edge_iterator eIt, eEnd;
+      for( boost::tie( eIt, eEnd ) = out_edges( u, graph ); eIt != eEnd; ++eIt )
+        {
+        const VertexDescriptorType v = target( *eIt, graph );
+        const EdgeValueType alt = this->m_Distances[ u ] + get( weightmap, *eIt );
+
+        if( !this->m_States.IsVisited( v ) )
+          {
+          this->m_Bounds[ v ] = this->ComputeBound( this->m_Table + v * numberOfLandmarks, targetRow );
+          if( this->m_Bounds[ v ] == infinity )
+            {
+            continue;
+            }
+          }
+        else if( alt >= this->m_Distances[ v ] )
+          {
+          continue;
+          }
+
+        // settled vertices are reopened, since the bound is not consistent
+        this->m_States.SetReached( v );
+        this->m_Distances[ v ] = alt;
+        this->m_Predecessors[ v ] = u;
+        this->m_Queue.push_back( QueueElementType( alt + this->m_Bounds[ v ], v ) );
+        std::push_heap( this->m_Queue.begin(), this->m_Queue.end(), QueueCompareType() );
+        }
+      }
+
+    return false;
+    }
+
+  void PrintSelf( std::ostream& os, Indent indent ) const
+    {
+    Superclass::PrintSelf( os, indent );
+    os << indent << "NumberOfLandmarks: " << this->m_NumberOfLandmarks << std::endl;
+    os << indent << "NumberOfThreads: " << this->m_NumberOfThreads << std::endl;
+    os << indent << "Scale: " << this->m_Scale << std::endl;
+    os << indent << "NumberOfSettledVertices: " << this->m_NumberOfSettledVertices << std::endl;
+    }
+
+private:
+  LandmarkShortestPathIndex( const Self& );
+  void operator = ( const Self& );
+};
+
+}
+
+#endif
@@ -0,0 +1,293 @@
+#ifndef __itkLiveWirePathFinder_h
+#define __itkLiveWirePathFinder_h
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkNumericTraits.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkSearchStateArray.h"
+
+namespace itk
+{
+/** \class LiveWirePathFinder
+ *  \brief Incremental single-source Dijkstra for livewire (intelligent
+ *  scissors) boundary tracing.
+ *
+ *  The search runs over the graph of an ImageBoostGraphAdaptor, with its
+ *  edge weights, and is kept alive between queries: GetPath() only expands
+ *  it until the requested pixel is settled, so that a path to an already
+ *  settled pixel is a walk along the predecessors.
+ *
+ *  Per-vertex state is allocated once for the graph size. SetSeed() starts
+ *  a new search by bumping a generation counter, without clearing or
+ *  reallocating it. The search is also restarted when the adaptor output
+ *  was updated since it began.
+ */
+template< class TAdaptor >
+class LiveWirePathFinder : public Object
+  {
+public:
+  typedef LiveWirePathFinder          Self;
+  typedef Object                      Superclass;
+  typedef SmartPointer< Self >        Pointer;
+  typedef SmartPointer< const Self >  ConstPointer;
+
+  /** Method for creation through object factory */
+  itkNewMacro( Self );
+
+  itkTypeMacro( LiveWirePathFinder, Object );
+
+  typedef TAdaptor                                    AdaptorType;
+  typedef typename AdaptorType::GraphType             GraphType;
+  typedef typename AdaptorType::GraphTraits           GraphTraits;
+  typedef typename AdaptorType::VertexDescriptorType  VertexDescriptorType;
+  typedef typename AdaptorType::EdgeValueType         EdgeValueType;
+  typedef typename AdaptorType::InputIndexType        InputIndexType;
+
+  typedef std::vector< InputIndexType >               PathType;
+  typedef std::vector< VertexDescriptorType >         VertexPathType;
+
+  void SetAdaptor( const AdaptorType* iAdaptor )
+    {
+    if( this->m_Adaptor != iAdaptor )
+      {
+      this->m_Adaptor = iAdaptor;
+      this->m_GraphTime = 0;
+      this->Modified();
+      }
+    }
+
+  const AdaptorType* GetAdaptor() const
+    {
+    return this->m_Adaptor.GetPointer();
+    }
+
+  /** Start a new search from iSeed. */
+  void SetSeed( const InputIndexType& iSeed )
+    {
+    if( !this->m_Adaptor )
+      {
+      itkExceptionMacro( << "adaptor is null" );
+      }
+
+    bool inside = false;
+    VertexDescriptorType seed = this->m_Adaptor->GetVertexFromIndex( iSeed, inside );
+
+    if( !inside )
+      {
+      itkExceptionMacro( << "seed " << iSeed << " is outside of the image" );
+      }
+
+    this->m_SeedIndex = iSeed;
+    this->m_Seed      = seed;
+    this->m_HasSeed   = true;
+    this->Restart();
+    this->Modified();
+    }
+
+  itkGetConstReferenceMacro( SeedIndex, InputIndexType );
+
+  /** Path from the seed to iTarget (both included), expanding the search as
+   *  far as needed. Returns false if iTarget is outside of the image or not
+   *  reachable from the seed. */
+  bool GetPath( const InputIndexType& iTarget, PathType& oPath )
+    {
+    if( !this->GetVertexPath( iTarget, this->m_VertexPath ) )
+      {
+      oPath.clear();
+      return false;
+      }
+
+    oPath.resize( this->m_VertexPath.size() );
+    this->m_Adaptor->GetVertexOrdering().ComputeIndices( this->m_VertexPath.begin(),
+                                                         this->m_VertexPath.end(),
+                                                         oPath.begin() );
+    return true;
+    }
+
+  /** Same as GetPath(), as vertices of the adaptor graph. */
+  bool GetVertexPath( const InputIndexType& iTarget, VertexPathType& oPath )
+    {
+    oPath.clear();
+
+    VertexDescriptorType v;
+    if( !this->Settle( iTarget, v ) )
+      {
+      return false;
+      }
+
+    while( v != this->m_Seed )
+      {
+      oPath.push_back( v );
+      v = this->m_Predecessors[ v ];
+      }
+    oPath.push_back( this->m_Seed );
+
+    std::reverse( oPath.begin(), oPath.end() );
+    return true;
+    }
+
+  /** Distance from the seed to iTarget, expanding the search as far as
+   *  needed; NumericTraits< EdgeValueType >::max() if not reachable. */
+  EdgeValueType GetDistance( const InputIndexType& iTarget )
+    {
+    VertexDescriptorType v;
+    if( !this->Settle( iTarget, v ) )
+      {
+      return NumericTraits< EdgeValueType >::max();
+      }
+    return this->m_Distances[ v ];
+    }
+
+  /** Whether the shortest path to iIndex is already known. */
+  bool IsSettled( const InputIndexType& iIndex ) const
+    {
+    bool inside = false;
+    VertexDescriptorType v = this->m_Adaptor->GetVertexFromIndex( iIndex, inside );
+
+    return inside && this->IsUpToDate() && this->m_States.IsSettled( v );
+    }
+
+  itkGetConstMacro( NumberOfSettledVertices, SizeValueType );
+
+protected:
+  LiveWirePathFinder() :
+    m_HasSeed( false ),
+    m_Seed( 0 ),
+    m_GraphTime( 0 ),
+    m_NumberOfSettledVertices( 0 )
+    {
+    this->m_SeedIndex.Fill( 0 );
+    }
+  ~LiveWirePathFinder() {}
+
+  typedef std::pair< EdgeValueType, VertexDescriptorType > QueueElementType;
+  typedef std::greater< QueueElementType >                 QueueCompareType;
+
+  typename AdaptorType::ConstPointer  m_Adaptor;
+
+  bool                                m_HasSeed;
+  InputIndexType                      m_SeedIndex;
+  VertexDescriptorType                m_Seed;
+  ModifiedTimeType                    m_GraphTime;
+
+  /** Whether each vertex is reached or settled by the current search; the
+   *  distance and predecessor of the other vertices are meaningless. */
+  SearchStateArray                    m_States;
+  std::vector< EdgeValueType >        m_Distances;
+  std::vector< VertexDescriptorType > m_Predecessors;
+
+  /** Binary heap with lazy deletion, kept as a vector so that restarting
+   *  keeps its capacity. */
+  std::vector< QueueElementType >     m_Queue;
+
+  SizeValueType                       m_NumberOfSettledVertices;
+
+  VertexPathType                      m_VertexPath;
+
+  bool IsUpToDate() const
+    {
+    return this->m_HasSeed &&
+           ( this->m_GraphTime == this->m_Adaptor->GetGraphOutput()->GetUpdateMTime() );
+    }
+
+  void Restart()
+    {
+    const GraphType& graph = this->m_Adaptor->GetOutput();
+    const SizeValueType numberOfVertices = num_vertices( graph );
+
+    this->m_States.Restart( numberOfVertices );
+    this->m_Distances.resize( numberOfVertices );
+    this->m_Predecessors.resize( numberOfVertices );
+
+    this->m_GraphTime = this->m_Adaptor->GetGraphOutput()->GetUpdateMTime();
+    this->m_NumberOfSettledVertices = 0;
+    this->m_Queue.clear();
+
+    this->m_States.SetReached( this->m_Seed );
+    this->m_Distances[ this->m_Seed ] = NumericTraits< EdgeValueType >::Zero;
+    this->m_Predecessors[ this->m_Seed ] = this->m_Seed;
+    this->m_Queue.push_back( QueueElementType( NumericTraits< EdgeValueType >::Zero, this->m_Seed ) );
+    }
+
+  /** Expand the search until the vertex of iTarget is settled. */
+  bool Settle( const InputIndexType& iTarget, VertexDescriptorType& oVertex )
+    {
+    if( !this->m_HasSeed )
+      {
+      itkExceptionMacro( << "no seed" );
+      }
+
+    if( !this->IsUpToDate() )
+      {
+      this->SetSeed( this->m_SeedIndex );
+      }
+
+    bool inside = false;
+    oVertex = this->m_Adaptor->GetVertexFromIndex( iTarget, inside );
+
+    if( !inside )
+      {
+      return false;
+      }
+
+    const GraphType& graph = this->m_Adaptor->GetOutput();
+    typedef typename boost::property_map< GraphType, boost::edge_weight_t >::const_type WeightMapType;
+    WeightMapType weightmap = get( boost::edge_weight, graph );
+
+    while( !this->m_States.IsSettled( oVertex ) && !this->m_Queue.empty() )
+      {
+      std::pop_heap( this->m_Queue.begin(), this->m_Queue.end(), QueueCompareType() );
+      const QueueElementType top = this->m_Queue.back();
+      this->m_Queue.pop_back();
+
+      const VertexDescriptorType u = top.second;
+
+      // lazy deletion: u has already been settled with a shorter distance
+      if( this->m_States.IsSettled( u ) )
+        {
+        continue;
+        }
+      this->m_States.SetSettled( u );
+      ++this->m_NumberOfSettledVertices;
+
+      typename GraphTraits::out_edge_iterator eIt, eEnd;
+      for( boost::tie( eIt, eEnd ) = out_edges( u, graph ); eIt != eEnd; ++eIt )
+        {
+        const VertexDescriptorType v = target( *eIt, graph );
+        const EdgeValueType alt = top.first + get( weightmap, *eIt );
+
+        if( !this->m_States.IsSettled( v ) &&
+            ( !this->m_States.IsReached( v ) || alt < this->m_Distances[ v ] ) )
+          {
+          this->m_States.SetReached( v );
+          this->m_Distances[ v ] = alt;
+          this->m_Predecessors[ v ] = u;
+          this->m_Queue.push_back( QueueElementType( alt, v ) );
+          std::push_heap( this->m_Queue.begin(), this->m_Queue.end(), QueueCompareType() );
+          }
+        }
+      }
+
+    return this->m_States.IsSettled( oVertex );
+    }
+
+  void PrintSelf( std::ostream& os, Indent indent ) const
+    {
+    Superclass::PrintSelf( os, indent );
+    os << indent << "SeedIndex: " << this->m_SeedIndex << std::endl;
+    os << indent << "NumberOfSettledVertices: " << this->m_NumberOfSettledVertices << std::endl;
+    }
+
+private:
+  LiveWirePathFinder( const Self& );
+  void operator = ( const Self& );
+};
+
+}
+
+#endif
@@ -0,0 +1,556 @@
+#ifndef __itkMultiLabelGraphCutImageFilter_h
+#define __itkMultiLabelGraphCutImageFilter_h
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <boost/graph/compressed_sparse_row_graph.hpp>
+#include <boost/graph/boykov_kolmogorov_max_flow.hpp>
+
+#include "itkImageGraphToImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkCompressedSparseRowMatrix.h"
+
+namespace itk
+{
+/** \class MultiLabelGraphCutImageFilter
+ *  \brief Multi-label labeling by alpha-expansion or alpha-beta swap moves
+ *  (Boykov, Veksler and Zabih, 2001) over the pixel graph.
+ *
+ *  The labeling f minimizes
+ *
+ *    E( f ) = sum_p D_l( p ) [ f( p ) = l ] + sum_pq w_pq [ f( p ) != f( q ) ]
+ *
+ *  where D_l is the data cost image of label l (SetDataCost(), inputs 1 to
+ *  L) and w_pq = Smoothness * exp( -Beta * m / mMax ), m being the metric
+ *  evaluated on the edge and mMax its largest value over the image. Labels
+ *  are written as 0 ... L - 1, starting from the cheapest label of each
+ *  pixel.
+ *
+ *  The pixel graph is exported once in CSR form by ImageBoostGraphAdaptor,
+ *  and the max-flow graph (pixels, source and sink, each edge with its
+ *  reverse) is built once from it. A move only rewrites the capacities in
+ *  place before running boykov_kolmogorov_max_flow; pixels which a swap
+ *  move leaves out keep zero capacities. The flow and the search trees
+ *  are not carried over from one move to the next, since the boost solver
+ *  starts from a zero flow.
+ *
+ *  A cycle tries every label (every pair of labels for swaps) once; moves
+ *  are kept when they lower the energy, until a cycle brings no decrease or
+ *  MaximumNumberOfIterations cycles. Progress is reported, and
+ *  AbortGenerateData checked, after every move.
+ */
+template< class TInputImage,
+          class TLabelImage = Image< unsigned char, TInputImage::ImageDimension >,
+          class TMetric = IndexMetric< TInputImage, double > >
+class MultiLabelGraphCutImageFilter :
+  public ImageGraphToImageFilter< TInputImage, TLabelImage, TMetric >
+  {
+public:
+  typedef MultiLabelGraphCutImageFilter                                 Self;
+  typedef ImageGraphToImageFilter< TInputImage, TLabelImage, TMetric >  Superclass;
+  typedef SmartPointer< Self >                                          Pointer;
+  typedef SmartPointer< const Self >                                    ConstPointer;
+
+  /** Method for creation through object factory */
+  itkNewMacro( Self );
+
+  itkTypeMacro( MultiLabelGraphCutImageFilter, ImageGraphToImageFilter );
+
+  itkStaticConstMacro( ImageDimension, unsigned int, TInputImage::ImageDimension );
+
+  typedef TInputImage                               InputImageType;
+  typedef typename InputImageType::RegionType       InputImageRegionType;
+  typedef typename InputImageType::OffsetType       InputOffsetType;
+
+  typedef TLabelImage                               LabelImageType;
+  typedef typename LabelImageType::PixelType        LabelPixelType;
+
+  typedef Image< float, ImageDimension >            CostImageType;
+
+  typedef TMetric MetricType;
+
+  typedef double                                    RealType;
+
+  typedef enum
+    {
+    AlphaExpansion = 0,
+    AlphaBetaSwap
+    } MoveType;
+
+  /** Cost of giving label iLabel to each pixel. */
+  void SetDataCost( unsigned int iLabel, const CostImageType* iCost )
+    {
+    this->ProcessObject::SetNthInput( iLabel + 1, const_cast< CostImageType* >( iCost ) );
+    }
+
+  const CostImageType* GetDataCost( unsigned int iLabel ) const
+    {
+    return static_cast< const CostImageType* >( this->ProcessObject::GetInput( iLabel + 1 ) );
+    }
+
+  unsigned int GetNumberOfLabels() const
+    {
+    const unsigned int numberOfInputs = this->GetNumberOfInputs();
+    return numberOfInputs > 1 ? numberOfInputs - 1 : 0;
+    }
+
+  itkSetMacro( MoveType, MoveType );
+  itkGetConstMacro( MoveType, MoveType );
+
+  /** Scale of the pairwise term. */
+  itkSetMacro( Smoothness, RealType );
+  itkGetConstMacro( Smoothness, RealType );
+
+  /** Decay of the pairwise term with the metric; 0 gives the Potts model. */
+  itkSetMacro( Beta, RealType );
+  itkGetConstMacro( Beta, RealType );
+
+  /** Largest number of cycles. */
+  itkSetMacro( MaximumNumberOfIterations, unsigned int );
+  itkGetConstMacro( MaximumNumberOfIterations, unsigned int );
+
+  itkGetConstMacro( NumberOfIterations, unsigned int );
+
+  /** Energy of the output labeling. */
+  itkGetConstMacro( Energy, RealType );
+
+protected:
+  MultiLabelGraphCutImageFilter() :
+    m_MoveType( AlphaExpansion ),
+    m_Smoothness( 1. ),
+    m_Beta( 0. ),
+    m_MaximumNumberOfIterations( 10 ),
+    m_NumberOfIterations( 0 ),
+    m_Energy( 0. )
+    {
+    this->SetNumberOfRequiredInputs( 2 );
+    }
+  ~MultiLabelGraphCutImageFilter() {}
+
+  MoveType      m_MoveType;
+  RealType      m_Smoothness;
+  RealType      m_Beta;
+  unsigned int  m_MaximumNumberOfIterations;
+  unsigned int  m_NumberOfIterations;
+  RealType      m_Energy;
+
+  typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::undirectedS,
+    boost::no_property, boost::property< boost::edge_weight_t, RealType > > PixelGraphType;
+  typedef ImageBoostGraphAdaptor< InputImageType, PixelGraphType, MetricType > AdaptorType;
+  typedef typename AdaptorType::CSRMatrixType       MatrixType;
+  typedef typename MatrixType::IndexType            MatrixIndexType;
+
+  typedef boost::compressed_sparse_row_graph< boost::directedS >  FlowGraphType;
+  typedef boost::graph_traits< FlowGraphType >                    FlowGraphTraits;
+  typedef typename FlowGraphTraits::vertex_descriptor             FlowVertexType;
+  typedef typename FlowGraphTraits::edge_descriptor               FlowEdgeType;
+
+  /** Pixel graph and max-flow graph, built once per update.
+   *
+   *  The edges of the max-flow graph are sorted by source: pixel u has its
+   *  neighbors in the order of the pixel graph, then an edge to the source
+   *  (the reverse of the source edge, never saturated) and its sink edge;
+   *  the source and the sink come last, with an edge to every pixel. */
+  struct GraphCutType
+    {
+    MatrixType                          Pixels;
+    std::vector< RealType >             Weights;
+    std::vector< RealType >             Costs;
+    unsigned int                        NumberOfLabels;
+
+    FlowGraphType                       Graph;
+    FlowVertexType                      Source;
+    FlowVertexType                      Sink;
+    std::vector< FlowEdgeType >         Reverses;
+    std::vector< RealType >             Capacities;
+    std::vector< RealType >             Residuals;
+    std::vector< FlowEdgeType >         Predecessors;
+    std::vector< boost::default_color_type > Colors;
+    std::vector< long >                 Distances;
+
+    /** Unary terms of the move, for a pixel in the source or sink tree */
+    std::vector< RealType >             SourceSideCosts;
+    std::vector< RealType >             SinkSideCosts;
+
+    MatrixIndexType NumberOfPixels() const
+      {
+      return this->Pixels.GetNumberOfRows();
+      }
+
+    /** First edge of pixel u in the max-flow graph */
+    MatrixIndexType FirstEdge( MatrixIndexType iU ) const
+      {
+      return this->Pixels.GetRowPointers()[ iU ] + 2 * iU;
+      }
+
+    MatrixIndexType SourceEdge( MatrixIndexType iU ) const
+      {
+      return this->Pixels.GetNumberOfEntries() + 2 * this->NumberOfPixels() + iU;
+      }
+
+    MatrixIndexType SinkEdge( MatrixIndexType iU ) const
+      {
+      return this->Pixels.GetNumberOfEntries() + 3 * this->NumberOfPixels() + iU;
+      }
+
+    RealType DataCost( MatrixIndexType iU, unsigned int iLabel ) const
+      {
+      return this->Costs[ iU * this->NumberOfLabels + iLabel ];
+      }
+    };
+
+  void GenerateData()
+    {
+    const InputImageType* input = this->GetInput();
+    LabelImageType*       output = this->GetOutput();
+
+    output->SetBufferedRegion( output->GetRequestedRegion() );
+    output->Allocate();
+
+    const InputImageRegionType region = output->GetBufferedRegion();
+    const unsigned int numberOfLabels = this->GetNumberOfLabels();
+
+    GraphCutType g;
+    g.NumberOfLabels = numberOfLabels;
+
+    // Data costs, interleaved by pixel
+    const MatrixIndexType numberOfPixels = region.GetNumberOfPixels();
+    g.Costs.resize( numberOfPixels * numberOfLabels );
+
+    for( unsigned int l = 0; l < numberOfLabels; ++l )
+      {
+      const CostImageType* cost = this->GetDataCost( l );
+      if( !cost )
+        {
+        itkExceptionMacro( << "no data cost for label " << l );
+        }
+
+      ImageRegionConstIterator< CostImageType > costIt( cost, region );
+      MatrixIndexType u = 0;
+      for( costIt.GoToBegin(); !costIt.IsAtEnd(); ++costIt, ++u )
+        {
+        g.Costs[ u * numberOfLabels + l ] = static_cast< RealType >( costIt.Get() );
+        }
+      }
+
+    // Pixel graph, in raster order over the region
+    typename AdaptorType::Pointer adaptor = AdaptorType::New();
+    adaptor->SetInput( input );
+    adaptor->SetNeighbors( this->m_OffsetList );
+    adaptor->SetMetric( this->m_Metric );
+    adaptor->SetNumberOfThreads( this->GetNumberOfThreads() );
+    adaptor->ExportCSR( g.Pixels );
+
+    this->ComputeWeights( g );
+    this->BuildFlowGraph( g );
+
+    // Cheapest label of each pixel
+    std::vector< unsigned int > labels( numberOfPixels, 0 );
+    for( MatrixIndexType u = 0; u < numberOfPixels; ++u )
+      {
+      for( unsigned int l = 1; l < numberOfLabels; ++l )
+        {
+        if( g.DataCost( u, l ) < g.DataCost( u, labels[ u ] ) )
+          {
+          labels[ u ] = l;
+          }
+        }
+      }
+
+    this->m_Energy = this->ComputeEnergy( g, labels );
+    this->m_NumberOfIterations = 0;
+
+    const bool swap = ( this->m_MoveType == AlphaBetaSwap );
+    const unsigned int numberOfMoves = swap ?
+      numberOfLabels * ( numberOfLabels - 1 ) / 2 : numberOfLabels;
+
+    std::vector< unsigned int > candidate;
+    bool decreased = numberOfLabels > 1;
+
+    while( decreased && this->m_NumberOfIterations < this->m_MaximumNumberOfIterations )
+      {
+      decreased = false;
+      unsigned int move = 0;
+
+      for( unsigned int alpha = 0; alpha < numberOfLabels; ++alpha )
+        {
+        for( unsigned int beta = swap ? alpha + 1 : alpha;
+             beta < ( swap ? numberOfLabels : alpha + 1 ); ++beta, ++move )
+          {
+          if( this->GetAbortGenerateData() )
+            {
+            ProcessAborted e( __FILE__, __LINE__ );
+            e.SetDescription( "Process aborted." );
+            throw e;
+            }
+
+          candidate = labels;
+          this->Move( g, alpha, beta, swap, candidate );
+
+          const RealType energy = this->ComputeEnergy( g, candidate );
+          if( energy < this->m_Energy - 1e-9 * ( 1. + std::abs( this->m_Energy ) ) )
+            {
+            labels.swap( candidate );
+            this->m_Energy = energy;
+            decreased = true;
+            }
+
+          this->UpdateProgress( static_cast< float >( this->m_NumberOfIterations * numberOfMoves + move + 1 ) /
+                                static_cast< float >( this->m_MaximumNumberOfIterations * numberOfMoves ) );
+          }
+        }
+      ++this->m_NumberOfIterations;
+      }
+
+    LabelPixelType* outputBuffer = output->GetBufferPointer();
+    for( MatrixIndexType u = 0; u < numberOfPixels; ++u )
+      {
+      outputBuffer[ u ] = static_cast< LabelPixelType >( labels[ u ] );
+      }
+    }
+
+  /** Pairwise weights from the metric values of the pixel graph. */
+  void ComputeWeights( GraphCutType& g ) const
+    {
+    const std::vector< RealType >& metric = g.Pixels.GetValues();
+
+    RealType maximum = 0.;
+    for( size_t e = 0; e < metric.size(); ++e )
+      {
+      maximum = std::max( maximum, metric[ e ] );
+      }
+    if( maximum <= 0. )
+      {
+      maximum = 1.;
+      }
+
+    g.Weights.resize( metric.size() );
+    for( size_t e = 0; e < metric.size(); ++e )
+      {
+      g.Weights[ e ] = this->m_Smoothness * std::exp( -this->m_Beta * metric[ e ] / maximum );
+      }
+    }
+
+  void BuildFlowGraph( GraphCutType& g ) const
+    {
+    const MatrixIndexType n = g.NumberOfPixels();
+    const MatrixIndexType* rowPointers = &g.Pixels.GetRowPointers()[0];
+    const MatrixIndexType* columns = g.Pixels.GetColumns().empty() ? 0 : &g.Pixels.GetColumns()[0];
+    const MatrixIndexType numberOfEdges = g.Pixels.GetNumberOfEntries() + 4 * n;
+
+    g.Source = n;
+    g.Sink   = n + 1;
+
+    std::vector< std::pair< FlowVertexType, FlowVertexType > > edgeList;
+    std::vector< MatrixIndexType > reverses;
+    edgeList.reserve( numberOfEdges );
+    reverses.reserve( numberOfEdges );
+
+    for( MatrixIndexType u = 0; u < n; ++u )
+      {
+      for( MatrixIndexType e = rowPointers[ u ]; e < rowPointers[ u + 1 ]; ++e )
+        {
+        const MatrixIndexType v = columns[ e ];
+
+        MatrixIndexType k = 0;
+        while( columns[ rowPointers[ v ] + k ] != u )
+          {
+          ++k;
+          }
+        edgeList.push_back( std::make_pair( u, v ) );
+        reverses.push_back( g.FirstEdge( v ) + k );
+        }
+      edgeList.push_back( std::make_pair( u, g.Source ) );
+      reverses.push_back( g.SourceEdge( u ) );
+      edgeList.push_back( std::make_pair( u, g.Sink ) );
+      reverses.push_back( g.SinkEdge( u ) );
+      }
+    for( MatrixIndexType u = 0; u < n; ++u )
+      {
+      edgeList.push_back( std::make_pair( g.Source, u ) );
+      reverses.push_back( g.FirstEdge( u + 1 ) - 2 );
+      }
+    for( MatrixIndexType u = 0; u < n; ++u )
+      {
+      edgeList.push_back( std::make_pair( g.Sink, u ) );
+      reverses.push_back( g.FirstEdge( u + 1 ) - 1 );
+      }
+
+    g.Graph = FlowGraphType( boost::edges_are_sorted, edgeList.begin(), edgeList.end(), n + 2 );
+
+    // Edges are indexed in the order they were given
+    std::vector< FlowEdgeType > edgesByIndex;
+    edgesByIndex.reserve( numberOfEdges );
+    typename FlowGraphTraits::edge_iterator eIt, eEnd;
+    for( boost::tie( eIt, eEnd ) = edges( g.Graph ); eIt != eEnd; ++eIt )
+      {
+      edgesByIndex.push_back( *eIt );
+      }
+
+    g.Reverses.resize( numberOfEdges );
+    for( MatrixIndexType e = 0; e < numberOfEdges; ++e )
+      {
+      g.Reverses[ e ] = edgesByIndex[ reverses[ e ] ];
+      }
+
+    g.Capacities.resize( numberOfEdges );
+    g.Residuals.resize( numberOfEdges );
+    g.Predecessors.resize( n + 2 );
+    g.Colors.resize( n + 2 );
+    g.Distances.resize( n + 2 );
+    g.SourceSideCosts.resize( n );
+    g.SinkSideCosts.resize( n );
+    }
+
+  /** Potts energy of a labeling. */
+  RealType ComputeEnergy( const GraphCutType& g, const std::vector< unsigned int >& iLabels ) const
+    {
+    const MatrixIndexType n = g.NumberOfPixels();
+    const MatrixIndexType* rowPointers = &g.Pixels.GetRowPointers()[0];
+    const MatrixIndexType* columns = g.Pixels.GetColumns().empty() ? 0 : &g.Pixels.GetColumns()[0];
+
+    RealType energy = 0.;
+    for( MatrixIndexType u = 0; u < n; ++u )
+      {
+      energy += g.DataCost( u, iLabels[ u ] );
+      for( MatrixIndexType e = rowPointers[ u ]; e < rowPointers[ u + 1 ]; ++e )
+        {
+        // each edge is in the rows of both its ends
+        if( columns[ e ] > u && iLabels[ columns[ e ] ] != iLabels[ u ] )
+          {
+          energy += g.Weights[ e ];
+          }
+        }
+      }
+    return energy;
+    }
+
+  /** Best move on ioLabels: pixels labelled alpha or beta get alpha in the
+   *  source tree and beta in the sink tree (iSwap), or any pixel keeps its
+   *  label in the source tree and takes alpha in the sink tree. The binary
+   *  energy of the move is cast as a cut (Kolmogorov and Zabih, 2004). */
+  void Move( GraphCutType& g,
+             unsigned int iAlpha,
+             unsigned int iBeta,
+             bool iSwap,
+             std::vector< unsigned int >& ioLabels ) const
+    {
+    const MatrixIndexType n = g.NumberOfPixels();
+    const MatrixIndexType* rowPointers = &g.Pixels.GetRowPointers()[0];
+    const MatrixIndexType* columns = g.Pixels.GetColumns().empty() ? 0 : &g.Pixels.GetColumns()[0];
+
+    std::fill( g.Capacities.begin(), g.Capacities.end(), 0. );
+    std::fill( g.SourceSideCosts.begin(), g.SourceSideCosts.end(), 0. );
+    std::fill( g.SinkSideCosts.begin(), g.SinkSideCosts.end(), 0. );
+
+    // Labels of u in the source and sink trees
+    std::vector< unsigned int > sourceLabels( n ), sinkLabels( n );
+    std::vector< bool > active( n );
+    for( MatrixIndexType u = 0; u < n; ++u )
+      {
+      if( iSwap )
+        {
+        active[ u ]       = ( ioLabels[ u ] == iAlpha || ioLabels[ u ] == iBeta );
+        sourceLabels[ u ] = iAlpha;
+        sinkLabels[ u ]   = iBeta;
+        }
+      else
+        {
+        active[ u ]       = true;
+        sourceLabels[ u ] = ioLabels[ u ];
+        sinkLabels[ u ]   = iAlpha;
+        }
+      }
+
+    for( MatrixIndexType u = 0; u < n; ++u )
+      {
+      if( !active[ u ] )
+        {
+        continue;
+        }
+      g.SourceSideCosts[ u ] += g.DataCost( u, sourceLabels[ u ] );
+      g.SinkSideCosts[ u ] += g.DataCost( u, sinkLabels[ u ] );
+
+      for( MatrixIndexType e = rowPointers[ u ]; e < rowPointers[ u + 1 ]; ++e )
+        {
+        const MatrixIndexType v = columns[ e ];
+        const RealType w = g.Weights[ e ];
+
+        if( !active[ v ] )
+          {
+          g.SourceSideCosts[ u ] += ( sourceLabels[ u ] != ioLabels[ v ] ) ? w : 0.;
+          g.SinkSideCosts[ u ] += ( sinkLabels[ u ] != ioLabels[ v ] ) ? w : 0.;
+          }
+        else if( v > u )
+          {
+          // A + ( C - A ) x_u + ( D - C ) x_v + ( B + C - A - D ) ( 1 - x_u ) x_v
+          const RealType a = ( sourceLabels[ u ] != sourceLabels[ v ] ) ? w : 0.;
+          const RealType b = ( sourceLabels[ u ] != sinkLabels[ v ] ) ? w : 0.;
+          const RealType c = ( sinkLabels[ u ] != sourceLabels[ v ] ) ? w : 0.;
+          const RealType d = ( sinkLabels[ u ] != sinkLabels[ v ] ) ? w : 0.;
+
+          g.SourceSideCosts[ u ] += a;
+          g.SinkSideCosts[ u ] += c;
+          g.SinkSideCosts[ v ] += d - c;
+          g.Capacities[ g.FirstEdge( u ) + e - rowPointers[ u ] ] = std::max( b + c - a - d, 0. );
+          }
+        }
+      }
+
+    // A pixel in the sink tree is cut from the source, and conversely
+    for( MatrixIndexType u = 0; u < n; ++u )
+      {
+      if( active[ u ] )
+        {
+        const RealType offset = std::min( g.SourceSideCosts[ u ], g.SinkSideCosts[ u ] );
+        g.Capacities[ g.SourceEdge( u ) ] = g.SinkSideCosts[ u ] - offset;
+        g.Capacities[ g.FirstEdge( u + 1 ) - 1 ] = g.SourceSideCosts[ u ] - offset;
+        }
+      }
+
+    typedef typename boost::property_map< FlowGraphType, boost::edge_index_t >::type   EdgeIndexMapType;
+    typedef typename boost::property_map< FlowGraphType, boost::vertex_index_t >::type VertexIndexMapType;
+
+    EdgeIndexMapType   edgeIndex = get( boost::edge_index, g.Graph );
+    VertexIndexMapType vertexIndex = get( boost::vertex_index, g.Graph );
+
+    boost::boykov_kolmogorov_max_flow( g.Graph,
+      boost::make_iterator_property_map( g.Capacities.begin(), edgeIndex ),
+      boost::make_iterator_property_map( g.Residuals.begin(), edgeIndex ),
+      boost::make_iterator_property_map( g.Reverses.begin(), edgeIndex ),
+      boost::make_iterator_property_map( g.Predecessors.begin(), vertexIndex ),
+      boost::make_iterator_property_map( g.Colors.begin(), vertexIndex ),
+      boost::make_iterator_property_map( g.Distances.begin(), vertexIndex ),
+      vertexIndex, g.Source, g.Sink );
+
+    for( MatrixIndexType u = 0; u < n; ++u )
+      {
+      if( active[ u ] )
+        {
+        ioLabels[ u ] = ( g.Colors[ u ] == boost::black_color ) ? sourceLabels[ u ] : sinkLabels[ u ];
+        }
+      }
+    }
+
+  void PrintSelf( std::ostream& os, Indent indent ) const
+    {
+    Superclass::PrintSelf( os, indent );
+    os << indent << "MoveType: " << this->m_MoveType << std::endl;
+    os << indent << "Smoothness: " << this->m_Smoothness << std::endl;
+    os << indent << "Beta: " << this->m_Beta << std::endl;
+    os << indent << "MaximumNumberOfIterations: " << this->m_MaximumNumberOfIterations << std::endl;
+    os << indent << "NumberOfIterations: " << this->m_NumberOfIterations << std::endl;
+    os << indent << "Energy: " << this->m_Energy << std::endl;
+    }
+
+private:
+  MultiLabelGraphCutImageFilter( const Self& );
+  void operator = ( const Self& );
+};
+
+}
+
+#endif
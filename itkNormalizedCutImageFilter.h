@@ -0,0 +1,1537 @@
+#ifndef __itkNormalizedCutImageFilter_h
+#define __itkNormalizedCutImageFilter_h
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "itkImageGraphToImageFilter.h"
+#include "itkNumericTraits.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkImageStencil.h"
+#include "itkCompressedSparseRowMatrix.h"
+#include "itkRangeThreader.h"
+
+namespace itk
+{
+/** \class NormalizedCutImageFilter
+ *  \brief Spectral segmentation of the pixel graph by normalized cuts (Shi
+ *  and Malik, 2000).
+ *
+ *  Affinities are w = exp( -beta * m / mMax ) + epsilon, as in
+ *  RandomWalkerImageFilter. The normalized affinity N = D^-1/2 W D^-1/2 is
+ *  assembled in CSR form directly from the stencil, in threaded passes; its
+ *  largest eigenvectors are those of the smallest eigenvalues of the
+ *  normalized Laplacian I - N.
+ *
+ *  Those eigenvalues are small and clustered, which makes Krylov methods
+ *  crawl on large images. The graph is therefore coarsened by matching
+ *  each vertex with its strongest neighbor, when the edge is strong enough
+ *  compared to the others of the vertex (W_c = P^T W P), down to a few
+ *  hundred vertices, so that the weak edges of the cuts are kept. The
+ *  eigenvectors of the coarsest graph, interpolated, start a block LOBPCG
+ *  (Knyazev, 2001) on the next finer one, and so on: on each level only
+ *  the fine scale details are left to converge. The residuals are
+ *  preconditioned by a V-cycle over the same hierarchy, with damped Jacobi
+ *  smoothing and a dense Cholesky solve on the coarsest graph. The trivial
+ *  eigenvector D^1/2 1 is known and projected out. Sparse products, dot
+ *  products and basis updates are all threaded over the rows, and the
+ *  passes over several vectors go by chunks of rows.
+ *
+ *  The NumberOfClusters - 1 non-trivial generalized eigenvectors
+ *  D^-1/2 v embed the pixels, which a threaded k-means splits into
+ *  NumberOfClusters labels, numbered from 1 in the raster order of their
+ *  first pixel. The stencil is made symmetric.
+ */
+template< class TInputImage,
+          class TLabelImage = Image< unsigned char, TInputImage::ImageDimension >,
+          class TMetric = IndexMetric< TInputImage, double > >
+class NormalizedCutImageFilter :
+  public ImageGraphToImageFilter< TInputImage, TLabelImage, TMetric >
+  {
+public:
+  typedef NormalizedCutImageFilter                                      Self;
+  typedef ImageGraphToImageFilter< TInputImage, TLabelImage, TMetric >  Superclass;
+  typedef SmartPointer< Self >                                          Pointer;
+  typedef SmartPointer< const Self >                                    ConstPointer;
+
+  /** Method for creation through object factory */
+  itkNewMacro( Self );
+
+  itkTypeMacro( NormalizedCutImageFilter, ImageGraphToImageFilter );
+
+  itkStaticConstMacro( ImageDimension, unsigned int, TInputImage::ImageDimension );
+
+  typedef TInputImage                               InputImageType;
+  typedef typename InputImageType::RegionType       InputImageRegionType;
+  typedef typename InputImageType::IndexType        InputIndexType;
+  typedef typename InputImageType::OffsetType       InputOffsetType;
+  typedef typename Superclass::OffsetContainerType  OffsetContainerType;
+  typedef typename InputImageType::OffsetValueType  OffsetValueType;
+  typedef ImageVertexOrdering< ImageDimension >     VertexOrderingType;
+  typedef ImageStencil< ImageDimension >            StencilType;
+
+  typedef TLabelImage                               LabelImageType;
+  typedef typename LabelImageType::PixelType        LabelPixelType;
+
+  typedef TMetric MetricType;
+
+  typedef double                                    RealType;
+  typedef CompressedSparseRowMatrix< RealType >     MatrixType;
+  typedef typename MatrixType::IndexType            MatrixIndexType;
+
+  itkSetMacro( Beta, RealType );
+  itkGetConstMacro( Beta, RealType );
+
+  itkSetMacro( NumberOfClusters, unsigned int );
+  itkGetConstMacro( NumberOfClusters, unsigned int );
+
+  /** Residual norm under which an eigenvector has converged. */
+  itkSetMacro( Tolerance, RealType );
+  itkGetConstMacro( Tolerance, RealType );
+
+  /** Vectors iterated together; 0 chooses NumberOfClusters, one more than
+   *  the eigenvectors wanted. */
+  itkSetMacro( BlockSize, unsigned int );
+  itkGetConstMacro( BlockSize, unsigned int );
+
+  /** Largest number of LOBPCG iterations on each level. */
+  itkSetMacro( MaximumNumberOfIterations, unsigned int );
+  itkGetConstMacro( MaximumNumberOfIterations, unsigned int );
+
+  /** Graphs solved, the input one included, and iterations on the input one. */
+  itkGetConstMacro( NumberOfLevels, unsigned int );
+  itkGetConstMacro( NumberOfIterations, unsigned int );
+
+  /** Smallest eigenvalues of the normalized Laplacian, the trivial 0 first. */
+  const std::vector< RealType >& GetEigenvalues() const
+    {
+    return this->m_Eigenvalues;
+    }
+
+protected:
+  NormalizedCutImageFilter() :
+    m_Beta( 90. ),
+    m_NumberOfClusters( 2 ),
+    m_Tolerance( 1e-7 ),
+    m_BlockSize( 0 ),
+    m_MaximumNumberOfIterations( 1000 ),
+    m_NumberOfLevels( 0 ),
+    m_NumberOfIterations( 0 )
+    {}
+  ~NormalizedCutImageFilter() {}
+
+  RealType                m_Beta;
+  unsigned int            m_NumberOfClusters;
+  RealType                m_Tolerance;
+  unsigned int            m_BlockSize;
+  unsigned int            m_MaximumNumberOfIterations;
+  unsigned int            m_NumberOfLevels;
+  unsigned int            m_NumberOfIterations;
+  std::vector< RealType > m_Eigenvalues;
+
+  /** Graph of one level of the hierarchy, and the coarser vertex each of
+   *  its vertices is aggregated to; the vertices of each aggregate are
+   *  listed in CSR form in Members, and Weights holds the entries of the
+   *  prolongation Q below. InverseDiagonal is the inverse of the diagonal
+   *  of the normalized Laplacian, Right, Correction and Product are the
+   *  vectors of the
+   *  multigrid cycle, and Factor, on the coarsest level only, the dense
+   *  Cholesky factor of I - N + q q^T, q being the trivial eigenvector. */
+  struct LevelType
+    {
+    SizeValueType                 NumberOfVertices;
+    MatrixType                    Matrix;
+    std::vector< RealType >       Degrees;
+    std::vector< SizeValueType >  Aggregates;
+    std::vector< SizeValueType >  MemberPointers;
+    std::vector< SizeValueType >  Members;
+    std::vector< RealType >       Weights;
+
+    std::vector< RealType >       InverseDiagonal;
+    std::vector< RealType >       Right;
+    std::vector< RealType >       Correction;
+    std::vector< RealType >       Product;
+    std::vector< RealType >       Factor;
+    };
+
+  /** State shared by the threaded assembly passes of the input graph. */
+  struct AffinityType
+    {
+    const InputImageType*           Image;
+    const MetricType*               Metric;
+    InputImageRegionType            Region;
+    VertexOrderingType              Ordering;
+    OffsetContainerType             Offsets;
+    StencilType                     Stencil;
+
+    RealType                        Beta;
+    std::vector< RealType >         MaximumMetric;
+
+    LevelType*                      Level;
+
+    InputIndexType ComputeIndex( OffsetValueType iV ) const
+      {
+      return this->Ordering.ComputeIndex( iV );
+      }
+
+    RealType Weight( RealType iMetric ) const
+      {
+      const RealType maximum = ( this->MaximumMetric[ 0 ] > 0. ) ? this->MaximumMetric[ 0 ] : 1.;
+      return std::exp( -this->Beta * iMetric / maximum ) + 1e-6;
+      }
+    };
+
+  /** First pass: largest metric value and length of each row. */
+  struct CountFunctor
+    {
+    AffinityType* Affinity;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType iThreadId )
+      {
+      AffinityType& a = *Affinity;
+      MatrixIndexType* rowPointers = &a.Level->Matrix.GetRowPointers()[0];
+      RealType maximum = 0.;
+
+      for( SizeValueType u = iBegin; u < iEnd; ++u )
+        {
+        const InputIndexType index = a.ComputeIndex( u );
+        MatrixIndexType length = 0;
+
+        const bool interior = a.Stencil.IsInterior( index );
+        for( unsigned int k = 0; k < a.Stencil.GetNumberOfOffsets(); ++k )
+          {
+          if( interior || a.Stencil.IsInside( index, k ) )
+            {
+            const InputIndexType neighIndex = index + a.Offsets[ k ];
+            const RealType m = EvaluateMetric< RealType >( *a.Metric, a.Image, index, neighIndex, k );
+            if( m > maximum )
+              {
+              maximum = m;
+              }
+            ++length;
+            }
+          }
+        rowPointers[ u + 1 ] = length;
+        }
+      a.MaximumMetric[ iThreadId ] = std::max( a.MaximumMetric[ iThreadId ], maximum );
+      }
+    };
+
+  /** Second pass: affinities and degrees. */
+  struct FillFunctor
+    {
+    AffinityType* Affinity;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      AffinityType& a = *Affinity;
+      const MatrixIndexType* rowPointers = &a.Level->Matrix.GetRowPointers()[0];
+      MatrixIndexType* columns  = &a.Level->Matrix.GetColumns()[0];
+      RealType*        values   = &a.Level->Matrix.GetValues()[0];
+      RealType*        degrees  = &a.Level->Degrees[0];
+
+      for( SizeValueType u = iBegin; u < iEnd; ++u )
+        {
+        const InputIndexType index = a.ComputeIndex( u );
+        MatrixIndexType e = rowPointers[ u ];
+        RealType degree = 0.;
+
+        const bool interior = a.Stencil.IsInterior( index );
+        for( unsigned int k = 0; k < a.Stencil.GetNumberOfOffsets(); ++k )
+          {
+          if( interior || a.Stencil.IsInside( index, k ) )
+            {
+            const InputIndexType neighIndex = index + a.Offsets[ k ];
+            const RealType w = a.Weight(
+                  EvaluateMetric< RealType >( *a.Metric, a.Image, index, neighIndex, k ) );
+            columns[ e ] = u + a.Stencil.GetDelta( k );
+            values[ e ] = w;
+            degree += w;
+            ++e;
+            }
+          }
+        degrees[ u ] = ( degree > 0. ) ? degree : 1.;
+        }
+      }
+    };
+
+  /** Rows of the coarse graph P^T W P: the rows of the members of each
+   *  aggregate, with their columns aggregated and merged. The first pass
+   *  counts the entries and sums the degrees, the second one fills them. */
+  struct CoarsenFunctor
+    {
+    const LevelType*  Fine;
+    LevelType*        Coarse;
+    bool              Fill;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      const MatrixIndexType* fineRows     = &Fine->Matrix.GetRowPointers()[0];
+      const MatrixIndexType* fineColumns  = &Fine->Matrix.GetColumns()[0];
+      const RealType*        fineValues   = &Fine->Matrix.GetValues()[0];
+      MatrixIndexType*       rowPointers  = &Coarse->Matrix.GetRowPointers()[0];
+
+      std::vector< std::pair< MatrixIndexType, RealType > > row;
+
+      for( SizeValueType c = iBegin; c < iEnd; ++c )
+        {
+        row.clear();
+        RealType degree = 0.;
+
+        for( SizeValueType i = Fine->MemberPointers[ c ]; i < Fine->MemberPointers[ c + 1 ]; ++i )
+          {
+          const SizeValueType f = Fine->Members[ i ];
+          degree += Fine->Degrees[ f ];
+          for( MatrixIndexType e = fineRows[ f ]; e < fineRows[ f + 1 ]; ++e )
+            {
+            row.push_back( std::make_pair( Fine->Aggregates[ fineColumns[ e ] ], fineValues[ e ] ) );
+            }
+          }
+
+        std::sort( row.begin(), row.end() );
+
+        MatrixIndexType e = Fill ? rowPointers[ c ] : 0;
+        for( size_t i = 0; i < row.size(); ++i )
+          {
+          if( i > 0 && row[ i ].first == row[ i - 1 ].first )
+            {
+            if( Fill )
+              {
+              Coarse->Matrix.GetValues()[ e - 1 ] += row[ i ].second;
+              }
+            continue;
+            }
+          if( Fill )
+            {
+            Coarse->Matrix.GetColumns()[ e ] = row[ i ].first;
+            Coarse->Matrix.GetValues()[ e ] = row[ i ].second;
+            }
+          ++e;
+          }
+
+        if( !Fill )
+          {
+          rowPointers[ c + 1 ] = e;
+          Coarse->Degrees[ c ] = degree;
+          }
+        }
+      }
+    };
+
+  /** W becomes D^-1/2 W D^-1/2, the inverse of the diagonal of I - N is
+   *  kept, and the weights of Q computed if there is a Coarse level */
+  struct NormalizeFunctor
+    {
+    LevelType*        Level;
+    const LevelType*  Coarse;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      const MatrixIndexType* rowPointers = &Level->Matrix.GetRowPointers()[0];
+      const MatrixIndexType* columns     = &Level->Matrix.GetColumns()[0];
+      RealType*              values      = &Level->Matrix.GetValues()[0];
+      const RealType*        degrees     = &Level->Degrees[0];
+
+      for( SizeValueType u = iBegin; u < iEnd; ++u )
+        {
+        RealType diagonal = 1.;
+        for( MatrixIndexType e = rowPointers[ u ]; e < rowPointers[ u + 1 ]; ++e )
+          {
+          values[ e ] /= std::sqrt( degrees[ u ] * degrees[ columns[ e ] ] );
+          if( columns[ e ] == u )
+            {
+            diagonal -= values[ e ];
+            }
+          }
+        Level->InverseDiagonal[ u ] = 1. / diagonal;
+        if( Coarse )
+          {
+          Level->Weights[ u ] = std::sqrt( degrees[ u ] / Coarse->Degrees[ Level->Aggregates[ u ] ] );
+          }
+        }
+      }
+    };
+
+  /** Coarse vectors, in the D^1/2 scaled basis, interpolated by constants:
+   *  x_f = Q x_c with Q = D_f^1/2 P D_c^-1/2, whose columns are orthonormal
+   *  and for which Q^T ( I - N_f ) Q = I - N_c. Added to the fine vectors
+   *  if Add is set. */
+  struct ProlongFunctor
+    {
+    const LevelType*  Fine;
+    const LevelType*  Coarse;
+    const RealType*   CoarseVectors;
+    RealType*         FineVectors;
+    unsigned int      NumberOfVectors;
+    bool              Add;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      const SizeValueType n = Fine->NumberOfVertices;
+      const SizeValueType nc = Coarse->NumberOfVertices;
+
+      for( SizeValueType u = iBegin; u < iEnd; ++u )
+        {
+        const SizeValueType c = Fine->Aggregates[ u ];
+        const RealType scale = Fine->Weights[ u ];
+        for( unsigned int i = 0; i < NumberOfVectors; ++i )
+          {
+          FineVectors[ i * n + u ] = ( Add ? FineVectors[ i * n + u ] : 0. ) + scale * CoarseVectors[ i * nc + c ];
+          }
+        }
+      }
+    };
+
+  /** Coarse right-hand side Q^T r of the fine residual, held in Product */
+  struct RestrictFunctor
+    {
+    const LevelType*  Fine;
+    LevelType*        Coarse;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      for( SizeValueType c = iBegin; c < iEnd; ++c )
+        {
+        RealType sum = 0.;
+        for( SizeValueType i = Fine->MemberPointers[ c ]; i < Fine->MemberPointers[ c + 1 ]; ++i )
+          {
+          const SizeValueType f = Fine->Members[ i ];
+          sum += Fine->Weights[ f ] * Fine->Product[ f ];
+          }
+        Coarse->Right[ c ] = sum;
+        }
+      }
+    };
+
+  /** Damped Jacobi steps on ( I - N ) e = r, Product holding N e:
+   *  Start sets e = omega r / diag, Smooth adds omega ( r - e + N e ) / diag,
+   *  and Residual replaces Product by r - e + N e. */
+  struct SmoothFunctor
+    {
+    enum StepType { Start, Smooth, Residual };
+
+    LevelType*  Level;
+    StepType    Step;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      const RealType omega = 2. / 3.;
+      const RealType* r = &Level->Right[0];
+      const RealType* d = &Level->InverseDiagonal[0];
+      RealType* e = &Level->Correction[0];
+      RealType* ne = &Level->Product[0];
+
+      for( SizeValueType u = iBegin; u < iEnd; ++u )
+        {
+        switch( Step )
+          {
+          case Start:
+            e[ u ] = omega * r[ u ] * d[ u ];
+            break;
+          case Smooth:
+            e[ u ] += omega * ( r[ u ] - e[ u ] + ne[ u ] ) * d[ u ];
+            break;
+          case Residual:
+            ne[ u ] = r[ u ] - e[ u ] + ne[ u ];
+            break;
+          }
+        }
+      }
+    };
+
+  /** Rows per chunk of the passes over several vectors at once */
+  itkStaticConstMacro( ChunkSize, SizeValueType, 512 );
+
+  /** Partial dot products of the basis vectors [0, NumberOfVectors) with
+   *  the vectors [0, NumberOfColumns) of W, row-major. Rows go by chunks so
+   *  that each vector is read once from memory, and four sums run side by
+   *  side instead of one long chain of additions. */
+  struct DotFunctor
+    {
+    const RealType*           Basis;
+    const RealType*           W;
+    SizeValueType             Size;
+    unsigned int              NumberOfVectors;
+    unsigned int              NumberOfColumns;
+    std::vector< RealType >*  Partials;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType iThreadId )
+      {
+      RealType* partial = &( *Partials )[ iThreadId * NumberOfVectors * NumberOfColumns ];
+      for( SizeValueType begin = iBegin; begin < iEnd; begin += ChunkSize )
+        {
+        const SizeValueType end = ( iEnd - begin > ChunkSize ) ? begin + ChunkSize : iEnd;
+        for( unsigned int i = 0; i < NumberOfVectors; ++i )
+          {
+          const RealType* v = Basis + i * Size;
+          for( unsigned int j = 0; j < NumberOfColumns; ++j )
+            {
+            const RealType* w = W + j * Size;
+            RealType sum[ 4 ] = { 0., 0., 0., 0. };
+            SizeValueType r = begin;
+            for( ; r + 4 <= end; r += 4 )
+              {
+              sum[ 0 ] += v[ r ] * w[ r ];
+              sum[ 1 ] += v[ r + 1 ] * w[ r + 1 ];
+              sum[ 2 ] += v[ r + 2 ] * w[ r + 2 ];
+              sum[ 3 ] += v[ r + 3 ] * w[ r + 3 ];
+              }
+            for( ; r < end; ++r )
+              {
+              sum[ 0 ] += v[ r ] * w[ r ];
+              }
+            partial[ i * NumberOfColumns + j ] += ( sum[ 0 ] + sum[ 1 ] ) + ( sum[ 2 ] + sum[ 3 ] );
+            }
+          }
+        }
+      }
+    };
+
+  /** W_j -= sum_i H_ij V_i for the vectors [0, NumberOfColumns) of W, the
+   *  same combinations of the images being removed from AW when Images is
+   *  set; by chunks of rows, as above. */
+  struct SubtractFunctor
+    {
+    const RealType*           Basis;
+    RealType*                 W;
+    const RealType*           Images;
+    RealType*                 AW;
+    const RealType*           H;
+    SizeValueType             Size;
+    unsigned int              NumberOfVectors;
+    unsigned int              NumberOfColumns;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      for( SizeValueType begin = iBegin; begin < iEnd; begin += ChunkSize )
+        {
+        const SizeValueType end = ( iEnd - begin > ChunkSize ) ? begin + ChunkSize : iEnd;
+        for( unsigned int j = 0; j < NumberOfColumns; ++j )
+          {
+          RealType* w = W + j * Size;
+          RealType* aw = Images ? AW + j * Size : 0;
+          for( unsigned int i = 0; i < NumberOfVectors; ++i )
+            {
+            const RealType h = H[ i * NumberOfColumns + j ];
+            const RealType* v = Basis + i * Size;
+            for( SizeValueType r = begin; r < end; ++r )
+              {
+              w[ r ] -= h * v[ r ];
+              }
+            if( Images )
+              {
+              const RealType* av = Images + i * Size;
+              for( SizeValueType r = begin; r < end; ++r )
+                {
+                aw[ r ] -= h * av[ r ];
+                }
+              }
+            }
+          }
+        }
+      }
+    };
+
+  /** Basis vectors [First, First + NumberOfVectors) replaced, chunk of
+   *  rows by chunk of rows, by the NumberOfOutputs combinations given by
+   *  the columns of S */
+  struct RotateFunctor
+    {
+    RealType*                 Basis;
+    SizeValueType             Size;
+    unsigned int              First;
+    unsigned int              NumberOfVectors;
+    unsigned int              NumberOfOutputs;
+    const RealType*           S;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      std::vector< RealType > rows( NumberOfOutputs * ChunkSize );
+      RealType* basis = Basis + First * Size;
+
+      for( SizeValueType begin = iBegin; begin < iEnd; begin += ChunkSize )
+        {
+        const SizeValueType end = ( iEnd - begin > ChunkSize ) ? begin + ChunkSize : iEnd;
+        const SizeValueType length = end - begin;
+        std::fill( rows.begin(), rows.end(), 0. );
+        for( unsigned int l = 0; l < NumberOfVectors; ++l )
+          {
+          const RealType* v = basis + l * Size + begin;
+          for( unsigned int i = 0; i < NumberOfOutputs; ++i )
+            {
+            const RealType s = S[ l * NumberOfOutputs + i ];
+            RealType* row = &rows[ i * ChunkSize ];
+            for( SizeValueType r = 0; r < length; ++r )
+              {
+              row[ r ] += s * v[ r ];
+              }
+            }
+          }
+        for( unsigned int i = 0; i < NumberOfOutputs; ++i )
+          {
+          std::copy( &rows[ i * ChunkSize ], &rows[ i * ChunkSize ] + length, basis + i * Size + begin );
+          }
+        }
+      }
+    };
+
+  /** R_i = AX_i - Theta_i X_i, and the partial squared norms */
+  struct ResidualFunctor
+    {
+    const RealType*           X;
+    const RealType*           AX;
+    RealType*                 R;
+    const RealType*           Theta;
+    SizeValueType             Size;
+    unsigned int              NumberOfVectors;
+    std::vector< RealType >*  Partials;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType iThreadId )
+      {
+      RealType* partial = &( *Partials )[ iThreadId * NumberOfVectors ];
+      for( unsigned int i = 0; i < NumberOfVectors; ++i )
+        {
+        const SizeValueType o = i * Size;
+        RealType norm = 0.;
+        for( SizeValueType r = iBegin; r < iEnd; ++r )
+          {
+          R[ o + r ] = AX[ o + r ] - Theta[ i ] * X[ o + r ];
+          norm += R[ o + r ] * R[ o + r ];
+          }
+        partial[ i ] += norm;
+        }
+      }
+    };
+
+  /** Nearest center of each point, and per-thread sums of the clusters */
+  struct AssignFunctor
+    {
+    const RealType*               Points;
+    unsigned int                  Dimension;
+    const RealType*               Centers;
+    unsigned int                  NumberOfCenters;
+    unsigned int*                 Assignments;
+    std::vector< RealType >*      Sums;
+    std::vector< SizeValueType >* Changes;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType iThreadId )
+      {
+      const unsigned int d = Dimension;
+      const unsigned int k = NumberOfCenters;
+      RealType* sums = &( *Sums )[ iThreadId * k * ( d + 1 ) ];
+      SizeValueType changes = 0;
+
+      for( SizeValueType u = iBegin; u < iEnd; ++u )
+        {
+        const RealType* p = Points + u * d;
+        unsigned int best = 0;
+        RealType bestDistance = NumericTraits< RealType >::max();
+        for( unsigned int c = 0; c < k; ++c )
+          {
+          RealType distance = 0.;
+          for( unsigned int j = 0; j < d; ++j )
+            {
+            const RealType t = p[ j ] - Centers[ c * d + j ];
+            distance += t * t;
+            }
+          if( distance < bestDistance )
+            {
+            bestDistance = distance;
+            best = c;
+            }
+          }
+        if( Assignments[ u ] != best )
+          {
+          Assignments[ u ] = best;
+          ++changes;
+          }
+        RealType* sum = sums + best * ( d + 1 );
+        for( unsigned int j = 0; j < d; ++j )
+          {
+          sum[ j ] += p[ j ];
+          }
+        sum[ d ] += 1.;
+        }
+      ( *Changes )[ iThreadId ] += changes;
+      }
+    };
+
+  static void SumPartials( const std::vector< RealType >& iPartials,
+                           unsigned int iSize,
+                           std::vector< RealType >& oSum )
+    {
+    oSum.assign( iSize, 0. );
+    for( size_t i = 0; i < iPartials.size(); ++i )
+      {
+      oSum[ i % iSize ] += iPartials[ i ];
+      }
+    }
+
+  /** Working vectors of the eigensolver on one level, of Size rows each:
+   *  slot 0 holds the trivial eigenvector, then come the block X, the
+   *  search directions P and the residuals W; Images holds their products
+   *  by the normalized affinity. */
+  struct SolverType
+    {
+    SizeValueType             Size;
+    ThreadIdType              NumberOfThreads;
+    std::vector< RealType >   Vectors;
+    std::vector< RealType >   Images;
+    std::vector< RealType >   Partials;
+    std::vector< RealType >   Sums;
+
+    RealType* Vector( unsigned int iSlot ) { return &this->Vectors[ iSlot * this->Size ]; }
+    RealType* Image( unsigned int iSlot ) { return &this->Images[ iSlot * this->Size ]; }
+
+    /** Dot products of the slots [iFirst, iFirst + iCount) with the
+     *  iColumns vectors from iW, in Sums, row-major */
+    void Dot( unsigned int iFirst, unsigned int iCount, const RealType* iW, unsigned int iColumns )
+      {
+      DotFunctor dot;
+      dot.Basis           = this->Vector( iFirst );
+      dot.W               = iW;
+      dot.Size            = this->Size;
+      dot.NumberOfVectors = iCount;
+      dot.NumberOfColumns = iColumns;
+      dot.Partials        = &this->Partials;
+
+      this->Partials.assign( this->NumberOfThreads * iCount * iColumns, 0. );
+      RangeThreader< DotFunctor >::Run( this->Size, this->NumberOfThreads, dot );
+      SumPartials( this->Partials, iCount * iColumns, this->Sums );
+      }
+
+    /** Orthonormalizes the slots [iFirst, iFirst + iCount) against all the
+     *  slots before them and among themselves: block classical Gram-Schmidt,
+     *  twice, each time followed by the eigenvectors of the Gram matrix of
+     *  the block, scaled by the original norms (SVQB). Directions left with
+     *  almost nothing are dropped, the others moved down; with iImages, the
+     *  same operations are applied to the images. Returns the number kept. */
+    unsigned int Orthonormalize( unsigned int iFirst, unsigned int iCount, bool iImages )
+      {
+      std::vector< RealType > h, scales( iCount ), gram, values, vectors, rotation;
+      unsigned int kept = iCount;
+
+      for( unsigned int pass = 0; pass < 2 && kept > 0; ++pass )
+        {
+        // the first pass also gives the norms before the projections
+        this->Dot( 0, iFirst + ( pass == 0 ? kept : 0 ), this->Vector( iFirst ), kept );
+        if( pass == 0 )
+          {
+          for( unsigned int j = 0; j < kept; ++j )
+            {
+            const RealType norm = std::sqrt( this->Sums[ ( iFirst + j ) * kept + j ] );
+            scales[ j ] = ( norm > 0. ) ? 1. / norm : 0.;
+            }
+          }
+        else
+          {
+          scales.assign( kept, 1. );
+          }
+        h.assign( this->Sums.begin(), this->Sums.begin() + iFirst * kept );
+
+        SubtractFunctor subtract;
+        subtract.Basis            = this->Vector( 0 );
+        subtract.W                = this->Vector( iFirst );
+        subtract.Images           = iImages ? this->Image( 0 ) : 0;
+        subtract.AW               = iImages ? this->Image( iFirst ) : 0;
+        subtract.H                = &h[0];
+        subtract.Size             = this->Size;
+        subtract.NumberOfVectors  = iFirst;
+        subtract.NumberOfColumns  = kept;
+        RangeThreader< SubtractFunctor >::Run( this->Size, this->NumberOfThreads, subtract );
+
+        this->Dot( iFirst, kept, this->Vector( iFirst ), kept );
+        gram.resize( kept * kept );
+        for( unsigned int i = 0; i < kept; ++i )
+          {
+          for( unsigned int j = 0; j < kept; ++j )
+            {
+            gram[ i * kept + j ] = 0.5 * ( this->Sums[ i * kept + j ] + this->Sums[ j * kept + i ] ) *
+                                   scales[ i ] * scales[ j ];
+            }
+          }
+        SymmetricEigen( gram, kept, values, vectors );
+
+        // on the first pass, drop the directions which were almost entirely
+        // in the span of the previous slots, or of the rest of the block
+        unsigned int outputs = 0;
+        while( outputs < kept && values[ outputs ] > ( pass == 0 ? 1e-12 : 0. ) )
+          {
+          ++outputs;
+          }
+
+        if( outputs > 0 )
+          {
+          rotation.resize( kept * outputs );
+          for( unsigned int l = 0; l < kept; ++l )
+            {
+            for( unsigned int i = 0; i < outputs; ++i )
+              {
+              rotation[ l * outputs + i ] = vectors[ l * kept + i ] * scales[ l ] / std::sqrt( values[ i ] );
+              }
+            }
+
+          RotateFunctor rotate;
+          rotate.Size             = this->Size;
+          rotate.First            = iFirst;
+          rotate.NumberOfVectors  = kept;
+          rotate.NumberOfOutputs  = outputs;
+          rotate.S                = &rotation[0];
+
+          rotate.Basis = &this->Vectors[0];
+          RangeThreader< RotateFunctor >::Run( this->Size, this->NumberOfThreads, rotate );
+          if( iImages )
+            {
+            rotate.Basis = &this->Images[0];
+            RangeThreader< RotateFunctor >::Run( this->Size, this->NumberOfThreads, rotate );
+            }
+          }
+        kept = outputs;
+        }
+      return kept;
+      }
+    };
+
+  /** Eigen-decomposition of the symmetric n x n matrix ioA by cyclic Jacobi
+   *  rotations: eigenvalues in decreasing order, eigenvectors as columns. */
+  static void SymmetricEigen( std::vector< RealType >& ioA, unsigned int n,
+                              std::vector< RealType >& oValues,
+                              std::vector< RealType >& oVectors )
+    {
+    std::vector< RealType > v( n * n, 0. );
+    for( unsigned int i = 0; i < n; ++i )
+      {
+      v[ i * n + i ] = 1.;
+      }
+
+    for( unsigned int sweep = 0; sweep < 100; ++sweep )
+      {
+      RealType off = 0., total = 0.;
+      for( unsigned int i = 0; i < n; ++i )
+        {
+        for( unsigned int j = 0; j < n; ++j )
+          {
+          total += ioA[ i * n + j ] * ioA[ i * n + j ];
+          if( i != j )
+            {
+            off += ioA[ i * n + j ] * ioA[ i * n + j ];
+            }
+          }
+        }
+      if( off <= 1e-30 * total )
+        {
+        break;
+        }
+
+      for( unsigned int p = 0; p + 1 < n; ++p )
+        {
+        for( unsigned int q = p + 1; q < n; ++q )
+          {
+          const RealType apq = ioA[ p * n + q ];
+          if( apq == 0. )
+            {
+            continue;
+            }
+          const RealType theta = ( ioA[ q * n + q ] - ioA[ p * n + p ] ) / ( 2. * apq );
+          const RealType t = ( theta >= 0. ? 1. : -1. ) / ( std::abs( theta ) + std::sqrt( theta * theta + 1. ) );
+          const RealType c = 1. / std::sqrt( t * t + 1. );
+          const RealType s = t * c;
+
+          for( unsigned int k = 0; k < n; ++k )
+            {
+            const RealType akp = ioA[ k * n + p ];
+            const RealType akq = ioA[ k * n + q ];
+            ioA[ k * n + p ] = c * akp - s * akq;
+            ioA[ k * n + q ] = s * akp + c * akq;
+            }
+          for( unsigned int k = 0; k < n; ++k )
+            {
+            const RealType apk = ioA[ p * n + k ];
+            const RealType aqk = ioA[ q * n + k ];
+            ioA[ p * n + k ] = c * apk - s * aqk;
+            ioA[ q * n + k ] = s * apk + c * aqk;
+            }
+          for( unsigned int k = 0; k < n; ++k )
+            {
+            const RealType vkp = v[ k * n + p ];
+            const RealType vkq = v[ k * n + q ];
+            v[ k * n + p ] = c * vkp - s * vkq;
+            v[ k * n + q ] = s * vkp + c * vkq;
+            }
+          }
+        }
+      }
+
+    // decreasing order
+    std::vector< std::pair< RealType, unsigned int > > order( n );
+    for( unsigned int i = 0; i < n; ++i )
+      {
+      order[ i ] = std::make_pair( -ioA[ i * n + i ], i );
+      }
+    std::sort( order.begin(), order.end() );
+
+    oValues.resize( n );
+    oVectors.resize( n * n );
+    for( unsigned int i = 0; i < n; ++i )
+      {
+      oValues[ i ] = -order[ i ].first;
+      for( unsigned int k = 0; k < n; ++k )
+        {
+        oVectors[ k * n + i ] = v[ k * n + order[ i ].second ];
+        }
+      }
+    }
+
+  void GenerateData()
+    {
+    const InputImageType* input = this->GetInput();
+    LabelImageType*       output = this->GetOutput();
+
+    output->SetBufferedRegion( output->GetRequestedRegion() );
+    output->Allocate();
+
+    const InputImageRegionType region = output->GetBufferedRegion();
+    const SizeValueType n = region.GetNumberOfPixels();
+
+    // Non-trivial eigenvectors wanted, and vectors iterated with them
+    const SizeValueType available = ( n > 1 ) ? n - 1 : 0;
+    const unsigned int numberOfEigenvectors = static_cast< unsigned int >(
+      std::min( static_cast< SizeValueType >( std::max( this->m_NumberOfClusters, 1u ) - 1 ), available ) );
+    unsigned int blockSize = ( this->m_BlockSize > 0 ) ? this->m_BlockSize : numberOfEigenvectors + 1;
+    blockSize = static_cast< unsigned int >(
+      std::min( static_cast< SizeValueType >( std::max( blockSize, numberOfEigenvectors ) ), available ) );
+
+    this->m_Eigenvalues.assign( 1, 0. );
+    this->m_NumberOfLevels = 0;
+    this->m_NumberOfIterations = 0;
+
+    if( numberOfEigenvectors == 0 )
+      {
+      output->FillBuffer( NumericTraits< LabelPixelType >::One );
+      return;
+      }
+
+    const ThreadIdType numberOfThreads = this->GetNumberOfThreads();
+
+    // Hierarchy of graphs, coarsened while large compared to the block
+    // of vectors and while the matching still halves them, roughly.
+    std::vector< LevelType > levels( 1 );
+    levels.reserve( 64 );
+    levels[0].NumberOfVertices = n;
+
+    this->AssembleAffinity( input, region, levels[0], numberOfThreads );
+
+    while( levels.back().NumberOfVertices > std::max( 256u, 16 * blockSize ) )
+      {
+      levels.push_back( LevelType() );
+      LevelType& fine = levels[ levels.size() - 2 ];
+      this->Coarsen( fine, levels.back(), numberOfThreads );
+      if( 3 * levels.back().NumberOfVertices > 2 * fine.NumberOfVertices )
+        {
+        fine.Aggregates.clear();
+        levels.pop_back();
+        break;
+        }
+      }
+    this->m_NumberOfLevels = static_cast< unsigned int >( levels.size() );
+
+    for( size_t l = 0; l < levels.size(); ++l )
+      {
+      LevelType& level = levels[ l ];
+      level.InverseDiagonal.resize( level.NumberOfVertices );
+      level.Weights.resize( l + 1 < levels.size() ? level.NumberOfVertices : 0 );
+      level.Right.resize( level.NumberOfVertices );
+      level.Correction.resize( level.NumberOfVertices );
+      level.Product.resize( level.NumberOfVertices );
+
+      NormalizeFunctor normalize;
+      normalize.Level = &level;
+      normalize.Coarse = ( l + 1 < levels.size() ) ? &levels[ l + 1 ] : 0;
+      RangeThreader< NormalizeFunctor >::Run( level.NumberOfVertices, numberOfThreads, normalize );
+      }
+    this->Factorize( levels.back() );
+
+    // From the coarsest graph to the input one
+    std::vector< RealType > x, theta;
+    for( size_t l = levels.size(); l-- > 0; )
+      {
+      std::vector< RealType > start( blockSize * levels[ l ].NumberOfVertices );
+      if( l + 1 == levels.size() )
+        {
+        unsigned int state = 12345;
+        for( size_t i = 0; i < start.size(); ++i )
+          {
+          state = state * 1664525u + 1013904223u;
+          start[ i ] = static_cast< RealType >( state >> 8 ) / 16777216. - 0.5;
+          }
+        }
+      else
+        {
+        ProlongFunctor prolong;
+        prolong.Fine            = &levels[ l ];
+        prolong.Coarse          = &levels[ l + 1 ];
+        prolong.CoarseVectors   = &x[0];
+        prolong.FineVectors     = &start[0];
+        prolong.NumberOfVectors = blockSize;
+        prolong.Add             = false;
+        RangeThreader< ProlongFunctor >::Run( levels[ l ].NumberOfVertices, numberOfThreads, prolong );
+        }
+      x.swap( start );
+
+      // the coarsest solution is the one all the others are built upon
+      const RealType tolerance = ( l + 1 == levels.size() ) ? 0.01 * this->m_Tolerance : this->m_Tolerance;
+      this->m_NumberOfIterations = this->Solve( levels, l, blockSize, numberOfEigenvectors,
+                                                tolerance, x, theta, numberOfThreads );
+
+      this->UpdateProgress( static_cast< float >( levels.size() - l ) / static_cast< float >( levels.size() ) );
+      }
+
+    for( unsigned int i = 0; i < numberOfEigenvectors; ++i )
+      {
+      this->m_Eigenvalues.push_back( 1. - theta[ i ] );
+      }
+
+    // Generalized eigenvectors D^-1/2 v, interleaved
+    std::vector< RealType > embedding( n * numberOfEigenvectors );
+    for( SizeValueType u = 0; u < n; ++u )
+      {
+      const RealType scale = 1. / std::sqrt( levels[0].Degrees[ u ] );
+      for( unsigned int i = 0; i < numberOfEigenvectors; ++i )
+        {
+        embedding[ u * numberOfEigenvectors + i ] = x[ i * n + u ] * scale;
+        }
+      }
+
+    this->Discretize( embedding, numberOfEigenvectors, output->GetBufferPointer(), numberOfThreads );
+    }
+
+  void AssembleAffinity( const InputImageType* iInput, const InputImageRegionType& iRegion,
+                         LevelType& oLevel, ThreadIdType iNumberOfThreads )
+    {
+    AffinityType a;
+    a.Image   = iInput;
+    a.Metric  = &this->m_Metric;
+    a.Region  = iRegion;
+    a.Beta    = this->m_Beta;
+    a.Level   = &oLevel;
+
+    // Symmetric stencil
+    StencilType::GenerateOffsets( this->m_OffsetList, a.Offsets, true );
+    InitializeMetric( this->m_Metric, iInput, a.Offsets );
+
+    a.Ordering.Initialize( a.Region );
+    a.Stencil.Initialize( a.Region, a.Offsets );
+
+    const SizeValueType n = oLevel.NumberOfVertices;
+
+    oLevel.Matrix.SetSize( n, n );
+    a.MaximumMetric.assign( iNumberOfThreads, 0. );
+
+    CountFunctor count;
+    count.Affinity = &a;
+    RangeThreader< CountFunctor >::Run( n, iNumberOfThreads, count );
+
+    a.MaximumMetric[ 0 ] = *std::max_element( a.MaximumMetric.begin(), a.MaximumMetric.end() );
+
+    typename MatrixType::IndexContainerType& rowPointers = oLevel.Matrix.GetRowPointers();
+    for( SizeValueType r = 0; r < n; ++r )
+      {
+      rowPointers[ r + 1 ] += rowPointers[ r ];
+      }
+    oLevel.Matrix.AllocateEntries();
+    oLevel.Degrees.resize( n );
+
+    FillFunctor fill;
+    fill.Affinity = &a;
+    RangeThreader< FillFunctor >::Run( n, iNumberOfThreads, fill );
+    }
+
+  /** Aggregates ioFine by a greedy heavy-edge matching: each vertex not
+   *  matched yet is paired, in raster order, with the free neighbor of
+   *  largest w( u, v ) ( 1 / d_u + 1 / d_v ), if that edge is at least half
+   *  as strong as its strongest one. Weak edges are thus never contracted
+   *  and the cuts between regions survive coarsening (as in Graclus,
+   *  Dhillon et al., 2007). */
+  void Coarsen( LevelType& ioFine, LevelType& oCoarse, ThreadIdType iNumberOfThreads )
+    {
+    const SizeValueType n = ioFine.NumberOfVertices;
+    const MatrixIndexType* rowPointers = &ioFine.Matrix.GetRowPointers()[0];
+    const MatrixIndexType* columns     = &ioFine.Matrix.GetColumns()[0];
+    const RealType*        values      = &ioFine.Matrix.GetValues()[0];
+    const RealType*        degrees     = &ioFine.Degrees[0];
+
+    const SizeValueType unmatched = NumericTraits< SizeValueType >::max();
+    ioFine.Aggregates.assign( n, unmatched );
+
+    SizeValueType nc = 0;
+    for( SizeValueType u = 0; u < n; ++u )
+      {
+      if( ioFine.Aggregates[ u ] != unmatched )
+        {
+        continue;
+        }
+      SizeValueType best = u;
+      RealType bestWeight = 0.;
+      RealType strongest = 0.;
+      for( MatrixIndexType e = rowPointers[ u ]; e < rowPointers[ u + 1 ]; ++e )
+        {
+        const SizeValueType v = columns[ e ];
+        if( v != u )
+          {
+          const RealType w = values[ e ] * ( 1. / degrees[ u ] + 1. / degrees[ v ] );
+          strongest = std::max( strongest, w );
+          if( w > bestWeight && ioFine.Aggregates[ v ] == unmatched )
+            {
+            bestWeight = w;
+            best = v;
+            }
+          }
+        }
+      if( bestWeight < 0.5 * strongest )
+        {
+        best = u;
+        }
+      ioFine.Aggregates[ u ] = ioFine.Aggregates[ best ] = nc++;
+      }
+
+    ioFine.MemberPointers.assign( nc + 1, 0 );
+    for( SizeValueType u = 0; u < n; ++u )
+      {
+      ++ioFine.MemberPointers[ ioFine.Aggregates[ u ] + 1 ];
+      }
+    for( SizeValueType c = 0; c < nc; ++c )
+      {
+      ioFine.MemberPointers[ c + 1 ] += ioFine.MemberPointers[ c ];
+      }
+    ioFine.Members.resize( n );
+    std::vector< SizeValueType > next( ioFine.MemberPointers.begin(), ioFine.MemberPointers.end() - 1 );
+    for( SizeValueType u = 0; u < n; ++u )
+      {
+      ioFine.Members[ next[ ioFine.Aggregates[ u ] ]++ ] = u;
+      }
+
+    oCoarse.NumberOfVertices = nc;
+    oCoarse.Matrix.SetSize( nc, nc );
+    oCoarse.Degrees.resize( nc );
+
+    CoarsenFunctor coarsen;
+    coarsen.Fine    = &ioFine;
+    coarsen.Coarse  = &oCoarse;
+    coarsen.Fill    = false;
+    RangeThreader< CoarsenFunctor >::Run( nc, iNumberOfThreads, coarsen );
+
+    typename MatrixType::IndexContainerType& coarseRows = oCoarse.Matrix.GetRowPointers();
+    for( SizeValueType r = 0; r < nc; ++r )
+      {
+      coarseRows[ r + 1 ] += coarseRows[ r ];
+      }
+    oCoarse.Matrix.AllocateEntries();
+
+    coarsen.Fill = true;
+    RangeThreader< CoarsenFunctor >::Run( nc, iNumberOfThreads, coarsen );
+    }
+
+  /** Dense Cholesky factor of I - N + q q^T on a coarsest graph small
+   *  enough; larger ones are only smoothed. */
+  void Factorize( LevelType& ioLevel )
+    {
+    const SizeValueType n = ioLevel.NumberOfVertices;
+    if( n > 2048 )
+      {
+      return;
+      }
+
+    RealType total = 0.;
+    for( SizeValueType u = 0; u < n; ++u )
+      {
+      total += ioLevel.Degrees[ u ];
+      }
+
+    std::vector< RealType >& a = ioLevel.Factor;
+    a.resize( n * n );
+    for( SizeValueType i = 0; i < n; ++i )
+      {
+      for( SizeValueType j = 0; j < n; ++j )
+        {
+        a[ i * n + j ] = std::sqrt( ioLevel.Degrees[ i ] * ioLevel.Degrees[ j ] ) / total;
+        }
+      a[ i * n + i ] += 1.;
+      for( MatrixIndexType e = ioLevel.Matrix.GetRowPointers()[ i ]; e < ioLevel.Matrix.GetRowPointers()[ i + 1 ]; ++e )
+        {
+        a[ i * n + ioLevel.Matrix.GetColumns()[ e ] ] -= ioLevel.Matrix.GetValues()[ e ];
+        }
+      }
+
+    for( SizeValueType j = 0; j < n; ++j )
+      {
+      RealType pivot = a[ j * n + j ];
+      for( SizeValueType k = 0; k < j; ++k )
+        {
+        pivot -= a[ j * n + k ] * a[ j * n + k ];
+        }
+      a[ j * n + j ] = std::sqrt( std::max( pivot, 1e-14 ) );
+      for( SizeValueType i = j + 1; i < n; ++i )
+        {
+        RealType sum = a[ i * n + j ];
+        for( SizeValueType k = 0; k < j; ++k )
+          {
+          sum -= a[ i * n + k ] * a[ j * n + k ];
+          }
+        a[ i * n + j ] = sum / a[ j * n + j ];
+        }
+      }
+    }
+
+  /** Correction = T Right for level l, T approximating the inverse of the
+   *  normalized Laplacian: a V-cycle with one damped Jacobi step before and
+   *  after the coarse correction, and the dense solve on the coarsest
+   *  graph. T is symmetric positive definite, as LOBPCG requires. */
+  void Precondition( std::vector< LevelType >& ioLevels, size_t l, ThreadIdType iNumberOfThreads )
+    {
+    LevelType& level = ioLevels[ l ];
+    const SizeValueType n = level.NumberOfVertices;
+
+    if( l + 1 == ioLevels.size() && !level.Factor.empty() )
+      {
+      const RealType* a = &level.Factor[0];
+      RealType* e = &level.Correction[0];
+      for( SizeValueType i = 0; i < n; ++i )
+        {
+        RealType sum = level.Right[ i ];
+        for( SizeValueType k = 0; k < i; ++k )
+          {
+          sum -= a[ i * n + k ] * e[ k ];
+          }
+        e[ i ] = sum / a[ i * n + i ];
+        }
+      for( SizeValueType i = n; i-- > 0; )
+        {
+        RealType sum = e[ i ];
+        for( SizeValueType k = i + 1; k < n; ++k )
+          {
+          sum -= a[ k * n + i ] * e[ k ];
+          }
+        e[ i ] = sum / a[ i * n + i ];
+        }
+      return;
+      }
+
+    SmoothFunctor smooth;
+    smooth.Level = &level;
+    smooth.Step = SmoothFunctor::Start;
+    RangeThreader< SmoothFunctor >::Run( n, iNumberOfThreads, smooth );
+
+    if( l + 1 == ioLevels.size() )
+      {
+      return;
+      }
+
+    LevelType& coarse = ioLevels[ l + 1 ];
+
+    level.Matrix.Multiply( &level.Correction[0], &level.Product[0], 1, iNumberOfThreads );
+    smooth.Step = SmoothFunctor::Residual;
+    RangeThreader< SmoothFunctor >::Run( n, iNumberOfThreads, smooth );
+
+    RestrictFunctor restriction;
+    restriction.Fine   = &level;
+    restriction.Coarse = &coarse;
+    RangeThreader< RestrictFunctor >::Run( coarse.NumberOfVertices, iNumberOfThreads, restriction );
+
+    this->Precondition( ioLevels, l + 1, iNumberOfThreads );
+
+    ProlongFunctor prolong;
+    prolong.Fine            = &level;
+    prolong.Coarse          = &coarse;
+    prolong.CoarseVectors   = &coarse.Correction[0];
+    prolong.FineVectors     = &level.Correction[0];
+    prolong.NumberOfVectors = 1;
+    prolong.Add             = true;
+    RangeThreader< ProlongFunctor >::Run( n, iNumberOfThreads, prolong );
+
+    level.Matrix.Multiply( &level.Correction[0], &level.Product[0], 1, iNumberOfThreads );
+    smooth.Step = SmoothFunctor::Smooth;
+    RangeThreader< SmoothFunctor >::Run( n, iNumberOfThreads, smooth );
+    }
+
+  /** LOBPCG for the iBlockSize largest eigenvalues but the trivial one of
+   *  the normalized affinity of level l, from the vectors in ioX; stops when
+   *  the residuals of the iNumberOfWanted first are below iTolerance.
+   *  Returns the iterations. */
+  unsigned int Solve( std::vector< LevelType >& ioLevels, size_t l,
+                      unsigned int iBlockSize, unsigned int iNumberOfWanted,
+                      RealType iTolerance, std::vector< RealType >& ioX, std::vector< RealType >& oTheta,
+                      ThreadIdType iNumberOfThreads )
+    {
+    LevelType& level = ioLevels[ l ];
+    const SizeValueType n = level.NumberOfVertices;
+    const unsigned int  p = iBlockSize;
+
+    SolverType s;
+    s.Size = n;
+    s.NumberOfThreads = iNumberOfThreads;
+    s.Vectors.resize( ( 1 + 3 * p ) * n );
+    s.Images.resize( ( 1 + 3 * p ) * n );
+
+    RealType norm = 0.;
+    for( SizeValueType u = 0; u < n; ++u )
+      {
+      norm += level.Degrees[ u ];
+      }
+    norm = std::sqrt( norm );
+    for( SizeValueType u = 0; u < n; ++u )
+      {
+      s.Vector( 0 )[ u ] = s.Image( 0 )[ u ] = std::sqrt( level.Degrees[ u ] ) / norm;
+      }
+
+    std::copy( ioX.begin(), ioX.end(), s.Vector( 1 ) );
+    unsigned int x = s.Orthonormalize( 1, p, false );
+    unsigned int state = 54321;
+    while( x < p )
+      {
+      for( SizeValueType u = 0; u < n; ++u )
+        {
+        state = state * 1664525u + 1013904223u;
+        s.Vector( 1 + x )[ u ] = static_cast< RealType >( state >> 8 ) / 16777216. - 0.5;
+        }
+      x += s.Orthonormalize( 1 + x, 1, false );
+      }
+    for( unsigned int i = 0; i < p; ++i )
+      {
+      level.Matrix.Multiply( s.Vector( 1 + i ), s.Image( 1 + i ), 1, iNumberOfThreads );
+      }
+
+    std::vector< RealType > gram, values, vectors, rotation, residuals;
+    unsigned int numberOfDirections = 0;
+    unsigned int numberOfResiduals = 0;
+    unsigned int iteration = 0;
+
+    while( true )
+      {
+      if( this->GetAbortGenerateData() )
+        {
+        ProcessAborted e( __FILE__, __LINE__ );
+        e.SetDescription( "Process aborted." );
+        throw e;
+        }
+
+      // Rayleigh-Ritz on the orthonormal [ X, P, W ]
+      const unsigned int m = p + numberOfDirections + numberOfResiduals;
+      gram.resize( m * m );
+      s.Dot( 1, m, s.Image( 1 ), m );
+      for( unsigned int i = 0; i < m; ++i )
+        {
+        for( unsigned int j = 0; j < m; ++j )
+          {
+          gram[ i * m + j ] = 0.5 * ( s.Sums[ i * m + j ] + s.Sums[ j * m + i ] );
+          }
+        }
+      SymmetricEigen( gram, m, values, vectors );
+
+      // New X, and new directions P: their part outside of the old X
+      const unsigned int outputs = ( m > p ) ? 2 * p : p;
+      rotation.assign( m * outputs, 0. );
+      for( unsigned int l = 0; l < m; ++l )
+        {
+        for( unsigned int i = 0; i < p; ++i )
+          {
+          rotation[ l * outputs + i ] = vectors[ l * m + i ];
+          if( outputs > p && l >= p )
+            {
+            rotation[ l * outputs + p + i ] = vectors[ l * m + i ];
+            }
+          }
+        }
+
+      RotateFunctor rotate;
+      rotate.Size             = n;
+      rotate.First            = 1;
+      rotate.NumberOfVectors  = m;
+      rotate.NumberOfOutputs  = outputs;
+      rotate.S                = &rotation[0];
+
+      rotate.Basis = &s.Vectors[0];
+      RangeThreader< RotateFunctor >::Run( n, iNumberOfThreads, rotate );
+      rotate.Basis = &s.Images[0];
+      RangeThreader< RotateFunctor >::Run( n, iNumberOfThreads, rotate );
+
+      oTheta.assign( values.begin(), values.begin() + p );
+
+      // Residuals, in the last p slots
+      ResidualFunctor residual;
+      residual.X                = s.Vector( 1 );
+      residual.AX               = s.Image( 1 );
+      residual.R                = s.Vector( 1 + 2 * p );
+      residual.Theta            = &oTheta[0];
+      residual.Size             = n;
+      residual.NumberOfVectors  = p;
+      residual.Partials         = &s.Partials;
+
+      s.Partials.assign( iNumberOfThreads * p, 0. );
+      RangeThreader< ResidualFunctor >::Run( n, iNumberOfThreads, residual );
+      SumPartials( s.Partials, p, residuals );
+
+      ++iteration;
+
+      bool converged = true;
+      for( unsigned int i = 0; i < iNumberOfWanted; ++i )
+        {
+        converged = converged && ( std::sqrt( residuals[ i ] ) <= iTolerance );
+        }
+      if( converged || iteration >= this->m_MaximumNumberOfIterations )
+        {
+        break;
+        }
+
+      numberOfDirections = ( outputs > p ) ? s.Orthonormalize( 1 + p, p, true ) : 0;
+
+      // Preconditioned residuals, but for the vectors already converged
+      const unsigned int first = 1 + p + numberOfDirections;
+      unsigned int active = 0;
+      for( unsigned int i = 0; i < p; ++i )
+        {
+        if( std::sqrt( residuals[ i ] ) > iTolerance )
+          {
+          std::copy( s.Vector( 1 + 2 * p + i ), s.Vector( 2 + 2 * p + i ), level.Right.begin() );
+          this->Precondition( ioLevels, l, iNumberOfThreads );
+          std::copy( level.Correction.begin(), level.Correction.end(), s.Vector( first + active ) );
+          ++active;
+          }
+        }
+      numberOfResiduals = s.Orthonormalize( first, active, false );
+      for( unsigned int i = 0; i < numberOfResiduals; ++i )
+        {
+        level.Matrix.Multiply( s.Vector( first + i ), s.Image( first + i ), 1, iNumberOfThreads );
+        }
+      }
+
+    std::copy( s.Vector( 1 ), s.Vector( 1 + p ), ioX.begin() );
+    return iteration;
+    }
+
+  /** k-means of the embedded pixels, from farthest-point centers. */
+  void Discretize( const std::vector< RealType >& iEmbedding, unsigned int iDimension,
+                   LabelPixelType* oLabels, ThreadIdType iNumberOfThreads )
+    {
+    const unsigned int  d = iDimension;
+    const SizeValueType n = iEmbedding.size() / d;
+    const unsigned int  k = this->m_NumberOfClusters;
+
+    std::vector< unsigned int > assignments( n, 0 );
+    std::vector< RealType >     centers( k * d );
+
+    // first center: the point farthest from the mean, then the point
+    // farthest from the centers already chosen
+    std::vector< RealType > mean( d, 0. );
+    for( SizeValueType u = 0; u < n; ++u )
+      {
+      for( unsigned int j = 0; j < d; ++j )
+        {
+        mean[ j ] += iEmbedding[ u * d + j ] / n;
+        }
+      }
+    std::vector< RealType > nearest( n, NumericTraits< RealType >::max() );
+    const RealType* reference = &mean[0];
+    for( unsigned int c = 0; c < k; ++c )
+      {
+      SizeValueType farthest = 0;
+      RealType farthestDistance = -1.;
+      for( SizeValueType u = 0; u < n; ++u )
+        {
+        RealType distance = 0.;
+        for( unsigned int j = 0; j < d; ++j )
+          {
+          const RealType t = iEmbedding[ u * d + j ] - reference[ j ];
+          distance += t * t;
+          }
+        if( c > 0 )
+          {
+          nearest[ u ] = std::min( nearest[ u ], distance );
+          distance = nearest[ u ];
+          }
+        if( distance > farthestDistance )
+          {
+          farthestDistance = distance;
+          farthest = u;
+          }
+        }
+      std::copy( iEmbedding.begin() + farthest * d, iEmbedding.begin() + ( farthest + 1 ) * d,
+                 centers.begin() + c * d );
+      reference = &centers[ c * d ];
+      }
+
+    std::vector< RealType > sums, totals;
+    std::vector< SizeValueType > changes;
+
+    AssignFunctor assign;
+    assign.Points           = &iEmbedding[0];
+    assign.Dimension        = d;
+    assign.Centers          = &centers[0];
+    assign.NumberOfCenters  = k;
+    assign.Assignments      = &assignments[0];
+    assign.Sums             = &sums;
+    assign.Changes          = &changes;
+
+    for( unsigned int iteration = 0; iteration < 100; ++iteration )
+      {
+      sums.assign( iNumberOfThreads * k * ( d + 1 ), 0. );
+      changes.assign( iNumberOfThreads, 0 );
+      RangeThreader< AssignFunctor >::Run( n, iNumberOfThreads, assign );
+
+      SumPartials( sums, k * ( d + 1 ), totals );
+      for( unsigned int c = 0; c < k; ++c )
+        {
+        const RealType count = totals[ c * ( d + 1 ) + d ];
+        if( count > 0. )
+          {
+          for( unsigned int j = 0; j < d; ++j )
+            {
+            centers[ c * d + j ] = totals[ c * ( d + 1 ) + j ] / count;
+            }
+          }
+        }
+
+      SizeValueType changed = 0;
+      for( size_t i = 0; i < changes.size(); ++i )
+        {
+        changed += changes[ i ];
+        }
+      if( iteration > 0 && changed == 0 )
+        {
+        break;
+        }
+      }
+
+    // labels from 1, in the order of the first pixel of each cluster
+    std::vector< LabelPixelType > labels( k, NumericTraits< LabelPixelType >::Zero );
+    LabelPixelType next = NumericTraits< LabelPixelType >::Zero;
+    for( SizeValueType u = 0; u < n; ++u )
+      {
+      if( labels[ assignments[ u ] ] == NumericTraits< LabelPixelType >::Zero )
+        {
+        labels[ assignments[ u ] ] = ++next;
+        }
+      oLabels[ u ] = labels[ assignments[ u ] ];
+      }
+    }
+
+  void PrintSelf( std::ostream& os, Indent indent ) const
+    {
+    Superclass::PrintSelf( os, indent );
+    os << indent << "Beta: " << this->m_Beta << std::endl;
+    os << indent << "NumberOfClusters: " << this->m_NumberOfClusters << std::endl;
+    os << indent << "Tolerance: " << this->m_Tolerance << std::endl;
+    os << indent << "BlockSize: " << this->m_BlockSize << std::endl;
+    os << indent << "MaximumNumberOfIterations: " << this->m_MaximumNumberOfIterations << std::endl;
+    os << indent << "NumberOfLevels: " << this->m_NumberOfLevels << std::endl;
+    os << indent << "NumberOfIterations: " << this->m_NumberOfIterations << std::endl;
+    }
+
+private:
+  NormalizedCutImageFilter( const Self& );
+  void operator = ( const Self& );
+};
+
+}
+
+#endif
@@ -0,0 +1,698 @@
+#ifndef __itkParallelGraphTraversal_h
+#define __itkParallelGraphTraversal_h
+
+#include <algorithm>
+#include <vector>
+
+#include "itkImageRegion.h"
+#include "itkNumericTraits.h"
+#include "itkCompressedSparseRowMatrix.h"
+#include "itkImageVertexOrdering.h"
+#include "itkImageStencil.h"
+#include "itkRangeThreader.h"
+#include "itkInitializeMetric.h"
+
+namespace itk
+{
+/** \class WeightThresholdPredicate
+ *  \brief Keeps the edges whose weight is at most the threshold.
+ */
+template< class TWeight >
+class WeightThresholdPredicate
+  {
+public:
+  typedef TWeight WeightType;
+
+  WeightThresholdPredicate() : m_Threshold( NumericTraits< WeightType >::max() ) {}
+  WeightThresholdPredicate( const WeightType& iThreshold ) : m_Threshold( iThreshold ) {}
+
+  void SetThreshold( const WeightType& iThreshold ) { this->m_Threshold = iThreshold; }
+  const WeightType& GetThreshold() const { return this->m_Threshold; }
+
+  bool operator()( const WeightType& iWeight ) const
+    {
+    return iWeight <= this->m_Threshold;
+    }
+
+private:
+  WeightType m_Threshold;
+  };
+
+/** \class ImageGraphNeighborhood
+ *  \brief Neighbors in the pixel graph of a region and a stencil, without
+ *  building it.
+ *
+ *  Vertices are the pixels of the region in raster order; the stencil is
+ *  symmetrized, and the edges whose metric value fails the predicate are
+ *  skipped; the predicate takes a WeightType. The metric is evaluated from
+ *  both ends of an edge, so it should be symmetric (IndexMetric,
+ *  PhysicalDistanceMetric).
+ */
+template< class TImage, class TMetric, class TPredicate >
+class ImageGraphNeighborhood
+  {
+public:
+  typedef ImageGraphNeighborhood                Self;
+  typedef TImage                                ImageType;
+  typedef TMetric                               MetricType;
+  typedef TPredicate                            PredicateType;
+
+  itkStaticConstMacro( ImageDimension, unsigned int, TImage::ImageDimension );
+
+  typedef typename ImageType::RegionType        RegionType;
+  typedef typename ImageType::IndexType         IndexType;
+  typedef typename ImageType::OffsetType        OffsetType;
+  typedef SizeValueType                         VertexType;
+
+  typedef ImageVertexOrdering< itkGetStaticConstMacro( ImageDimension ) > VertexOrderingType;
+  typedef ImageStencil< itkGetStaticConstMacro( ImageDimension ) >        StencilType;
+
+  ImageGraphNeighborhood() : m_Image( 0 ) {}
+
+  template< class TOffsetContainer >
+  void Initialize( const ImageType* iImage,
+                   const RegionType& iRegion,
+                   const TOffsetContainer& iOffsets,
+                   const MetricType& iMetric,
+                   const PredicateType& iPredicate )
+    {
+    this->m_Image = iImage;
+    this->m_Region = iRegion;
+    this->m_Metric = iMetric;
+    this->m_Predicate = iPredicate;
+
+    std::vector< OffsetType > offsets;
+    StencilType::GenerateOffsets( iOffsets, offsets, true );
+
+    InitializeMetric( this->m_Metric, iImage, offsets );
+    this->m_Ordering.Initialize( iRegion );
+    this->m_Stencil.Initialize( this->m_Ordering, offsets );
+    }
+
+  VertexType GetNumberOfVertices() const
+    {
+    return this->m_Region.GetNumberOfPixels();
+    }
+
+  const VertexOrderingType& GetVertexOrdering() const
+    {
+    return this->m_Ordering;
+    }
+
+  /** Calls iVisitor( v ) for each neighbor v of iU, until it returns true. */
+  template< class TVisitor >
+  bool VisitNeighbors( VertexType iU, TVisitor& iVisitor ) const
+    {
+    const IndexType index = this->m_Ordering.ComputeIndex( static_cast< OffsetValueType >( iU ) );
+    const bool interior = this->m_Stencil.IsInterior( index );
+
+    for( unsigned int k = 0; k < this->m_Stencil.GetNumberOfOffsets(); ++k )
+      {
+      if( interior || this->m_Stencil.IsInside( index, k ) )
+        {
+        const IndexType neighIndex = index + this->m_Stencil.GetOffset( k );
+        if( this->m_Predicate( EvaluateMetric< typename PredicateType::WeightType >(
+                                 this->m_Metric, this->m_Image, index, neighIndex, k ) ) &&
+            iVisitor( static_cast< VertexType >( iU + this->m_Stencil.GetDelta( k ) ) ) )
+          {
+          return true;
+          }
+        }
+      }
+    return false;
+    }
+
+private:
+  const ImageType*                m_Image;
+  RegionType                      m_Region;
+  VertexOrderingType              m_Ordering;
+  StencilType                     m_Stencil;
+  MetricType                      m_Metric;
+  PredicateType                   m_Predicate;
+  };
+
+/** \class CompressedSparseRowNeighborhood
+ *  \brief Neighbors in a graph exported as a CompressedSparseRowMatrix,
+ *  e.g. by ImageBoostGraphAdaptor::ExportCSR(), whose edges are kept when
+ *  their weight passes the predicate.
+ *
+ *  Breadth-first search reads the rows as in-edges as well, so the matrix
+ *  should be symmetric, as it is for undirected graphs.
+ */
+template< class TValue, class TPredicate = WeightThresholdPredicate< TValue > >
+class CompressedSparseRowNeighborhood
+  {
+public:
+  typedef CompressedSparseRowMatrix< TValue > MatrixType;
+  typedef TPredicate                          PredicateType;
+  typedef SizeValueType                       VertexType;
+
+  CompressedSparseRowNeighborhood() : m_Matrix( 0 ) {}
+
+  CompressedSparseRowNeighborhood( const MatrixType* iMatrix, const PredicateType& iPredicate ) :
+    m_Matrix( iMatrix ),
+    m_Predicate( iPredicate )
+    {}
+
+  VertexType GetNumberOfVertices() const
+    {
+    return this->m_Matrix->GetNumberOfRows();
+    }
+
+  template< class TVisitor >
+  bool VisitNeighbors( VertexType iU, TVisitor& iVisitor ) const
+    {
+    const typename MatrixType::IndexType* rowPointers = &this->m_Matrix->GetRowPointers()[0];
+    const typename MatrixType::IndexType* columns = this->m_Matrix->GetColumns().empty() ? 0 : &this->m_Matrix->GetColumns()[0];
+    const TValue* values = this->m_Matrix->GetValues().empty() ? 0 : &this->m_Matrix->GetValues()[0];
+
+    for( typename MatrixType::IndexType e = rowPointers[ iU ]; e < rowPointers[ iU + 1 ]; ++e )
+      {
+      if( this->m_Predicate( values[ e ] ) && iVisitor( static_cast< VertexType >( columns[ e ] ) ) )
+        {
+        return true;
+        }
+      }
+    return false;
+    }
+
+private:
+  const MatrixType* m_Matrix;
+  PredicateType     m_Predicate;
+  };
+
+/** \class ParallelGraphTraversal
+ *  \brief Parallel connected components and breadth-first search over a
+ *  neighborhood (ImageGraphNeighborhood, CompressedSparseRowNeighborhood).
+ *
+ *  Vertices are split into one contiguous chunk per thread.
+ *
+ *  Connected components run a union-find with path halving on the edges
+ *  within each chunk in parallel, then on the edges between chunks, which
+ *  are few on a grid. The root of a component is its smallest vertex, so
+ *  components are labelled 1, 2, ... in the order of their first vertex,
+ *  whatever the number of threads.
+ *
+ *  Breadth-first search is direction-optimizing (Beamer et al., 2012):
+ *  top-down steps expand the frontier list, each thread handing the newly
+ *  reached vertices to the thread owning them, which keeps the first
+ *  visit; bottom-up steps let each unvisited vertex look for a neighbor in
+ *  the frontier bitmap, and stop at the first one. The search goes bottom-up
+ *  when the frontier is more than 1 / Alpha of the unvisited vertices, and
+ *  back top-down when it is less than 1 / Beta of all of them. Neither kind
+ *  of step needs atomic operations.
+ */
+template< class TNeighborhood >
+class ParallelGraphTraversal
+  {
+public:
+  typedef TNeighborhood                           NeighborhoodType;
+  typedef SizeValueType                           VertexType;
+  typedef std::vector< VertexType >               VertexContainerType;
+
+  ParallelGraphTraversal() :
+    m_NumberOfThreads( 1 ),
+    m_Alpha( 14. ),
+    m_Beta( 24. ),
+    m_NumberOfComponents( 0 ),
+    m_NumberOfLevels( 0 ),
+    m_NumberOfBottomUpLevels( 0 )
+    {}
+
+  void SetNumberOfThreads( ThreadIdType iNumberOfThreads ) { this->m_NumberOfThreads = iNumberOfThreads; }
+  ThreadIdType GetNumberOfThreads() const { return this->m_NumberOfThreads; }
+
+  void SetAlpha( double iAlpha ) { this->m_Alpha = iAlpha; }
+  double GetAlpha() const { return this->m_Alpha; }
+
+  void SetBeta( double iBeta ) { this->m_Beta = iBeta; }
+  double GetBeta() const { return this->m_Beta; }
+
+  SizeValueType GetNumberOfComponents() const { return this->m_NumberOfComponents; }
+  SizeValueType GetNumberOfLevels() const { return this->m_NumberOfLevels; }
+  SizeValueType GetNumberOfBottomUpLevels() const { return this->m_NumberOfBottomUpLevels; }
+
+  /** Writes the component label, from 1, of each vertex in oLabels. */
+  template< class TLabel >
+  SizeValueType ComputeConnectedComponents( const NeighborhoodType& iNeighborhood, TLabel* oLabels )
+    {
+    const VertexType n = iNeighborhood.GetNumberOfVertices();
+    const VertexType numberOfChunks = this->GetNumberOfChunks( n );
+
+    VertexContainerType parents( n );
+    VertexContainerType roots( n );
+    std::vector< std::vector< std::pair< VertexType, VertexType > > > crossEdges( numberOfChunks );
+
+    LinkFunctor link;
+    link.Neighborhood = &iNeighborhood;
+    link.Parents = parents.empty() ? 0 : &parents[0];
+    link.CrossEdges = &crossEdges;
+    link.NumberOfVertices = n;
+    link.NumberOfChunks = numberOfChunks;
+    RangeThreader< LinkFunctor >::Run( numberOfChunks, this->m_NumberOfThreads, link );
+
+    for( VertexType c = 0; c < numberOfChunks; ++c )
+      {
+      for( size_t e = 0; e < crossEdges[ c ].size(); ++e )
+        {
+        Union( link.Parents, crossEdges[ c ][ e ].first, crossEdges[ c ][ e ].second );
+        }
+      }
+
+    // Roots, then consecutive component numbers from per-chunk root counts
+    LabelFunctor< TLabel > label;
+    label.Parents = link.Parents;
+    label.Roots = roots.empty() ? 0 : &roots[0];
+    label.Labels = oLabels;
+    label.NumberOfVertices = n;
+    label.NumberOfChunks = numberOfChunks;
+    label.Counts.assign( numberOfChunks + 1, 0 );
+    label.Pass = 0;
+    RangeThreader< LabelFunctor< TLabel > >::Run( numberOfChunks, this->m_NumberOfThreads, label );
+
+    for( VertexType c = 0; c < numberOfChunks; ++c )
+      {
+      label.Counts[ c + 1 ] += label.Counts[ c ];
+      }
+    this->m_NumberOfComponents = label.Counts[ numberOfChunks ];
+
+    if( static_cast< double >( this->m_NumberOfComponents ) >
+        static_cast< double >( NumericTraits< TLabel >::max() ) )
+      {
+      itkGenericExceptionMacro( << this->m_NumberOfComponents << " components do not fit in the label type" );
+      }
+
+    label.Pass = 1;
+    RangeThreader< LabelFunctor< TLabel > >::Run( numberOfChunks, this->m_NumberOfThreads, label );
+    label.Pass = 2;
+    RangeThreader< LabelFunctor< TLabel > >::Run( numberOfChunks, this->m_NumberOfThreads, label );
+
+    return this->m_NumberOfComponents;
+    }
+
+  /** Writes the number of hops from the nearest seed of each vertex in
+   *  oDistances, the maximum of TDistance for unreachable vertices. */
+  template< class TDistance >
+  SizeValueType ComputeBreadthFirstDistances( const NeighborhoodType& iNeighborhood,
+                                              const VertexContainerType& iSeeds,
+                                              TDistance* oDistances )
+    {
+    const VertexType n = iNeighborhood.GetNumberOfVertices();
+    const VertexType numberOfChunks = this->GetNumberOfChunks( n );
+    const TDistance unreached = NumericTraits< TDistance >::max();
+
+    std::fill( oDistances, oDistances + n, unreached );
+
+    VertexContainerType frontier;
+    for( size_t s = 0; s < iSeeds.size(); ++s )
+      {
+      if( oDistances[ iSeeds[ s ] ] == unreached )
+        {
+        oDistances[ iSeeds[ s ] ] = NumericTraits< TDistance >::Zero;
+        frontier.push_back( iSeeds[ s ] );
+        }
+      }
+
+    std::vector< unsigned char > inFrontier;
+    std::vector< unsigned char > inNext;
+
+    StepFunctor< TDistance > step;
+    step.Neighborhood = &iNeighborhood;
+    step.Distances = oDistances;
+    step.NumberOfVertices = n;
+    step.NumberOfChunks = numberOfChunks;
+    step.Buckets.resize( numberOfChunks, std::vector< VertexContainerType >( numberOfChunks ) );
+    step.Next.resize( numberOfChunks );
+    step.Counts.resize( numberOfChunks );
+
+    VertexType frontierSize = frontier.size();
+    VertexType unvisited = n - frontierSize;
+    bool bottomUp = false;
+    TDistance level = NumericTraits< TDistance >::Zero;
+
+    this->m_NumberOfLevels = 0;
+    this->m_NumberOfBottomUpLevels = 0;
+
+    while( frontierSize > 0 )
+      {
+      ++this->m_NumberOfLevels;
+      if( level == unreached - 1 )
+        {
+        break;
+        }
+
+      if( !bottomUp && frontierSize * this->m_Alpha > unvisited )
+        {
+        bottomUp = true;
+        inFrontier.assign( n, 0 );
+        inNext.resize( n );
+        for( size_t i = 0; i < frontier.size(); ++i )
+          {
+          inFrontier[ frontier[ i ] ] = 1;
+          }
+        }
+      else if( bottomUp && frontierSize * this->m_Beta < n )
+        {
+        bottomUp = false;
+        frontier.clear();
+        for( VertexType c = 0; c < numberOfChunks; ++c )
+          {
+          frontier.insert( frontier.end(), step.Next[ c ].begin(), step.Next[ c ].end() );
+          }
+        }
+
+      step.Level = level;
+      VertexType reached = 0;
+
+      if( bottomUp )
+        {
+        ++this->m_NumberOfBottomUpLevels;
+
+        step.InFrontier = &inFrontier[0];
+        step.InNext = &inNext[0];
+        step.Pass = BottomUpPass;
+        RangeThreader< StepFunctor< TDistance > >::Run( numberOfChunks, this->m_NumberOfThreads, step );
+
+        for( VertexType c = 0; c < numberOfChunks; ++c )
+          {
+          reached += step.Counts[ c ];
+          }
+        inFrontier.swap( inNext );
+        }
+      else
+        {
+        step.Frontier = &frontier;
+        step.Pass = TopDownPass;
+        RangeThreader< StepFunctor< TDistance > >::Run( numberOfChunks, this->m_NumberOfThreads, step );
+        step.Pass = AssignPass;
+        RangeThreader< StepFunctor< TDistance > >::Run( numberOfChunks, this->m_NumberOfThreads, step );
+
+        frontier.clear();
+        for( VertexType c = 0; c < numberOfChunks; ++c )
+          {
+          frontier.insert( frontier.end(), step.Next[ c ].begin(), step.Next[ c ].end() );
+          }
+        reached = frontier.size();
+        }
+
+      frontierSize = reached;
+      unvisited -= reached;
+      ++level;
+      }
+
+    return this->m_NumberOfLevels;
+    }
+
+protected:
+  ThreadIdType  m_NumberOfThreads;
+  double        m_Alpha;
+  double        m_Beta;
+  SizeValueType m_NumberOfComponents;
+  SizeValueType m_NumberOfLevels;
+  SizeValueType m_NumberOfBottomUpLevels;
+
+  VertexType GetNumberOfChunks( VertexType iNumberOfVertices ) const
+    {
+    return std::max( std::min( static_cast< VertexType >( this->m_NumberOfThreads ), iNumberOfVertices ),
+                     static_cast< VertexType >( 1 ) );
+    }
+
+  static VertexType ChunkBegin( VertexType iChunk, VertexType iNumberOfVertices, VertexType iNumberOfChunks )
+    {
+    return iChunk * iNumberOfVertices / iNumberOfChunks;
+    }
+
+  /** Chunk whose range [ ChunkBegin( c ), ChunkBegin( c + 1 ) ) holds iV. */
+  static VertexType ChunkOf( VertexType iV, VertexType iNumberOfVertices, VertexType iNumberOfChunks )
+    {
+    return ( ( iV + 1 ) * iNumberOfChunks - 1 ) / iNumberOfVertices;
+    }
+
+  static VertexType Find( VertexType* ioParents, VertexType iV )
+    {
+    while( ioParents[ iV ] != iV )
+      {
+      ioParents[ iV ] = ioParents[ ioParents[ iV ] ];
+      iV = ioParents[ iV ];
+      }
+    return iV;
+    }
+
+  /** The smallest root stays a root. */
+  static void Union( VertexType* ioParents, VertexType iU, VertexType iV )
+    {
+    const VertexType ru = Find( ioParents, iU );
+    const VertexType rv = Find( ioParents, iV );
+    if( ru < rv )
+      {
+      ioParents[ rv ] = ru;
+      }
+    else if( rv < ru )
+      {
+      ioParents[ ru ] = rv;
+      }
+    }
+
+  /** Union of the edges within each chunk; the other ones are kept. */
+  struct LinkFunctor
+    {
+    const NeighborhoodType*                                               Neighborhood;
+    VertexType*                                                           Parents;
+    std::vector< std::vector< std::pair< VertexType, VertexType > > >*    CrossEdges;
+    VertexType                                                            NumberOfVertices;
+    VertexType                                                            NumberOfChunks;
+
+    struct Visitor
+      {
+      VertexType*                                       Parents;
+      VertexType                                        Begin;
+      VertexType                                        End;
+      VertexType                                        U;
+      std::vector< std::pair< VertexType, VertexType > >* CrossEdges;
+
+      bool operator()( VertexType iV )
+        {
+        if( iV >= this->Begin && iV < this->End )
+          {
+          Union( this->Parents, this->U, iV );
+          }
+        else
+          {
+          this->CrossEdges->push_back( std::make_pair( this->U, iV ) );
+          }
+        return false;
+        }
+      };
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      for( SizeValueType c = iBegin; c < iEnd; ++c )
+        {
+        Visitor visitor;
+        visitor.Parents = Parents;
+        visitor.Begin = ChunkBegin( c, NumberOfVertices, NumberOfChunks );
+        visitor.End = ChunkBegin( c + 1, NumberOfVertices, NumberOfChunks );
+        visitor.CrossEdges = &( *CrossEdges )[ c ];
+
+        for( VertexType u = visitor.Begin; u < visitor.End; ++u )
+          {
+          Parents[ u ] = u;
+          }
+        for( VertexType u = visitor.Begin; u < visitor.End; ++u )
+          {
+          visitor.U = u;
+          Neighborhood->VisitNeighbors( u, visitor );
+          }
+        }
+      }
+    };
+
+  /** Pass 0: roots, without compression, and root counts; pass 1: component
+   *  numbers of the roots; pass 2: labels. */
+  template< class TLabel >
+  struct LabelFunctor
+    {
+    VertexType*                 Parents;
+    VertexType*                 Roots;
+    TLabel*                     Labels;
+    VertexType                  NumberOfVertices;
+    VertexType                  NumberOfChunks;
+    std::vector< VertexType >   Counts;
+    int                         Pass;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      for( SizeValueType c = iBegin; c < iEnd; ++c )
+        {
+        const VertexType begin = ChunkBegin( c, NumberOfVertices, NumberOfChunks );
+        const VertexType end = ChunkBegin( c + 1, NumberOfVertices, NumberOfChunks );
+
+        if( Pass == 0 )
+          {
+          VertexType count = 0;
+          for( VertexType u = begin; u < end; ++u )
+            {
+            VertexType r = u;
+            while( Parents[ r ] != r )
+              {
+              r = Parents[ r ];
+              }
+            Roots[ u ] = r;
+            if( r == u )
+              {
+              ++count;
+              }
+            }
+          Counts[ c + 1 ] = count;
+          }
+        else if( Pass == 1 )
+          {
+          // parents are not read anymore: they hold the component numbers
+          VertexType next = Counts[ c ];
+          for( VertexType u = begin; u < end; ++u )
+            {
+            if( Roots[ u ] == u )
+              {
+              Parents[ u ] = ++next;
+              }
+            }
+          }
+        else
+          {
+          for( VertexType u = begin; u < end; ++u )
+            {
+            Labels[ u ] = static_cast< TLabel >( Parents[ Roots[ u ] ] );
+            }
+          }
+        }
+      }
+    };
+
+  typedef enum
+    {
+    TopDownPass,
+    AssignPass,
+    BottomUpPass
+    } PassType;
+
+  template< class TDistance >
+  struct StepFunctor
+    {
+    const NeighborhoodType*                       Neighborhood;
+    TDistance*                                    Distances;
+    VertexType                                    NumberOfVertices;
+    VertexType                                    NumberOfChunks;
+    TDistance                                     Level;
+    PassType                                      Pass;
+
+    // top-down: Buckets[ c ][ o ] holds the vertices reached from chunk c
+    // of the frontier and owned by chunk o
+    const VertexContainerType*                    Frontier;
+    std::vector< std::vector< VertexContainerType > > Buckets;
+
+    // bottom-up
+    const unsigned char*                          InFrontier;
+    unsigned char*                                InNext;
+
+    std::vector< VertexContainerType >            Next;
+    std::vector< VertexType >                     Counts;
+
+    struct TopDownVisitor
+      {
+      const TDistance*                    Distances;
+      std::vector< VertexContainerType >* Buckets;
+      VertexType                          NumberOfVertices;
+      VertexType                          NumberOfChunks;
+
+      bool operator()( VertexType iV )
+        {
+        if( this->Distances[ iV ] == NumericTraits< TDistance >::max() )
+          {
+          ( *this->Buckets )[ ChunkOf( iV, this->NumberOfVertices, this->NumberOfChunks ) ].push_back( iV );
+          }
+        return false;
+        }
+      };
+
+    struct BottomUpVisitor
+      {
+      const unsigned char* InFrontier;
+
+      bool operator()( VertexType iV ) const
+        {
+        return this->InFrontier[ iV ] != 0;
+        }
+      };
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      const TDistance unreached = NumericTraits< TDistance >::max();
+
+      for( SizeValueType c = iBegin; c < iEnd; ++c )
+        {
+        if( Pass == TopDownPass )
+          {
+          const VertexType size = Frontier->size();
+          const VertexType begin = ChunkBegin( c, size, NumberOfChunks );
+          const VertexType end = ChunkBegin( c + 1, size, NumberOfChunks );
+
+          TopDownVisitor visitor;
+          visitor.Distances = Distances;
+          visitor.Buckets = &Buckets[ c ];
+          visitor.NumberOfVertices = NumberOfVertices;
+          visitor.NumberOfChunks = NumberOfChunks;
+
+          for( VertexType i = begin; i < end; ++i )
+            {
+            Neighborhood->VisitNeighbors( ( *Frontier )[ i ], visitor );
+            }
+          }
+        else if( Pass == AssignPass )
+          {
+          Next[ c ].clear();
+          for( VertexType from = 0; from < NumberOfChunks; ++from )
+            {
+            VertexContainerType& bucket = Buckets[ from ][ c ];
+            for( size_t i = 0; i < bucket.size(); ++i )
+              {
+              if( Distances[ bucket[ i ] ] == unreached )
+                {
+                Distances[ bucket[ i ] ] = Level + 1;
+                Next[ c ].push_back( bucket[ i ] );
+                }
+              }
+            bucket.clear();
+            }
+          }
+        else
+          {
+          const VertexType begin = ChunkBegin( c, NumberOfVertices, NumberOfChunks );
+          const VertexType end = ChunkBegin( c + 1, NumberOfVertices, NumberOfChunks );
+
+          BottomUpVisitor visitor;
+          visitor.InFrontier = InFrontier;
+
+          // the list of reached vertices is kept for a switch to top-down
+          Next[ c ].clear();
+          VertexType count = 0;
+          for( VertexType v = begin; v < end; ++v )
+            {
+            InNext[ v ] = 0;
+            if( Distances[ v ] == unreached && Neighborhood->VisitNeighbors( v, visitor ) )
+              {
+              Distances[ v ] = Level + 1;
+              InNext[ v ] = 1;
+              Next[ c ].push_back( v );
+              ++count;
+              }
+            }
+          Counts[ c ] = count;
+          }
+        }
+      }
+    };
+  };
+
+}
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef __itkPatchGraphArena_h
+#define __itkPatchGraphArena_h
+
+#include <vector>
+
+#include "itkIntTypes.h"
+
+namespace itk
+{
+/** \class PatchGraphArena
+ *  \brief The graphs of many image patches, as CSR blocks in shared arrays.
+ *
+ *  Patch p owns the vertices [ m_VertexStarts[ p ], m_VertexStarts[ p + 1 ] )
+ *  of the arena and the values [ m_EdgeStarts[ p ], m_EdgeStarts[ p + 1 ] ).
+ *  Its rows and columns are those of its topology m_TopologyIds[ p ], which
+ *  patches with the same structure (e.g. the unmasked patches of a size)
+ *  share: topology t holds the row pointers and columns of
+ *  [ m_TopologyVertexStarts[ t ], m_TopologyVertexStarts[ t + 1 ] ) and
+ *  [ m_TopologyEdgeStarts[ t ], m_TopologyEdgeStarts[ t + 1 ] ). The block
+ *  of a patch is a complete CSR matrix on its own: GetNumberOfVertices( p ) + 1
+ *  row pointers starting from 0 and columns numbered within the patch, so
+ *  that the pointers returned for one patch can be handed to any CSR code.
+ *  The containers are exposed so that the blocks can be filled in place, in
+ *  parallel, once the starts are known; they keep their capacity from one
+ *  batch to the next.
+ */
+template< class TValue >
+class PatchGraphArena
+  {
+public:
+  typedef TValue                          ValueType;
+  typedef SizeValueType                   IndexType;
+  typedef std::vector< IndexType >        IndexContainerType;
+  typedef std::vector< ValueType >        ValueContainerType;
+
+  PatchGraphArena() :
+    m_VertexStarts( 1, 0 ), m_EdgeStarts( 1, 0 ),
+    m_TopologyVertexStarts( 1, 0 ), m_TopologyEdgeStarts( 1, 0 ) {}
+
+  IndexType GetNumberOfPatches() const
+    {
+    return this->m_VertexStarts.size() - 1;
+    }
+
+  IndexType GetNumberOfTopologies() const
+    {
+    return this->m_TopologyVertexStarts.size() - 1;
+    }
+
+  IndexType GetNumberOfVertices( IndexType iPatch ) const
+    {
+    return this->m_VertexStarts[ iPatch + 1 ] - this->m_VertexStarts[ iPatch ];
+    }
+
+  IndexType GetNumberOfEntries( IndexType iPatch ) const
+    {
+    return this->m_EdgeStarts[ iPatch + 1 ] - this->m_EdgeStarts[ iPatch ];
+    }
+
+  IndexType GetTopologyId( IndexType iPatch ) const
+    {
+    return this->m_TopologyIds[ iPatch ];
+    }
+
+  /** Row pointers of the block of iPatch, one per vertex and one more. */
+  const IndexType* GetRowPointers( IndexType iPatch ) const
+    {
+    const IndexType t = this->m_TopologyIds[ iPatch ];
+    return &this->m_RowPointers[ this->m_TopologyVertexStarts[ t ] + t ];
+    }
+
+  const IndexType* GetColumns( IndexType iPatch ) const
+    {
+    return this->m_Columns.empty() ? 0 :
+      &this->m_Columns[0] + this->m_TopologyEdgeStarts[ this->m_TopologyIds[ iPatch ] ];
+    }
+
+  const ValueType* GetValues( IndexType iPatch ) const
+    {
+    return this->m_Values.empty() ? 0 : &this->m_Values[0] + this->m_EdgeStarts[ iPatch ];
+    }
+
+  /** Size the arena for iNumberOfPatches patches sharing iNumberOfTopologies
+   *  topologies. The vertex and entry counts of the patches are then written
+   *  to the starts, from index 1, and the topology of each patch to the
+   *  topology ids; patches of a topology must have its counts. */
+  void SetNumberOfPatches( IndexType iNumberOfPatches, IndexType iNumberOfTopologies )
+    {
+    this->m_VertexStarts.assign( iNumberOfPatches + 1, 0 );
+    this->m_EdgeStarts.assign( iNumberOfPatches + 1, 0 );
+    this->m_TopologyIds.assign( iNumberOfPatches, 0 );
+    this->m_TopologyVertexStarts.assign( iNumberOfTopologies + 1, 0 );
+    this->m_TopologyEdgeStarts.assign( iNumberOfTopologies + 1, 0 );
+    }
+
+  /** Turn the counts into starts and allocate the blocks: the values of
+   *  every patch, and the rows and columns of every topology. */
+  void AllocateBlocks()
+    {
+    for( size_t p = 0; p < this->m_TopologyIds.size(); ++p )
+      {
+      const IndexType t = this->m_TopologyIds[ p ];
+      this->m_TopologyVertexStarts[ t + 1 ] = this->m_VertexStarts[ p + 1 ];
+      this->m_TopologyEdgeStarts[ t + 1 ] = this->m_EdgeStarts[ p + 1 ];
+      }
+    for( size_t p = 1; p < this->m_VertexStarts.size(); ++p )
+      {
+      this->m_VertexStarts[ p ] += this->m_VertexStarts[ p - 1 ];
+      this->m_EdgeStarts[ p ] += this->m_EdgeStarts[ p - 1 ];
+      }
+    for( size_t t = 1; t < this->m_TopologyVertexStarts.size(); ++t )
+      {
+      this->m_TopologyVertexStarts[ t ] += this->m_TopologyVertexStarts[ t - 1 ];
+      this->m_TopologyEdgeStarts[ t ] += this->m_TopologyEdgeStarts[ t - 1 ];
+      }
+    this->m_RowPointers.resize( this->m_TopologyVertexStarts.back() + this->GetNumberOfTopologies() );
+    this->m_Columns.resize( this->m_TopologyEdgeStarts.back() );
+    this->m_Values.resize( this->m_EdgeStarts.back() );
+    }
+
+  IndexContainerType& GetVertexStarts() { return this->m_VertexStarts; }
+  const IndexContainerType& GetVertexStarts() const { return this->m_VertexStarts; }
+
+  IndexContainerType& GetEdgeStarts() { return this->m_EdgeStarts; }
+  const IndexContainerType& GetEdgeStarts() const { return this->m_EdgeStarts; }
+
+  IndexContainerType& GetTopologyIds() { return this->m_TopologyIds; }
+  const IndexContainerType& GetTopologyIds() const { return this->m_TopologyIds; }
+
+  IndexContainerType& GetTopologyVertexStarts() { return this->m_TopologyVertexStarts; }
+  const IndexContainerType& GetTopologyVertexStarts() const { return this->m_TopologyVertexStarts; }
+
+  IndexContainerType& GetTopologyEdgeStarts() { return this->m_TopologyEdgeStarts; }
+  const IndexContainerType& GetTopologyEdgeStarts() const { return this->m_TopologyEdgeStarts; }
+
+  /** Row pointers of the topologies, topology t starting at
+   *  m_TopologyVertexStarts[ t ] + t. */
+  IndexContainerType& GetRowPointers() { return this->m_RowPointers; }
+  const IndexContainerType& GetRowPointers() const { return this->m_RowPointers; }
+
+  IndexContainerType& GetColumns() { return this->m_Columns; }
+  const IndexContainerType& GetColumns() const { return this->m_Columns; }
+
+  ValueContainerType& GetValues() { return this->m_Values; }
+  const ValueContainerType& GetValues() const { return this->m_Values; }
+
+protected:
+  IndexContainerType  m_VertexStarts;
+  IndexContainerType  m_EdgeStarts;
+  IndexContainerType  m_TopologyIds;
+  IndexContainerType  m_TopologyVertexStarts;
+  IndexContainerType  m_TopologyEdgeStarts;
+  IndexContainerType  m_RowPointers;
+  IndexContainerType  m_Columns;
+  ValueContainerType  m_Values;
+};
+
+}
+
+#endif
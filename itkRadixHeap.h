@@ -0,0 +1,187 @@
+#ifndef __itkRadixHeap_h
+#define __itkRadixHeap_h
+
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include "itkIntTypes.h"
+#include "itkNumericTraits.h"
+
+namespace itk
+{
+/** \class RadixHeap
+ *  \brief Monotone priority queue for non-negative integer keys.
+ *
+ *  Valid as long as no key smaller than the last popped one is pushed, which
+ *  is the case in Dijkstra's algorithm with non-negative weights. Element
+ *  with key k is in bucket b = bit width of ( k xor last ), so that bucket 0
+ *  holds the keys equal to the last popped one, and a pop only scans the
+ *  first non-empty bucket and spreads it over lower ones: each element moves
+ *  at most 64 times, independently of the number of elements.
+ */
+template< class TValue >
+class RadixHeap
+  {
+public:
+  typedef uint64_t                          KeyType;
+  typedef TValue                            ValueType;
+  typedef std::pair< KeyType, ValueType >   ElementType;
+
+  RadixHeap() : m_Last( 0 ), m_Size( 0 ) {}
+
+  bool IsEmpty() const
+    {
+    return this->m_Size == 0;
+    }
+
+  SizeValueType GetSize() const
+    {
+    return this->m_Size;
+    }
+
+  void Clear()
+    {
+    for( unsigned int b = 0; b < NumberOfBuckets; ++b )
+      {
+      this->m_Buckets[ b ].clear();
+      }
+    this->m_Last = 0;
+    this->m_Size = 0;
+    }
+
+  void Push( KeyType iKey, const ValueType& iValue )
+    {
+    this->m_Buckets[ BucketIndex( iKey ^ this->m_Last ) ].push_back( ElementType( iKey, iValue ) );
+    ++this->m_Size;
+    }
+
+  /** Remove an element of smallest key. The queue must not be empty. */
+  void Pop( KeyType& oKey, ValueType& oValue )
+    {
+    if( this->m_Buckets[ 0 ].empty() )
+      {
+      unsigned int b = 1;
+      while( this->m_Buckets[ b ].empty() )
+        {
+        ++b;
+        }
+
+      std::vector< ElementType >& bucket = this->m_Buckets[ b ];
+
+      KeyType minimum = bucket[ 0 ].first;
+      for( size_t i = 1; i < bucket.size(); ++i )
+        {
+        if( bucket[ i ].first < minimum )
+          {
+          minimum = bucket[ i ].first;
+          }
+        }
+
+      this->m_Last = minimum;
+      for( size_t i = 0; i < bucket.size(); ++i )
+        {
+        this->m_Buckets[ BucketIndex( bucket[ i ].first ^ minimum ) ].push_back( bucket[ i ] );
+        }
+      bucket.clear();
+      }
+
+    oKey   = this->m_Buckets[ 0 ].back().first;
+    oValue = this->m_Buckets[ 0 ].back().second;
+    this->m_Buckets[ 0 ].pop_back();
+    --this->m_Size;
+    }
+
+protected:
+  itkStaticConstMacro( NumberOfBuckets, unsigned int, 65 );
+
+  KeyType                     m_Last;
+  SizeValueType               m_Size;
+  std::vector< ElementType >  m_Buckets[ 65 ];
+
+  static unsigned int BucketIndex( KeyType iX )
+    {
+#if defined( __GNUC__ )
+    return iX == 0 ? 0 : 64 - __builtin_clzll( iX );
+#else
+    unsigned int width = 0;
+    while( iX != 0 )
+      {
+      iX >>= 1;
+      ++width;
+      }
+    return width;
+#endif
+    }
+};
+
+/** \class MonotonePriorityQueue
+ *  \brief Min-priority queue for Dijkstra-like propagations: a RadixHeap for
+ *  integer distances, a binary heap otherwise. */
+template< class TKey, class TValue,
+          bool VIntegerKey = NumericTraits< TKey >::is_integer >
+class MonotonePriorityQueue
+  {
+public:
+  typedef TKey    KeyType;
+  typedef TValue  ValueType;
+
+  bool IsEmpty() const
+    {
+    return this->m_Heap.empty();
+    }
+
+  void Push( const KeyType& iKey, const ValueType& iValue )
+    {
+    this->m_Heap.push( ElementType( iKey, iValue ) );
+    }
+
+  void Pop( KeyType& oKey, ValueType& oValue )
+    {
+    oKey   = this->m_Heap.top().first;
+    oValue = this->m_Heap.top().second;
+    this->m_Heap.pop();
+    }
+
+protected:
+  typedef std::pair< KeyType, ValueType > ElementType;
+
+  std::priority_queue< ElementType,
+                       std::vector< ElementType >,
+                       std::greater< ElementType > > m_Heap;
+};
+
+template< class TKey, class TValue >
+class MonotonePriorityQueue< TKey, TValue, true >
+  {
+public:
+  typedef TKey    KeyType;
+  typedef TValue  ValueType;
+
+  bool IsEmpty() const
+    {
+    return this->m_Heap.IsEmpty();
+    }
+
+  /** iKey must be non-negative. */
+  void Push( const KeyType& iKey, const ValueType& iValue )
+    {
+    this->m_Heap.Push( static_cast< typename HeapType::KeyType >( iKey ), iValue );
+    }
+
+  void Pop( KeyType& oKey, ValueType& oValue )
+    {
+    typename HeapType::KeyType key;
+    this->m_Heap.Pop( key, oValue );
+    oKey = static_cast< KeyType >( key );
+    }
+
+protected:
+  typedef RadixHeap< TValue > HeapType;
+
+  HeapType m_Heap;
+};
+
+}
+
+#endif
@@ -0,0 +1,619 @@
+#ifndef __itkRandomWalkerImageFilter_h
+#define __itkRandomWalkerImageFilter_h
+
+#include <cmath>
+#include <map>
+#include <vector>
+
+#include "itkImageGraphToImageFilter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkNumericTraits.h"
+#include "itkImageBoostGraphAdaptor.h"
+#include "itkImageStencil.h"
+#include "itkCompressedSparseRowMatrix.h"
+#include "itkRangeThreader.h"
+
+namespace itk
+{
+/** \class RandomWalkerImageFilter
+ *  \brief Random walker segmentation (Grady, 2006) over the pixel graph.
+ *
+ *  Edge weights are w = exp( -beta * m / mMax ) + epsilon, where m is the
+ *  metric evaluated on the edge and mMax its largest value over the image.
+ *  The Laplacian restricted to the unseeded pixels is assembled in CSR form
+ *  directly from the stencil, without any boost graph, in two threaded
+ *  passes (row lengths, then entries).
+ *
+ *  With K labels, the K - 1 systems L_U X = B share the matrix and the
+ *  Jacobi preconditioner and are solved together by a multithreaded
+ *  conjugate gradient, one sparse product per iteration for all of them;
+ *  the probabilities of the last label are deduced. Each pixel gets the
+ *  label with the highest probability. Without a multigrid preconditioner
+ *  the iteration count grows with the image size: thousands of iterations
+ *  for a megapixel image.
+ *
+ *  Seeds are the non-zero pixels of the seed image (input 1). The stencil is
+ *  made symmetric: the opposite of every offset is added if missing. A
+ *  pixel with no neighbor in the region through the stencil is isolated:
+ *  its row of L_U is zero, it is left out of the solve and labeled 0.
+ */
+template< class TInputImage,
+          class TLabelImage = Image< unsigned char, TInputImage::ImageDimension >,
+          class TMetric = IndexMetric< TInputImage, double > >
+class RandomWalkerImageFilter :
+  public ImageGraphToImageFilter< TInputImage, TLabelImage, TMetric >
+  {
+public:
+  typedef RandomWalkerImageFilter                                       Self;
+  typedef ImageGraphToImageFilter< TInputImage, TLabelImage, TMetric >  Superclass;
+  typedef SmartPointer< Self >                                          Pointer;
+  typedef SmartPointer< const Self >                                    ConstPointer;
+
+  /** Method for creation through object factory */
+  itkNewMacro( Self );
+
+  itkTypeMacro( RandomWalkerImageFilter, ImageGraphToImageFilter );
+
+  itkStaticConstMacro( ImageDimension, unsigned int, TInputImage::ImageDimension );
+
+  typedef TInputImage                               InputImageType;
+  typedef typename InputImageType::RegionType       InputImageRegionType;
+  typedef typename InputImageType::IndexType        InputIndexType;
+  typedef typename InputImageType::OffsetType       InputOffsetType;
+  typedef typename Superclass::OffsetContainerType  OffsetContainerType;
+  typedef typename InputImageType::OffsetValueType  OffsetValueType;
+  typedef ImageVertexOrdering< ImageDimension >     VertexOrderingType;
+  typedef ImageStencil< ImageDimension >            StencilType;
+
+  typedef TLabelImage                               LabelImageType;
+  typedef typename LabelImageType::PixelType        LabelPixelType;
+
+  typedef TMetric MetricType;
+
+  typedef double                                    RealType;
+  typedef CompressedSparseRowMatrix< RealType >     MatrixType;
+  typedef typename MatrixType::IndexType            MatrixIndexType;
+
+  void SetSeedImage( const LabelImageType* iSeeds )
+    {
+    this->ProcessObject::SetNthInput( 1, const_cast< LabelImageType* >( iSeeds ) );
+    }
+
+  const LabelImageType* GetSeedImage() const
+    {
+    return static_cast< const LabelImageType* >( this->ProcessObject::GetInput( 1 ) );
+    }
+
+  itkSetMacro( Beta, RealType );
+  itkGetConstMacro( Beta, RealType );
+
+  /** Relative residual at which the conjugate gradient stops. */
+  itkSetMacro( Tolerance, RealType );
+  itkGetConstMacro( Tolerance, RealType );
+
+  itkSetMacro( MaximumNumberOfIterations, unsigned int );
+  itkGetConstMacro( MaximumNumberOfIterations, unsigned int );
+
+  itkGetConstMacro( NumberOfIterations, unsigned int );
+
+protected:
+  RandomWalkerImageFilter() :
+    m_Beta( 90. ),
+    m_Tolerance( 1e-4 ),
+    m_MaximumNumberOfIterations( 5000 ),
+    m_NumberOfIterations( 0 )
+    {
+    this->SetNumberOfRequiredInputs( 2 );
+    }
+  ~RandomWalkerImageFilter() {}
+
+  RealType      m_Beta;
+  RealType      m_Tolerance;
+  unsigned int  m_MaximumNumberOfIterations;
+  unsigned int  m_NumberOfIterations;
+
+  /** State shared by the threaded passes. */
+  struct SystemType
+    {
+    const InputImageType*           Image;
+    const MetricType*               Metric;
+    InputImageRegionType            Region;
+    VertexOrderingType              Ordering;
+    OffsetContainerType             Offsets;
+    StencilType                     Stencil;
+
+    /** Row of each unseeded vertex, label slot of each seeded one. */
+    std::vector< MatrixIndexType >  Rows;
+    std::vector< MatrixIndexType >  RowVertices;
+    std::vector< unsigned int >     SeedLabels;
+    unsigned int                    NumberOfLabels;
+    unsigned int                    NumberOfSystems;
+
+    RealType                        Beta;
+    std::vector< RealType >         MaximumMetric;
+
+    MatrixType                      Matrix;
+    std::vector< RealType >         RightHandSides;
+
+    MatrixIndexType InvalidRow() const
+      {
+      return NumericTraits< MatrixIndexType >::max();
+      }
+
+    InputIndexType ComputeIndex( OffsetValueType iV ) const
+      {
+      return this->Ordering.ComputeIndex( iV );
+      }
+
+    /** Whether no offset of the stencil leads from iV into the region. */
+    bool IsIsolated( OffsetValueType iV ) const
+      {
+      const InputIndexType index = this->ComputeIndex( iV );
+      for( unsigned int k = 0; k < this->Stencil.GetNumberOfOffsets(); ++k )
+        {
+        if( this->Stencil.IsInside( index, k ) )
+          {
+          return false;
+          }
+        }
+      return true;
+      }
+
+    RealType Weight( RealType iMetric ) const
+      {
+      const RealType maximum = ( this->MaximumMetric[ 0 ] > 0. ) ? this->MaximumMetric[ 0 ] : 1.;
+      return std::exp( -this->Beta * iMetric / maximum ) + 1e-6;
+      }
+    };
+
+  /** First pass: largest metric value and length of each row. */
+  struct CountFunctor
+    {
+    SystemType* System;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType iThreadId )
+      {
+      SystemType& s = *System;
+      MatrixIndexType* rowPointers = &s.Matrix.GetRowPointers()[0];
+      RealType maximum = 0.;
+
+      for( SizeValueType r = iBegin; r < iEnd; ++r )
+        {
+        const OffsetValueType u = s.RowVertices[ r ];
+        const InputIndexType index = s.ComputeIndex( u );
+        MatrixIndexType length = 1;
+
+        const bool interior = s.Stencil.IsInterior( index );
+        for( unsigned int k = 0; k < s.Stencil.GetNumberOfOffsets(); ++k )
+          {
+          if( interior || s.Stencil.IsInside( index, k ) )
+            {
+            const InputIndexType neighIndex = index + s.Offsets[ k ];
+            const RealType m = EvaluateMetric< RealType >( *s.Metric, s.Image, index, neighIndex, k );
+            if( m > maximum )
+              {
+              maximum = m;
+              }
+            if( s.Rows[ u + s.Stencil.GetDelta( k ) ] != s.InvalidRow() )
+              {
+              ++length;
+              }
+            }
+          }
+        rowPointers[ r + 1 ] = length;
+        }
+      s.MaximumMetric[ iThreadId ] = maximum;
+      }
+    };
+
+  /** Second pass: entries of L_U (diagonal first) and of B. */
+  struct FillFunctor
+    {
+    SystemType* System;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      SystemType& s = *System;
+      const MatrixIndexType* rowPointers = &s.Matrix.GetRowPointers()[0];
+      MatrixIndexType* columns  = &s.Matrix.GetColumns()[0];
+      RealType*        values   = &s.Matrix.GetValues()[0];
+      const unsigned int m      = s.NumberOfSystems;
+
+      for( SizeValueType r = iBegin; r < iEnd; ++r )
+        {
+        const OffsetValueType u = s.RowVertices[ r ];
+        const InputIndexType index = s.ComputeIndex( u );
+        MatrixIndexType e = rowPointers[ r ];
+        const MatrixIndexType diagonal = e++;
+        RealType degree = 0.;
+
+        const bool interior = s.Stencil.IsInterior( index );
+        for( unsigned int k = 0; k < s.Stencil.GetNumberOfOffsets(); ++k )
+          {
+          if( interior || s.Stencil.IsInside( index, k ) )
+            {
+            const InputIndexType neighIndex = index + s.Offsets[ k ];
+            const OffsetValueType v = u + s.Stencil.GetDelta( k );
+            const RealType w = s.Weight(
+                  EvaluateMetric< RealType >( *s.Metric, s.Image, index, neighIndex, k ) );
+            degree += w;
+
+            if( s.Rows[ v ] != s.InvalidRow() )
+              {
+              columns[ e ] = s.Rows[ v ];
+              values[ e ] = -w;
+              ++e;
+              }
+            else if( s.SeedLabels[ v ] < m )
+              {
+              s.RightHandSides[ r * m + s.SeedLabels[ v ] ] += w;
+              }
+            }
+          }
+        columns[ diagonal ] = r;
+        values[ diagonal ] = degree;
+        }
+      }
+    };
+
+  /** Per-system dot product of two interleaved vector sets. */
+  struct DotFunctor
+    {
+    const RealType*           A;
+    const RealType*           B;
+    unsigned int              NumberOfSystems;
+    std::vector< RealType >*  Partials;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType iThreadId )
+      {
+      const unsigned int m = NumberOfSystems;
+      RealType* partial = &( *Partials )[ iThreadId * m ];
+
+      for( SizeValueType i = iBegin * m; i < iEnd * m; i += m )
+        {
+        for( unsigned int j = 0; j < m; ++j )
+          {
+          partial[ j ] += A[ i + j ] * B[ i + j ];
+          }
+        }
+      }
+    };
+
+  /** x += alpha p, r -= alpha q, z = D^-1 r, and the partial r.z and r.r */
+  struct UpdateFunctor
+    {
+    RealType*                 X;
+    RealType*                 R;
+    RealType*                 Z;
+    const RealType*           P;
+    const RealType*           Q;
+    const RealType*           InverseDiagonal;
+    const RealType*           Alpha;
+    unsigned int              NumberOfSystems;
+    std::vector< RealType >*  Partials;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType iThreadId )
+      {
+      const unsigned int m = NumberOfSystems;
+      RealType* rz = &( *Partials )[ 2 * iThreadId * m ];
+      RealType* rr = rz + m;
+
+      for( SizeValueType row = iBegin; row < iEnd; ++row )
+        {
+        const SizeValueType i = row * m;
+        for( unsigned int j = 0; j < m; ++j )
+          {
+          X[ i + j ] += Alpha[ j ] * P[ i + j ];
+          R[ i + j ] -= Alpha[ j ] * Q[ i + j ];
+          Z[ i + j ] = InverseDiagonal[ row ] * R[ i + j ];
+          rz[ j ] += R[ i + j ] * Z[ i + j ];
+          rr[ j ] += R[ i + j ] * R[ i + j ];
+          }
+        }
+      }
+    };
+
+  /** p = z + beta p */
+  struct DirectionFunctor
+    {
+    RealType*       P;
+    const RealType* Z;
+    const RealType* Beta;
+    unsigned int    NumberOfSystems;
+
+    void operator()( SizeValueType iBegin, SizeValueType iEnd, ThreadIdType )
+      {
+      const unsigned int m = NumberOfSystems;
+      for( SizeValueType i = iBegin * m; i < iEnd * m; i += m )
+        {
+        for( unsigned int j = 0; j < m; ++j )
+          {
+          P[ i + j ] = Z[ i + j ] + Beta[ j ] * P[ i + j ];
+          }
+        }
+      }
+    };
+
+  static void SumPartials( const std::vector< RealType >& iPartials,
+                           unsigned int iSize,
+                           std::vector< RealType >& oSum )
+    {
+    oSum.assign( iSize, 0. );
+    for( size_t i = 0; i < iPartials.size(); ++i )
+      {
+      oSum[ i % iSize ] += iPartials[ i ];
+      }
+    }
+
+  void GenerateData()
+    {
+    const InputImageType* input = this->GetInput();
+    const LabelImageType* seeds = this->GetSeedImage();
+    LabelImageType*       output = this->GetOutput();
+
+    output->SetBufferedRegion( output->GetRequestedRegion() );
+    output->Allocate();
+
+    const ThreadIdType numberOfThreads = this->GetNumberOfThreads();
+
+    SystemType s;
+    s.Image   = input;
+    s.Metric  = &this->m_Metric;
+    s.Region  = output->GetBufferedRegion();
+    s.Beta    = this->m_Beta;
+
+    // Symmetric stencil
+    StencilType::GenerateOffsets( this->m_OffsetList, s.Offsets, true );
+    InitializeMetric( this->m_Metric, input, s.Offsets );
+
+    s.Ordering.Initialize( s.Region );
+    s.Stencil.Initialize( s.Region, s.Offsets );
+
+    // Seeds and numbering of the unknowns
+    const SizeValueType numberOfVertices = s.Region.GetNumberOfPixels();
+
+    s.Rows.assign( numberOfVertices, s.InvalidRow() );
+    s.SeedLabels.assign( numberOfVertices, 0 );
+    s.RowVertices.reserve( numberOfVertices );
+
+    typedef std::map< LabelPixelType, unsigned int > LabelMapType;
+    LabelMapType labelSlots;
+    std::vector< LabelPixelType > labels;
+
+    ImageRegionConstIteratorWithIndex< LabelImageType > seedIt( seeds, s.Region );
+    MatrixIndexType v = 0;
+    for( seedIt.GoToBegin(); !seedIt.IsAtEnd(); ++seedIt, ++v )
+      {
+      const LabelPixelType label = seedIt.Get();
+      if( label == NumericTraits< LabelPixelType >::Zero )
+        {
+        s.Rows[ v ] = s.RowVertices.size();
+        s.RowVertices.push_back( v );
+        }
+      else
+        {
+        typename LabelMapType::iterator slot = labelSlots.find( label );
+        if( slot == labelSlots.end() )
+          {
+          slot = labelSlots.insert( std::make_pair( label, labels.size() ) ).first;
+          labels.push_back( label );
+          }
+        s.SeedLabels[ v ] = slot->second;
+        }
+      }
+
+    if( labels.empty() )
+      {
+      itkExceptionMacro( << "no seed" );
+      }
+
+    s.NumberOfLabels  = labels.size();
+    s.NumberOfSystems = s.NumberOfLabels - 1;
+
+    const MatrixIndexType numberOfRows = s.RowVertices.size();
+    const unsigned int    m = s.NumberOfSystems;
+
+    std::vector< RealType > x( numberOfRows * m, 0. );
+
+    if( m > 0 && numberOfRows > 0 )
+      {
+      this->AssembleSystem( s, numberOfThreads );
+      this->Solve( s, x, numberOfThreads );
+      }
+
+    // Most probable label
+    LabelPixelType* outputBuffer = output->GetBufferPointer();
+    for( SizeValueType u = 0; u < numberOfVertices; ++u )
+      {
+      const MatrixIndexType r = s.Rows[ u ];
+      if( r == s.InvalidRow() )
+        {
+        outputBuffer[ u ] = labels[ s.SeedLabels[ u ] ];
+        }
+      else if( s.IsIsolated( u ) )
+        {
+        // isolated pixel, reached by no seed
+        outputBuffer[ u ] = NumericTraits< LabelPixelType >::Zero;
+        }
+      else
+        {
+        RealType     last = 1.;
+        RealType     best = -1.;
+        unsigned int bestSlot = 0;
+        for( unsigned int j = 0; j < m; ++j )
+          {
+          last -= x[ r * m + j ];
+          if( x[ r * m + j ] > best )
+            {
+            best = x[ r * m + j ];
+            bestSlot = j;
+            }
+          }
+        if( last > best )
+          {
+          bestSlot = m;
+          }
+        outputBuffer[ u ] = labels[ bestSlot ];
+        }
+      }
+    }
+
+  void AssembleSystem( SystemType& s, ThreadIdType iNumberOfThreads )
+    {
+    const MatrixIndexType numberOfRows = s.RowVertices.size();
+
+    s.Matrix.SetSize( numberOfRows, numberOfRows );
+    s.MaximumMetric.assign( iNumberOfThreads, 0. );
+
+    CountFunctor count;
+    count.System = &s;
+    RangeThreader< CountFunctor >::Run( numberOfRows, iNumberOfThreads, count );
+
+    s.MaximumMetric[ 0 ] = *std::max_element( s.MaximumMetric.begin(), s.MaximumMetric.end() );
+
+    typename MatrixType::IndexContainerType& rowPointers = s.Matrix.GetRowPointers();
+    for( MatrixIndexType r = 0; r < numberOfRows; ++r )
+      {
+      rowPointers[ r + 1 ] += rowPointers[ r ];
+      }
+    s.Matrix.AllocateEntries();
+    s.RightHandSides.assign( numberOfRows * s.NumberOfSystems, 0. );
+
+    FillFunctor fill;
+    fill.System = &s;
+    RangeThreader< FillFunctor >::Run( numberOfRows, iNumberOfThreads, fill );
+    }
+
+  /** Jacobi-preconditioned conjugate gradient on all the systems at once. */
+  void Solve( const SystemType& s, std::vector< RealType >& x, ThreadIdType iNumberOfThreads )
+    {
+    const MatrixIndexType numberOfRows = s.RowVertices.size();
+    const unsigned int    m = s.NumberOfSystems;
+    const SizeValueType   n = numberOfRows * m;
+
+    std::vector< RealType > inverseDiagonal( numberOfRows );
+    for( MatrixIndexType r = 0; r < numberOfRows; ++r )
+      {
+      // the diagonal is the first entry of each row; it is zero only for a
+      // pixel without any neighbor in the region, whose row is left at zero
+      const RealType diagonal = s.Matrix.GetValues()[ s.Matrix.GetRowPointers()[ r ] ];
+      inverseDiagonal[ r ] = ( diagonal > 0. ) ? 1. / diagonal : 0.;
+      }
+
+    std::vector< RealType > r( s.RightHandSides );
+    std::vector< RealType > z( n ), p( n ), q( n );
+    for( SizeValueType i = 0; i < n; ++i )
+      {
+      z[ i ] = inverseDiagonal[ i / m ] * r[ i ];
+      p[ i ] = z[ i ];
+      }
+
+    std::vector< RealType > partials;
+    std::vector< RealType > rz, rr, bb, pq, alpha( m ), beta( m ), sums;
+
+    DotFunctor dot;
+    dot.NumberOfSystems = m;
+    dot.Partials        = &partials;
+
+    partials.assign( iNumberOfThreads * m, 0. );
+    dot.A = &r[0];
+    dot.B = &z[0];
+    RangeThreader< DotFunctor >::Run( numberOfRows, iNumberOfThreads, dot );
+    SumPartials( partials, m, rz );
+
+    partials.assign( iNumberOfThreads * m, 0. );
+    dot.A = &r[0];
+    dot.B = &r[0];
+    RangeThreader< DotFunctor >::Run( numberOfRows, iNumberOfThreads, dot );
+    SumPartials( partials, m, bb );
+
+    const RealType tolerance2 = this->m_Tolerance * this->m_Tolerance;
+
+    UpdateFunctor update;
+    update.X                = &x[0];
+    update.R                = &r[0];
+    update.Z                = &z[0];
+    update.P                = &p[0];
+    update.Q                = &q[0];
+    update.InverseDiagonal  = &inverseDiagonal[0];
+    update.Alpha            = &alpha[0];
+    update.NumberOfSystems  = m;
+    update.Partials         = &partials;
+
+    DirectionFunctor direction;
+    direction.P               = &p[0];
+    direction.Z               = &z[0];
+    direction.Beta            = &beta[0];
+    direction.NumberOfSystems = m;
+
+    rr = bb;
+    this->m_NumberOfIterations = 0;
+
+    while( this->m_NumberOfIterations < this->m_MaximumNumberOfIterations )
+      {
+      bool converged = true;
+      for( unsigned int j = 0; j < m; ++j )
+        {
+        converged = converged && ( rr[ j ] <= tolerance2 * bb[ j ] );
+        }
+      if( converged )
+        {
+        break;
+        }
+
+      if( this->GetAbortGenerateData() )
+        {
+        ProcessAborted e( __FILE__, __LINE__ );
+        e.SetDescription( "Process aborted." );
+        throw e;
+        }
+
+      s.Matrix.Multiply( &p[0], &q[0], m, iNumberOfThreads );
+
+      partials.assign( iNumberOfThreads * m, 0. );
+      dot.A = &p[0];
+      dot.B = &q[0];
+      RangeThreader< DotFunctor >::Run( numberOfRows, iNumberOfThreads, dot );
+      SumPartials( partials, m, pq );
+
+      for( unsigned int j = 0; j < m; ++j )
+        {
+        alpha[ j ] = ( pq[ j ] > 0. ) ? rz[ j ] / pq[ j ] : 0.;
+        }
+
+      partials.assign( 2 * iNumberOfThreads * m, 0. );
+      RangeThreader< UpdateFunctor >::Run( numberOfRows, iNumberOfThreads, update );
+      SumPartials( partials, 2 * m, sums );
+
+      for( unsigned int j = 0; j < m; ++j )
+        {
+        beta[ j ] = ( rz[ j ] > 0. ) ? sums[ j ] / rz[ j ] : 0.;
+        rz[ j ] = sums[ j ];
+        rr[ j ] = sums[ m + j ];
+        }
+
+      RangeThreader< DirectionFunctor >::Run( numberOfRows, iNumberOfThreads, direction );
+
+      ++this->m_NumberOfIterations;
+      this->UpdateProgress( static_cast< float >( this->m_NumberOfIterations ) /
+                            static_cast< float >( this->m_MaximumNumberOfIterations ) );
+      }
+    }
+
+  void PrintSelf( std::ostream& os, Indent indent ) const
+    {
+    Superclass::PrintSelf( os, indent );
+    os << indent << "Beta: " << this->m_Beta << std::endl;
+    os << indent << "Tolerance: " << this->m_Tolerance << std::endl;
+    os << indent << "MaximumNumberOfIterations: " << this->m_MaximumNumberOfIterations << std::endl;
+    os << indent << "NumberOfIterations: " << this->m_NumberOfIterations << std::endl;
+    }
+
+private:
+  RandomWalkerImageFilter( const Self& );
+  void operator = ( const Self& );
+};
+
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef __itkRangeThreader_h
+#define __itkRangeThreader_h
+
+#include <algorithm>
+
+#include "itkMultiThreader.h"
+
+namespace itk
+{
+/** \class RangeThreader
+ *  \brief Split [0, n) into one contiguous chunk per thread.
+ *
+ *  TFunctor is called as iFunctor( begin, end, threadId ) from each thread
+ *  of a MultiThreader. Reductions are done by the functor into per-thread
+ *  slots, which must be sized for the requested number of threads: the
+ *  threader may use fewer of them.
+ *
+ *  Chunk i goes to thread i and the split only depends on the size and the
+ *  number of threads, so that two passes over the same range see the same
+ *  chunks (e.g. count, then write from per-chunk offsets).
+ */
+template< class TFunctor >
+class RangeThreader
+  {
+public:
+  static void Run( SizeValueType iSize,
+                   ThreadIdType iNumberOfThreads,
+                   TFunctor& iFunctor )
+    {
+    if( iSize == 0 )
+      {
+      return;
+      }
+
+    ThreadIdType numberOfThreads = std::max( iNumberOfThreads, static_cast< ThreadIdType >( 1 ) );
+    if( iSize < numberOfThreads )
+      {
+      numberOfThreads = static_cast< ThreadIdType >( iSize );
+      }
+
+    if( numberOfThreads == 1 )
+      {
+      iFunctor( 0, iSize, 0 );
+      return;
+      }
+
+    ThreadStruct str;
+    str.Functor = &iFunctor;
+    str.Size    = iSize;
+
+    MultiThreader::Pointer threader = MultiThreader::New();
+    threader->SetNumberOfThreads( numberOfThreads );
+    threader->SetSingleMethod( ThreaderCallback, &str );
+    threader->SingleMethodExecute();
+    }
+
+private:
+  struct ThreadStruct
+    {
+    TFunctor*     Functor;
+    SizeValueType Size;
+    };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void* arg )
+    {
+    MultiThreader::ThreadInfoStruct* info = static_cast< MultiThreader::ThreadInfoStruct* >( arg );
+    ThreadStruct* str = static_cast< ThreadStruct* >( info->UserData );
+
+    const SizeValueType numberOfThreads = info->NumberOfThreads;
+    const SizeValueType chunk = ( str->Size + numberOfThreads - 1 ) / numberOfThreads;
+    const SizeValueType begin = std::min( info->ThreadID * chunk, str->Size );
+    const SizeValueType end   = std::min( begin + chunk, str->Size );
+
+    if( begin < end )
+      {
+      ( *str->Functor )( begin, end, info->ThreadID );
+      }
+
+    return ITK_THREAD_RETURN_VALUE;
+    }
+};
+
+}
+
+#endif
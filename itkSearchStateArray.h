@@ -0,0 +1,95 @@
+#ifndef __itkSearchStateArray_h
+#define __itkSearchStateArray_h
+
+#include <algorithm>
+#include <vector>
+
+#include "itkIntTypes.h"
+#include "itkNumericTraits.h"
+
+namespace itk
+{
+/** \class SearchStateArray
+ *  \brief Reached and settled flags of the vertices of repeated graph
+ *  searches, cleared in constant time.
+ *
+ *  The state of a vertex is 2 * generation + 1 once it is reached and
+ *  2 * generation + 2 once it is settled, where the generation is the number
+ *  of the current search; any other value means the vertex has not been
+ *  reached by the current search, whatever was stored for it by the previous
+ *  ones. Restart() only increments the generation, and clears the states when
+ *  the number of vertices changes or the counter would wrap around.
+ */
+class SearchStateArray
+  {
+public:
+  typedef unsigned int  StateType;
+
+  SearchStateArray() : m_Generation( 0 ), m_Reached( 1 ), m_Settled( 2 ) {}
+
+  SizeValueType GetNumberOfVertices() const
+    {
+    return this->m_States.size();
+    }
+
+  /** Start a new search over iNumberOfVertices vertices, none reached. */
+  void Restart( SizeValueType iNumberOfVertices )
+    {
+    if( this->m_States.size() != iNumberOfVertices )
+      {
+      this->m_States.assign( iNumberOfVertices, 0 );
+      this->m_Generation = 0;
+      }
+    else
+      {
+      ++this->m_Generation;
+
+      // the states would be ambiguous once the counter wraps around
+      if( this->m_Generation >= NumericTraits< StateType >::max() / 2 )
+        {
+        std::fill( this->m_States.begin(), this->m_States.end(), 0 );
+        this->m_Generation = 0;
+        }
+      }
+
+    this->m_Reached = 2 * this->m_Generation + 1;
+    this->m_Settled = 2 * this->m_Generation + 2;
+    }
+
+  /** Reached by the current search, and not settled since. */
+  bool IsReached( SizeValueType iVertex ) const
+    {
+    return this->m_States[ iVertex ] == this->m_Reached;
+    }
+
+  bool IsSettled( SizeValueType iVertex ) const
+    {
+    return this->m_States[ iVertex ] == this->m_Settled;
+    }
+
+  /** Reached or settled by the current search. */
+  bool IsVisited( SizeValueType iVertex ) const
+    {
+    return this->IsReached( iVertex ) || this->IsSettled( iVertex );
+    }
+
+  void SetReached( SizeValueType iVertex )
+    {
+    this->m_States[ iVertex ] = this->m_Reached;
+    }
+
+  void SetSettled( SizeValueType iVertex )
+    {
+    this->m_States[ iVertex ] = this->m_Settled;
+    }
+
+protected:
+  std::vector< StateType >  m_States;
+  StateType                 m_Generation;
+  StateType                 m_Reached;
+  StateType                 m_Settled;
+};
+
+}
+
+#endif